@@ -11,30 +11,45 @@
 #include "host/ble_hs.h"
 #include "nimble/nimble_port.h"
 #include "nimble/nimble_port_freertos.h"
+#include "nimble/nimble_npl.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "ble_devices.h"
+#include "bthome.h"
+#include "ble_gatt.h"
 
 #define BLE_TAG "BLE_DRIVER"
 #define APPLE_MANUFACTURER_ID 0x004C
 
-#define BLE_MAX_DEVICES 8
-#define BLE_NAME_MAX 32
+// Coalesce table changes into at most one snapshot publish per interval
+#define BLE_PUBLISH_INTERVAL_MS 250
+
+// Sensor broadcast (extended advertising, non-connectable)
+#define BLE_ADV_INSTANCE        0
+#define BLE_ADV_ITVL_MS         1000
 
-typedef struct {
-    bool used;
-    uint8_t addr[6];
-    char name[BLE_NAME_MAX];
-    int8_t rssi;
-} ble_device_t;
+// Connectable set that lets a phone reach the GATT service
+#define BLE_GATT_ADV_INSTANCE   1
+#define BLE_GATT_ADV_ITVL_MS    500
 
-static ble_device_t s_devices[BLE_MAX_DEVICES];
-static int s_device_count = 0;
-static bool s_devices_dirty = false;
+static struct ble_npl_callout s_publish_callout;
+static uint32_t s_ui_generation = 0;
 static bool s_scanning = false;
 
 static uint8_t own_addr_type;
 static bool is_connecting = false;
+static bool s_have_reading = false;
+
+// Latest sample from the sampler task; s_reading_event hands it to the host task
+static portMUX_TYPE s_reading_mux = portMUX_INITIALIZER_UNLOCKED;
+static bthome_reading_t s_pending_reading = { .battery_pct = -1 };
+static struct ble_npl_event s_reading_event;
+static bool s_host_ready = false;
 
 static int ble_gap_event(struct ble_gap_event *event, void *arg);
 static void ble_start_scan(void);
+static esp_err_t start_gatt_advertising(void);
 
 static void addr_to_str(const uint8_t* addr, char* out, size_t out_sz)
 {
@@ -42,48 +57,29 @@ static void addr_to_str(const uint8_t* addr, char* out, size_t out_sz)
              addr[5], addr[4], addr[3], addr[2], addr[1], addr[0]);
 }
 
-static int find_device_index(const uint8_t* addr)
+static void upsert_device(const uint8_t* addr, const char* name, int8_t rssi)
 {
-    for (int i = 0; i < BLE_MAX_DEVICES; i++) {
-        if (s_devices[i].used && memcmp(s_devices[i].addr, addr, 6) == 0) {
-            return i;
-        }
+    uint32_t now_ms = (uint32_t)pdTICKS_TO_MS(xTaskGetTickCount());
+    if (ble_devices_upsert(addr, name, rssi, now_ms) && !ble_npl_callout_is_active(&s_publish_callout)) {
+        ble_npl_callout_reset(&s_publish_callout, ble_npl_time_ms_to_ticks32(BLE_PUBLISH_INTERVAL_MS));
     }
-    return -1;
 }
 
-static void upsert_device(const uint8_t* addr, const char* name, int8_t rssi)
+// Runs on the host task, same as upsert_device, so the table has a single writer
+static void publish_devices_cb(struct ble_npl_event *ev)
 {
-    int idx = find_device_index(addr);
-    if (idx < 0) {
-        for (int i = 0; i < BLE_MAX_DEVICES; i++) {
-            if (!s_devices[i].used) {
-                idx = i;
-                s_devices[i].used = true;
-                memcpy(s_devices[i].addr, addr, 6);
-                s_device_count++;
-                break;
-            }
-        }
-    }
+    ble_devices_publish();
+}
 
-    if (idx >= 0) {
-        bool changed = false;
-        if (name && name[0] != '\0' && strncmp(s_devices[idx].name, name, BLE_NAME_MAX) != 0) {
-            strlcpy(s_devices[idx].name, name, BLE_NAME_MAX);
-            changed = true;
-        } else if (!s_devices[idx].name[0] && name && name[0]) {
-            strlcpy(s_devices[idx].name, name, BLE_NAME_MAX);
-            changed = true;
-        }
-        if (s_devices[idx].rssi != rssi) {
-            s_devices[idx].rssi = rssi;
-            changed = true;
-        }
-        if (changed) {
-            s_devices_dirty = true;
-        }
-    }
+// Advertising and GATT state is only touched on the host task
+static void reading_event_cb(struct ble_npl_event *ev)
+{
+    portENTER_CRITICAL(&s_reading_mux);
+    bthome_reading_t r = s_pending_reading;
+    portEXIT_CRITICAL(&s_reading_mux);
+
+    ble_adv_update_reading(r.temp_centi_c, r.hum_centi_pct, r.battery_pct);
+    ble_gatt_update_reading(r.temp_centi_c, r.hum_centi_pct);
 }
 
 static void ble_on_sync(void)
@@ -95,6 +91,12 @@ static void ble_on_sync(void)
     }
 
     ble_start_scan();
+    start_gatt_advertising();
+
+    // Only broadcast once there is something worth reading
+    if (s_have_reading) {
+        start_ble5_advertising();
+    }
 }
 
 static void ble_start_scan(void)
@@ -134,55 +136,67 @@ static void ble_log_adv_fields(const struct ble_hs_adv_fields *fields)
     }
 }
 
-static int ble_gap_event(struct ble_gap_event *event, void *arg)
+// Shared by legacy (DISC) and extended (EXT_DISC) scan reports
+static void on_adv_report(const ble_addr_t* addr, int8_t rssi, const uint8_t* data, uint8_t len)
 {
-    switch (event->type) {
-    case BLE_GAP_EVENT_DISC: {
-        struct ble_hs_adv_fields fields;
-        memset(&fields, 0, sizeof(fields));
+    struct ble_hs_adv_fields fields;
+    memset(&fields, 0, sizeof(fields));
 
-        int rc = ble_hs_adv_parse_fields(&fields, event->disc.data, event->disc.length_data);
-        if (rc != 0) {
-            return 0;
-        }
+    if (ble_hs_adv_parse_fields(&fields, data, len) != 0) {
+        return;
+    }
 
-        char name[BLE_NAME_MAX] = {0};
-        if (fields.name != NULL && fields.name_len > 0) {
-            int n = fields.name_len;
-            if (n >= BLE_NAME_MAX) n = BLE_NAME_MAX - 1;
-            memcpy(name, fields.name, n);
-            name[n] = '\0';
-        }
+    char name[BLE_NAME_MAX] = {0};
+    if (fields.name != NULL && fields.name_len > 0) {
+        int n = fields.name_len;
+        if (n >= BLE_NAME_MAX) n = BLE_NAME_MAX - 1;
+        memcpy(name, fields.name, n);
+        name[n] = '\0';
+    }
 
-        if (!name[0]) {
-            addr_to_str(event->disc.addr.val, name, sizeof(name));
-        }
+    if (!name[0]) {
+        addr_to_str(addr->val, name, sizeof(name));
+    }
 
-        upsert_device(event->disc.addr.val, name, (int8_t)event->disc.rssi);
+    upsert_device(addr->val, name, rssi);
 
-        bool is_apple_device = false;
-        if (fields.mfg_data != NULL && fields.mfg_data_len >= 2) {
-            uint16_t manufacturer_id = (fields.mfg_data[1] << 8) | fields.mfg_data[0];
-            if (manufacturer_id == APPLE_MANUFACTURER_ID) {
-                is_apple_device = true;
-                ESP_LOGI(BLE_TAG, "Apple device found, RSSI %d", event->disc.rssi);
-                ble_log_adv_fields(&fields);
-            }
+    bool is_apple_device = false;
+    if (fields.mfg_data != NULL && fields.mfg_data_len >= 2) {
+        uint16_t manufacturer_id = (fields.mfg_data[1] << 8) | fields.mfg_data[0];
+        if (manufacturer_id == APPLE_MANUFACTURER_ID) {
+            is_apple_device = true;
+            ESP_LOGI(BLE_TAG, "Apple device found, RSSI %d", rssi);
+            ble_log_adv_fields(&fields);
         }
+    }
 
-        if (!is_connecting && is_apple_device) {
-            is_connecting = true;
-            ble_gap_disc_cancel();
+    if (!is_connecting && is_apple_device) {
+        is_connecting = true;
+        ble_gap_disc_cancel();
 
-            int conn_rc = ble_gap_connect(own_addr_type, &event->disc.addr, 30000, NULL, ble_gap_event, NULL);
-            if (conn_rc != 0) {
-                ESP_LOGE(BLE_TAG, "ble_gap_connect failed: %d", conn_rc);
-                is_connecting = false;
-                ble_start_scan();
-            }
+        int conn_rc = ble_gap_connect(own_addr_type, addr, 30000, NULL, ble_gap_event, NULL);
+        if (conn_rc != 0) {
+            ESP_LOGE(BLE_TAG, "ble_gap_connect failed: %d", conn_rc);
+            is_connecting = false;
+            ble_start_scan();
         }
-        return 0;
     }
+}
+
+static int ble_gap_event(struct ble_gap_event *event, void *arg)
+{
+    switch (event->type) {
+    case BLE_GAP_EVENT_DISC:
+        on_adv_report(&event->disc.addr, (int8_t)event->disc.rssi,
+                      event->disc.data, event->disc.length_data);
+        return 0;
+#if CONFIG_BT_NIMBLE_EXT_ADV
+    // With extended advertising enabled the host reports every scan result here
+    case BLE_GAP_EVENT_EXT_DISC:
+        on_adv_report(&event->ext_disc.addr, event->ext_disc.rssi,
+                      event->ext_disc.data, event->ext_disc.length_data);
+        return 0;
+#endif
     case BLE_GAP_EVENT_CONNECT:
         s_scanning = false;
         if (event->connect.status == 0) {
@@ -227,10 +241,15 @@ void ble_init(void)
 
     nimble_port_init();
 
+    ble_npl_callout_init(&s_publish_callout, nimble_port_get_dflt_eventq(), publish_devices_cb, NULL);
+    ble_npl_event_init(&s_reading_event, reading_event_cb, NULL);
+    s_host_ready = true;
+
     ble_hs_cfg.sync_cb = ble_on_sync;
 
     ble_svc_gap_init();
     ble_svc_gatt_init();
+    ble_gatt_init();
     ble_svc_gap_device_name_set("ESP32-Mobile");
 
     nimble_port_freertos_init(ble_host_task);
@@ -238,6 +257,205 @@ void ble_init(void)
     ESP_LOGI(BLE_TAG, "NimBLE initialized");
 }
 
+#if CONFIG_BT_NIMBLE_EXT_ADV
+#if CONFIG_BT_NIMBLE_MAX_EXT_ADV_INSTANCES < 2
+#error "BTHome and GATT use separate advertising sets; set CONFIG_BT_NIMBLE_MAX_EXT_ADV_INSTANCES >= 2"
+#endif
+
+static bthome_reading_t s_adv_reading = { .battery_pct = -1 };
+static bool s_adv_configured = false;
+static bool s_adv_active = false;
+static bool s_gatt_adv_configured = false;
+static bool s_gatt_adv_active = false;
+
+// Events for the connectable set. The BTHome set never connects, so it keeps
+// broadcasting while a central is attached.
+static int ble_periph_gap_event(struct ble_gap_event *event, void *arg)
+{
+    ble_gatt_on_gap_event(event);
+
+    switch (event->type) {
+    case BLE_GAP_EVENT_ADV_COMPLETE:
+        // The set stops on its own once a central connects
+        s_gatt_adv_active = false;
+        return 0;
+    case BLE_GAP_EVENT_CONNECT:
+        s_gatt_adv_active = false;
+        if (event->connect.status == 0) {
+            ESP_LOGI(BLE_TAG, "Central connected");
+        } else {
+            start_gatt_advertising();
+        }
+        return 0;
+    case BLE_GAP_EVENT_DISCONNECT:
+        ESP_LOGI(BLE_TAG, "Central disconnected, reason=%d", event->disconnect.reason);
+        start_gatt_advertising();
+        return 0;
+    default:
+        return 0;
+    }
+}
+
+static esp_err_t ble_adv_push_data(void)
+{
+    uint8_t buf[BTHOME_ADV_MAX];
+    size_t len = bthome_encode_adv(&s_adv_reading, buf, sizeof(buf));
+    if (len == 0) return ESP_ERR_INVALID_SIZE;
+
+    struct os_mbuf *om = os_msys_get_pkthdr(len, 0);
+    if (!om) return ESP_ERR_NO_MEM;
+    if (os_mbuf_append(om, buf, len) != 0) {
+        os_mbuf_free_chain(om);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Takes ownership of om. A single-fragment payload may be replaced while
+    // the set is enabled, so there is no need to stop advertising.
+    int rc = ble_gap_ext_adv_set_data(BLE_ADV_INSTANCE, om);
+    if (rc != 0) {
+        ESP_LOGE(BLE_TAG, "ble_gap_ext_adv_set_data failed: %d", rc);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t configure_ble5_advertising(void)
+{
+    if (s_adv_configured) return ESP_OK;
+
+    struct ble_gap_ext_adv_params params;
+    memset(&params, 0, sizeof(params));
+    params.connectable = 0;
+    params.scannable = 0;
+    params.legacy_pdu = 0;
+    params.own_addr_type = own_addr_type;
+    params.primary_phy = BLE_HCI_LE_PHY_1M;
+    params.secondary_phy = BLE_HCI_LE_PHY_1M;
+    params.tx_power = 127; // no preference
+    params.sid = BLE_ADV_INSTANCE;
+    params.itvl_min = BLE_GAP_ADV_ITVL_MS(BLE_ADV_ITVL_MS);
+    params.itvl_max = BLE_GAP_ADV_ITVL_MS(BLE_ADV_ITVL_MS);
+
+    int rc = ble_gap_ext_adv_configure(BLE_ADV_INSTANCE, &params, NULL, NULL, NULL);
+    if (rc != 0) {
+        ESP_LOGE(BLE_TAG, "ble_gap_ext_adv_configure failed: %d", rc);
+        return ESP_FAIL;
+    }
+
+    s_adv_configured = true;
+    return ESP_OK;
+}
+
+esp_err_t start_ble5_advertising(void)
+{
+    if (!s_adv_configured) {
+        esp_err_t err = configure_ble5_advertising();
+        if (err != ESP_OK) return err;
+    }
+
+    if (s_adv_active) return ESP_OK;
+
+    esp_err_t err = ble_adv_push_data();
+    if (err != ESP_OK) return err;
+
+    int rc = ble_gap_ext_adv_start(BLE_ADV_INSTANCE, 0, 0);
+    if (rc != 0) {
+        ESP_LOGE(BLE_TAG, "ble_gap_ext_adv_start failed: %d", rc);
+        return ESP_FAIL;
+    }
+
+    s_adv_active = true;
+    ESP_LOGI(BLE_TAG, "Sensor advertising started");
+    return ESP_OK;
+}
+
+// Legacy ADV_IND so any phone can find and connect to the GATT service
+static esp_err_t configure_gatt_advertising(void)
+{
+    if (s_gatt_adv_configured) return ESP_OK;
+
+    struct ble_gap_ext_adv_params params;
+    memset(&params, 0, sizeof(params));
+    params.connectable = 1;
+    params.scannable = 1;
+    params.legacy_pdu = 1;
+    params.own_addr_type = own_addr_type;
+    params.primary_phy = BLE_HCI_LE_PHY_1M;
+    params.secondary_phy = BLE_HCI_LE_PHY_1M;
+    params.tx_power = 127;
+    params.sid = BLE_GATT_ADV_INSTANCE;
+    params.itvl_min = BLE_GAP_ADV_ITVL_MS(BLE_GATT_ADV_ITVL_MS);
+    params.itvl_max = BLE_GAP_ADV_ITVL_MS(BLE_GATT_ADV_ITVL_MS);
+
+    int rc = ble_gap_ext_adv_configure(BLE_GATT_ADV_INSTANCE, &params, NULL, ble_periph_gap_event, NULL);
+    if (rc != 0) {
+        ESP_LOGE(BLE_TAG, "ble_gap_ext_adv_configure (GATT) failed: %d", rc);
+        return ESP_FAIL;
+    }
+
+    struct ble_hs_adv_fields fields;
+    memset(&fields, 0, sizeof(fields));
+    static const ble_uuid16_t ess_uuid = BLE_UUID16_INIT(ESS_SVC_UUID);
+    const char *name = ble_svc_gap_device_name();
+    fields.flags = BLE_HS_ADV_F_DISC_GEN | BLE_HS_ADV_F_BREDR_UNSUP;
+    fields.uuids16 = &ess_uuid;
+    fields.num_uuids16 = 1;
+    fields.uuids16_is_complete = 1;
+    fields.name = (const uint8_t *)name;
+    fields.name_len = strlen(name);
+    fields.name_is_complete = 1;
+
+    struct os_mbuf *om = os_msys_get_pkthdr(BLE_HS_ADV_MAX_SZ, 0);
+    if (!om) return ESP_ERR_NO_MEM;
+    rc = ble_hs_adv_set_fields_mbuf(&fields, om);
+    if (rc != 0) {
+        os_mbuf_free_chain(om);
+        ESP_LOGE(BLE_TAG, "ble_hs_adv_set_fields_mbuf failed: %d", rc);
+        return ESP_FAIL;
+    }
+    rc = ble_gap_ext_adv_set_data(BLE_GATT_ADV_INSTANCE, om);
+    if (rc != 0) {
+        ESP_LOGE(BLE_TAG, "ble_gap_ext_adv_set_data (GATT) failed: %d", rc);
+        return ESP_FAIL;
+    }
+
+    s_gatt_adv_configured = true;
+    return ESP_OK;
+}
+
+static esp_err_t start_gatt_advertising(void)
+{
+    esp_err_t err = configure_gatt_advertising();
+    if (err != ESP_OK) return err;
+
+    if (s_gatt_adv_active) return ESP_OK;
+
+    int rc = ble_gap_ext_adv_start(BLE_GATT_ADV_INSTANCE, 0, 0);
+    if (rc != 0) {
+        ESP_LOGE(BLE_TAG, "ble_gap_ext_adv_start (GATT) failed: %d", rc);
+        return ESP_FAIL;
+    }
+
+    s_gatt_adv_active = true;
+    ESP_LOGI(BLE_TAG, "GATT advertising started");
+    return ESP_OK;
+}
+
+esp_err_t ble_adv_update_reading(int16_t temp_centi_c, uint16_t hum_centi_pct, int8_t battery_pct)
+{
+    s_adv_reading.temp_centi_c = temp_centi_c;
+    s_adv_reading.hum_centi_pct = hum_centi_pct;
+    s_adv_reading.battery_pct = battery_pct;
+    s_adv_reading.packet_id++;
+    s_have_reading = true;
+
+    if (!s_adv_active) {
+        // Before host sync ble_on_sync starts it with this reading
+        return ble_hs_synced() ? start_ble5_advertising() : ESP_OK;
+    }
+    return ble_adv_push_data();
+}
+#else
 esp_err_t configure_ble5_advertising(void)
 {
     return ESP_ERR_NOT_SUPPORTED;
@@ -248,6 +466,31 @@ esp_err_t start_ble5_advertising(void)
     return ESP_ERR_NOT_SUPPORTED;
 }
 
+static esp_err_t start_gatt_advertising(void)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t ble_adv_update_reading(int16_t temp_centi_c, uint16_t hum_centi_pct, int8_t battery_pct)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+#endif
+
+void ble_update_reading(int16_t temp_centi_c, uint16_t hum_centi_pct, int8_t battery_pct)
+{
+    if (!s_host_ready) return;
+
+    portENTER_CRITICAL(&s_reading_mux);
+    s_pending_reading.temp_centi_c = temp_centi_c;
+    s_pending_reading.hum_centi_pct = hum_centi_pct;
+    s_pending_reading.battery_pct = battery_pct;
+    portEXIT_CRITICAL(&s_reading_mux);
+
+    // An event still in the queue is not queued twice; it picks up the newest values
+    ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &s_reading_event);
+}
+
 void ble_scan_start(void)
 {
     ble_start_scan();
@@ -255,25 +498,27 @@ void ble_scan_start(void)
 
 bool ble_devices_take_dirty(void)
 {
-    bool dirty = s_devices_dirty;
-    s_devices_dirty = false;
+    uint32_t gen = ble_devices_generation();
+    bool dirty = (gen != s_ui_generation);
+    s_ui_generation = gen;
     return dirty;
 }
 
-void ble_get_devices_text(char* out, size_t out_sz)
+void ble_get_devices_text(fmt_t* f)
 {
-    if (!out || out_sz == 0) return;
-
-    if (s_device_count == 0) {
-        snprintf(out, out_sz, "Scanning...");
+    static ble_devices_snapshot_t snap; // UI task only; keeps it off the stack
+    if (!ble_devices_read_snapshot(&snap) || snap.total == 0) {
+        fmt_str(f, "Scanning...");
         return;
     }
 
-    int pos = snprintf(out, out_sz, "Found: %d\n", s_device_count);
-    for (int i = 0; i < BLE_MAX_DEVICES && pos < (int)out_sz - 1; i++) {
-        if (!s_devices[i].used) continue;
-        pos += snprintf(out + pos, out_sz - (size_t)pos, "%s (%ddBm)\n",
-                        s_devices[i].name[0] ? s_devices[i].name : "Unknown",
-                        s_devices[i].rssi);
+    fmt_str(f, "Found: ");
+    fmt_uint(f, snap.total);
+    fmt_char(f, '\n');
+    for (int i = 0; i < snap.count && !f->truncated; i++) {
+        fmt_str(f, snap.devices[i].name[0] ? snap.devices[i].name : "Unknown");
+        fmt_str(f, " (");
+        fmt_int(f, snap.devices[i].rssi);
+        fmt_str(f, "dBm)\n");
     }
 }
\ No newline at end of file
@@ -10,13 +10,22 @@
 #include "services/gatt/ble_svc_gatt.h"
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+
+#include "fmt.h"
 
 void ble_init(void);
 void ble_scan_start(void);
 bool ble_devices_take_dirty(void);
-void ble_get_devices_text(char* out, size_t out_sz);
+void ble_get_devices_text(fmt_t* f);
 
 esp_err_t configure_ble5_advertising(void);
 esp_err_t start_ble5_advertising(void);
+// Refresh the broadcast payload in place. battery_pct < 0 means unknown.
+// NimBLE host task only; other tasks go through ble_update_reading.
+esp_err_t ble_adv_update_reading(int16_t temp_centi_c, uint16_t hum_centi_pct, int8_t battery_pct);
+// New sample for both the broadcast payload and the GATT characteristics.
+// Safe from any task: the update is posted to the NimBLE host task.
+void ble_update_reading(int16_t temp_centi_c, uint16_t hum_centi_pct, int8_t battery_pct);
 
 #endif /* BLE */
@@ -0,0 +1,201 @@
+#include "ble_devices.h"
+#include <stdatomic.h>
+#include <string.h>
+
+// Open-addressing (linear probing) index over a fixed entry pool. The index only
+// holds entry numbers, so backward-shift deletion never moves an entry and the LRU
+// links stay valid. Every advertising report costs one hash, a short probe and a
+// constant-time LRU splice.
+//
+// The UI never touches the table. The host task publishes a small sorted snapshot
+// into one of two buffers guarded by a sequence counter: odd while the back buffer
+// is being written, and the front buffer is (seq >> 1) & 1. Readers copy the front
+// and retry only if the writer came back around to that same buffer mid-copy.
+
+#define BLE_INDEX_SIZE (BLE_DEVICES_MAX * 2)
+#define BLE_INDEX_MASK (BLE_INDEX_SIZE - 1)
+#define BLE_NIL        0xFFFF
+
+_Static_assert((BLE_DEVICES_MAX & (BLE_DEVICES_MAX - 1)) == 0, "BLE_DEVICES_MAX must be a power of two");
+_Static_assert(BLE_DEVICES_MAX < BLE_NIL, "BLE_DEVICES_MAX too large");
+
+static ble_device_t s_entries[BLE_DEVICES_MAX];
+static uint16_t s_index[BLE_INDEX_SIZE];
+static uint16_t s_count = 0;
+static uint16_t s_lru_head = BLE_NIL; // most recently seen
+static uint16_t s_lru_tail = BLE_NIL; // eviction candidate
+
+static ble_devices_snapshot_t s_snap[2];
+static atomic_uint s_snap_seq = 0;
+
+#define BLE_SNAPSHOT_READ_RETRIES 8
+
+static uint32_t addr_hash(const uint8_t* a)
+{
+    uint32_t lo = (uint32_t)a[0] | ((uint32_t)a[1] << 8) | ((uint32_t)a[2] << 16) | ((uint32_t)a[3] << 24);
+    uint32_t hi = (uint32_t)a[4] | ((uint32_t)a[5] << 8);
+    uint32_t h = (lo ^ (hi * 0x9E3779B1u)) * 0x85EBCA6Bu;
+    return h ^ (h >> 16);
+}
+
+// Returns the index slot holding `addr`, or the empty slot where it would go.
+static uint32_t index_probe(const uint8_t* addr)
+{
+    uint32_t slot = addr_hash(addr) & BLE_INDEX_MASK;
+    while (s_index[slot] != BLE_NIL && memcmp(s_entries[s_index[slot]].addr, addr, 6) != 0) {
+        slot = (slot + 1) & BLE_INDEX_MASK;
+    }
+    return slot;
+}
+
+static void index_remove(uint32_t hole)
+{
+    uint32_t j = hole;
+    for (;;) {
+        j = (j + 1) & BLE_INDEX_MASK;
+        if (s_index[j] == BLE_NIL) break;
+
+        uint32_t home = addr_hash(s_entries[s_index[j]].addr) & BLE_INDEX_MASK;
+        // Leave the entry alone if its home lies cyclically in (hole, j]
+        bool stays = (hole <= j) ? (home > hole && home <= j) : (home > hole || home <= j);
+        if (!stays) {
+            s_index[hole] = s_index[j];
+            hole = j;
+        }
+    }
+    s_index[hole] = BLE_NIL;
+}
+
+static void lru_unlink(uint16_t e)
+{
+    ble_device_t* d = &s_entries[e];
+    if (d->lru_prev != BLE_NIL) s_entries[d->lru_prev].lru_next = d->lru_next;
+    else s_lru_head = d->lru_next;
+    if (d->lru_next != BLE_NIL) s_entries[d->lru_next].lru_prev = d->lru_prev;
+    else s_lru_tail = d->lru_prev;
+}
+
+static void lru_push_front(uint16_t e)
+{
+    ble_device_t* d = &s_entries[e];
+    d->lru_prev = BLE_NIL;
+    d->lru_next = s_lru_head;
+    if (s_lru_head != BLE_NIL) s_entries[s_lru_head].lru_prev = e;
+    s_lru_head = e;
+    if (s_lru_tail == BLE_NIL) s_lru_tail = e;
+}
+
+void ble_devices_reset(void)
+{
+    memset(s_index, 0xFF, sizeof(s_index));
+    s_count = 0;
+    s_lru_head = BLE_NIL;
+    s_lru_tail = BLE_NIL;
+}
+
+bool ble_devices_upsert(const uint8_t* addr, const char* name, int8_t rssi, uint32_t now_ms)
+{
+    if (!addr) return false;
+
+    // Lazily initialise so the table works without an explicit reset call
+    static bool s_ready = false;
+    if (!s_ready) {
+        ble_devices_reset();
+        s_ready = true;
+    }
+
+    uint32_t slot = index_probe(addr);
+    uint16_t e = s_index[slot];
+    bool changed = false;
+
+    if (e == BLE_NIL) {
+        if (s_count < BLE_DEVICES_MAX) {
+            e = s_count++;
+        } else {
+            // Full: recycle the least recently seen entry
+            e = s_lru_tail;
+            index_remove(index_probe(s_entries[e].addr));
+            lru_unlink(e);
+            slot = index_probe(addr); // removal may have shifted our slot
+        }
+        ble_device_t* d = &s_entries[e];
+        memcpy(d->addr, addr, 6);
+        d->name[0] = '\0';
+        d->rssi_q4 = (int16_t)(rssi * 16);
+        s_index[slot] = e;
+        lru_push_front(e);
+        changed = true;
+    } else {
+        ble_device_t* d = &s_entries[e];
+        int before = ble_device_rssi(d);
+        d->rssi_q4 += (int16_t)((rssi * 16 - d->rssi_q4) >> BLE_RSSI_EWMA_SHIFT);
+        if (ble_device_rssi(d) != before) changed = true;
+        if (e != s_lru_head) {
+            lru_unlink(e);
+            lru_push_front(e);
+        }
+    }
+
+    ble_device_t* d = &s_entries[e];
+    d->last_seen_ms = now_ms;
+    if (name && name[0] && strncmp(d->name, name, BLE_NAME_MAX) != 0) {
+        strlcpy(d->name, name, BLE_NAME_MAX);
+        changed = true;
+    }
+    return changed;
+}
+
+void ble_devices_publish(void)
+{
+    unsigned seq = atomic_load_explicit(&s_snap_seq, memory_order_relaxed);
+    ble_devices_snapshot_t* back = &s_snap[((seq >> 1) + 1) & 1];
+
+    atomic_store_explicit(&s_snap_seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    // Top-K by smoothed RSSI via insertion into the (small) output array
+    int n = 0;
+    for (uint16_t e = s_lru_head; e != BLE_NIL; e = s_entries[e].lru_next) {
+        const ble_device_t* d = &s_entries[e];
+        int rssi = ble_device_rssi(d);
+        int pos = n;
+        while (pos > 0 && back->devices[pos - 1].rssi < rssi) pos--;
+        if (pos >= BLE_SNAPSHOT_MAX) continue;
+
+        int last = (n < BLE_SNAPSHOT_MAX) ? n : BLE_SNAPSHOT_MAX - 1;
+        memmove(&back->devices[pos + 1], &back->devices[pos], (size_t)(last - pos) * sizeof(back->devices[0]));
+        ble_device_view_t* v = &back->devices[pos];
+        memcpy(v->addr, d->addr, 6);
+        v->rssi = (int8_t)rssi;
+        memcpy(v->name, d->name, BLE_NAME_MAX);
+        if (n < BLE_SNAPSHOT_MAX) n++;
+    }
+    back->count = (uint8_t)n;
+    back->total = s_count;
+    back->generation = (seq >> 1) + 1;
+
+    atomic_store_explicit(&s_snap_seq, seq + 2, memory_order_release);
+}
+
+uint32_t ble_devices_generation(void)
+{
+    return atomic_load_explicit(&s_snap_seq, memory_order_acquire) >> 1;
+}
+
+bool ble_devices_read_snapshot(ble_devices_snapshot_t* out)
+{
+    if (!out) return false;
+
+    for (int i = 0; i < BLE_SNAPSHOT_READ_RETRIES; i++) {
+        unsigned s1 = atomic_load_explicit(&s_snap_seq, memory_order_acquire);
+        memcpy(out, &s_snap[(s1 >> 1) & 1], sizeof(*out));
+        atomic_thread_fence(memory_order_acquire);
+        unsigned s2 = atomic_load_explicit(&s_snap_seq, memory_order_relaxed);
+
+        // The writer only reaches our buffer again on its next write phase
+        if (s2 - s1 < ((s1 & 1) ? 2u : 3u)) {
+            return true;
+        }
+    }
+    return false;
+}
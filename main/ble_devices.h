@@ -0,0 +1,67 @@
+#ifndef BLE_DEVICES
+#define BLE_DEVICES
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Scan table capacity. Must be a power of two; the hash index is twice this size.
+#ifndef BLE_DEVICES_MAX
+#define BLE_DEVICES_MAX 128
+#endif
+
+#define BLE_NAME_MAX 32
+
+// RSSI is kept as an EWMA in 1/16 dBm steps, alpha = 1 / (1 << BLE_RSSI_EWMA_SHIFT).
+#define BLE_RSSI_EWMA_SHIFT 2
+
+typedef struct {
+    uint8_t addr[6];
+    char name[BLE_NAME_MAX];
+    int16_t rssi_q4;        // smoothed RSSI, dBm * 16
+    uint32_t last_seen_ms;
+    uint16_t lru_prev;      // LRU list links (entry indices)
+    uint16_t lru_next;
+} ble_device_t;
+
+// Sorted (strongest first) view published for the UI
+#ifndef BLE_SNAPSHOT_MAX
+#define BLE_SNAPSHOT_MAX 8
+#endif
+
+typedef struct {
+    uint8_t addr[6];
+    int8_t rssi;
+    char name[BLE_NAME_MAX];
+} ble_device_view_t;
+
+typedef struct {
+    uint32_t generation;    // bumps on every publish
+    uint16_t total;         // devices in the table at publish time
+    uint8_t count;          // valid entries in devices[]
+    ble_device_view_t devices[BLE_SNAPSHOT_MAX];
+} ble_devices_snapshot_t;
+
+// Writer side: only ever call these from one task (the NimBLE host task).
+void ble_devices_reset(void);
+
+// Insert or refresh a device. Evicts the least recently seen entry when full.
+// Returns true if anything visible (new device, name, rounded RSSI) changed.
+bool ble_devices_upsert(const uint8_t* addr, const char* name, int8_t rssi, uint32_t now_ms);
+
+// Copy the strongest devices into the back buffer and flip it to the front. O(n).
+void ble_devices_publish(void);
+
+// Reader side: safe from any task, never blocks the writer.
+uint32_t ble_devices_generation(void);
+
+// Consistent copy of the latest published snapshot. Returns false only if the
+// writer kept republishing underneath us for every retry.
+bool ble_devices_read_snapshot(ble_devices_snapshot_t* out);
+
+static inline int ble_device_rssi(const ble_device_t* dev) {
+    // Round to nearest dBm
+    return (dev->rssi_q4 >= 0) ? (dev->rssi_q4 + 8) >> 4 : -((-dev->rssi_q4 + 8) >> 4);
+}
+
+#endif /* BLE_DEVICES */
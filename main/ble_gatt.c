@@ -0,0 +1,270 @@
+#include "ble_gatt.h"
+#include <string.h>
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "host/ble_uuid.h"
+#include "nimble/nimble_port.h"
+#include "services/gatt/ble_svc_gatt.h"
+
+#include "history.h"
+
+#define GATT_TAG "BLE_GATT"
+
+// Largest packet we build; an ATT MTU of 247 leaves 244 bytes of notification payload
+#define HIST_PACKET_MAX 244
+
+// When the host runs out of buffers the stream is retried from a callout; after
+// this many failed attempts in a row it is abandoned
+#define HIST_RETRY_MS   20
+#define HIST_RETRY_MAX  50
+
+// 7d3a0001-5e1c-4c8e-9a3e-6f1b2c4d5e6f / ...0002...
+static const ble_uuid128_t s_hist_data_uuid =
+    BLE_UUID128_INIT(0x6f, 0x5e, 0x4d, 0x2c, 0x1b, 0x6f, 0x3e, 0x9a,
+                     0x8e, 0x4c, 0x1c, 0x5e, 0x01, 0x00, 0x3a, 0x7d);
+static const ble_uuid128_t s_hist_ctrl_uuid =
+    BLE_UUID128_INIT(0x6f, 0x5e, 0x4d, 0x2c, 0x1b, 0x6f, 0x3e, 0x9a,
+                     0x8e, 0x4c, 0x1c, 0x5e, 0x02, 0x00, 0x3a, 0x7d);
+
+static uint16_t s_temp_handle;
+static uint16_t s_hum_handle;
+static uint16_t s_hist_handle;
+
+static volatile int16_t s_temp_centi_c = 0;
+static volatile uint16_t s_hum_centi_pct = 0;
+static int16_t s_notified_temp = INT16_MIN;
+static uint16_t s_notified_hum = UINT16_MAX;
+static TickType_t s_last_notify = 0;
+
+// Streaming state, only touched from the NimBLE host task
+static uint16_t s_conn = BLE_HS_CONN_HANDLE_NONE;
+static bool s_hist_streaming = false;
+static uint32_t s_hist_seq = 0;
+static uint16_t s_hist_packet_no = 0;
+static uint16_t s_hist_credits = 0;
+static uint8_t s_hist_retries = 0;
+static struct ble_npl_callout s_hist_retry;
+
+static int ess_access(uint16_t conn_handle, uint16_t attr_handle,
+                      struct ble_gatt_access_ctxt *ctxt, void *arg);
+static int hist_access(uint16_t conn_handle, uint16_t attr_handle,
+                       struct ble_gatt_access_ctxt *ctxt, void *arg);
+
+static const struct ble_gatt_svc_def s_svcs[] = {
+    {
+        .type = BLE_GATT_SVC_TYPE_PRIMARY,
+        .uuid = BLE_UUID16_DECLARE(ESS_SVC_UUID),
+        .characteristics = (struct ble_gatt_chr_def[]) {
+            {
+                .uuid = BLE_UUID16_DECLARE(ESS_TEMPERATURE_UUID),
+                .access_cb = ess_access,
+                .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_NOTIFY,
+                .val_handle = &s_temp_handle,
+            },
+            {
+                .uuid = BLE_UUID16_DECLARE(ESS_HUMIDITY_UUID),
+                .access_cb = ess_access,
+                .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_NOTIFY,
+                .val_handle = &s_hum_handle,
+            },
+            {
+                .uuid = &s_hist_data_uuid.u,
+                .access_cb = hist_access,
+                .flags = BLE_GATT_CHR_F_NOTIFY,
+                .val_handle = &s_hist_handle,
+            },
+            {
+                .uuid = &s_hist_ctrl_uuid.u,
+                .access_cb = hist_access,
+                .flags = BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_WRITE_NO_RSP,
+            },
+            { 0 }
+        },
+    },
+    { 0 },
+};
+
+static int ess_access(uint16_t conn_handle, uint16_t attr_handle,
+                      struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    if (ctxt->op != BLE_GATT_ACCESS_OP_READ_CHR) {
+        return BLE_ATT_ERR_UNLIKELY;
+    }
+
+    uint8_t v[2];
+    uint16_t raw = (attr_handle == s_temp_handle) ? (uint16_t)s_temp_centi_c : s_hum_centi_pct;
+    v[0] = raw & 0xFF;
+    v[1] = raw >> 8;
+    return os_mbuf_append(ctxt->om, v, sizeof(v)) == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+}
+
+static void hist_stop(void)
+{
+    s_hist_streaming = false;
+    s_hist_credits = 0;
+    s_hist_retries = 0;
+    ble_npl_callout_stop(&s_hist_retry);
+}
+
+// A notification that cannot be queued has nothing in flight to resume the stream
+// (NOTIFY_TX for a notification is reported from inside the send call), so try
+// again from the callout.
+static void hist_stalled(int rc)
+{
+    if (++s_hist_retries > HIST_RETRY_MAX) {
+        ESP_LOGE(GATT_TAG, "History stream aborted at packet %u: %d", s_hist_packet_no, rc);
+        hist_stop();
+        return;
+    }
+    ble_npl_callout_reset(&s_hist_retry, ble_npl_time_ms_to_ticks32(HIST_RETRY_MS));
+}
+
+// Send as many history packets as the client has granted credits for
+static void hist_pump(void)
+{
+    while (s_hist_streaming && s_hist_credits > 0 && s_conn != BLE_HS_CONN_HANDLE_NONE) {
+        uint8_t buf[HIST_PACKET_MAX];
+        size_t max = ble_att_mtu(s_conn) - 3;
+        if (max > sizeof(buf)) max = sizeof(buf);
+
+        uint32_t seq = s_hist_seq;
+        size_t len = history_pack(&seq, s_hist_packet_no, buf, max);
+        if (len == 0) {
+            hist_stop();
+            break;
+        }
+
+        struct os_mbuf *om = ble_hs_mbuf_from_flat(buf, len);
+        if (!om) {
+            hist_stalled(BLE_HS_ENOMEM);
+            break;
+        }
+        // Consumes om on failure too
+        int rc = ble_gatts_notify_custom(s_conn, s_hist_handle, om);
+        if (rc != 0) {
+            hist_stalled(rc);
+            break;
+        }
+
+        s_hist_seq = seq;
+        s_hist_packet_no++;
+        s_hist_credits--;
+        s_hist_retries = 0;
+        if (buf[HISTORY_PACKET_COUNT_OFS] == 0) {
+            ESP_LOGI(GATT_TAG, "History stream done, %u packets", s_hist_packet_no);
+            hist_stop();
+        }
+    }
+}
+
+static void hist_retry_cb(struct ble_npl_event *ev)
+{
+    hist_pump();
+}
+
+static int hist_access(uint16_t conn_handle, uint16_t attr_handle,
+                       struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    if (ctxt->op != BLE_GATT_ACCESS_OP_WRITE_CHR) {
+        return BLE_ATT_ERR_UNLIKELY;
+    }
+
+    uint8_t cmd[8];
+    uint16_t len = 0;
+    if (ble_hs_mbuf_to_flat(ctxt->om, cmd, sizeof(cmd), &len) != 0 || len == 0) {
+        return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+    }
+
+    switch (cmd[0]) {
+    case HIST_OP_START: {
+        if (len < 6) return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+        uint32_t since = (uint32_t)cmd[1] | ((uint32_t)cmd[2] << 8) |
+                         ((uint32_t)cmd[3] << 16) | ((uint32_t)cmd[4] << 24);
+        s_conn = conn_handle;
+        s_hist_seq = history_find_since(since);
+        s_hist_packet_no = 0;
+        s_hist_credits = cmd[5];
+        s_hist_retries = 0;
+        s_hist_streaming = true;
+        ESP_LOGI(GATT_TAG, "History stream from seq %lu", (unsigned long)s_hist_seq);
+        break;
+    }
+    case HIST_OP_CREDIT:
+        if (len < 2) return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+        // Saturate: a peer granting credits it never drains must not wrap the count
+        s_hist_credits = (s_hist_credits > UINT16_MAX - cmd[1]) ? UINT16_MAX : s_hist_credits + cmd[1];
+        break;
+    case HIST_OP_STOP:
+        hist_stop();
+        return 0;
+    default:
+        return BLE_ATT_ERR_REQ_NOT_SUPPORTED;
+    }
+
+    hist_pump();
+    return 0;
+}
+
+int ble_gatt_init(void)
+{
+    int rc = ble_gatts_count_cfg(s_svcs);
+    if (rc != 0) {
+        ESP_LOGE(GATT_TAG, "ble_gatts_count_cfg failed: %d", rc);
+        return rc;
+    }
+
+    rc = ble_gatts_add_svcs(s_svcs);
+    if (rc != 0) {
+        ESP_LOGE(GATT_TAG, "ble_gatts_add_svcs failed: %d", rc);
+        return rc;
+    }
+
+    ble_npl_callout_init(&s_hist_retry, nimble_port_get_dflt_eventq(), hist_retry_cb, NULL);
+    return 0;
+}
+
+void ble_gatt_on_gap_event(struct ble_gap_event *event)
+{
+    switch (event->type) {
+    case BLE_GAP_EVENT_CONNECT:
+        if (event->connect.status == 0) {
+            s_conn = event->connect.conn_handle;
+        }
+        break;
+    case BLE_GAP_EVENT_DISCONNECT:
+        s_conn = BLE_HS_CONN_HANDLE_NONE;
+        hist_stop();
+        break;
+    default:
+        break;
+    }
+}
+
+void ble_gatt_update_reading(int16_t temp_centi_c, uint16_t hum_centi_pct)
+{
+    s_temp_centi_c = temp_centi_c;
+    s_hum_centi_pct = hum_centi_pct;
+
+    // Subscribers get at most one update per ESS_NOTIFY_MIN_MS, and only on change
+    TickType_t now = xTaskGetTickCount();
+    if (s_last_notify != 0 && (now - s_last_notify) < pdMS_TO_TICKS(ESS_NOTIFY_MIN_MS)) {
+        return;
+    }
+
+    bool sent = false;
+    if (temp_centi_c != s_notified_temp) {
+        ble_gatts_chr_updated(s_temp_handle);
+        s_notified_temp = temp_centi_c;
+        sent = true;
+    }
+    if (hum_centi_pct != s_notified_hum) {
+        ble_gatts_chr_updated(s_hum_handle);
+        s_notified_hum = hum_centi_pct;
+        sent = true;
+    }
+    if (sent) {
+        s_last_notify = now;
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef BLE_GATT
+#define BLE_GATT
+
+#include <stdint.h>
+#include "host/ble_hs.h"
+
+// Environmental Sensing service plus a vendor bulk-history pair:
+//   data (notify):    packets from history_pack(), one per notification
+//   control (write / write without response):
+//     0x01 START  [u32 since_time_s][u8 credits]  restart the stream
+//     0x02 CREDIT [u8 credits]                     allow that many more packets
+//     0x03 STOP
+// The stream ends with a packet whose record count is 0.
+#define ESS_SVC_UUID            0x181A
+#define ESS_TEMPERATURE_UUID    0x2A6E
+#define ESS_HUMIDITY_UUID       0x2A6F
+
+#define HIST_OP_START   0x01
+#define HIST_OP_CREDIT  0x02
+#define HIST_OP_STOP    0x03
+
+// Minimum spacing between temperature/humidity notifications
+#define ESS_NOTIFY_MIN_MS 5000
+
+int ble_gatt_init(void);
+void ble_gatt_on_gap_event(struct ble_gap_event *event);
+void ble_gatt_update_reading(int16_t temp_centi_c, uint16_t hum_centi_pct);
+
+#endif /* BLE_GATT */
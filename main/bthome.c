@@ -0,0 +1,43 @@
+#include "bthome.h"
+
+size_t bthome_encode_adv(const bthome_reading_t* r, uint8_t* out, size_t out_sz)
+{
+    if (!r || !out) return 0;
+
+    const size_t svc_len = 4 + 2 + (r->battery_pct >= 0 ? 2 : 0) + 3 + 3;
+    const size_t total = 3 + 1 + svc_len;
+    if (out_sz < total) return 0;
+
+    size_t n = 0;
+
+    // Flags: LE general discoverable, BR/EDR not supported
+    out[n++] = 2;
+    out[n++] = 0x01;
+    out[n++] = 0x06;
+
+    // Service data - 16-bit UUID. Objects must be in ascending id order.
+    out[n++] = (uint8_t)svc_len;
+    out[n++] = 0x16;
+    out[n++] = BTHOME_SERVICE_UUID & 0xFF;
+    out[n++] = BTHOME_SERVICE_UUID >> 8;
+    out[n++] = BTHOME_DEVICE_INFO;
+
+    out[n++] = BTHOME_OBJ_PACKET_ID;
+    out[n++] = r->packet_id;
+
+    if (r->battery_pct >= 0) {
+        out[n++] = BTHOME_OBJ_BATTERY;
+        out[n++] = (uint8_t)(r->battery_pct > 100 ? 100 : r->battery_pct);
+    }
+
+    uint16_t t = (uint16_t)r->temp_centi_c;
+    out[n++] = BTHOME_OBJ_TEMPERATURE;
+    out[n++] = t & 0xFF;
+    out[n++] = t >> 8;
+
+    out[n++] = BTHOME_OBJ_HUMIDITY;
+    out[n++] = r->hum_centi_pct & 0xFF;
+    out[n++] = r->hum_centi_pct >> 8;
+
+    return n;
+}
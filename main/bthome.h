@@ -0,0 +1,29 @@
+#ifndef BTHOME
+#define BTHOME
+
+#include <stddef.h>
+#include <stdint.h>
+
+// BTHome v2 service data (https://bthome.io/format/), unencrypted.
+#define BTHOME_SERVICE_UUID     0xFCD2
+#define BTHOME_DEVICE_INFO      0x40 // v2, no encryption, regular interval
+
+#define BTHOME_OBJ_PACKET_ID    0x00
+#define BTHOME_OBJ_BATTERY      0x01 // uint8, %
+#define BTHOME_OBJ_TEMPERATURE  0x02 // sint16, 0.01 C
+#define BTHOME_OBJ_HUMIDITY     0x03 // uint16, 0.01 %
+
+#define BTHOME_ADV_MAX          31
+
+typedef struct {
+    int16_t temp_centi_c;
+    uint16_t hum_centi_pct;
+    int8_t battery_pct;     // < 0 when unknown, omitted from the payload
+    uint8_t packet_id;      // bump per new sample so receivers can dedupe
+} bthome_reading_t;
+
+// Writes the flags AD and the BTHome service data AD into `out`.
+// Returns the number of bytes written, or 0 if `out_sz` is too small.
+size_t bthome_encode_adv(const bthome_reading_t* r, uint8_t* out, size_t out_sz);
+
+#endif /* BTHOME */
@@ -0,0 +1,139 @@
+#include "climate.h"
+
+#define ES_STEPS (CLIMATE_T_MAX_C - CLIMATE_T_MIN_C)
+
+// Saturation vapour pressure in centi-pascal at CLIMATE_T_MIN_C + i degrees:
+// round(611.2 * exp(17.62 t / (243.12 + t)) * 100)
+static const uint32_t s_es_cpa[ES_STEPS + 1] = {
+    1902, 2109, 2336, 2586, 2858, 3157, 3484, 3840,
+    4230, 4654, 5117, 5620, 6168, 6764, 7410, 8112,
+    8872, 9696, 10588, 11553, 12597, 13723, 14939, 16251,
+    17665, 19187, 20826, 22589, 24483, 26518, 28703, 31047,
+    33559, 36251, 39134, 42218, 45517, 49043, 52809, 56830,
+    61120, 65695, 70570, 75763, 81292, 87174, 93430, 100079,
+    107143, 114643, 122603, 131046, 139998, 149483, 159531, 170167,
+    181423, 193327, 205913, 219212, 233260, 248090, 263742, 280251,
+    297659, 316006, 335334, 355689, 377115, 399660, 423372, 448303,
+    474505, 502031, 530939, 561284, 593128, 626531, 661558, 698274,
+    736746, 777044, 819241, 863409, 909627, 957971, 1008523, 1061367,
+    1116588, 1174274, 1234516, 1297407, 1363042, 1431521, 1502945, 1577416,
+    1655043, 1735933, 1820201, 1907960, 1999329, 2094429, 2193384, 2296322,
+    2403374, 2514671, 2630353, 2750558, 2875431, 3005117, 3139768, 3279536,
+    3424580, 3575059, 3731139, 3892987, 4060774, 4234677, 4414874, 4601548,
+    4794885,
+};
+
+static int32_t clamp_t(int32_t t)
+{
+    if (t < CLIMATE_T_MIN_C * 100) return CLIMATE_T_MIN_C * 100;
+    if (t > CLIMATE_T_MAX_C * 100) return CLIMATE_T_MAX_C * 100;
+    return t;
+}
+
+static uint32_t es_cpa(int32_t t_centi)
+{
+    int32_t off = clamp_t(t_centi) - CLIMATE_T_MIN_C * 100;
+    int32_t i = off / 100;
+    int32_t frac = off % 100;
+    if (i >= ES_STEPS) return s_es_cpa[ES_STEPS];
+    return s_es_cpa[i] + (uint32_t)(((uint64_t)(s_es_cpa[i + 1] - s_es_cpa[i]) * frac + 50) / 100);
+}
+
+// Temperature at which the table reaches e
+static int32_t es_inverse_centi_c(uint32_t e)
+{
+    if (e <= s_es_cpa[0]) return CLIMATE_T_MIN_C * 100;
+    if (e >= s_es_cpa[ES_STEPS]) return CLIMATE_T_MAX_C * 100;
+
+    int lo = 0, hi = ES_STEPS;
+    while (hi - lo > 1) {
+        int mid = (lo + hi) / 2;
+        if (s_es_cpa[mid] <= e) lo = mid;
+        else hi = mid;
+    }
+    uint32_t span = s_es_cpa[hi] - s_es_cpa[lo];
+    return (CLIMATE_T_MIN_C + lo) * 100 + (int32_t)(((uint64_t)(e - s_es_cpa[lo]) * 100 + span / 2) / span);
+}
+
+static uint32_t isqrt64(uint64_t x)
+{
+    uint64_t r = 0, bit = 1ull << 62;
+    while (bit > x) bit >>= 2;
+    while (bit) {
+        if (x >= r + bit) {
+            x -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)r;
+}
+
+// NWS heat index (https://www.wpc.ncep.noaa.gov/html/heatindex_equation.shtml) in
+// centi-F, from milli-F so the choice of formula is exact at the 80 F boundary.
+// Regression coefficients are scaled by 1e8 and grouped by powers of RH so every
+// product fits in 64 bits.
+static int32_t heat_index_centi_f(int32_t t_mf, int32_t rh)
+{
+    // Steadman's simple form first, in milli-F; the regression only applies above 80 F
+    int32_t simple = (t_mf + 61000 + (t_mf - 68000) * 6 / 5 + rh * 94 / 100) / 2;
+    if (simple + t_mf < 160000) return (simple + (simple >= 0 ? 5 : -5)) / 10;
+
+    const int32_t t = (t_mf + 5) / 10;
+    const int64_t T = t, T2 = T * T;
+    const int64_t a = -4237900000LL + 204901523LL * T / 100 - 683783LL * T2 / 10000;
+    const int64_t b = 1014333127LL - 22475541LL * T / 100 + 122874LL * T2 / 10000;
+    const int64_t c = -5481717LL + 85282LL * T / 100 - 199LL * T2 / 10000;
+    const int64_t R = rh;
+    int32_t hi = (int32_t)((a + b * R / 100 + c * R * R / 10000) / 1000000);
+
+    if (rh < 1300 && t >= 8000 && t <= 11200) {
+        // - ((13 - RH) / 4) * sqrt((17 - |T - 95|) / 17)
+        int32_t d = t - 9500;
+        if (d < 0) d = -d;
+        uint32_t root = isqrt64((uint64_t)(1700 - d) * 100000000 / 1700); // 1e4 = 1.0
+        hi -= (int32_t)((int64_t)(1300 - rh) / 4 * root / 10000);
+    } else if (rh > 8500 && t >= 8000 && t <= 8700) {
+        // + ((RH - 85) / 10) * ((87 - T) / 5)
+        hi += (rh - 8500) * (8700 - t) / 5000;
+    }
+    return hi;
+}
+
+void climate_compute(centi_c_t t, centi_pct_t rh, climate_t* out)
+{
+    if (rh > 10000) rh = 10000;
+
+    // Actual vapour pressure
+    uint32_t e = (uint32_t)(((uint64_t)es_cpa(t) * rh + 5000) / 10000);
+
+    out->dew_point_centi_c = (centi_c_t)(rh == 0 ? CLIMATE_T_MIN_C * 100 : es_inverse_centi_c(e));
+
+    // AH [g/m3] = 2.1674 * e [Pa] / T [K], so hundredths are 21674 * e[cPa] / T[cK] / 100
+    out->abs_hum_centi_g_m3 = (uint16_t)(((uint64_t)e * 21674 / 100 + (27315 + t) / 2) / (uint32_t)(27315 + t));
+
+    int32_t hi_c = (heat_index_centi_f(t * 18 + 32000, rh) - 3200) * 5 / 9;
+    if (hi_c > INT16_MAX) hi_c = INT16_MAX; // the regression runs away far outside its range
+    out->heat_index_centi_c = (centi_c_t)hi_c;
+}
+
+bool climate_update(centi_c_t t, centi_pct_t rh, climate_t* out)
+{
+    static bool s_have = false;
+    static centi_c_t s_t;
+    static centi_pct_t s_rh;
+    static climate_t s_out;
+
+    if (s_have && t == s_t && rh == s_rh) {
+        *out = s_out;
+        return false;
+    }
+    climate_compute(t, rh, &s_out);
+    s_t = t;
+    s_rh = rh;
+    s_have = true;
+    *out = s_out;
+    return true;
+}
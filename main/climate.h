@@ -0,0 +1,29 @@
+#ifndef CLIMATE
+#define CLIMATE
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "fixed.h"
+
+// Derived comfort metrics from a temperature / humidity pair, all in integers:
+// saturation vapour pressure comes from a 1 C lookup table (Magnus, over water) with
+// linear interpolation, and dew point is its inverse on the same table. Heat index
+// is the NWS Rothfusz regression evaluated in 64-bit fixed point.
+
+#define CLIMATE_T_MIN_C     -40     // table range; temperatures are clamped to it
+#define CLIMATE_T_MAX_C     80
+
+typedef struct {
+    centi_c_t dew_point_centi_c;
+    centi_c_t heat_index_centi_c;
+    uint16_t abs_hum_centi_g_m3;    // absolute humidity, hundredths of g/m3
+} climate_t;
+
+void climate_compute(centi_c_t t, centi_pct_t rh, climate_t* out);
+
+// Memoised climate_compute() for a stream of samples: recomputes only when the inputs
+// differ from the previous call. Returns true if it did.
+bool climate_update(centi_c_t t, centi_pct_t rh, climate_t* out);
+
+#endif /* CLIMATE */
@@ -0,0 +1,133 @@
+#include "connectivity.h"
+
+#include <esp_timer.h>
+#include <esp_wifi.h>
+#include <freertos/FreeRTOS.h>
+
+static conn_snapshot_t s_conn;
+static portMUX_TYPE s_conn_lock = portMUX_INITIALIZER_UNLOCKED;
+static int32_t s_rssi_q4 = 0;       // EWMA, dBm * 16; only the timer and link events touch it
+static bool s_rssi_seeded = false;
+static esp_timer_handle_t s_timer = NULL;
+static volatile bool s_kicked = false;  // armed as a one-shot by connectivity_on_ip()
+
+// Lower edge of 1, 2 and 3 bars
+static const int8_t s_bar_dbm[3] = { -85, -75, -67 };
+
+static uint8_t raw_bars(int rssi)
+{
+    uint8_t bars = 0;
+    while (bars < 3 && rssi >= s_bar_dbm[bars]) bars++;
+    return bars;
+}
+
+// Change the bar count only if it would still change CONN_BARS_HYST_DB further on
+static uint8_t bars_with_hysteresis(uint8_t cur, int rssi)
+{
+    uint8_t next = raw_bars(rssi);
+    if (next > cur && raw_bars(rssi - CONN_BARS_HYST_DB) <= cur) return cur;
+    if (next < cur && raw_bars(rssi + CONN_BARS_HYST_DB) >= cur) return cur;
+    return next;
+}
+
+static int rssi_round(int32_t q4)
+{
+    return (q4 >= 0) ? (q4 + 8) >> 4 : -((-q4 + 8) >> 4);
+}
+
+// online is left alone: only connectivity_on_ip() and a link drop change it
+static void publish(bool associated, int rssi, bool reset_bars)
+{
+    const bool have_rssi = associated && s_rssi_seeded;
+
+    taskENTER_CRITICAL(&s_conn_lock);
+    conn_snapshot_t next = s_conn;
+    next.associated = associated;
+    next.online = associated && s_conn.online;
+    next.rssi = have_rssi ? (int8_t)rssi : 0;
+    next.bars = !have_rssi ? 0 : reset_bars ? raw_bars(rssi) : bars_with_hysteresis(s_conn.bars, rssi);
+    if (next.associated != s_conn.associated || next.online != s_conn.online ||
+        next.rssi != s_conn.rssi || next.bars != s_conn.bars) {
+        next.generation++;
+        s_conn = next;
+    }
+    taskEXIT_CRITICAL(&s_conn_lock);
+}
+
+// esp_timer task, the only writer of the EWMA
+static void sample_rssi(void* arg)
+{
+    // A run that raced a link drop must not mark the link up again
+    if (!s_conn.associated) return;
+
+    if (s_kicked) {
+        s_kicked = false; // back to the regular period
+        esp_timer_start_periodic(s_timer, (uint64_t)CONN_RSSI_PERIOD_MS * 1000);
+    }
+
+    int rssi;
+    if (esp_wifi_sta_get_rssi(&rssi) != ESP_OK) return;
+
+    bool reset = !s_rssi_seeded;
+    if (reset) {
+        s_rssi_q4 = rssi * 16;
+        s_rssi_seeded = true;
+    } else {
+        s_rssi_q4 += (rssi * 16 - s_rssi_q4) >> CONN_RSSI_EWMA_SHIFT;
+    }
+    publish(true, rssi_round(s_rssi_q4), reset);
+}
+
+void connectivity_on_link(bool up)
+{
+    if (!s_timer) {
+        const esp_timer_create_args_t args = { .callback = sample_rssi, .name = "conn_rssi" };
+        if (esp_timer_create(&args, &s_timer) != ESP_OK) s_timer = NULL;
+    }
+
+    s_kicked = false;
+    if (up) {
+        s_rssi_seeded = false;
+        if (s_timer) {
+            esp_timer_stop(s_timer);
+            esp_timer_start_periodic(s_timer, (uint64_t)CONN_RSSI_PERIOD_MS * 1000);
+        }
+        publish(true, 0, true);
+    } else {
+        if (s_timer) esp_timer_stop(s_timer);
+        publish(false, 0, true);
+    }
+}
+
+void connectivity_on_ip(bool up)
+{
+    taskENTER_CRITICAL(&s_conn_lock);
+    if (s_conn.online != up && (s_conn.associated || !up)) {
+        s_conn.online = up;
+        s_conn.generation++;
+    }
+    taskEXIT_CRITICAL(&s_conn_lock);
+
+    // First bars now instead of a period later. The sample is taken on the timer task,
+    // not here on the event loop, so it cannot interleave with a periodic one.
+    if (up && !s_rssi_seeded && s_timer && s_conn.associated) {
+        esp_timer_stop(s_timer);
+        s_kicked = true;
+        if (esp_timer_start_once(s_timer, 0) != ESP_OK) {
+            s_kicked = false;
+            esp_timer_start_periodic(s_timer, (uint64_t)CONN_RSSI_PERIOD_MS * 1000);
+        }
+    }
+}
+
+void connectivity_get(conn_snapshot_t* out)
+{
+    taskENTER_CRITICAL(&s_conn_lock);
+    *out = s_conn;
+    taskEXIT_CRITICAL(&s_conn_lock);
+}
+
+bool connectivity_online(void)
+{
+    return s_conn.online;
+}
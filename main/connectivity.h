@@ -0,0 +1,31 @@
+#ifndef CONNECTIVITY
+#define CONNECTIVITY
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Cached link state for the UI and telemetry. wifi.c feeds it from the WiFi and IP
+// events; while associated, a timer samples the RSSI into an EWMA and the bar count
+// only moves once the smoothed RSSI is CONN_BARS_HYST_DB past a threshold. Readers
+// get a snapshot copy and never call into the WiFi driver.
+
+#define CONN_RSSI_PERIOD_MS     2000
+#define CONN_RSSI_EWMA_SHIFT    2       // alpha = 1/4, in 1/16 dBm steps like ble_devices
+#define CONN_BARS_HYST_DB       3
+
+typedef struct {
+    bool associated;        // WiFi link up
+    bool online;            // and holding an IP
+    int8_t rssi;            // smoothed, dBm; 0 while not associated
+    uint8_t bars;           // 0..3
+    uint32_t generation;    // bumps when any field above changes
+} conn_snapshot_t;
+
+// Called from the WiFi / IP event handlers
+void connectivity_on_link(bool up);
+void connectivity_on_ip(bool up);
+
+void connectivity_get(conn_snapshot_t* out);
+bool connectivity_online(void);
+
+#endif /* CONNECTIVITY */
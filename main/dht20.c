@@ -1,7 +1,36 @@
 #include "dht20.h"
+#include <time.h>
+#include <esp_timer.h>
+#include "history.h"
+#include "latency.h"
+#include "settings.h"
+#include "trace.h"
+
+static TickType_t s_history_last = 0;
+static dht20_sample_t s_last = {0};
+static portMUX_TYPE s_last_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t s_task = NULL;
+static volatile bool s_read_failed = false;  // last read attempt failed
+static dht20_listener_t s_listeners[DHT20_MAX_LISTENERS];
+static int s_listener_count = 0;
+
+// Status byte plus 20 bit humidity and temperature
+static void dht20_decode(const uint8_t data[7], centi_c_t *temp_centi_c, centi_pct_t *hum_centi_pct) {
+    // Check if sensor needs calibration (Bit 3 should be 1 after first power-up)
+    if (!(data[0] & 0x08)) {
+        ESP_LOGW(DHT20_TAG, "Sensor calibration needed or status error.");
+        // You might need to send an initialization command 0xBE if this occurs
+    }
+
+    // Parse temperature and humidity
+    uint32_t raw_humidity = ((data[1] << 16) | (data[2] << 8) | data[3]) >> 4;
+    uint32_t raw_temperature = ((data[3] & 0x0F) << 16) | (data[4] << 8) | data[5];
+    *hum_centi_pct = fixed_hum_from_raw20(raw_humidity);
+    *temp_centi_c = fixed_temp_from_raw20(raw_temperature);
+}
 
 // Function to read temperature and humidity from DHT20
-esp_err_t dht20_read(float *temperature, float *humidity) {
+esp_err_t dht20_read(centi_c_t *temp_centi_c, centi_pct_t *hum_centi_pct) {
     uint8_t data[7];
 
     // Send measurement command
@@ -36,33 +65,133 @@ esp_err_t dht20_read(float *temperature, float *humidity) {
         return ret;
     }
 
-    // Check if sensor needs calibration (Bit 3 should be 1 after first power-up)
-    if (!(data[0] & 0x08)) {
-        ESP_LOGW(DHT20_TAG, "Sensor calibration needed or status error.");
-        // You might need to send an initialization command 0xBE if this occurs
+    trace_record(TRACE_DHT20, data, sizeof(data));
+    dht20_decode(data, temp_centi_c, hum_centi_pct);
+    return ESP_OK;
+}
+
+static void dht20_publish(centi_c_t temp_centi_c, centi_pct_t hum_centi_pct) {
+    history_sample_t sample = {
+        .time_s = (uint32_t)time(NULL),
+        .temp_centi_c = temp_centi_c,
+        .hum_centi_pct = hum_centi_pct,
+    };
+    ble_update_reading(sample.temp_centi_c, sample.hum_centi_pct, -1);
+
+    // Outside the lock; the sensor often repeats a reading, which is then free
+    climate_t climate;
+    climate_update(temp_centi_c, hum_centi_pct, &climate);
+
+    TickType_t now = xTaskGetTickCount();
+    taskENTER_CRITICAL(&s_last_lock);
+    s_last.temp_centi_c = sample.temp_centi_c;
+    s_last.hum_centi_pct = sample.hum_centi_pct;
+    s_last.time_s = sample.time_s;
+    s_last.tick = now;
+    s_last.seq++;
+    s_last.climate = climate;
+    dht20_sample_t snap = s_last;
+    taskEXIT_CRITICAL(&s_last_lock);
+
+    if (s_history_last == 0 || (now - s_history_last) >= pdMS_TO_TICKS(settings_get_int(SET_HISTORY_S) * 1000)) {
+        history_push(&sample);
+        s_history_last = now;
     }
 
-    // Parse temperature and humidity
-    uint32_t raw_humidity = ((data[1] << 16) | (data[2] << 8) | data[3]) >> 4;
-    uint32_t raw_temperature = ((data[3] & 0x0F) << 16) | (data[4] << 8) | data[5];
-    *humidity = (raw_humidity * 100.0) / (1 << 20);
-    *temperature = (raw_temperature * 200.0) / (1 << 20) - 50.0;
+    for (int i = 0; i < s_listener_count; i++) {
+        s_listeners[i](&snap);
+    }
+}
 
+// Owns the sensor: the UI and every consumer read the cached sample instead of
+// each doing their own 85 ms I2C measurement.
+static void dht20_task(void *arg) {
+    for (;;) {
+        if (trace_replaying()) { // the replay feeds recorded frames instead
+            vTaskDelay(pdMS_TO_TICKS(settings_get_int(SET_SAMPLE_MS)));
+            continue;
+        }
+        centi_c_t temperature;
+        centi_pct_t humidity;
+        int64_t t0 = esp_timer_get_time();
+        esp_err_t ret = dht20_read(&temperature, &humidity);
+        latency_record(LAT_DHT20_READ, (uint32_t)(esp_timer_get_time() - t0));
+        s_read_failed = (ret != ESP_OK);
+        if (!s_read_failed) {
+            dht20_publish(temperature, humidity);
+        }
+        vTaskDelay(pdMS_TO_TICKS(settings_get_int(SET_SAMPLE_MS)));
+    }
+}
+
+void dht20_replay_frame(const uint8_t *frame, size_t len) {
+    if (len != 7) return;
+    centi_c_t temperature;
+    centi_pct_t humidity;
+    dht20_decode(frame, &temperature, &humidity);
+    s_read_failed = false;
+    dht20_publish(temperature, humidity);
+}
+
+esp_err_t dht20_start_sampler(void) {
+    if (s_task) return ESP_OK;
+    if (xTaskCreate(dht20_task, "dht20", 3072, NULL, 4, &s_task) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
     return ESP_OK;
 }
 
-// Function to read DHT20 and update the display
-void draw_dht20(void) {
-    float temperature, humidity;
-    esp_err_t ret = dht20_read(&temperature, &humidity);
+esp_err_t dht20_add_listener(dht20_listener_t cb) {
+    if (!cb || s_listener_count >= DHT20_MAX_LISTENERS) return ESP_ERR_NO_MEM;
+    s_listeners[s_listener_count++] = cb;
+    return ESP_OK;
+}
 
-    char msg[64] = {0};
+// Show the latest sample
+void draw_dht20(void) {
+    dht20_sample_t s;
 
-    if (ret == ESP_OK) {
-        snprintf(msg, sizeof(msg), "T: %.2fC\nH: %.2f%%", temperature, humidity);
-        update_screenf_font(u8g2_font_ncenB12_tr, "%s", msg);
+    if (s_read_failed) {
+        update_screen_text(u8g2_font_ncenB12_tr, "Sensor Error");
+    } else if (dht20_get_last(&s)) {
+        // Four lines of the small font fit under the status bar
+        fmt_t* f = screen_text_begin();
+        fmt_str(f, "T: ");
+        fmt_fixed(f, s.temp_centi_c, 2);
+        fmt_str(f, "C  H: ");
+        fmt_fixed(f, s.hum_centi_pct, 2);
+        fmt_str(f, "%\nDew point: ");
+        fmt_fixed(f, s.climate.dew_point_centi_c, 2);
+        fmt_str(f, "C\nFeels like: ");
+        fmt_fixed(f, s.climate.heat_index_centi_c, 2);
+        fmt_str(f, "C\nAbs hum: ");
+        fmt_fixed(f, s.climate.abs_hum_centi_g_m3, 2);
+        fmt_str(f, " g/m3");
+        screen_text_show(u8g2_font_ncenB08_tr);
     } else {
-        snprintf(msg, sizeof(msg), "Sensor Error");
-        update_screenf_font(u8g2_font_ncenB12_tr, "%s", msg);
+        update_screen_text(u8g2_font_ncenB12_tr, "Reading...");
+    }
+}
+
+void dht20_seed(centi_c_t temp_centi_c, centi_pct_t hum_centi_pct, uint32_t time_s) {
+    climate_t climate;
+    climate_compute(temp_centi_c, hum_centi_pct, &climate);
+
+    taskENTER_CRITICAL(&s_last_lock);
+    if (s_last.seq == 0) {
+        s_last.temp_centi_c = temp_centi_c;
+        s_last.hum_centi_pct = hum_centi_pct;
+        s_last.time_s = time_s;
+        s_last.tick = xTaskGetTickCount();
+        s_last.seq = 1;
+        s_last.climate = climate;
     }
+    taskEXIT_CRITICAL(&s_last_lock);
+}
+
+bool dht20_get_last(dht20_sample_t *out) {
+    taskENTER_CRITICAL(&s_last_lock);
+    *out = s_last;
+    taskEXIT_CRITICAL(&s_last_lock);
+    return out->seq != 0;
 }
\ No newline at end of file
@@ -3,14 +3,40 @@
 
 #include "u8g2.h"
 #include "main.h"
+#include "fixed.h"
+#include "climate.h"
 
 #define DHT20_ADDR              0x38 // DHT20 I2C address
 #define I2C_MASTER_NUM          I2C_NUM_0 // Use I2C port 0
 #define I2C_MASTER_TIMEOUT_MS   1000
 #define DHT20_TAG               "DHT20"
+#define DHT20_MAX_LISTENERS     4
 
-esp_err_t dht20_read(float *temperature, float *humidity);
+typedef struct {
+    int16_t temp_centi_c;
+    uint16_t hum_centi_pct;
+    uint32_t time_s;        // wall clock at sample time
+    TickType_t tick;        // for age, independent of SNTP
+    uint32_t seq;           // 0 until the first good read
+    climate_t climate;      // derived from this temperature / humidity
+} dht20_sample_t;
+
+// Called on the sampler task after every good read
+typedef void (*dht20_listener_t)(const dht20_sample_t *sample);
+
+esp_err_t dht20_read(centi_c_t *temp_centi_c, centi_pct_t *hum_centi_pct);
 void draw_dht20(void);
+// Start the background sampler (every sample_ms, see settings.h). Call after I2C init.
+esp_err_t dht20_start_sampler(void);
+// Register before dht20_start_sampler; the list is not locked.
+esp_err_t dht20_add_listener(dht20_listener_t cb);
+// Decode and publish a recorded 7 byte answer, as if the sensor had just sent it
+void dht20_replay_frame(const uint8_t *frame, size_t len);
+// Boot-time stand-in from the shutdown snapshot until the first real read; only
+// listeners see real samples
+void dht20_seed(centi_c_t temp_centi_c, centi_pct_t hum_centi_pct, uint32_t time_s);
+// Latest good sample; safe from any task. Returns false before the first read.
+bool dht20_get_last(dht20_sample_t *out);
 
 
 #endif /* DHT20 */
@@ -0,0 +1,225 @@
+#include "display.h"
+#include <string.h>
+
+#include <driver/gpio.h>
+#include <driver/spi_master.h>
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#include "main.h"
+#include "mirror.h"
+#include "latency.h"
+
+#define DISPLAY_TAG "DISPLAY"
+#define DISPLAY_STATS_EVERY 512
+
+// One command + one data transaction per page
+#define TRANS_PER_FRAME (DISPLAY_PAGES * 2)
+
+// Transaction user word: bit 0 = DC level, bit 1 = last of frame, bits 2+ = buffer
+#define USER_DC     0x1
+#define USER_END    0x2
+#define USER_BUF(u) (((uintptr_t)(u)) >> 2)
+
+static spi_device_handle_t s_spi = NULL;
+static uint8_t s_dc = 0;
+
+static uint8_t* s_fb[2] = { NULL, NULL };
+static spi_transaction_t s_trans[2][TRANS_PER_FRAME];
+static int s_pending[2] = { 0, 0 };     // transactions of each buffer not yet reaped
+static int s_next = 0;                  // buffer the next flush fills
+
+static volatile int64_t s_queued_us[2];
+static volatile int64_t s_done_us[2];
+static int64_t s_input_us[2];           // input the frame in each buffer answers, 0 if none
+static int64_t s_input_mark = 0;        // input not yet answered by a queued frame
+static display_stats_t s_stats = {0};
+
+static void IRAM_ATTR spi_pre_cb(spi_transaction_t *t)
+{
+    gpio_set_level(PIN_DC, ((uintptr_t)t->user) & USER_DC);
+}
+
+static void IRAM_ATTR spi_post_cb(spi_transaction_t *t)
+{
+    uintptr_t u = (uintptr_t)t->user;
+    if (u & USER_END) {
+        s_done_us[USER_BUF(u)] = esp_timer_get_time();
+    }
+}
+
+static esp_err_t display_spi_init(void)
+{
+    if (s_spi) return ESP_OK;
+
+    spi_bus_config_t bus = {
+        .mosi_io_num = PIN_MOSI,
+        .miso_io_num = -1,
+        .sclk_io_num = PIN_CLK,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .max_transfer_sz = DISPLAY_FB_SIZE,
+    };
+    esp_err_t err = spi_bus_initialize(DISPLAY_SPI_HOST, &bus, SPI_DMA_CH_AUTO);
+    if (err != ESP_OK) {
+        ESP_LOGE(DISPLAY_TAG, "spi_bus_initialize failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    spi_device_interface_config_t dev = {
+        .clock_speed_hz = DISPLAY_SPI_CLOCK_HZ,
+        .mode = 0,
+        .spics_io_num = PIN_CS,
+        .queue_size = TRANS_PER_FRAME * 2,
+        .pre_cb = spi_pre_cb,
+        .post_cb = spi_post_cb,
+    };
+    err = spi_bus_add_device(DISPLAY_SPI_HOST, &dev, &s_spi);
+    if (err != ESP_OK) {
+        ESP_LOGE(DISPLAY_TAG, "spi_bus_add_device failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        s_fb[i] = heap_caps_malloc(DISPLAY_FB_SIZE, MALLOC_CAP_DMA);
+        if (!s_fb[i]) return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+// Reap finished transactions until buffer `buf` is free
+static esp_err_t reap_until_free(int buf, TickType_t timeout)
+{
+    while (s_pending[buf] > 0) {
+        spi_transaction_t *t;
+        esp_err_t err = spi_device_get_trans_result(s_spi, &t, timeout);
+        if (err != ESP_OK) return err;
+        s_pending[USER_BUF(t->user)]--;
+    }
+    return ESP_OK;
+}
+
+esp_err_t display_flush_wait(TickType_t timeout)
+{
+    if (!s_spi) return ESP_OK;
+    esp_err_t err = reap_until_free(0, timeout);
+    if (err == ESP_OK) err = reap_until_free(1, timeout);
+    return err;
+}
+
+uint8_t display_byte_cb(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr)
+{
+    switch (msg) {
+    case U8X8_MSG_BYTE_INIT:
+        display_spi_init();
+        break;
+    case U8X8_MSG_BYTE_SET_DC:
+        s_dc = arg_int;
+        break;
+    case U8X8_MSG_BYTE_START_TRANSFER:
+        // Polling transfers may not overlap queued ones
+        display_flush_wait(portMAX_DELAY);
+        break;
+    case U8X8_MSG_BYTE_SEND: {
+        if (!s_spi || arg_int == 0) break;
+        spi_transaction_t t = {
+            .length = 8 * arg_int,
+            .tx_buffer = arg_ptr,
+            .user = (void*)(uintptr_t)(s_dc ? USER_DC : 0),
+        };
+        spi_device_polling_transmit(s_spi, &t);
+        break;
+    }
+    case U8X8_MSG_BYTE_END_TRANSFER:
+    default:
+        break;
+    }
+    return 0;
+}
+
+esp_err_t display_flush_async(u8g2_t *u8g2)
+{
+    if (!s_spi || !s_fb[0] || !s_fb[1]) {
+        u8g2_SendBuffer(u8g2);
+        return ESP_OK;
+    }
+
+    const int buf = s_next;
+    if (s_pending[buf] > 0) {
+        int64_t t0 = esp_timer_get_time();
+        esp_err_t err = reap_until_free(buf, portMAX_DELAY);
+        if (err != ESP_OK) return err;
+        s_stats.waits++;
+        s_stats.wait_us += (uint64_t)(esp_timer_get_time() - t0);
+    }
+    if (s_done_us[buf] > s_queued_us[buf]) {
+        s_stats.flush_us += (uint64_t)(s_done_us[buf] - s_queued_us[buf]);
+        // Reaped only now, so the sample lands one flush late
+        if (s_input_us[buf]) latency_record(LAT_INPUT_TO_PIXEL, (uint32_t)(s_done_us[buf] - s_input_us[buf]));
+    }
+    s_input_us[buf] = s_input_mark;
+    s_input_mark = 0;
+
+    // Snapshot the frame; drawing carries on in u8g2's own buffer straight away
+    memcpy(s_fb[buf], u8g2_GetBufferPtr(u8g2), DISPLAY_FB_SIZE);
+#if MIRROR_ENABLED
+    mirror_submit_frame(s_fb[buf]);
+#endif
+
+    s_queued_us[buf] = esp_timer_get_time();
+    for (int page = 0; page < DISPLAY_PAGES; page++) {
+        spi_transaction_t *cmd = &s_trans[buf][page * 2];
+        spi_transaction_t *data = &s_trans[buf][page * 2 + 1];
+
+        memset(cmd, 0, sizeof(*cmd));
+        cmd->flags = SPI_TRANS_USE_TXDATA;
+        cmd->length = 3 * 8;
+        cmd->tx_data[0] = 0xB0 | page;  // page address
+        cmd->tx_data[1] = 0x00;         // column low nibble
+        cmd->tx_data[2] = 0x10;         // column high nibble
+        cmd->user = (void*)(uintptr_t)(buf << 2);
+
+        memset(data, 0, sizeof(*data));
+        data->length = 128 * 8;
+        data->tx_buffer = s_fb[buf] + page * 128;
+        data->user = (void*)(uintptr_t)((buf << 2) | USER_DC |
+                                        (page == DISPLAY_PAGES - 1 ? USER_END : 0));
+
+        esp_err_t err = spi_device_queue_trans(s_spi, cmd, portMAX_DELAY);
+        if (err == ESP_OK) err = spi_device_queue_trans(s_spi, data, portMAX_DELAY);
+        if (err != ESP_OK) {
+            ESP_LOGE(DISPLAY_TAG, "queue_trans failed: %s", esp_err_to_name(err));
+            return err;
+        }
+        s_pending[buf] += 2;
+    }
+
+    s_next = buf ^ 1;
+    s_stats.frames++;
+
+    if ((s_stats.frames % DISPLAY_STATS_EVERY) == 0 && s_stats.flush_us > 0) {
+        // Share of SPI time the UI thread did not have to sit through; the wait also
+        // counts reap latency, so it can exceed the SPI time
+        unsigned overlap = 0;
+        if (s_stats.wait_us < s_stats.flush_us) {
+            overlap = (unsigned)(100 - (s_stats.wait_us * 100) / s_stats.flush_us);
+        }
+        ESP_LOGI(DISPLAY_TAG, "frames=%lu flush avg=%lluus wait avg=%lluus overlap=%u%%",
+                 (unsigned long)s_stats.frames,
+                 (unsigned long long)(s_stats.flush_us / s_stats.frames),
+                 (unsigned long long)(s_stats.wait_us / s_stats.frames),
+                 overlap);
+    }
+    return ESP_OK;
+}
+
+void display_mark_input(int64_t t_us)
+{
+    if (!s_input_mark) s_input_mark = t_us; // the oldest unanswered input counts
+}
+
+void display_get_stats(display_stats_t *out)
+{
+    if (out) *out = s_stats;
+}
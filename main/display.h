@@ -0,0 +1,42 @@
+#ifndef DISPLAY
+#define DISPLAY
+
+#include <stdint.h>
+#include <esp_err.h>
+#include <freertos/FreeRTOS.h>
+#include <u8g2.h>
+
+// Asynchronous SPI/DMA flush for the SSD1309. The SPI device is owned here instead
+// of by u8g2_esp32_hal so command bytes (u8g2 init, power save) and queued frame
+// transfers share one device; DC is driven per transaction from the pre-callback.
+
+#define DISPLAY_SPI_HOST        SPI2_HOST
+#define DISPLAY_SPI_CLOCK_HZ    (8 * 1000 * 1000)
+#define DISPLAY_FB_SIZE         1024    // 128x64 / 8
+#define DISPLAY_PAGES           8
+#define DISPLAY_FRAME_BYTES     (DISPLAY_FB_SIZE + 3 * DISPLAY_PAGES) // on the wire, page addressing included
+
+typedef struct {
+    uint32_t frames;
+    uint32_t waits;             // flushes that had to block for a free buffer
+    uint64_t flush_us;          // queue -> last byte on the wire, summed
+    uint64_t wait_us;           // time the caller spent blocked, summed
+} display_stats_t;
+
+// u8x8 byte callback replacing u8g2_esp32_spi_byte_cb. Sends synchronously,
+// after waiting for any queued frame.
+uint8_t display_byte_cb(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr);
+
+// Snapshot u8g2's framebuffer into a free DMA buffer, queue it and return.
+// Only blocks if both DMA buffers are still on the wire.
+esp_err_t display_flush_async(u8g2_t *u8g2);
+
+// Fence: wait until every queued frame has been sent.
+esp_err_t display_flush_wait(TickType_t timeout);
+
+void display_get_stats(display_stats_t *out);
+
+// Input arrived at t_us: the next flushed frame records its input-to-pixel latency
+void display_mark_input(int64_t t_us);
+
+#endif /* DISPLAY */
@@ -0,0 +1,26 @@
+#include "fixed.h"
+
+size_t fixed_format(char* out, size_t out_sz, int32_t value, unsigned decimals)
+{
+    if (!out || out_sz == 0) return 0;
+
+    char tmp[16];
+    size_t n = 0;
+    uint32_t a = (value < 0) ? 0u - (uint32_t)value : (uint32_t)value;
+
+    // Digits come out least significant first
+    do {
+        if (n == decimals && decimals > 0) tmp[n++] = '.';
+        tmp[n++] = (char)('0' + a % 10);
+        a /= 10;
+    } while ((a > 0 || n <= decimals) && n < sizeof(tmp) - 1);
+    if (value < 0) tmp[n++] = '-';
+
+    if (n + 1 > out_sz) {
+        out[0] = '\0';
+        return 0;
+    }
+    for (size_t i = 0; i < n; i++) out[i] = tmp[n - 1 - i];
+    out[n] = '\0';
+    return n;
+}
@@ -0,0 +1,39 @@
+#ifndef FIXED
+#define FIXED
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Fixed-point sensor values in hundredths: centi-degrees C and centi-percent RH.
+// The C6 has no FPU, so everything from the raw reading to the text on screen stays
+// in integers.
+
+typedef int16_t centi_c_t;
+typedef uint16_t centi_pct_t;
+
+// DHT20 20-bit raw values. T = raw * 200 / 2^20 - 50 and RH = raw * 100 / 2^20,
+// rounded to nearest with halves away from zero, like lround(). 20000 / 2^20 ==
+// 625 / 2^15, which keeps raw * 625 inside 32 bits.
+static inline centi_c_t fixed_temp_from_raw20(uint32_t raw)
+{
+    // Offset before rounding so ties below 0 C round down, not up
+    int32_t q15 = (int32_t)(raw * 625u) - 5000 * 32768;
+    return (centi_c_t)((q15 >= 0) ? (q15 + (1 << 14)) >> 15 : -((-q15 + (1 << 14)) >> 15));
+}
+
+static inline centi_pct_t fixed_hum_from_raw20(uint32_t raw)
+{
+    return (centi_pct_t)((raw * 625u + (1u << 15)) >> 16);
+}
+
+// Whole units, halves rounded away from zero
+static inline int32_t fixed_round_centi(int32_t centi)
+{
+    return (centi >= 0) ? (centi + 50) / 100 : -((-centi + 50) / 100);
+}
+
+// value / 10^decimals as text, e.g. (-512, 2) -> "-5.12". Returns the length, or 0
+// (and an empty string) if it does not fit.
+size_t fixed_format(char* out, size_t out_sz, int32_t value, unsigned decimals);
+
+#endif /* FIXED */
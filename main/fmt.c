@@ -0,0 +1,104 @@
+#include "fmt.h"
+#include <string.h>
+
+#include "fixed.h"
+
+static void put(fmt_t* f, const char* s, size_t n)
+{
+    if (f->cap == 0) return;
+    const size_t room = f->cap - 1 - f->len;
+    if (n > room) {
+        n = room;
+        f->truncated = true;
+    }
+    memcpy(f->buf + f->len, s, n);
+    f->len += n;
+    f->buf[f->len] = '\0';
+}
+
+void fmt_char(fmt_t* f, char c)
+{
+    put(f, &c, 1);
+}
+
+void fmt_str(fmt_t* f, const char* s)
+{
+    if (s) put(f, s, strlen(s));
+}
+
+void fmt_strn(fmt_t* f, const char* s, size_t max)
+{
+    if (s) put(f, s, strnlen(s, max));
+}
+
+// Digits are produced right to left into the end of a small scratch buffer
+static void put_number(fmt_t* f, uint32_t a, char sign, unsigned width, char pad)
+{
+    char tmp[24];
+    char* p = tmp + sizeof(tmp);
+    do {
+        *--p = (char)('0' + a % 10);
+        a /= 10;
+    } while (a);
+
+    unsigned n = (unsigned)(tmp + sizeof(tmp) - p) + (sign ? 1 : 0);
+    if (width > sizeof(tmp) - 1) width = sizeof(tmp) - 1;
+    if (pad == '0') {
+        while (n < width) {
+            *--p = '0';
+            n++;
+        }
+        if (sign) *--p = sign;
+    } else {
+        if (sign) *--p = sign;
+        while (n < width) {
+            *--p = ' ';
+            n++;
+        }
+    }
+    put(f, p, (size_t)(tmp + sizeof(tmp) - p));
+}
+
+void fmt_uint_pad(fmt_t* f, uint32_t v, unsigned width, char pad)
+{
+    put_number(f, v, 0, width, pad);
+}
+
+void fmt_int_pad(fmt_t* f, int32_t v, unsigned width, char pad)
+{
+    put_number(f, (v < 0) ? 0u - (uint32_t)v : (uint32_t)v, (v < 0) ? '-' : 0, width, pad);
+}
+
+void fmt_int_signed(fmt_t* f, int32_t v)
+{
+    put_number(f, (v < 0) ? 0u - (uint32_t)v : (uint32_t)v, (v < 0) ? '-' : '+', 0, ' ');
+}
+
+void fmt_hex(fmt_t* f, uint32_t v, unsigned width)
+{
+    static const char digits[] = "0123456789ABCDEF";
+    char tmp[8];
+    unsigned n = 0;
+    if (width > sizeof(tmp)) width = sizeof(tmp);
+    do {
+        tmp[sizeof(tmp) - 1 - n++] = digits[v & 0xF];
+        v >>= 4;
+    } while (v && n < sizeof(tmp));
+    while (n < width) tmp[sizeof(tmp) - 1 - n++] = '0';
+    put(f, tmp + sizeof(tmp) - n, n);
+}
+
+void fmt_fixed(fmt_t* f, int32_t value, unsigned decimals)
+{
+    char tmp[16];
+    const size_t n = fixed_format(tmp, sizeof(tmp), value, decimals);
+    put(f, tmp, n);
+}
+
+void fmt_ip4(fmt_t* f, uint32_t addr)
+{
+    for (int i = 0; i < 4; i++) {
+        if (i) fmt_char(f, '.');
+        fmt_uint(f, (addr >> (8 * i)) & 0xFF);
+    }
+}
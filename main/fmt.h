@@ -0,0 +1,52 @@
+#ifndef FMT
+#define FMT
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Integer-only text builder for the render paths. Each call appends to a caller
+// buffer, so a screen is formatted once, straight into the layout engine's text
+// (screen_text_begin), instead of snprintf into a temporary and then vsnprintf
+// "%s" again. Nothing here goes through newlib's printf. Output that does not fit
+// is cut off and `truncated` set; the buffer is always NUL terminated.
+
+typedef struct {
+    char* buf;
+    size_t cap;             // including the NUL
+    size_t len;
+    bool truncated;
+} fmt_t;
+
+static inline void fmt_init(fmt_t* f, char* buf, size_t cap)
+{
+    f->buf = buf;
+    f->cap = cap;
+    f->len = 0;
+    f->truncated = (cap == 0);
+    if (cap) buf[0] = '\0';
+}
+
+void fmt_char(fmt_t* f, char c);
+void fmt_str(fmt_t* f, const char* s);
+// At most `max` characters of s, like "%.*s"
+void fmt_strn(fmt_t* f, const char* s, size_t max);
+
+// Decimal, right-aligned to `width` with `pad` (' ' or '0'; zeros go after the sign)
+void fmt_uint_pad(fmt_t* f, uint32_t v, unsigned width, char pad);
+void fmt_int_pad(fmt_t* f, int32_t v, unsigned width, char pad);
+static inline void fmt_uint(fmt_t* f, uint32_t v) { fmt_uint_pad(f, v, 0, ' '); }
+static inline void fmt_int(fmt_t* f, int32_t v) { fmt_int_pad(f, v, 0, ' '); }
+// Sign always shown, like "%+d"
+void fmt_int_signed(fmt_t* f, int32_t v);
+// Upper case, zero padded to `width` digits, like "%02X"
+void fmt_hex(fmt_t* f, uint32_t v, unsigned width);
+
+// value / 10^decimals, e.g. (-512, 2) -> "-5.12"; see fixed_format()
+void fmt_fixed(fmt_t* f, int32_t value, unsigned decimals);
+
+// Dotted quad of an esp_ip4_addr_t.addr. The address is in network order in
+// memory, so on this little-endian target the first octet is the low byte.
+void fmt_ip4(fmt_t* f, uint32_t addr);
+
+#endif /* FMT */
@@ -0,0 +1,337 @@
+#include "forecast.h"
+#include <string.h>
+
+#define SECS_PER_DAY 86400
+
+// Container kinds on the frame stack
+enum {
+    F_ROOT,
+    F_LIST,         // "list": [ ... ]
+    F_ENTRY,        // one element of list
+    F_MAIN,         // entry.main
+    F_WEATHER,      // entry.weather: [ ... ]
+    F_COND,         // entry.weather[0]
+    F_CITY,
+    F_OTHER_OBJ,
+    F_OTHER_ARR,
+};
+
+// Keys we care about; anything else is K_OTHER
+enum {
+    K_OTHER,
+    K_LIST,
+    K_DT,
+    K_MAIN,
+    K_TEMP,
+    K_HUMIDITY,
+    K_WEATHER,
+    K_ID,
+    K_CITY,
+    K_TIMEZONE,
+};
+
+static const char* const s_keys[] = {
+    [K_LIST] = "list", [K_DT] = "dt", [K_MAIN] = "main", [K_TEMP] = "temp",
+    [K_HUMIDITY] = "humidity", [K_WEATHER] = "weather", [K_ID] = "id",
+    [K_CITY] = "city", [K_TIMEZONE] = "timezone",
+};
+
+enum { LEX_VALUE, LEX_STRING, LEX_STRING_ESC, LEX_SCALAR };
+
+// Bits of cur_have
+#define HAVE_DT     0x01
+#define HAVE_TEMP   0x02
+#define HAVE_HUM    0x04
+#define HAVE_COND   0x08
+
+static bool is_object(uint8_t frame)
+{
+    return frame != F_LIST && frame != F_WEATHER && frame != F_OTHER_ARR;
+}
+
+static uint8_t top(const forecast_parser_t* p)
+{
+    return p->depth ? p->frames[p->depth - 1] : F_OTHER_ARR;
+}
+
+static uint8_t match_key(const forecast_parser_t* p)
+{
+    if (p->tok_long) return K_OTHER;
+    for (uint8_t k = 1; k < sizeof(s_keys) / sizeof(s_keys[0]); k++) {
+        if (strlen(s_keys[k]) == p->tok_len && memcmp(s_keys[k], p->tok, p->tok_len) == 0) return k;
+    }
+    return K_OTHER;
+}
+
+// JSON number to value * 10^decimals, rounded half away from zero. Exponents are not
+// expected from OpenWeather and are rejected.
+static bool parse_scaled(const char* s, size_t len, unsigned decimals, int64_t* out)
+{
+    size_t i = 0;
+    bool neg = false;
+    if (i < len && s[i] == '-') {
+        neg = true;
+        i++;
+    }
+    if (i == len) return false;
+
+    int64_t v = 0;
+    unsigned frac = 0;
+    bool dot = false, round_up = false;
+    for (; i < len; i++) {
+        char c = s[i];
+        if (c == '.' && !dot) {
+            dot = true;
+        } else if (c >= '0' && c <= '9') {
+            if (!dot || frac < decimals) {
+                if (v > INT64_MAX / 10 - 9) return false;
+                v = v * 10 + (c - '0');
+                if (dot) frac++;
+            } else if (frac == decimals) {
+                round_up = (c >= '5');
+                frac++; // later digits no longer matter
+            }
+        } else {
+            return false;
+        }
+    }
+    for (; frac < decimals; frac++) v *= 10;
+    if (round_up) v++;
+    *out = neg ? -v : v;
+    return true;
+}
+
+static void on_scalar(forecast_parser_t* p)
+{
+    int64_t v;
+    const uint8_t frame = top(p);
+    const uint8_t key = p->key;
+
+    if (p->tok_long) return;
+    if (frame == F_MAIN && key == K_TEMP) {
+        if (parse_scaled(p->tok, p->tok_len, 2, &v) && v >= INT16_MIN && v <= INT16_MAX) {
+            p->cur.temp_centi_c = (int16_t)v;
+            p->cur_have |= HAVE_TEMP;
+        }
+    } else if (frame == F_MAIN && key == K_HUMIDITY) {
+        if (parse_scaled(p->tok, p->tok_len, 0, &v) && v >= 0 && v <= 100) {
+            p->cur.hum_pct = (uint8_t)v;
+            p->cur_have |= HAVE_HUM;
+        }
+    } else if (frame == F_ENTRY && key == K_DT) {
+        if (parse_scaled(p->tok, p->tok_len, 0, &v) && v >= 0 && v <= UINT32_MAX) {
+            p->cur.time_s = (uint32_t)v;
+            p->cur_have |= HAVE_DT;
+        }
+    } else if (frame == F_COND && key == K_ID) {
+        if (parse_scaled(p->tok, p->tok_len, 0, &v) && v >= 0 && v <= UINT16_MAX) {
+            p->cur.cond_id = (uint16_t)v;
+            p->cur_have |= HAVE_COND;
+        }
+    } else if (frame == F_CITY && key == K_TIMEZONE) {
+        if (parse_scaled(p->tok, p->tok_len, 0, &v) && v >= -14 * 3600 && v <= 14 * 3600) {
+            p->out->tz_offset_s = (int32_t)v;
+        }
+    }
+}
+
+static bool open_container(forecast_parser_t* p, bool object)
+{
+    if (p->depth >= FORECAST_MAX_DEPTH) return false;
+
+    const uint8_t parent = top(p);
+    uint8_t kind = object ? F_OTHER_OBJ : F_OTHER_ARR;
+    if (p->depth == 0) {
+        if (!object || p->frames[0] == F_ROOT) return false; // one document only
+        kind = F_ROOT;
+    } else if (parent == F_ROOT && !object && p->key == K_LIST) {
+        kind = F_LIST;
+    } else if (parent == F_ROOT && object && p->key == K_CITY) {
+        kind = F_CITY;
+    } else if (parent == F_LIST && object) {
+        kind = F_ENTRY;
+        memset(&p->cur, 0, sizeof(p->cur));
+        p->cur_have = 0;
+    } else if (parent == F_ENTRY && object && p->key == K_MAIN) {
+        kind = F_MAIN;
+    } else if (parent == F_ENTRY && !object && p->key == K_WEATHER) {
+        kind = F_WEATHER;
+    } else if (parent == F_WEATHER && object && !(p->cur_have & HAVE_COND)) {
+        kind = F_COND;
+    }
+
+    p->frames[p->depth++] = kind;
+    p->expect_key = object;
+    p->key = K_OTHER;
+    return true;
+}
+
+static bool close_container(forecast_parser_t* p, bool object)
+{
+    if (p->depth == 0 || is_object(top(p)) != object) return false;
+
+    const uint8_t kind = p->frames[--p->depth];
+    if (kind == F_ENTRY && (p->cur_have & HAVE_DT) && p->out->count < FORECAST_MAX_ENTRIES) {
+        p->out->entries[p->out->count++] = p->cur;
+    }
+    p->expect_key = false;
+    p->key = K_OTHER; // the key that named this container is done
+    return true;
+}
+
+static void tok_push(forecast_parser_t* p, char c)
+{
+    if (p->tok_len < FORECAST_TOK_MAX) {
+        p->tok[p->tok_len++] = c;
+    } else {
+        p->tok_long = true;
+    }
+}
+
+static bool end_scalar(forecast_parser_t* p)
+{
+    p->lex = LEX_VALUE;
+    if (p->depth == 0 || p->expect_key) return false;
+    on_scalar(p);
+    return true;
+}
+
+// Between tokens: structure characters and the start of strings and scalars
+static bool on_structural(forecast_parser_t* p, char c)
+{
+    switch (c) {
+    case ' ': case '\t': case '\r': case '\n':
+        return true;
+    case '{':
+        return !p->expect_key && open_container(p, true);
+    case '[':
+        return !p->expect_key && open_container(p, false);
+    case '}':
+        return close_container(p, true);
+    case ']':
+        return close_container(p, false);
+    case ':':
+        return true; // the key was already taken when its string closed
+    case ',':
+        p->expect_key = is_object(top(p));
+        return p->depth > 0;
+    case '"':
+        p->lex = LEX_STRING;
+        p->tok_len = 0;
+        p->tok_long = false;
+        return p->depth > 0;
+    default:
+        if (p->expect_key) return false;
+        p->lex = LEX_SCALAR;
+        p->tok_len = 0;
+        p->tok_long = false;
+        tok_push(p, c);
+        return true;
+    }
+}
+
+void forecast_parser_init(forecast_parser_t* p, forecast_t* out)
+{
+    memset(p, 0, sizeof(*p));
+    memset(out, 0, sizeof(*out));
+    p->out = out;
+    p->frames[0] = F_OTHER_OBJ; // becomes F_ROOT when the document opens
+}
+
+bool forecast_parser_feed(forecast_parser_t* p, const char* data, size_t len)
+{
+    for (size_t i = 0; i < len && !p->error; i++) {
+        const char c = data[i];
+        bool ok = true;
+
+        switch (p->lex) {
+        case LEX_STRING:
+            if (c == '"') {
+                p->lex = LEX_VALUE;
+                if (p->expect_key) {
+                    p->key = match_key(p);
+                    p->expect_key = false;
+                }
+            } else if (c == '\\') {
+                p->lex = LEX_STRING_ESC;
+            } else {
+                tok_push(p, c);
+            }
+            break;
+        case LEX_STRING_ESC:
+            p->lex = LEX_STRING;
+            tok_push(p, c); // keys we match never contain escapes
+            break;
+        case LEX_SCALAR:
+            if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' ||
+                (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+                tok_push(p, c);
+                break;
+            }
+            ok = end_scalar(p) && on_structural(p, c);
+            break;
+        default:
+            ok = on_structural(p, c);
+            break;
+        }
+        if (!ok) p->error = true;
+    }
+    return !p->error;
+}
+
+bool forecast_parser_finish(forecast_parser_t* p)
+{
+    if (p->lex == LEX_SCALAR && !end_scalar(p)) p->error = true;
+    return !p->error && p->lex == LEX_VALUE && p->depth == 0 && p->frames[0] == F_ROOT;
+}
+
+size_t forecast_daily(const forecast_t* f, forecast_day_t* days, size_t max_days)
+{
+    size_t n = 0;
+    uint32_t hum_sum = 0, hum_count = 0;
+    int32_t best_dist = 0;
+
+    for (size_t i = 0; i < f->count; i++) {
+        const forecast_entry_t* e = &f->entries[i];
+        const int64_t local = (int64_t)e->time_s + f->tz_offset_s;
+        if (local < 0) continue;
+        const uint32_t day = (uint32_t)(local / SECS_PER_DAY);
+        int32_t dist = (int32_t)(local % SECS_PER_DAY) - 12 * 3600;
+        if (dist < 0) dist = -dist;
+
+        forecast_day_t* d = n ? &days[n - 1] : NULL;
+        if (!d || d->day != day) {
+            if (n == max_days) break;
+            d = &days[n++];
+            d->day = day;
+            d->weekday = (uint8_t)((day + 4) % 7); // 1970-01-01 was a Thursday
+            d->tmin_centi_c = d->tmax_centi_c = e->temp_centi_c;
+            d->cond_id = e->cond_id;
+            best_dist = dist;
+            hum_sum = hum_count = 0;
+        }
+        if (e->temp_centi_c < d->tmin_centi_c) d->tmin_centi_c = e->temp_centi_c;
+        if (e->temp_centi_c > d->tmax_centi_c) d->tmax_centi_c = e->temp_centi_c;
+        if (dist < best_dist) {
+            best_dist = dist;
+            d->cond_id = e->cond_id;
+        }
+        hum_sum += e->hum_pct;
+        hum_count++;
+        d->hum_pct = (uint8_t)((hum_sum + hum_count / 2) / hum_count);
+    }
+    return n;
+}
+
+const char* forecast_condition(uint16_t cond_id)
+{
+    switch (cond_id / 100) {
+    case 2: return "Storm";
+    case 3: return "Drizzle";
+    case 5: return "Rain";
+    case 6: return "Snow";
+    case 7: return "Fog";
+    case 8: return (cond_id == 800) ? "Clear" : "Clouds";
+    default: return "?";
+    }
+}
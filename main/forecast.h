@@ -0,0 +1,71 @@
+#ifndef FORECAST
+#define FORECAST
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// OpenWeather /forecast (5 days, 3 hour steps) parsed as the body streams in. No ESP-IDF
+// dependencies, so it runs on the host against recorded responses.
+//
+// The parser is a byte-at-a-time JSON scanner that keeps only a stack of container
+// kinds, the last key and the token being read, so its state is under 100 bytes no
+// matter how large the response is. It picks out, per entry of "list":
+//   dt, main.temp, main.humidity, weather[0].id
+// and city.timezone, and packs each entry into a forecast_entry_t as it closes.
+
+#define FORECAST_MAX_ENTRIES    40      // cnt=40 is the whole 5 days
+#define FORECAST_MAX_DAYS       6       // 40 x 3 h can touch 6 local days
+#define FORECAST_MAX_DEPTH      8
+#define FORECAST_TOK_MAX        24
+
+typedef struct {
+    uint32_t time_s;        // UTC start of the 3 h step
+    int16_t temp_centi_c;
+    uint16_t cond_id;       // OpenWeather condition code, e.g. 500 light rain
+    uint8_t hum_pct;
+} forecast_entry_t;
+
+typedef struct {
+    forecast_entry_t entries[FORECAST_MAX_ENTRIES];
+    uint8_t count;
+    int32_t tz_offset_s;    // city.timezone
+} forecast_t;
+
+typedef struct {
+    uint32_t day;           // local days since 1970-01-01
+    uint8_t weekday;        // 0 = Sunday
+    int16_t tmin_centi_c;
+    int16_t tmax_centi_c;
+    uint8_t hum_pct;        // mean
+    uint16_t cond_id;       // from the step closest to local noon
+} forecast_day_t;
+
+typedef struct {
+    forecast_t* out;
+    uint8_t frames[FORECAST_MAX_DEPTH];     // kind of each open container
+    uint8_t depth;
+    uint8_t lex;
+    bool expect_key;
+    uint8_t key;                            // last key seen in the innermost object
+    char tok[FORECAST_TOK_MAX];
+    uint8_t tok_len;
+    bool tok_long;                          // token did not fit, value is ignored
+    forecast_entry_t cur;
+    uint8_t cur_have;
+    bool error;
+} forecast_parser_t;
+
+void forecast_parser_init(forecast_parser_t* p, forecast_t* out);
+// Any split of the body is fine. Returns false once the input is found malformed.
+bool forecast_parser_feed(forecast_parser_t* p, const char* data, size_t len);
+// True if the document was complete and well formed.
+bool forecast_parser_finish(forecast_parser_t* p);
+
+// Group the entries by local day. Returns the number of days written.
+size_t forecast_daily(const forecast_t* f, forecast_day_t* days, size_t max_days);
+
+// Short label for an OpenWeather condition code, e.g. "Rain"
+const char* forecast_condition(uint16_t cond_id);
+
+#endif /* FORECAST */
@@ -0,0 +1,110 @@
+#include "game.h"
+#include <string.h>
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "display.h"
+#include "latency.h"
+
+static const char* TAG = "game";
+
+void game_blit(uint8_t* fb, int x, int y, const uint8_t* cols, int w)
+{
+    if (y <= -8 || y >= GAME_FB_H) return;
+    const int page = y >> 3;                // arithmetic shift: -1 for y in -7..-1
+    const int shift = y & 7;
+    uint8_t* top = (page >= 0) ? fb + page * GAME_FB_W : NULL;
+    uint8_t* bottom = (shift && page + 1 < GAME_FB_H / 8) ? fb + (page + 1) * GAME_FB_W : NULL;
+
+    for (int i = 0; i < w; i++) {
+        const int cx = x + i;
+        if (cx < 0 || cx >= GAME_FB_W) continue;
+        if (top) top[cx] |= (uint8_t)(cols[i] << shift);
+        if (bottom) bottom[cx] |= (uint8_t)(cols[i] >> (8 - shift));
+    }
+}
+
+// esp_timer task: one notification per tick, they add up if the UI task is late
+static void frame_tick(void* arg)
+{
+    xTaskNotifyGive((TaskHandle_t)arg);
+}
+
+esp_err_t game_run(const game_t* game, u8g2_t* u8g2, game_poll_t poll, game_stats_t* stats)
+{
+    if (!game || !u8g2 || !poll || !stats) return ESP_ERR_INVALID_ARG;
+    memset(stats, 0, sizeof(*stats));
+
+    esp_timer_handle_t timer;
+    const esp_timer_create_args_t args = {
+        .callback = frame_tick,
+        .arg = xTaskGetCurrentTaskHandle(),
+        .name = "game",
+    };
+    esp_err_t err = esp_timer_create(&args, &timer);
+    if (err != ESP_OK) return err;
+
+    const UBaseType_t prio = uxTaskPriorityGet(NULL);
+    vTaskPrioritySet(NULL, GAME_TASK_PRIO);
+    ulTaskNotifyTake(pdTRUE, 0);
+    while (poll()) {} // keys typed before the game started
+
+    game->start();
+    const int64_t start_us = esp_timer_get_time();
+    esp_timer_start_periodic(timer, GAME_TICK_US);
+
+    uint64_t work_us = 0;
+    int64_t last_frame_us = 0;
+    uint8_t pressed = 0;
+    bool running = true;
+    while (running) {
+        uint32_t due = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+        if (due == 0) continue;
+        const int64_t t0 = esp_timer_get_time();
+
+        for (uint8_t b; (b = poll()) != 0;) pressed |= b;
+        if (pressed & GAME_BTN_QUIT) break;
+
+        if (due > GAME_MAX_CATCHUP) {
+            stats->dropped += due - GAME_MAX_CATCHUP;
+            due = GAME_MAX_CATCHUP;
+        }
+        for (uint32_t i = 0; i < due && running; i++) {
+            running = game->step(pressed);
+            pressed = 0; // a press counts once
+            stats->ticks++;
+        }
+
+        u8g2_ClearBuffer(u8g2);
+        game->draw(u8g2);
+        display_flush_async(u8g2);
+
+        const uint32_t work = (uint32_t)(esp_timer_get_time() - t0);
+        work_us += work;
+        if (work > stats->work_max_us) stats->work_max_us = work;
+        if (last_frame_us) {
+            const uint32_t interval = (uint32_t)(t0 - last_frame_us);
+            latency_record(LAT_GAME_FRAME, interval);
+            if (interval > GAME_TICK_US * 3 / 2) stats->late++;
+        }
+        last_frame_us = t0;
+        stats->frames++;
+    }
+
+    esp_timer_stop(timer);
+    esp_timer_delete(timer);
+    vTaskPrioritySet(NULL, prio);
+
+    stats->score = game->score();
+    stats->elapsed_ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+    stats->work_avg_us = stats->frames ? (uint32_t)(work_us / stats->frames) : 0;
+    ESP_LOGI(TAG, "%s: score %lu, %lu frames in %lu ms, %lu late, %lu ticks dropped, work avg %luus max %luus",
+             game->name, (unsigned long)stats->score, (unsigned long)stats->frames,
+             (unsigned long)stats->elapsed_ms, (unsigned long)stats->late,
+             (unsigned long)stats->dropped, (unsigned long)stats->work_avg_us,
+             (unsigned long)stats->work_max_us);
+    return ESP_OK;
+}
@@ -0,0 +1,67 @@
+#ifndef GAME
+#define GAME
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <esp_err.h>
+#include <u8g2.h>
+
+// Fixed-timestep runtime for the Games menu. An esp_timer wakes the UI task every
+// GAME_TICK_US; the game steps once per tick that came due (up to GAME_MAX_CATCHUP,
+// the rest are dropped so a stall doesn't turn into a burst), then draws one frame
+// straight into u8g2's page buffer and queues it on the async flush. Input is
+// polled without blocking before the steps. While a game runs the UI task sits
+// above the app's network tasks so HTTP, MQTT and the mirror don't steal frames.
+
+#define GAME_FPS            60
+#define GAME_TICK_US        (1000000 / GAME_FPS)
+#define GAME_MAX_CATCHUP    4
+#define GAME_TASK_PRIO      6       // above httpd (5), dht20, mqtt_pub and mirror; below lwIP and WiFi
+
+#define GAME_FB_W           128
+#define GAME_FB_H           64
+
+// Buttons pressed since the last poll
+#define GAME_BTN_UP         0x01
+#define GAME_BTN_DOWN       0x02
+#define GAME_BTN_LEFT       0x04
+#define GAME_BTN_RIGHT      0x08
+#define GAME_BTN_A          0x10
+#define GAME_BTN_QUIT       0x80
+
+typedef uint8_t (*game_poll_t)(void);
+
+typedef struct {
+    const char* name;
+    void (*start)(void);
+    // One tick with the buttons pressed since the previous one; false once it's over
+    bool (*step)(uint8_t pressed);
+    // Into a cleared buffer, the whole 128x64 is the game's
+    void (*draw)(u8g2_t* u8g2);
+    uint32_t (*score)(void);
+} game_t;
+
+typedef struct {
+    uint32_t score;
+    uint32_t frames;
+    uint32_t ticks;
+    uint32_t dropped;       // ticks skipped beyond GAME_MAX_CATCHUP
+    uint32_t late;          // frames more than 1.5 ticks after the previous one
+    uint32_t elapsed_ms;
+    uint32_t work_avg_us;   // step + draw + queueing the flush
+    uint32_t work_max_us;
+} game_stats_t;
+
+extern const game_t game_snake;
+extern const game_t game_tetris;
+
+// Blocks until the game ends or GAME_BTN_QUIT. Frame intervals also go to
+// LAT_GAME_FRAME.
+esp_err_t game_run(const game_t* game, u8g2_t* u8g2, game_poll_t poll, game_stats_t* stats);
+
+// ORs w columns of a sprite into the page buffer at (x, y), clipped. Sprites are
+// column bytes with bit 0 at the top, the panel's own layout, so when y is a
+// multiple of 8 each column is a single byte OR; otherwise it splits over two pages.
+void game_blit(uint8_t* fb, int x, int y, const uint8_t* cols, int w);
+
+#endif /* GAME */
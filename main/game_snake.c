@@ -0,0 +1,154 @@
+#include "game.h"
+#include <string.h>
+
+#include <esp_random.h>
+
+#include "fmt.h"
+#include "glyph_cache.h"
+
+// 4x4 px cells under an 8 px score line. Occupancy is one bitmask per row, so a
+// collision is a single AND and placing food is a popcount walk.
+#define SNAKE_COLS      32
+#define SNAKE_ROWS      14
+#define SNAKE_CELL      4
+#define SNAKE_TOP       8
+#define SNAKE_MAX       (SNAKE_COLS * SNAKE_ROWS)
+#define SNAKE_START_LEN 4
+#define SNAKE_PERIOD    8       // ticks per move at the start, 7.5 moves/s
+#define SNAKE_PERIOD_MIN 3
+
+typedef struct { uint8_t x, y; } cell_t;
+
+static cell_t s_body[SNAKE_MAX];        // ring, s_head is the newest
+static uint16_t s_head, s_len;
+static uint32_t s_occ[SNAKE_ROWS];
+static cell_t s_food;
+static int8_t s_dx, s_dy;               // current direction
+static int8_t s_next_dx, s_next_dy;     // last turn asked for, taken on the next move
+static uint8_t s_grow;
+static uint8_t s_timer;
+static uint32_t s_score;
+
+static const uint8_t s_body_sprite[SNAKE_CELL] = { 0x07, 0x07, 0x07, 0x00 };
+static const uint8_t s_head_sprite[SNAKE_CELL] = { 0x07, 0x05, 0x07, 0x00 };
+static const uint8_t s_food_sprite[SNAKE_CELL] = { 0x02, 0x07, 0x02, 0x00 };
+
+static void occ_set(cell_t c, bool on)
+{
+    if (on) s_occ[c.y] |= 1u << c.x;
+    else s_occ[c.y] &= ~(1u << c.x);
+}
+
+static void place_food(void)
+{
+    const uint32_t free_cells = SNAKE_MAX - s_len;
+    if (free_cells == 0) return;
+    uint32_t n = esp_random() % free_cells;
+    for (uint8_t y = 0; y < SNAKE_ROWS; y++) {
+        const uint32_t free_row = ~s_occ[y];
+        const uint32_t in_row = __builtin_popcount(free_row);
+        if (n >= in_row) {
+            n -= in_row;
+            continue;
+        }
+        uint32_t bits = free_row;
+        while (n--) bits &= bits - 1;   // drop the lowest n free cells
+        s_food = (cell_t){ (uint8_t)__builtin_ctz(bits), y };
+        return;
+    }
+}
+
+static void snake_start(void)
+{
+    memset(s_occ, 0, sizeof(s_occ));
+    s_len = 0;
+    s_head = SNAKE_MAX - 1;
+    for (uint8_t i = 0; i < SNAKE_START_LEN; i++) {
+        s_head = (s_head + 1) % SNAKE_MAX;
+        s_body[s_head] = (cell_t){ (uint8_t)(SNAKE_COLS / 4 + i), SNAKE_ROWS / 2 };
+        occ_set(s_body[s_head], true);
+        s_len++;
+    }
+    s_dx = s_next_dx = 1;
+    s_dy = s_next_dy = 0;
+    s_grow = 0;
+    s_timer = 0;
+    s_score = 0;
+    place_food();
+}
+
+static bool snake_step(uint8_t pressed)
+{
+    // No reversing into the neck
+    if ((pressed & GAME_BTN_UP) && s_dy == 0)         { s_next_dx = 0;  s_next_dy = -1; }
+    else if ((pressed & GAME_BTN_DOWN) && s_dy == 0)  { s_next_dx = 0;  s_next_dy = 1; }
+    else if ((pressed & GAME_BTN_LEFT) && s_dx == 0)  { s_next_dx = -1; s_next_dy = 0; }
+    else if ((pressed & GAME_BTN_RIGHT) && s_dx == 0) { s_next_dx = 1;  s_next_dy = 0; }
+
+    const uint8_t period = (s_score / 4 < SNAKE_PERIOD - SNAKE_PERIOD_MIN) ? SNAKE_PERIOD - s_score / 4 : SNAKE_PERIOD_MIN;
+    if (++s_timer < period) return true;
+    s_timer = 0;
+
+    s_dx = s_next_dx;
+    s_dy = s_next_dy;
+    const cell_t head = s_body[s_head];
+    const int nx = head.x + s_dx;
+    const int ny = head.y + s_dy;
+    if (nx < 0 || nx >= SNAKE_COLS || ny < 0 || ny >= SNAKE_ROWS) return false;
+
+    // The tail moves out of the way first, so chasing it is allowed
+    if (s_grow) {
+        s_grow--;
+    } else {
+        const uint16_t tail = (s_head + SNAKE_MAX + 1 - s_len) % SNAKE_MAX;
+        occ_set(s_body[tail], false);
+        s_len--;
+    }
+    if (s_occ[ny] & (1u << nx)) return false;
+
+    s_head = (s_head + 1) % SNAKE_MAX;
+    s_body[s_head] = (cell_t){ (uint8_t)nx, (uint8_t)ny };
+    occ_set(s_body[s_head], true);
+    s_len++;
+
+    if (nx == s_food.x && ny == s_food.y) {
+        s_score++;
+        s_grow += 2;
+        place_food();
+    }
+    return s_len < SNAKE_MAX;
+}
+
+static void snake_draw(u8g2_t* u8g2)
+{
+    uint8_t* fb = u8g2_GetBufferPtr(u8g2);
+
+    for (uint16_t i = 0; i < s_len; i++) {
+        const cell_t c = s_body[(s_head + SNAKE_MAX - i) % SNAKE_MAX];
+        game_blit(fb, c.x * SNAKE_CELL, SNAKE_TOP + c.y * SNAKE_CELL,
+                  i == 0 ? s_head_sprite : s_body_sprite, SNAKE_CELL);
+    }
+    game_blit(fb, s_food.x * SNAKE_CELL, SNAKE_TOP + s_food.y * SNAKE_CELL, s_food_sprite, SNAKE_CELL);
+
+    char line[24];
+    fmt_t f;
+    fmt_init(&f, line, sizeof(line));
+    fmt_str(&f, "Snake  ");
+    fmt_uint(&f, s_score);
+    u8g2_SetFont(u8g2, u8g2_font_5x8_tr);
+    glyph_cache_draw_str(u8g2, 0, 6, line);
+    u8g2_DrawHLine(u8g2, 0, SNAKE_TOP - 1, GAME_FB_W);
+}
+
+static uint32_t snake_score(void)
+{
+    return s_score;
+}
+
+const game_t game_snake = {
+    .name = "Snake",
+    .start = snake_start,
+    .step = snake_step,
+    .draw = snake_draw,
+    .score = snake_score,
+};
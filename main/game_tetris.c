@@ -0,0 +1,211 @@
+#include "game.h"
+#include <string.h>
+
+#include <esp_random.h>
+
+#include "fmt.h"
+#include "glyph_cache.h"
+
+// Board rows are 16 bit masks: the 10 playable columns sit at bits 3..12 and the
+// rest are set, so the side walls and the floor (a row of all ones) collide like
+// any other block and a move is tested with four ANDs.
+#define TETRIS_W        10
+#define TETRIS_H        20
+#define TETRIS_LEFT     3                   // bit of column 0
+#define TETRIS_WALLS    ((uint16_t)~(((1u << TETRIS_W) - 1) << TETRIS_LEFT))
+#define TETRIS_FULL     0xFFFF
+#define TETRIS_CELL     3
+#define TETRIS_X0       49                  // board position on screen
+#define TETRIS_Y0       2
+#define TETRIS_GRAVITY  48                  // ticks per row at level 0
+#define TETRIS_GRAVITY_MIN 6
+#define TETRIS_PIECES   7
+
+// Pieces are 4x4 masks, row r in bits 4r..4r+3 with bit 0 the leftmost column
+static uint16_t s_shapes[TETRIS_PIECES][4];
+
+static uint16_t s_board[TETRIS_H];
+static uint8_t s_piece, s_rot, s_next;
+static int8_t s_x, s_y;                     // board bit and row of the mask's top-left
+static uint8_t s_fall;
+static uint32_t s_score, s_lines;
+
+static const uint8_t s_cell_sprite[TETRIS_CELL] = { 0x07, 0x07, 0x07 };
+
+// Spawn orientation and the size of the box it rotates in
+static const struct { uint16_t mask; uint8_t n; } s_spawn[TETRIS_PIECES] = {
+    { 0x00F0, 4 },  // I
+    { 0x0033, 2 },  // O
+    { 0x0072, 3 },  // T
+    { 0x0036, 3 },  // S
+    { 0x0063, 3 },  // Z
+    { 0x0071, 3 },  // J
+    { 0x0074, 3 },  // L
+};
+
+static uint16_t rotate(uint16_t m, uint8_t n)
+{
+    uint16_t out = 0;
+    for (uint8_t r = 0; r < n; r++) {
+        for (uint8_t c = 0; c < n; c++) {
+            if (m & (1u << (r * 4 + c))) out |= 1u << (c * 4 + (n - 1 - r));
+        }
+    }
+    return out;
+}
+
+static uint16_t board_row(int y)
+{
+    if (y < 0) return TETRIS_WALLS;
+    return (y < TETRIS_H) ? s_board[y] : TETRIS_FULL;
+}
+
+static bool fits(uint8_t piece, uint8_t rot, int x, int y)
+{
+    const uint16_t m = s_shapes[piece][rot];
+    for (int r = 0; r < 4; r++) {
+        const uint16_t row = (m >> (r * 4)) & 0xF;
+        if (row && (board_row(y + r) & (uint16_t)(row << x))) return false;
+    }
+    return true;
+}
+
+static bool spawn(void)
+{
+    s_piece = s_next;
+    s_next = esp_random() % TETRIS_PIECES;
+    s_rot = 0;
+    s_x = TETRIS_LEFT + 3;
+    s_y = 0;
+    s_fall = 0;
+    return fits(s_piece, s_rot, s_x, s_y);
+}
+
+static void lock_piece(void)
+{
+    const uint16_t m = s_shapes[s_piece][s_rot];
+    for (int r = 0; r < 4; r++) {
+        const uint16_t row = (m >> (r * 4)) & 0xF;
+        if (row && s_y + r >= 0 && s_y + r < TETRIS_H) s_board[s_y + r] |= (uint16_t)(row << s_x);
+    }
+
+    static const uint16_t points[5] = { 0, 40, 100, 300, 1200 };
+    int cleared = 0;
+    for (int y = TETRIS_H - 1; y >= 0; y--) {
+        if (s_board[y] != TETRIS_FULL) continue;
+        memmove(&s_board[1], &s_board[0], y * sizeof(s_board[0]));
+        s_board[0] = TETRIS_WALLS;
+        cleared++;
+        y++; // the row that moved down into y
+    }
+    s_score += points[cleared] * (s_lines / 10 + 1);
+    s_lines += cleared;
+}
+
+static void tetris_start(void)
+{
+    for (int p = 0; p < TETRIS_PIECES; p++) {
+        s_shapes[p][0] = s_spawn[p].mask;
+        for (int r = 1; r < 4; r++) s_shapes[p][r] = rotate(s_shapes[p][r - 1], s_spawn[p].n);
+    }
+    for (int y = 0; y < TETRIS_H; y++) s_board[y] = TETRIS_WALLS;
+    s_score = s_lines = 0;
+    s_next = esp_random() % TETRIS_PIECES;
+    spawn();
+}
+
+static bool tetris_step(uint8_t pressed)
+{
+    if ((pressed & GAME_BTN_LEFT) && fits(s_piece, s_rot, s_x - 1, s_y)) s_x--;
+    if ((pressed & GAME_BTN_RIGHT) && fits(s_piece, s_rot, s_x + 1, s_y)) s_x++;
+    if (pressed & GAME_BTN_UP) {
+        // Rotate in place, else nudge one column off a wall or block
+        const uint8_t rot = (s_rot + 1) & 3;
+        static const int8_t kicks[3] = { 0, -1, 1 };
+        for (int i = 0; i < 3; i++) {
+            if (fits(s_piece, rot, s_x + kicks[i], s_y)) {
+                s_rot = rot;
+                s_x += kicks[i];
+                break;
+            }
+        }
+    }
+    if (pressed & GAME_BTN_A) {
+        while (fits(s_piece, s_rot, s_x, s_y + 1)) {
+            s_y++;
+            s_score += 2;
+        }
+        s_fall = UINT8_MAX; // lock now
+    }
+
+    const uint32_t level = s_lines / 10;
+    const uint8_t gravity = (level * 4 < TETRIS_GRAVITY - TETRIS_GRAVITY_MIN) ? TETRIS_GRAVITY - level * 4 : TETRIS_GRAVITY_MIN;
+    const bool soft = pressed & GAME_BTN_DOWN;
+    if (!soft && s_fall != UINT8_MAX && ++s_fall < gravity) return true;
+    s_fall = 0;
+
+    if (fits(s_piece, s_rot, s_x, s_y + 1)) {
+        s_y++;
+        if (soft) s_score++;
+        return true;
+    }
+    lock_piece();
+    return spawn();
+}
+
+static void draw_mask(uint8_t* fb, uint16_t m, int x0, int y0)
+{
+    for (int r = 0; r < 4; r++) {
+        for (int c = 0; c < 4; c++) {
+            if (m & (1u << (r * 4 + c))) {
+                game_blit(fb, x0 + c * TETRIS_CELL, y0 + r * TETRIS_CELL, s_cell_sprite, TETRIS_CELL);
+            }
+        }
+    }
+}
+
+static void tetris_draw(u8g2_t* u8g2)
+{
+    uint8_t* fb = u8g2_GetBufferPtr(u8g2);
+
+    for (int y = 0; y < TETRIS_H; y++) {
+        uint16_t row = s_board[y] & ~TETRIS_WALLS;
+        while (row) {
+            const int c = __builtin_ctz(row) - TETRIS_LEFT;
+            row &= row - 1;
+            game_blit(fb, TETRIS_X0 + c * TETRIS_CELL, TETRIS_Y0 + y * TETRIS_CELL, s_cell_sprite, TETRIS_CELL);
+        }
+    }
+    draw_mask(fb, s_shapes[s_piece][s_rot],
+              TETRIS_X0 + (s_x - TETRIS_LEFT) * TETRIS_CELL, TETRIS_Y0 + s_y * TETRIS_CELL);
+    u8g2_DrawFrame(u8g2, TETRIS_X0 - 2, TETRIS_Y0 - 2,
+                   TETRIS_W * TETRIS_CELL + 4, TETRIS_H * TETRIS_CELL + 4);
+
+    // Score on the left, next piece on the right
+    char line[16];
+    fmt_t f;
+    u8g2_SetFont(u8g2, u8g2_font_5x8_tr);
+    glyph_cache_draw_str(u8g2, 0, 8, "Score");
+    fmt_init(&f, line, sizeof(line));
+    fmt_uint(&f, s_score);
+    glyph_cache_draw_str(u8g2, 0, 18, line);
+    glyph_cache_draw_str(u8g2, 0, 32, "Lines");
+    fmt_init(&f, line, sizeof(line));
+    fmt_uint(&f, s_lines);
+    glyph_cache_draw_str(u8g2, 0, 42, line);
+    glyph_cache_draw_str(u8g2, 88, 8, "Next");
+    draw_mask(fb, s_shapes[s_next][0], 90, 12);
+}
+
+static uint32_t tetris_score(void)
+{
+    return s_score;
+}
+
+const game_t game_tetris = {
+    .name = "Tetris",
+    .start = tetris_start,
+    .step = tetris_step,
+    .draw = tetris_draw,
+    .score = tetris_score,
+};
@@ -0,0 +1,41 @@
+#include "geolocation.h"
+#include <string.h>
+
+// The ip-api.com reply, apart from the fetch so the host replay parses it too
+
+bool geo_parse(const char* buf, GeoInfo* out) {
+    cJSON* root = cJSON_Parse(buf);
+    if (!root) {
+        strlcpy(out->message, "JSON parse failed", sizeof(out->message));
+        return false;
+    }
+
+    cJSON* status = cJSON_GetObjectItem(root, "status");
+    cJSON* message = cJSON_GetObjectItem(root, "message");
+    cJSON* offset = cJSON_GetObjectItem(root, "offset");
+    cJSON* countryCode = cJSON_GetObjectItem(root, "countryCode");
+    cJSON* region = cJSON_GetObjectItem(root, "region");
+    cJSON* city = cJSON_GetObjectItem(root, "city");
+
+    bool ok = (status && cJSON_IsString(status) &&
+               strcmp(status->valuestring, "success") == 0 &&
+               offset && cJSON_IsNumber(offset));
+
+    if (!ok && message && cJSON_IsString(message) && message->valuestring) {
+        strlcpy(out->message, message->valuestring, sizeof(out->message));
+    }
+
+    if (ok) {
+        out->offset_sec = (long)offset->valuedouble;
+        if (countryCode && cJSON_IsString(countryCode) && countryCode->valuestring)
+            strlcpy(out->countryCode, countryCode->valuestring, sizeof(out->countryCode));
+        if (region && cJSON_IsString(region) && region->valuestring)
+            strlcpy(out->region, region->valuestring, sizeof(out->region));
+        if (city && cJSON_IsString(city) && city->valuestring)
+            strlcpy(out->city, city->valuestring, sizeof(out->city));
+        out->ok = true;
+    }
+
+    cJSON_Delete(root);
+    return out->ok;
+}
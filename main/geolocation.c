@@ -1,15 +1,32 @@
 #include "geolocation.h"
+#include <esp_timer.h>
+#include "http_body.h"
+#include "latency.h"
+#include "trace.h"
 
 static const char* TAG = "GEO";
 
 static bool geo_fetch_once(const char* url, GeoInfo* out) {
+    if (trace_replaying()) {
+        char buf[256];
+        int len = 0;
+        if (!trace_replay_http(TRACE_HTTP_GEO, buf, sizeof(buf), &len)) {
+            strlcpy(out->message, "Not in trace", sizeof(out->message));
+            return false;
+        }
+        return geo_parse(buf, out);
+    }
+
     esp_http_client_config_t cfg = {
         .url = url,
         .timeout_ms = 5000,
     };
+    http_body_t body;
+    http_body_config(&cfg, &body);
 
     esp_http_client_handle_t client = esp_http_client_init(&cfg);
     if (!client) return false;
+    http_body_request(client);
 
     esp_err_t err = esp_http_client_open(client, 0);
     if (err != ESP_OK) {
@@ -37,50 +54,19 @@ static bool geo_fetch_once(const char* url, GeoInfo* out) {
     }
 
     char buf[256];
-    int len = esp_http_client_read(client, buf, sizeof(buf) - 1);
-    buf[len] = '\0';
+    int len = 0;
+    err = http_body_read(client, &body, buf, sizeof(buf), &len);
     esp_http_client_close(client);
     esp_http_client_cleanup(client);
+    http_body_log(TAG, &body);
 
-    if (len <= 0) {
+    if (err != ESP_OK || len <= 0) {
         strlcpy(out->message, "Empty response", sizeof(out->message));
         return false;
     }
 
-    cJSON* root = cJSON_Parse(buf);
-    if (!root) {
-        strlcpy(out->message, "JSON parse failed", sizeof(out->message));
-        return false;
-    }
-
-    cJSON* status = cJSON_GetObjectItem(root, "status");
-    cJSON* message = cJSON_GetObjectItem(root, "message");
-    cJSON* offset = cJSON_GetObjectItem(root, "offset");
-    cJSON* countryCode = cJSON_GetObjectItem(root, "countryCode");
-    cJSON* region = cJSON_GetObjectItem(root, "region");
-    cJSON* city = cJSON_GetObjectItem(root, "city");
-
-    bool ok = (status && cJSON_IsString(status) &&
-               strcmp(status->valuestring, "success") == 0 &&
-               offset && cJSON_IsNumber(offset));
-
-    if (!ok && message && cJSON_IsString(message) && message->valuestring) {
-        strlcpy(out->message, message->valuestring, sizeof(out->message));
-    }
-
-    if (ok) {
-        out->offset_sec = (long)offset->valuedouble;
-        if (countryCode && cJSON_IsString(countryCode) && countryCode->valuestring)
-            strlcpy(out->countryCode, countryCode->valuestring, sizeof(out->countryCode));
-        if (region && cJSON_IsString(region) && region->valuestring)
-            strlcpy(out->region, region->valuestring, sizeof(out->region));
-        if (city && cJSON_IsString(city) && city->valuestring)
-            strlcpy(out->city, city->valuestring, sizeof(out->city));
-        out->ok = true;
-    }
-
-    cJSON_Delete(root);
-    return out->ok;
+    trace_record(TRACE_HTTP_GEO, buf, len);
+    return geo_parse(buf, out);
 }
 
 bool geo_fetch_info(const char* ip, GeoInfo* out) {
@@ -99,7 +85,11 @@ bool geo_fetch_info(const char* ip, GeoInfo* out) {
 
     const int max_retries = 3;
     for (int i = 0; i < max_retries; ++i) {
-        if (geo_fetch_once(url, out)) return true;
+        int64_t t0 = esp_timer_get_time();
+        bool ok = geo_fetch_once(url, out);
+        if (trace_replaying()) return ok; // no retries against a recording
+        latency_record(LAT_HTTP_GEO, (uint32_t)(esp_timer_get_time() - t0));
+        if (ok) return true;
 
         int backoff_ms = 500 * (i + 1); // 500ms, 1000ms, 1500ms
         vTaskDelay(pdMS_TO_TICKS(backoff_ms));
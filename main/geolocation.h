@@ -12,4 +12,6 @@ typedef struct {
     bool ok;
 } GeoInfo;
 
-bool geo_fetch_info(const char* ip, GeoInfo* out);
\ No newline at end of file
+bool geo_fetch_info(const char* ip, GeoInfo* out);
+// One ip-api.com JSON reply, NUL terminated (geo_parse.c)
+bool geo_parse(const char* buf, GeoInfo* out);
\ No newline at end of file
@@ -0,0 +1,228 @@
+#include "glyph_cache.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define GLYPH_EMPTY 0xFFFF
+
+typedef struct {
+    uint16_t encoding;  // GLYPH_EMPTY if unused
+    uint8_t w;
+    uint8_t h;
+    int8_t x;           // offset from the pen position
+    int8_t y;           // offset of the glyph bottom above the baseline
+    int8_t dx;          // advance
+    bool blank;         // nothing to draw (missing glyph, space)
+} glyph_entry_t;
+
+typedef struct {
+    const uint8_t* font;
+    uint16_t slots;
+    uint8_t max_w;
+    glyph_entry_t* entries;
+    uint32_t* cols;     // slots * max_w columns, bit 0 = glyph top row
+} font_cache_t;
+
+static font_cache_t s_fonts[GLYPH_CACHE_MAX_FONTS];
+static int s_font_count = 0;
+
+// Same bit reader as u8g2_font_decode_get_unsigned_bits: LSB first, spanning bytes
+typedef struct {
+    const uint8_t* ptr;
+    uint8_t bit_pos;
+} bit_reader_t;
+
+static uint8_t read_bits(bit_reader_t* r, uint8_t cnt)
+{
+    uint8_t val = r->ptr[0] >> r->bit_pos;
+    uint8_t end = r->bit_pos + cnt;
+    if (end >= 8) {
+        r->ptr++;
+        val |= r->ptr[0] << (8 - r->bit_pos);
+        end -= 8;
+    }
+    r->bit_pos = end;
+    return val & ((1U << cnt) - 1);
+}
+
+static int8_t read_signed_bits(bit_reader_t* r, uint8_t cnt)
+{
+    return (int8_t)((int)read_bits(r, cnt) - (1 << (cnt - 1)));
+}
+
+static font_cache_t* find_font(const uint8_t* font)
+{
+    for (int i = 0; i < s_font_count; i++) {
+        if (s_fonts[i].font == font) return &s_fonts[i];
+    }
+    return NULL;
+}
+
+bool glyph_cache_register(const uint8_t* font, uint16_t slots)
+{
+    if (!font || slots == 0 || s_font_count >= GLYPH_CACHE_MAX_FONTS) return false;
+    if (find_font(font)) return true;
+
+    // Byte 9 of the u8g2 font header is max_char_width
+    uint8_t max_w = font[9];
+    font_cache_t* fc = &s_fonts[s_font_count];
+    fc->entries = malloc(sizeof(glyph_entry_t) * slots);
+    fc->cols = calloc((size_t)slots * max_w, sizeof(uint32_t));
+    if (!fc->entries || !fc->cols) {
+        free(fc->entries);
+        free(fc->cols);
+        return false;
+    }
+    for (uint16_t i = 0; i < slots; i++) {
+        fc->entries[i].encoding = GLYPH_EMPTY;
+    }
+    fc->font = font;
+    fc->slots = slots;
+    fc->max_w = max_w;
+    s_font_count++;
+    return true;
+}
+
+// Run-length decode one glyph into vertical columns (see u8g2_font_decode_glyph)
+static void decode_glyph(u8g2_t* u8g2, font_cache_t* fc, uint16_t slot, uint16_t encoding)
+{
+    const u8g2_font_info_t* fi = &u8g2->font_info;
+    glyph_entry_t* g = &fc->entries[slot];
+    uint32_t* cols = &fc->cols[(size_t)slot * fc->max_w];
+
+    g->encoding = encoding;
+    g->blank = true;
+    g->w = g->h = 0;
+    g->x = g->y = g->dx = 0;
+
+    const uint8_t* data = u8g2_font_get_glyph_data(u8g2, encoding);
+    if (!data) return;
+
+    bit_reader_t r = { data, 0 };
+    uint8_t w = read_bits(&r, fi->bits_per_char_width);
+    uint8_t h = read_bits(&r, fi->bits_per_char_height);
+    g->x = read_signed_bits(&r, fi->bits_per_char_x);
+    g->y = read_signed_bits(&r, fi->bits_per_char_y);
+    g->dx = read_signed_bits(&r, fi->bits_per_delta_x);
+    g->w = w;
+    if (h == 0 || w == 0 || w > fc->max_w || h > 32) return;
+
+    g->h = h;
+    g->blank = false;
+    memset(cols, 0, sizeof(uint32_t) * w);
+
+    uint8_t px = 0, py = 0;
+    while (py < h) {
+        uint8_t zeros = read_bits(&r, fi->bits_per_0);
+        uint8_t ones = read_bits(&r, fi->bits_per_1);
+        do {
+            // Skip the background run, then set the foreground run, wrapping rows
+            unsigned skip = (unsigned)px + zeros;
+            py += skip / w;
+            px = skip % w;
+            for (uint8_t n = 0; n < ones && py < h; n++) {
+                cols[px] |= 1UL << py;
+                if (++px == w) {
+                    px = 0;
+                    py++;
+                }
+            }
+        } while (read_bits(&r, 1) != 0 && py < h);
+    }
+}
+
+static const glyph_entry_t* lookup(u8g2_t* u8g2, font_cache_t* fc, uint16_t encoding, const uint32_t** cols)
+{
+    uint16_t slot = encoding % fc->slots;
+    glyph_entry_t* g = &fc->entries[slot];
+    if (g->encoding != encoding) {
+        decode_glyph(u8g2, fc, slot, encoding);
+    }
+    *cols = &fc->cols[(size_t)slot * fc->max_w];
+    return g;
+}
+
+// Only plain left-to-right, baseline-referenced, colour 1 text is blitted directly
+static bool can_blit(u8g2_t* u8g2)
+{
+    return u8g2->cb == U8G2_R0 &&
+           u8g2->tile_curr_row == 0 &&
+           u8g2->font_decode.dir == 0 &&
+           u8g2->draw_color == 1 &&
+           u8g2->font_calc_vref == u8g2_font_calc_vref_font &&
+           u8g2->tile_buf_ptr != NULL;
+}
+
+static void blit(u8g2_t* u8g2, int x0, int top, const glyph_entry_t* g, const uint32_t* cols)
+{
+    uint8_t* buf = u8g2->tile_buf_ptr;
+    const int stride = u8g2_GetBufferTileWidth(u8g2) * 8;
+    const int buf_h = u8g2->tile_buf_height * 8;
+    const int disp_w = u8g2_GetDisplayWidth(u8g2);
+    const bool solid = (u8g2->font_decode.is_transparent == 0);
+    const uint32_t box = (g->h >= 32) ? 0xFFFFFFFFUL : ((1UL << g->h) - 1);
+
+    if (top >= buf_h || top + g->h <= 0) return;
+
+    // Work in page units; a negative top is handled by shifting the column down
+    int page = (top >= 0) ? top / 8 : -((-top + 7) / 8);
+    int shift = top - page * 8;
+
+    for (int c = 0; c < g->w; c++) {
+        int x = x0 + c;
+        if (x < 0) continue;
+        if (x >= disp_w) break;
+
+        uint64_t bits = (uint64_t)cols[c] << shift;
+        uint64_t mask = (uint64_t)box << shift;
+        for (int p = page; mask != 0; p++, bits >>= 8, mask >>= 8) {
+            if (p < 0) continue;
+            if (p * 8 >= buf_h) break;
+            uint8_t* dst = &buf[p * stride + x];
+            if (solid) *dst &= (uint8_t)~mask;
+            *dst |= (uint8_t)bits;
+        }
+    }
+}
+
+u8g2_uint_t glyph_cache_draw_str(u8g2_t* u8g2, u8g2_uint_t x, u8g2_uint_t y, const char* str)
+{
+    font_cache_t* fc = find_font(u8g2->font);
+    if (!fc || !can_blit(u8g2)) {
+        return u8g2_DrawStr(u8g2, x, y, str);
+    }
+
+    // u8g2 coordinates wrap, so a pen just left of the screen arrives as 0xFFFx
+    int pen = (int16_t)x;
+    const int base = (int16_t)y;
+    for (const uint8_t* p = (const uint8_t*)str; *p; p++) {
+        const uint32_t* cols;
+        const glyph_entry_t* g = lookup(u8g2, fc, *p, &cols);
+        if (!g->blank) {
+            blit(u8g2, pen + g->x, base - g->h - g->y, g, cols);
+        }
+        pen += g->dx;
+    }
+    return (u8g2_uint_t)(pen - (int16_t)x);
+}
+
+u8g2_uint_t glyph_cache_str_width(u8g2_t* u8g2, const char* str)
+{
+    font_cache_t* fc = find_font(u8g2->font);
+    if (!fc) {
+        return u8g2_GetStrWidth(u8g2, str);
+    }
+
+    // Match u8g2_GetStrWidth: sum of advances, with the last glyph's own extent
+    int w = 0;
+    const glyph_entry_t* last = NULL;
+    for (const uint8_t* p = (const uint8_t*)str; *p; p++) {
+        const uint32_t* cols;
+        last = lookup(u8g2, fc, *p, &cols);
+        w += last->dx;
+    }
+    if (last && last->w != 0) {
+        w -= last->dx;
+        w += last->w + last->x;
+    }
+    return (u8g2_uint_t)w;
+}
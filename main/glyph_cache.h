@@ -0,0 +1,23 @@
+#ifndef GLYPH_CACHE
+#define GLYPH_CACHE
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <u8g2.h>
+
+// Decoded-glyph cache for the fonts drawn every frame. Glyphs are stored as
+// vertical pixel columns, the same layout as the SSD1309 page buffer, so a cached
+// glyph is blitted with a shift and a couple of byte ORs per column instead of
+// re-running u8g2's RLE decoder from flash.
+
+#define GLYPH_CACHE_MAX_FONTS 4
+
+// Cache up to `slots` glyphs of `font` (direct mapped by encoding). Call once at init.
+bool glyph_cache_register(const uint8_t* font, uint16_t slots);
+
+// Drop-in for u8g2_DrawStr / u8g2_GetStrWidth. Falls back to u8g2 when the current
+// font is not registered or the draw state is something the blitter doesn't handle.
+u8g2_uint_t glyph_cache_draw_str(u8g2_t* u8g2, u8g2_uint_t x, u8g2_uint_t y, const char* str);
+u8g2_uint_t glyph_cache_str_width(u8g2_t* u8g2, const char* str);
+
+#endif /* GLYPH_CACHE */
@@ -0,0 +1,121 @@
+#include "history.h"
+#include <stdatomic.h>
+
+static history_sample_t s_ring[HISTORY_CAPACITY];
+static atomic_uint s_head = 0;
+
+static void put_u16(uint8_t* p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void put_u32(uint8_t* p, uint32_t v)
+{
+    put_u16(p, v & 0xFFFF);
+    put_u16(p + 2, v >> 16);
+}
+
+void history_push(const history_sample_t* s)
+{
+    if (!s) return;
+    unsigned head = atomic_load_explicit(&s_head, memory_order_relaxed);
+    s_ring[head % HISTORY_CAPACITY] = *s;
+    atomic_store_explicit(&s_head, head + 1, memory_order_release);
+}
+
+uint32_t history_head(void)
+{
+    return atomic_load_explicit(&s_head, memory_order_acquire);
+}
+
+uint32_t history_oldest(void)
+{
+    uint32_t head = history_head();
+    // One slot is kept back as the one the next push may be writing
+    return (head >= HISTORY_CAPACITY) ? head - HISTORY_CAPACITY + 1 : 0;
+}
+
+bool history_get(uint32_t seq, history_sample_t* out)
+{
+    uint32_t head = history_head();
+    if (seq >= head || head - seq >= HISTORY_CAPACITY) return false;
+
+    *out = s_ring[seq % HISTORY_CAPACITY];
+    atomic_thread_fence(memory_order_acquire);
+
+    // The slot is rewritten while head == seq + HISTORY_CAPACITY, before that push lands
+    head = atomic_load_explicit(&s_head, memory_order_relaxed);
+    return head - seq < HISTORY_CAPACITY;
+}
+
+uint32_t history_find_since(uint32_t since)
+{
+    // Times are pushed in order, so binary search the stored window
+    uint32_t lo = history_oldest();
+    uint32_t hi = history_head();
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        history_sample_t s;
+        if (!history_get(mid, &s)) {
+            lo = mid + 1; // overwritten under us, it was older anyway
+        } else if (s.time_s < since) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+size_t history_pack(uint32_t* seq, uint16_t packet_no, uint8_t* out, size_t out_sz)
+{
+    if (!seq || !out || out_sz < HISTORY_PACKET_HDR) return 0;
+
+    // Skip anything that fell off the ring while the client was catching up
+    uint32_t oldest = history_oldest();
+    if (*seq < oldest) *seq = oldest;
+
+    // Copy out as many samples as could fit; history_encode decides where the
+    // packet ends (time offset range)
+    history_sample_t batch[HISTORY_PACK_MAX_RECORDS];
+    size_t max_records = (out_sz - HISTORY_PACKET_HDR) / HISTORY_RECORD_SIZE;
+    if (max_records > HISTORY_PACK_MAX_RECORDS) max_records = HISTORY_PACK_MAX_RECORDS;
+    size_t n = 0;
+    while (n < max_records && history_get(*seq + n, &batch[n])) {
+        n++;
+    }
+
+    size_t encoded = 0;
+    size_t len = history_encode(batch, n, packet_no, out, out_sz, &encoded);
+    *seq += encoded;
+    return len;
+}
+
+size_t history_encode(const history_sample_t* s, size_t n, uint16_t packet_no,
+                      uint8_t* out, size_t out_sz, size_t* encoded)
+{
+    if (encoded) *encoded = 0;
+    if (!out || out_sz < HISTORY_PACKET_HDR) return 0;
+
+    const size_t max_records = (out_sz - HISTORY_PACKET_HDR) / HISTORY_RECORD_SIZE;
+    const uint32_t base = (s && n) ? s[0].time_s : 0;
+    size_t count = 0;
+    uint8_t* p = out + HISTORY_PACKET_HDR;
+
+    while (count < n && count < max_records && count < UINT8_MAX) {
+        const history_sample_t* r = &s[count];
+        if (r->time_s < base || r->time_s - base > UINT16_MAX) break;
+        put_u16(p, (uint16_t)(r->time_s - base));
+        put_u16(p + 2, (uint16_t)r->temp_centi_c);
+        put_u16(p + 4, r->hum_centi_pct);
+        p += HISTORY_RECORD_SIZE;
+        count++;
+    }
+
+    put_u16(out + HISTORY_PACKET_NO_OFS, packet_no);
+    put_u32(out + HISTORY_PACKET_BASE_OFS, base);
+    out[HISTORY_PACKET_COUNT_OFS] = (uint8_t)count;
+    if (encoded) *encoded = count;
+    return HISTORY_PACKET_HDR + count * HISTORY_RECORD_SIZE;
+}
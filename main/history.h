@@ -0,0 +1,57 @@
+#ifndef HISTORY
+#define HISTORY
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// In-RAM ring of recent sensor samples. One day at one sample per minute by
+// default; the period is the history_s setting.
+#ifndef HISTORY_CAPACITY
+#define HISTORY_CAPACITY 1440
+#endif
+
+// Bulk download packet: [u16 packet_no][u32 base_time][u8 count] then count records
+// of [u16 dt_s][i16 temp_centi_c][u16 hum_centi_pct], all little endian.
+#define HISTORY_PACKET_HDR  7
+#define HISTORY_RECORD_SIZE 6
+
+// Header field offsets
+#define HISTORY_PACKET_NO_OFS       0
+#define HISTORY_PACKET_BASE_OFS     2
+#define HISTORY_PACKET_COUNT_OFS    6
+
+typedef struct {
+    uint32_t time_s;
+    int16_t temp_centi_c;
+    uint16_t hum_centi_pct;
+} history_sample_t;
+
+// Single writer. Samples are addressed by a running sequence number, so a reader
+// can tell whether the slot it wants has been overwritten since.
+void history_push(const history_sample_t* s);
+
+uint32_t history_head(void);    // sequence number the next push will get
+uint32_t history_oldest(void);  // oldest sequence number still stored
+
+// Safe against a concurrent push; false if seq is not (or no longer) stored.
+bool history_get(uint32_t seq, history_sample_t* out);
+
+// First stored sequence number with time_s >= since (history_head() if none).
+uint32_t history_find_since(uint32_t since);
+
+// Records per history_pack() packet; the samples are staged on the stack. A 244 byte
+// notification holds 39.
+#define HISTORY_PACK_MAX_RECORDS 40
+
+// Pack records starting at *seq into one packet of at most out_sz bytes and advance
+// *seq past them. Returns the packet length; a packet with count 0 marks the end.
+size_t history_pack(uint32_t* seq, uint16_t packet_no, uint8_t* out, size_t out_sz);
+
+// Same packet layout from a caller-held array. Time offsets are taken from s[0]; stops
+// early at a sample that does not fit (out of space or dt out of u16 range).
+// *encoded gets the number of samples written.
+size_t history_encode(const history_sample_t* s, size_t n, uint16_t packet_no,
+                      uint8_t* out, size_t out_sz, size_t* encoded);
+
+#endif /* HISTORY */
@@ -0,0 +1,258 @@
+#include "http_api.h"
+#include <string.h>
+
+#include <esp_http_server.h>
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_wifi.h>
+
+#include "main.h"
+
+#define HTTP_TAG "HTTP_API"
+
+#define READING_BUF_SIZE 192
+#define METRICS_BUF_SIZE 640
+#define LIVE_BUF_SIZE    1024
+
+// The sample part of each body is cached and only re-rendered when a new sample
+// arrives (the sampler bumps seq). Everything that changes between requests is
+// formatted per request into s_live_buf and sent after it as a second chunk.
+typedef struct {
+    bool have_sample;
+    uint32_t seq;
+} sample_key_t;
+
+typedef struct {
+    uint32_t sample_age_s;
+    int8_t rssi;
+    bool wifi_up;
+    uint32_t heap_free;
+    uint32_t heap_min_free;
+    uint32_t uptime_s;
+    uint32_t frames;
+} live_values_t;
+
+static httpd_handle_t s_server = NULL;
+
+// Only touched from the httpd task
+static uint32_t s_req_reading = 0;
+static uint32_t s_req_metrics = 0;
+static uint32_t s_renders = 0;
+
+static char s_reading_buf[READING_BUF_SIZE];
+static int s_reading_len = 0;
+static bool s_reading_valid = false;
+static sample_key_t s_reading_key;
+
+static char s_metrics_buf[METRICS_BUF_SIZE];
+static int s_metrics_len = 0;
+static bool s_metrics_valid = false;
+static sample_key_t s_metrics_key;
+
+static char s_live_buf[LIVE_BUF_SIZE];
+
+static void get_sample(dht20_sample_t* sample, sample_key_t* key)
+{
+    key->have_sample = dht20_get_last(sample);
+    key->seq = key->have_sample ? sample->seq : 0;
+}
+
+static bool key_equal(const sample_key_t* a, const sample_key_t* b)
+{
+    return a->have_sample == b->have_sample && a->seq == b->seq;
+}
+
+static void collect_live(const dht20_sample_t* sample, bool have_sample, live_values_t* v)
+{
+    v->sample_age_s = have_sample ? pdTICKS_TO_MS(xTaskGetTickCount() - sample->tick) / 1000 : 0;
+
+    conn_snapshot_t conn;
+    connectivity_get(&conn);
+    v->wifi_up = conn.associated;
+    v->rssi = conn.rssi;
+
+    v->heap_free = esp_get_free_heap_size();
+    v->heap_min_free = esp_get_minimum_free_heap_size();
+    v->uptime_s = (uint32_t)(esp_timer_get_time() / 1000000);
+
+    display_stats_t ds;
+    display_get_stats(&ds);
+    v->frames = ds.frames;
+}
+
+// Cached JSON head, left open for the live fields
+static void render_reading(const dht20_sample_t* sample, const sample_key_t* key)
+{
+    s_renders++;
+
+    char t[16] = "null", h[16] = "null", dp[16] = "null", hi[16] = "null", ah[16] = "null";
+    if (key->have_sample) {
+        fixed_format(t, sizeof(t), sample->temp_centi_c, 2);
+        fixed_format(h, sizeof(h), sample->hum_centi_pct, 2);
+        fixed_format(dp, sizeof(dp), sample->climate.dew_point_centi_c, 2);
+        fixed_format(hi, sizeof(hi), sample->climate.heat_index_centi_c, 2);
+        fixed_format(ah, sizeof(ah), sample->climate.abs_hum_centi_g_m3, 2);
+    }
+
+    int n = snprintf(s_reading_buf, sizeof(s_reading_buf),
+        "{\"temperature_c\":%s,\"humidity_pct\":%s,\"dew_point_c\":%s,\"heat_index_c\":%s,"
+        "\"abs_humidity_g_m3\":%s",
+        t, h, dp, hi, ah);
+    s_reading_len = (n < (int)sizeof(s_reading_buf)) ? n : (int)sizeof(s_reading_buf) - 1;
+    s_reading_key = *key;
+    s_reading_valid = true;
+}
+
+static int render_reading_live(const live_values_t* v)
+{
+    int n = snprintf(s_live_buf, sizeof(s_live_buf),
+        ",\"sample_age_s\":%lu,\"wifi_rssi_dbm\":%d,\"heap_free\":%lu,\"heap_min_free\":%lu,\"uptime_s\":%lu}",
+        (unsigned long)v->sample_age_s, v->rssi,
+        (unsigned long)v->heap_free, (unsigned long)v->heap_min_free,
+        (unsigned long)v->uptime_s);
+    return (n < (int)sizeof(s_live_buf)) ? n : (int)sizeof(s_live_buf) - 1;
+}
+
+#define EMIT(...) do { n = snprintf(p, left, __VA_ARGS__); if (n < 0 || (size_t)n >= left) goto full; p += n; left -= (size_t)n; } while (0)
+
+static void render_metrics(const dht20_sample_t* sample, const sample_key_t* key)
+{
+    s_renders++;
+
+    char* p = s_metrics_buf;
+    size_t left = sizeof(s_metrics_buf);
+    int n;
+
+    if (key->have_sample) {
+        char num[16];
+        fixed_format(num, sizeof(num), sample->temp_centi_c, 2);
+        EMIT("# TYPE esp32_temperature_celsius gauge\nesp32_temperature_celsius %s\n", num);
+        fixed_format(num, sizeof(num), sample->hum_centi_pct, 2);
+        EMIT("# TYPE esp32_humidity_percent gauge\nesp32_humidity_percent %s\n", num);
+        fixed_format(num, sizeof(num), sample->climate.dew_point_centi_c, 2);
+        EMIT("# TYPE esp32_dew_point_celsius gauge\nesp32_dew_point_celsius %s\n", num);
+        fixed_format(num, sizeof(num), sample->climate.heat_index_centi_c, 2);
+        EMIT("# TYPE esp32_heat_index_celsius gauge\nesp32_heat_index_celsius %s\n", num);
+        fixed_format(num, sizeof(num), sample->climate.abs_hum_centi_g_m3, 2);
+        EMIT("# TYPE esp32_absolute_humidity_grams_per_cubic_meter gauge\n"
+             "esp32_absolute_humidity_grams_per_cubic_meter %s\n", num);
+        EMIT("# TYPE esp32_sensor_samples_total counter\nesp32_sensor_samples_total %lu\n",
+             (unsigned long)sample->seq);
+    }
+
+full:
+    s_metrics_len = (int)(p - s_metrics_buf);
+    s_metrics_key = *key;
+    s_metrics_valid = true;
+}
+
+static int render_metrics_live(bool have_sample, const live_values_t* v)
+{
+    char* p = s_live_buf;
+    size_t left = sizeof(s_live_buf);
+    int n;
+
+    if (have_sample) {
+        EMIT("# TYPE esp32_sample_age_seconds gauge\nesp32_sample_age_seconds %lu\n",
+             (unsigned long)v->sample_age_s);
+    }
+    if (v->wifi_up) {
+        EMIT("# TYPE esp32_wifi_rssi_dbm gauge\nesp32_wifi_rssi_dbm %d\n", v->rssi);
+    }
+    EMIT("# TYPE esp32_heap_free_bytes gauge\nesp32_heap_free_bytes %lu\n", (unsigned long)v->heap_free);
+    EMIT("# TYPE esp32_heap_min_free_bytes gauge\nesp32_heap_min_free_bytes %lu\n", (unsigned long)v->heap_min_free);
+    EMIT("# TYPE esp32_uptime_seconds counter\nesp32_uptime_seconds %lu\n", (unsigned long)v->uptime_s);
+    EMIT("# TYPE esp32_display_frames_total counter\nesp32_display_frames_total %lu\n", (unsigned long)v->frames);
+    EMIT("# TYPE esp32_http_requests_total counter\n"
+         "esp32_http_requests_total{path=\"/api/v1/reading\"} %lu\n"
+         "esp32_http_requests_total{path=\"/metrics\"} %lu\n",
+         (unsigned long)s_req_reading, (unsigned long)s_req_metrics);
+    EMIT("# TYPE esp32_http_renders_total counter\nesp32_http_renders_total %lu\n", (unsigned long)s_renders);
+
+full:
+    return (int)(p - s_live_buf);
+}
+#undef EMIT
+
+// Cached part, live part, then the terminating empty chunk. A zero length chunk
+// ends the response, so empty parts are skipped.
+static esp_err_t send_body(httpd_req_t* req, const char* cached, int cached_len, int live_len)
+{
+    esp_err_t err = ESP_OK;
+    if (cached_len > 0) err = httpd_resp_send_chunk(req, cached, cached_len);
+    if (err == ESP_OK && live_len > 0) err = httpd_resp_send_chunk(req, s_live_buf, live_len);
+    if (err == ESP_OK) err = httpd_resp_send_chunk(req, NULL, 0);
+    return err;
+}
+
+static esp_err_t reading_handler(httpd_req_t* req)
+{
+    s_req_reading++;
+
+    dht20_sample_t sample;
+    sample_key_t key;
+    get_sample(&sample, &key);
+    if (!s_reading_valid || !key_equal(&key, &s_reading_key)) {
+        render_reading(&sample, &key);
+    }
+
+    live_values_t live;
+    collect_live(&sample, key.have_sample, &live);
+    int live_len = render_reading_live(&live);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    return send_body(req, s_reading_buf, s_reading_len, live_len);
+}
+
+static esp_err_t metrics_handler(httpd_req_t* req)
+{
+    s_req_metrics++;
+
+    dht20_sample_t sample;
+    sample_key_t key;
+    get_sample(&sample, &key);
+    if (!s_metrics_valid || !key_equal(&key, &s_metrics_key)) {
+        render_metrics(&sample, &key);
+    }
+
+    live_values_t live;
+    collect_live(&sample, key.have_sample, &live);
+    int live_len = render_metrics_live(key.have_sample, &live);
+
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+    return send_body(req, s_metrics_buf, s_metrics_len, live_len);
+}
+
+esp_err_t http_api_start(void)
+{
+    if (s_server) return ESP_OK;
+
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = HTTP_API_PORT;
+    config.max_uri_handlers = 4;
+    config.lru_purge_enable = true;
+
+    esp_err_t err = httpd_start(&s_server, &config);
+    if (err != ESP_OK) {
+        ESP_LOGE(HTTP_TAG, "httpd_start failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    static const httpd_uri_t reading_uri = {
+        .uri = "/api/v1/reading",
+        .method = HTTP_GET,
+        .handler = reading_handler,
+    };
+    static const httpd_uri_t metrics_uri = {
+        .uri = "/metrics",
+        .method = HTTP_GET,
+        .handler = metrics_handler,
+    };
+    httpd_register_uri_handler(s_server, &reading_uri);
+    httpd_register_uri_handler(s_server, &metrics_uri);
+
+    ESP_LOGI(HTTP_TAG, "listening on port %d", HTTP_API_PORT);
+    return ESP_OK;
+}
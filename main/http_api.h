@@ -0,0 +1,19 @@
+#ifndef HTTP_API
+#define HTTP_API
+
+#include <esp_err.h>
+
+// Local HTTP API:
+//   GET /api/v1/reading  JSON with the latest DHT20 sample, RSSI and heap
+//   GET /metrics         the same plus counters, Prometheus text format
+// The sample values of each body are rendered into a static buffer once per new
+// sample. Uptime, heap, RSSI and the counters change on every request, so they are
+// formatted per request and sent after the cached part as a second chunk.
+
+#define HTTP_API_ENABLED    1
+#define HTTP_API_PORT       80
+
+// Start the server. Needs a network interface, so call once Wi-Fi is up.
+esp_err_t http_api_start(void);
+
+#endif /* HTTP_API */
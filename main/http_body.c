@@ -0,0 +1,139 @@
+#include "http_body.h"
+#include <stdlib.h>
+#include <strings.h>
+
+#include <esp_log.h>
+
+static uint32_t s_wire_total = 0;   // since boot, fetch tasks only
+static uint32_t s_body_total = 0;
+
+static esp_err_t on_http_event(esp_http_client_event_t* evt)
+{
+    http_body_t* body = evt->user_data;
+    if (evt->event_id == HTTP_EVENT_ON_HEADER && body &&
+        strcasecmp(evt->header_key, "Content-Encoding") == 0) {
+        body->gzip = (strcasecmp(evt->header_value, "gzip") == 0);
+    }
+    return ESP_OK;
+}
+
+void http_body_config(esp_http_client_config_t* config, http_body_t* body)
+{
+    *body = (http_body_t){0};
+    config->event_handler = on_http_event;
+    config->user_data = body;
+}
+
+void http_body_request(esp_http_client_handle_t client)
+{
+    esp_http_client_set_header(client, "Accept-Encoding", "gzip");
+}
+
+static bool count_sink(void* ctx, const uint8_t* data, size_t len)
+{
+    ((http_body_t*)ctx)->body_bytes += len;
+    return true;
+}
+
+esp_err_t http_body_read(esp_http_client_handle_t client, http_body_t* body,
+                         char* buf, size_t cap, int* len)
+{
+    if (!buf || cap == 0 || !len) return ESP_ERR_INVALID_ARG;
+    *len = 0;
+    buf[0] = '\0';
+
+    if (!body->gzip) {
+        int total = 0;
+        while (total < (int)cap - 1) {
+            int r = esp_http_client_read(client, buf + total, cap - 1 - total);
+            if (r < 0) return ESP_FAIL;
+            if (r == 0) break;
+            total += r;
+        }
+        buf[total] = '\0';
+        body->wire_bytes = body->body_bytes = total;
+        *len = total;
+        return ESP_OK;
+    }
+
+    // One byte short of cap, for the NUL
+    inflate_stream_t* inflater = inflate_stream_create_linear(INFLATE_GZIP, (uint8_t*)buf, cap - 1);
+    if (!inflater) return ESP_ERR_NO_MEM;
+    uint8_t chunk[HTTP_BODY_READ_CHUNK];
+    esp_err_t err = ESP_OK;
+    while (err == ESP_OK && !inflate_stream_done(inflater)) {
+        int r = esp_http_client_read(client, (char*)chunk, sizeof(chunk));
+        if (r < 0) {
+            err = ESP_FAIL;
+            break;
+        }
+        body->wire_bytes += r;
+        bool last = (r == 0) || esp_http_client_is_complete_data_received(client);
+        err = inflate_stream_feed(inflater, chunk, r, last, count_sink, body);
+        if (last) break;
+    }
+    if (err == ESP_OK && !inflate_stream_done(inflater)) err = ESP_ERR_INVALID_SIZE;
+    inflate_stream_free(inflater);
+    if (err != ESP_OK) return err;
+
+    buf[body->body_bytes] = '\0';
+    *len = (int)body->body_bytes;
+    return ESP_OK;
+}
+
+typedef struct {
+    http_body_t* body;
+    inflate_sink_t sink;
+    void* ctx;
+} stream_ctx_t;
+
+static bool stream_sink(void* ctx, const uint8_t* data, size_t len)
+{
+    stream_ctx_t* sc = ctx;
+    sc->body->body_bytes += len;
+    return sc->sink(sc->ctx, data, len);
+}
+
+esp_err_t http_body_stream(esp_http_client_handle_t client, http_body_t* body,
+                           char* chunk, size_t chunk_sz, inflate_sink_t sink, void* ctx)
+{
+    stream_ctx_t sc = { .body = body, .sink = sink, .ctx = ctx };
+    inflate_stream_t* inflater = NULL;
+    if (body->gzip) {
+        inflater = inflate_stream_create(INFLATE_GZIP);
+        if (!inflater) return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t err = ESP_OK;
+    for (;;) {
+        int r = esp_http_client_read(client, chunk, chunk_sz);
+        if (r < 0) {
+            err = ESP_FAIL;
+            break;
+        }
+        body->wire_bytes += r;
+        if (!inflater) {
+            if (r == 0) break;
+            if (!stream_sink(&sc, (const uint8_t*)chunk, r)) {
+                err = ESP_ERR_INVALID_STATE;
+                break;
+            }
+            continue;
+        }
+        bool last = (r == 0) || esp_http_client_is_complete_data_received(client);
+        err = inflate_stream_feed(inflater, (const uint8_t*)chunk, r, last, stream_sink, &sc);
+        if (err != ESP_OK || last || inflate_stream_done(inflater)) break;
+    }
+    if (err == ESP_OK && inflater && !inflate_stream_done(inflater)) err = ESP_ERR_INVALID_SIZE;
+    inflate_stream_free(inflater);
+    return err;
+}
+
+void http_body_log(const char* tag, const http_body_t* body)
+{
+    s_wire_total += body->wire_bytes;
+    s_body_total += body->body_bytes;
+    ESP_LOGI(tag, "%lu bytes over the air, %lu decoded%s; since boot %lu / %lu",
+             (unsigned long)body->wire_bytes, (unsigned long)body->body_bytes,
+             body->gzip ? " (gzip)" : "", (unsigned long)s_wire_total, (unsigned long)s_body_total);
+}
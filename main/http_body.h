@@ -0,0 +1,45 @@
+#ifndef HTTP_BODY
+#define HTTP_BODY
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_err.h>
+#include <esp_http_client.h>
+
+#include "inflate_stream.h"
+
+// Response bodies for the esp_http_client fetches (weather, forecast, geo). Weather
+// and geo go out with Accept-Encoding: gzip (http_body_request); a gzip body is
+// inflated while it is read, so the JSON parsers only ever see decoded text, and a
+// plain one passes through. Each fetch logs bytes over the air against decoded
+// bytes, plus running totals.
+
+#define HTTP_BODY_READ_CHUNK 256 // socket read size while inflating into a buffer
+
+typedef struct {
+    bool gzip;                  // the response said Content-Encoding: gzip
+    uint32_t wire_bytes;        // body bytes received
+    uint32_t body_bytes;        // after inflate
+} http_body_t;
+
+// Before esp_http_client_init(): hooks the response headers into `body`
+void http_body_config(esp_http_client_config_t* config, http_body_t* body);
+// Before esp_http_client_open()
+void http_body_request(esp_http_client_handle_t client);
+
+// The decoded body into buf, NUL terminated, *len bytes. A plain body longer than
+// cap - 1 is cut off as before; a gzip one fails with ESP_ERR_NO_MEM. The gzip path
+// inflates straight into buf, so only the decompressor state (~11 KB) is allocated.
+esp_err_t http_body_read(esp_http_client_handle_t client, http_body_t* body,
+                         char* buf, size_t cap, int* len);
+
+// The decoded body to sink as it arrives, reading through `chunk`. A gzip body needs
+// the full 32 KB inflate window while it streams, so callers that must stay small
+// (the forecast) leave out http_body_request and get plain bodies.
+esp_err_t http_body_stream(esp_http_client_handle_t client, http_body_t* body,
+                           char* chunk, size_t chunk_sz, inflate_sink_t sink, void* ctx);
+
+void http_body_log(const char* tag, const http_body_t* body);
+
+#endif /* HTTP_BODY */
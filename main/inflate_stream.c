@@ -0,0 +1,185 @@
+#include "inflate_stream.h"
+#include <stdlib.h>
+
+#include <esp_rom_crc.h>
+
+// gzip header flags and the parser states, in stream order
+#define GZ_FHCRC        0x02
+#define GZ_FEXTRA       0x04
+#define GZ_FNAME        0x08
+#define GZ_FCOMMENT     0x10
+
+enum {
+    GZ_FIXED,       // ID1 ID2 CM FLG MTIME(4) XFL OS
+    GZ_XLEN,
+    GZ_EXTRA,
+    GZ_NAME,
+    GZ_COMMENT,
+    GZ_HCRC,
+    GZ_BODY,
+    GZ_TRAILER,
+};
+
+static inflate_stream_t* create(inflate_format_t format, size_t extra)
+{
+    inflate_stream_t* s = calloc(1, sizeof(*s) + extra);
+    if (!s) return NULL;
+    tinfl_init(&s->decomp);
+    s->flags = (format == INFLATE_ZLIB) ? TINFL_FLAG_PARSE_ZLIB_HEADER : 0;
+    s->gzip = (format == INFLATE_GZIP);
+    s->gz_state = s->gzip ? GZ_FIXED : GZ_BODY;
+    return s;
+}
+
+inflate_stream_t* inflate_stream_create(inflate_format_t format)
+{
+    inflate_stream_t* s = create(format, TINFL_LZ_DICT_SIZE);
+    if (!s) return NULL;
+    s->window = (uint8_t*)(s + 1);
+    s->window_size = TINFL_LZ_DICT_SIZE;
+    return s;
+}
+
+inflate_stream_t* inflate_stream_create_linear(inflate_format_t format, uint8_t* out, size_t out_sz)
+{
+    if (!out || out_sz == 0) return NULL;
+    inflate_stream_t* s = create(format, 0);
+    if (!s) return NULL;
+    s->window = out;
+    s->window_size = out_sz;
+    s->linear = true;
+    s->flags |= TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF;
+    return s;
+}
+
+void inflate_stream_free(inflate_stream_t* s)
+{
+    free(s);
+}
+
+// The next optional header field the flags ask for, else the body
+static uint8_t next_gz_state(uint8_t state, uint8_t flags)
+{
+    if (state < GZ_XLEN && (flags & GZ_FEXTRA)) return GZ_XLEN;
+    if (state < GZ_NAME && (flags & GZ_FNAME)) return GZ_NAME;
+    if (state < GZ_COMMENT && (flags & GZ_FCOMMENT)) return GZ_COMMENT;
+    if (state < GZ_HCRC && (flags & GZ_FHCRC)) return GZ_HCRC;
+    return GZ_BODY;
+}
+
+// One header byte at a time; headers are a handful of bytes
+static esp_err_t gzip_header_byte(inflate_stream_t* s, uint8_t b)
+{
+    switch (s->gz_state) {
+    case GZ_FIXED: {
+        static const uint8_t magic[3] = { 0x1F, 0x8B, 0x08 }; // ID1 ID2, CM = deflate
+        if (s->gz_count < 3 && b != magic[s->gz_count]) return ESP_ERR_NOT_SUPPORTED;
+        if (s->gz_count == 3) s->gz_flags = b;
+        if (++s->gz_count < 10) return ESP_OK;
+        break;
+    }
+    case GZ_XLEN:
+        s->gz_extra |= (uint16_t)b << (8 * s->gz_count);
+        if (++s->gz_count < 2) return ESP_OK;
+        s->gz_count = 0;
+        s->gz_state = GZ_EXTRA;
+        if (s->gz_extra > 0) return ESP_OK;
+        break;
+    case GZ_EXTRA:
+        if (++s->gz_count < s->gz_extra) return ESP_OK;
+        break;
+    case GZ_NAME:
+    case GZ_COMMENT:
+        if (b != 0) return ESP_OK;
+        break;
+    case GZ_HCRC:
+        if (++s->gz_count < 2) return ESP_OK;
+        break;
+    }
+    s->gz_count = 0;
+    s->gz_state = next_gz_state(s->gz_state, s->gz_flags);
+    return ESP_OK;
+}
+
+static esp_err_t gzip_trailer(inflate_stream_t* s, const uint8_t* in, size_t len, size_t* pos, bool last)
+{
+    while (*pos < len && s->gz_count < sizeof(s->gz_trailer)) {
+        s->gz_trailer[s->gz_count++] = in[(*pos)++];
+        s->in_total++;
+    }
+    if (s->gz_count < sizeof(s->gz_trailer)) return last ? ESP_ERR_INVALID_SIZE : ESP_OK;
+
+    const uint8_t* t = s->gz_trailer;
+    const uint32_t crc = t[0] | (t[1] << 8) | (t[2] << 16) | ((uint32_t)t[3] << 24);
+    const uint32_t isize = t[4] | (t[5] << 8) | (t[6] << 16) | ((uint32_t)t[7] << 24);
+    if (crc != s->gz_crc || isize != (uint32_t)s->out_total) return ESP_ERR_INVALID_CRC;
+    s->done = true;
+    return ESP_OK;
+}
+
+// tinfl reads ahead: at TINFL_STATUS_DONE its bit buffer can still hold whole input
+// bytes past the end of the deflate data, and those are the start of the trailer.
+// The partial byte is padding. The bytes may have come in an earlier chunk, so they
+// are taken from the bit buffer rather than by rewinding `in`.
+static void gzip_unread(inflate_stream_t* s)
+{
+    const uint32_t bits = s->decomp.m_num_bits;
+    const uint32_t n = bits >> 3;
+    for (uint32_t i = 0; i < n && s->gz_count < sizeof(s->gz_trailer); i++) {
+        s->gz_trailer[s->gz_count++] = (uint8_t)(s->decomp.m_bit_buf >> ((bits & 7) + 8 * i));
+    }
+}
+
+esp_err_t inflate_stream_feed(inflate_stream_t* s, const uint8_t* in, size_t len, bool last,
+                              inflate_sink_t sink, void* ctx)
+{
+    if (!s || (!in && len) || !sink) return ESP_ERR_INVALID_ARG;
+    if (s->done) return ESP_OK;
+
+    size_t pos = 0;
+    while (s->gz_state < GZ_BODY && pos < len) {
+        esp_err_t err = gzip_header_byte(s, in[pos++]);
+        s->in_total++;
+        if (err != ESP_OK) return err;
+    }
+    if (s->gz_state == GZ_TRAILER) return gzip_trailer(s, in, len, &pos, last);
+    if (s->gz_state < GZ_BODY) return last ? ESP_ERR_INVALID_SIZE : ESP_OK;
+
+    const uint32_t flags = s->flags | (last ? 0 : TINFL_FLAG_HAS_MORE_INPUT);
+
+    for (;;) {
+        size_t in_sz = len - pos;
+        size_t out_sz = s->window_size - s->window_pos;
+        tinfl_status status = tinfl_decompress(&s->decomp, in + pos, &in_sz, s->window,
+                                               s->window + s->window_pos, &out_sz, flags);
+        pos += in_sz;
+        s->in_total += in_sz;
+
+        if (out_sz > 0) {
+            if (s->gzip) s->gz_crc = esp_rom_crc32_le(s->gz_crc, s->window + s->window_pos, out_sz);
+            if (!sink(ctx, s->window + s->window_pos, out_sz)) return ESP_ERR_INVALID_STATE;
+            s->out_total += out_sz;
+            s->window_pos += out_sz;
+            if (!s->linear) s->window_pos &= TINFL_LZ_DICT_SIZE - 1;
+        }
+
+        if (status == TINFL_STATUS_DONE) {
+            if (s->gzip) {
+                s->gz_state = GZ_TRAILER;
+                gzip_unread(s);
+                return gzip_trailer(s, in, len, &pos, last);
+            }
+            s->done = true;
+            return ESP_OK;
+        }
+        if (status < 0) return ESP_ERR_INVALID_CRC;  // corrupt data or checksum mismatch
+        if (status == TINFL_STATUS_NEEDS_MORE_INPUT && pos == len) {
+            return last ? ESP_ERR_INVALID_SIZE : ESP_OK;  // truncated if this was the end
+        }
+        // TINFL_STATUS_HAS_MORE_OUTPUT: the window wrapped, go again; a linear
+        // buffer that is full cannot take the rest
+        if (status == TINFL_STATUS_HAS_MORE_OUTPUT && s->linear && s->window_pos == s->window_size) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef INFLATE_STREAM
+#define INFLATE_STREAM
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_err.h>
+#include <rom/miniz.h>
+
+// Incremental inflate on the ROM tinfl. Input can arrive in chunks of any size; output
+// is handed to a sink as it is produced, straight out of the 32 KB LZ window, so
+// memory stays fixed no matter how large the stream is. For small bodies the window
+// can instead be the caller's output buffer (inflate_stream_create_linear): the
+// whole result stays there and only the decompressor state (~11 KB) is allocated.
+
+typedef enum {
+    INFLATE_RAW,    // bare deflate
+    INFLATE_ZLIB,   // zlib header and adler32 trailer, checked
+    INFLATE_GZIP,   // gzip member (RFC 1952): header skipped, crc32 and size checked
+} inflate_format_t;
+
+// Return false to abort the stream
+typedef bool (*inflate_sink_t)(void* ctx, const uint8_t* data, size_t len);
+
+typedef struct {
+    tinfl_decompressor decomp;
+    uint8_t* window;            // the LZ ring, or the linear output buffer
+    size_t window_size;
+    size_t window_pos;
+    uint32_t flags;
+    bool linear;
+    bool done;
+    size_t in_total;
+    size_t out_total;
+
+    // INFLATE_GZIP framing
+    bool gzip;
+    uint8_t gz_state;
+    uint8_t gz_flags;           // FLG byte of the header
+    uint16_t gz_count;          // bytes seen of the current header field
+    uint16_t gz_extra;          // FEXTRA length
+    uint8_t gz_trailer[8];      // crc32, isize
+    uint32_t gz_crc;
+} inflate_stream_t;
+
+// About 43 KB, so it lives on the heap only while a stream is open
+inflate_stream_t* inflate_stream_create(inflate_format_t format);
+// Inflates into out[0..out_sz); a stream that decodes to more is an error
+// (ESP_ERR_NO_MEM). The sink still sees each piece as it lands in `out`.
+inflate_stream_t* inflate_stream_create_linear(inflate_format_t format, uint8_t* out, size_t out_sz);
+void inflate_stream_free(inflate_stream_t* s);
+
+// Feed the next chunk. last marks the final one, so running out of input there is an
+// error. Bytes after the end of the deflate stream (or gzip trailer) are ignored.
+esp_err_t inflate_stream_feed(inflate_stream_t* s, const uint8_t* in, size_t len, bool last,
+                              inflate_sink_t sink, void* ctx);
+
+static inline bool inflate_stream_done(const inflate_stream_t* s)
+{
+    return s->done;
+}
+
+#endif /* INFLATE_STREAM */
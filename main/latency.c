@@ -0,0 +1,127 @@
+#include "latency.h"
+#include <stdio.h>
+#include <string.h>
+
+#include <freertos/FreeRTOS.h>
+
+#define SUB_COUNT   (1u << LATENCY_SUB_BITS)
+#define SUB_MASK    (SUB_COUNT - 1)
+#define MAX_VALUE   ((1u << LATENCY_MAX_BITS) - 1)
+
+typedef struct {
+    uint16_t counts[LATENCY_BUCKETS];
+    uint32_t samples;
+    uint32_t max_us;
+} histogram_t;
+
+static histogram_t s_hist[LAT_COUNT];
+static portMUX_TYPE s_hist_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static const char* const s_names[LAT_COUNT] = {
+    [LAT_LOOP_JITTER]    = "loop",
+    [LAT_INPUT_TO_PIXEL] = "input",
+    [LAT_DHT20_READ]     = "dht20",
+    [LAT_HTTP_WEATHER]   = "weather",
+    [LAT_HTTP_FORECAST]  = "forecast",
+    [LAT_HTTP_GEO]       = "geo",
+    [LAT_WIFI_CONNECT]   = "wifi",
+    [LAT_GAME_FRAME]     = "frame",
+};
+
+static unsigned bucket_of(uint32_t v)
+{
+    if (v < SUB_COUNT) return v;
+    unsigned m = 31 - __builtin_clz(v); // >= LATENCY_SUB_BITS here
+    return ((m - LATENCY_SUB_BITS + 1) << LATENCY_SUB_BITS) | ((v >> (m - LATENCY_SUB_BITS)) & SUB_MASK);
+}
+
+// Largest value that lands in bucket b
+static uint32_t bucket_top(unsigned b)
+{
+    if (b < SUB_COUNT) return b;
+    unsigned m = (b >> LATENCY_SUB_BITS) + LATENCY_SUB_BITS - 1;
+    uint32_t low = (1u << m) | ((uint32_t)(b & SUB_MASK) << (m - LATENCY_SUB_BITS));
+    return low + (1u << (m - LATENCY_SUB_BITS)) - 1;
+}
+
+void latency_record(latency_id_t id, uint32_t us)
+{
+    if (id >= LAT_COUNT) return;
+    histogram_t* h = &s_hist[id];
+    const unsigned b = bucket_of(us > MAX_VALUE ? MAX_VALUE : us);
+
+    taskENTER_CRITICAL(&s_hist_lock);
+    if (h->counts[b] == UINT16_MAX) {
+        for (unsigned i = 0; i < LATENCY_BUCKETS; i++) h->counts[i] >>= 1;
+    }
+    h->counts[b]++;
+    h->samples++;
+    if (us > h->max_us) h->max_us = us;
+    taskEXIT_CRITICAL(&s_hist_lock);
+}
+
+// Percentiles in per mille, so p99 is 990. Counts are copied out first, keeping the
+// critical section to a memcpy.
+static void summarize(const histogram_t* h, latency_summary_t* out)
+{
+    uint32_t total = 0;
+    for (unsigned i = 0; i < LATENCY_BUCKETS; i++) total += h->counts[i];
+
+    out->samples = h->samples;
+    out->max_us = h->max_us;
+    out->p50_us = out->p99_us = 0;
+    if (total == 0) return;
+
+    const uint32_t want50 = (total * 500 + 999) / 1000;
+    const uint32_t want99 = (total * 990 + 999) / 1000;
+    uint32_t seen = 0;
+    for (unsigned i = 0; i < LATENCY_BUCKETS; i++) {
+        if (!h->counts[i]) continue;
+        seen += h->counts[i];
+        uint32_t top = bucket_top(i);
+        if (top > h->max_us) top = h->max_us;
+        if (!out->p50_us && seen >= want50) out->p50_us = top;
+        if (seen >= want99) {
+            out->p99_us = top;
+            break;
+        }
+    }
+}
+
+void latency_summary(latency_id_t id, latency_summary_t* out)
+{
+    static histogram_t copy; // callers are the UI and console, one at a time
+    memset(out, 0, sizeof(*out));
+    if (id >= LAT_COUNT) return;
+
+    taskENTER_CRITICAL(&s_hist_lock);
+    memcpy(&copy, &s_hist[id], sizeof(copy));
+    taskEXIT_CRITICAL(&s_hist_lock);
+    summarize(&copy, out);
+}
+
+const char* latency_name(latency_id_t id)
+{
+    return (id < LAT_COUNT) ? s_names[id] : "?";
+}
+
+void latency_dump(void)
+{
+    static histogram_t copy;
+    for (int id = 0; id < LAT_COUNT; id++) {
+        taskENTER_CRITICAL(&s_hist_lock);
+        memcpy(&copy, &s_hist[id], sizeof(copy));
+        taskEXIT_CRITICAL(&s_hist_lock);
+
+        latency_summary_t s;
+        summarize(&copy, &s);
+        printf("%-8s n=%lu p50=%luus p99=%luus max=%luus\n", s_names[id],
+               (unsigned long)s.samples, (unsigned long)s.p50_us,
+               (unsigned long)s.p99_us, (unsigned long)s.max_us);
+        for (unsigned i = 0; i < LATENCY_BUCKETS; i++) {
+            if (copy.counts[i]) {
+                printf("  <=%lu us: %u\n", (unsigned long)bucket_top(i), copy.counts[i]);
+            }
+        }
+    }
+}
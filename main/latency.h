@@ -0,0 +1,44 @@
+#ifndef LATENCY
+#define LATENCY
+
+#include <stdint.h>
+
+// Fixed-size latency histograms, HDR style: microsecond values go into buckets that
+// are exact below 2^LATENCY_SUB_BITS and otherwise split each power of two into
+// 2^LATENCY_SUB_BITS steps, so any reported value is within 12.5% of the truth from
+// 1 us up to 2^LATENCY_MAX_BITS us (~134 s). Counts are 16 bit: when one would
+// overflow, every bucket of that histogram is halved, which keeps the shape and
+// lets recent samples weigh more.
+
+#define LATENCY_SUB_BITS    3
+#define LATENCY_MAX_BITS    27
+#define LATENCY_BUCKETS     ((LATENCY_MAX_BITS - LATENCY_SUB_BITS + 1) << LATENCY_SUB_BITS)
+
+typedef enum {
+    LAT_LOOP_JITTER,        // app_main loop period minus its nominal 100 ms
+    LAT_INPUT_TO_PIXEL,     // handle_input to the last byte of the next frame on the wire
+    LAT_DHT20_READ,
+    LAT_HTTP_WEATHER,
+    LAT_HTTP_FORECAST,
+    LAT_HTTP_GEO,
+    LAT_WIFI_CONNECT,
+    LAT_GAME_FRAME,         // between frames of the game runtime, nominally GAME_TICK_US
+    LAT_COUNT
+} latency_id_t;
+
+typedef struct {
+    uint32_t samples;       // since boot
+    uint32_t p50_us;
+    uint32_t p99_us;
+    uint32_t max_us;        // exact
+} latency_summary_t;
+
+// Safe from any task
+void latency_record(latency_id_t id, uint32_t us);
+void latency_summary(latency_id_t id, latency_summary_t* out);
+const char* latency_name(latency_id_t id);
+
+// Summaries plus the non-empty buckets of every histogram, on the console
+void latency_dump(void);
+
+#endif /* LATENCY */
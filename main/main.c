@@ -1,32 +1,51 @@
 #include "main.h"
 
 static void i2c_master_init(void);
-static void u8g2_init(void);
 static void uart_init(void);
 static void draw_wifi_info(void);
 static void draw_time(void);
 static void draw_geo(void);
 // static void draw_wrapped_text(int x, int y, int max_w, const char* text);
 static void handle_input(const uint8_t* data, int len);
+static void handle_command(uint8_t b);
 static void go_back_one_menu(void);
 static void set_screen(Screen s);
 static void status_bar_update_if_changed(void);
-static void action_placeholder(void);
 static void action_open_weather(void);
 static void action_tnh(void);
 static void action_time(void);
 static void action_weather_mtl(void);
+static void action_forecast(void);
 static void action_geo(void);
 static void action_open_settings(void);
 static void action_wifi(void);
+static void action_wifi_scan(void);
 static void action_bt(void);
+static void action_ota(void);
+static void action_diag(void);
+static void action_games(void);
+static void action_snake(void);
+static void action_tetris(void);
+static void action_shutdown(void);
 static Key decode_key(uint8_t b);
 static void weather_ui_update(const WeatherInfo* w);
 static void log_mem_usage(void);
-static int get_wifi_bars(void);
 static void draw_status_bar(void);
-// static void draw_bt_devices(void);
+static void draw_bt_devices(void);
+static void update_bt_devices(void);
 static void draw_wifi_bars(const int w, const int bars);
+static void draw_ota(void);
+static void draw_forecast(void);
+static void draw_diag(void);
+static void draw_wifi_scan(void);
+static void enter_wifi_scan(void);
+static void update_wifi_scan(void);
+static void draw_game_result(void);
+static void action_prefs(void);
+static void draw_prefs(void);
+static void update_prefs(void);
+static bool prefs_key(Key k);
+static void console_feed(const uint8_t* data, int len);
 
 
 // Menu state model
@@ -36,41 +55,95 @@ static const Menu* current_menu = NULL;
 static int main_selected = 0;
 static int weather_selected = 0;
 static int settings_selected = 0;
-static bool sntp_started = false;
-static bool wifi_connected = false;
+static int games_selected = 0;
 static GeoInfo geo_info = {0};
-static bool s_last_wifi_connected = false;
-static char s_last_bat_label[8] = "BAT?";
+static WeatherInfo s_last_weather;      // last good fetch, for the shutdown snapshot
+// Shutdown is a main menu item, so the snapshot saves where the user was before coming
+// back to the main menu, and the item that had taken them there
+static Screen s_resume_screen = SCREEN_MAIN;
+static int s_resume_main_selected = 0;
+static bool s_have_weather = false;
+static forecast_t s_forecast;
 static int s_last_wifi_bars = -1;
+static char s_last_bat_label[8] = "BAT?";
+static uint32_t s_wifi_scan_gen = 0;
+static bool s_replay_pending = false;
+static const game_t* s_last_game = NULL;
+static game_stats_t s_game_stats;
+static int s_prefs_sel = 0;
+static int s_prefs_edit = -1;           // setting being edited, -1 while browsing
+static int32_t s_prefs_int;             // edit buffers
+static char s_prefs_str[SETTINGS_STR_MAX];
+static int s_prefs_pos;                 // string edit cursor
+static uint32_t s_prefs_gen = 0;
+static bool s_console_active = false;   // typing a settings command line
+static bool s_command_prefix = false;   // COMMAND_PREFIX_KEY seen, next byte is a command
+static char s_console_line[112];    // room for "wifi add", a quoted SSID and a password
+static int s_console_len = 0;
 
 // Main menu
 static const MenuItem main_menu_items[] = {
-    { "Games",       action_placeholder },
+    { "Games",       action_games },
     { "Weather",     action_open_weather },
     { "Time",        action_time },
     { "Settings",    action_open_settings },
-    { "Shutdown",    action_placeholder }
+    { "Shutdown",    action_shutdown }
 };
 
 #define MAIN_MENU_COUNT (sizeof(main_menu_items) / sizeof(main_menu_items[0]))
 
 static const MenuItem weather_menu_items[] = {
     { "Here", action_tnh },
-    { "Montreal", action_weather_mtl }
+    { "City", action_weather_mtl },
+    { "Forecast", action_forecast }
 };
 #define WEATHER_MENU_COUNT (sizeof(weather_menu_items) / sizeof(weather_menu_items[0]))
 
+static const MenuItem games_menu_items[] = {
+    { "Snake",  action_snake },
+    { "Tetris", action_tetris }
+};
+#define GAMES_MENU_COUNT (sizeof(games_menu_items) / sizeof(games_menu_items[0]))
+
 // Settings submenu
 static const MenuItem settings_menu_items[] = {
     { "WiFi",        action_wifi },
+    { "WiFi scan",   action_wifi_scan },
     { "Bluetooth",   action_bt },
-    { "Geolocation", action_geo }
+    { "Geolocation", action_geo },
+    { "Update",      action_ota },
+    { "Diagnostics", action_diag },
+    { "Preferences", action_prefs }
 };
 #define SETTINGS_MENU_COUNT (sizeof(settings_menu_items) / sizeof(settings_menu_items[0]))
 
 static const Menu main_menu = { main_menu_items, MAIN_MENU_COUNT, &main_selected };
 static const Menu weather_menu = { weather_menu_items, WEATHER_MENU_COUNT, &weather_selected };
 static const Menu settings_menu = { settings_menu_items, SETTINGS_MENU_COUNT, &settings_selected };
+static const Menu games_menu = { games_menu_items, GAMES_MENU_COUNT, &games_selected };
+
+// Screen registry, indexed by Screen
+static const ScreenDef screens[SCREEN_COUNT] = {
+    //                     parent           enter            update             period  menu     key
+    [SCREEN_MAIN]        = { SCREEN_MAIN,     NULL,            NULL,                 0,   &main_menu },
+    [SCREEN_SETTINGS]    = { SCREEN_MAIN,     NULL,            NULL,                 0,   &settings_menu },
+    [SCREEN_WEATHER]     = { SCREEN_MAIN,     NULL,            NULL,                 0,   &weather_menu },
+    [SCREEN_WEATHER_MTL] = { SCREEN_WEATHER,  NULL,            NULL,                 0,   NULL },
+    [SCREEN_FORECAST]    = { SCREEN_WEATHER,  draw_forecast,   NULL,                 0,   NULL },
+    [SCREEN_TIME]        = { SCREEN_MAIN,     NULL,            draw_time,          500,   NULL },
+    [SCREEN_TNH]         = { SCREEN_WEATHER,  NULL,            draw_dht20,        1000,   NULL },
+    [SCREEN_WIFI]        = { SCREEN_SETTINGS, NULL,            draw_wifi_info,    1000,   NULL },
+    [SCREEN_WIFI_SCAN]   = { SCREEN_SETTINGS, enter_wifi_scan, update_wifi_scan,   250,   NULL },
+    [SCREEN_GEO]         = { SCREEN_SETTINGS, draw_geo,        NULL,                 0,   NULL },
+    [SCREEN_BT]          = { SCREEN_SETTINGS, draw_bt_devices, update_bt_devices,  250,   NULL },
+    [SCREEN_OTA]         = { SCREEN_SETTINGS, NULL,            draw_ota,           500,   NULL },
+    [SCREEN_DIAG]        = { SCREEN_SETTINGS, NULL,            draw_diag,         1000,   NULL },
+    [SCREEN_GAMES]       = { SCREEN_MAIN,     NULL,            NULL,                 0,   &games_menu },
+    [SCREEN_GAME]        = { SCREEN_GAMES,    draw_game_result, NULL,                0,   NULL },
+    [SCREEN_PREFS]       = { SCREEN_SETTINGS, draw_prefs,      update_prefs,       250,   NULL, prefs_key },
+};
+
+static TickType_t s_last_update = 0;
 
 u8g2_t u8g2;
 
@@ -87,7 +160,7 @@ static void i2c_master_init(void) {
     i2c_driver_install(I2C_MASTER_NUM, conf.mode, 0, 0, 0);
 }
 
-static void u8g2_init(void) {    
+void ui_display_init(void) {
     u8g2_esp32_hal_t u8g2_esp32_hal = U8G2_ESP32_HAL_DEFAULT;
     u8g2_esp32_hal.clk   = PIN_CLK;
     u8g2_esp32_hal.mosi  = PIN_MOSI;
@@ -97,9 +170,16 @@ static void u8g2_init(void) {
 
     u8g2_esp32_hal_init(u8g2_esp32_hal);
 
-    u8g2_Setup_ssd1309_128x64_noname2_f(&u8g2, U8G2_R0, u8g2_esp32_spi_byte_cb, u8g2_esp32_gpio_and_delay_cb);
+    // SPI is driven by display.c (queued DMA flushes); the HAL still does reset/DC GPIOs and delays
+    u8g2_Setup_ssd1309_128x64_noname2_f(&u8g2, U8G2_R0, display_byte_cb, u8g2_esp32_gpio_and_delay_cb);
     u8g2_InitDisplay(&u8g2);
     u8g2_SetPowerSave(&u8g2, 0);
+
+#if GLYPH_CACHE_ENABLED
+    glyph_cache_register(u8g2_font_ncenB08_tr, GLYPH_CACHE_SLOTS_NCENB08);
+    glyph_cache_register(u8g2_font_ncenB12_tr, GLYPH_CACHE_SLOTS_NCENB12);
+    glyph_cache_register(u8g2_font_5x8_tr, GLYPH_CACHE_SLOTS_5X8);
+#endif
 }
 
 static void uart_init(void) {
@@ -118,10 +198,18 @@ static void uart_init(void) {
     uart_set_pin(UART_NUM, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
 }
 
-static void update_screenf_font_v(const uint8_t* font, const char* fmt, va_list args) {
-    char text[256];
-    vsnprintf(text, sizeof(text), fmt, args);
+// The layout engine's text. Render paths fill it in place through screen_text_begin();
+// only the update_screenf() wrappers still go through vsnprintf.
+static char s_screen_text[256];
+static fmt_t s_screen_fmt;
+
+fmt_t* screen_text_begin(void) {
+    fmt_init(&s_screen_fmt, s_screen_text, sizeof(s_screen_text));
+    return &s_screen_fmt;
+}
 
+// Word-wraps `text` under the status bar and flushes
+static void layout_text(const uint8_t* font, const char* text) {
     u8g2_ClearBuffer(&u8g2);
     draw_status_bar();
     u8g2_SetFont(&u8g2, font ? font : u8g2_font_ncenB08_tr);
@@ -137,7 +225,7 @@ static void update_screenf_font_v(const uint8_t* font, const char* fmt, va_list
     while (*p) {
         if (*p == '\n') {
             if (line[0]) {
-                u8g2_DrawStr(&u8g2, 0, y, line);
+                glyph_cache_draw_str(&u8g2, 0, y, line);
                 y += line_h;
                 line[0] = '\0';
             } else {
@@ -165,26 +253,39 @@ static void update_screenf_font_v(const uint8_t* font, const char* fmt, va_list
             strlcpy(trial, word, sizeof(trial));
         }
 
-        if (u8g2_GetStrWidth(&u8g2, trial) > max_w) {
+        if (glyph_cache_str_width(&u8g2, trial) > max_w) {
             if (line[0]) {
-                u8g2_DrawStr(&u8g2, 0, y, line);
+                glyph_cache_draw_str(&u8g2, 0, y, line);
                 y += line_h;
-                snprintf(line, sizeof(line), "%s", word);
+                strlcpy(line, word, sizeof(line));
             } else {
-                u8g2_DrawStr(&u8g2, 0, y, word);
+                glyph_cache_draw_str(&u8g2, 0, y, word);
                 y += line_h;
                 line[0] = '\0';
             }
         } else {
-            snprintf(line, sizeof(line), "%s", trial);
+            strlcpy(line, trial, sizeof(line));
         }
     }
 
     if (line[0]) {
-        u8g2_DrawStr(&u8g2, 0, y, line);
+        glyph_cache_draw_str(&u8g2, 0, y, line);
     }
 
-    u8g2_SendBuffer(&u8g2);
+    display_flush_async(&u8g2);
+}
+
+void screen_text_show(const uint8_t* font) {
+    layout_text(font, s_screen_text);
+}
+
+void update_screen_text(const uint8_t* font, const char* text) {
+    layout_text(font, text);
+}
+
+static void update_screenf_font_v(const uint8_t* font, const char* fmt, va_list args) {
+    vsnprintf(s_screen_text, sizeof(s_screen_text), fmt, args);
+    layout_text(font, s_screen_text);
 }
 
 void update_screenf_font(const uint8_t* font, const char* fmt, ...) {
@@ -202,38 +303,35 @@ void update_screenf(const char* fmt, ...) {
 }
 
 static void weather_ui_update(const WeatherInfo* w) {
-    u8g2_ClearBuffer(&u8g2);
-    draw_status_bar();
-    u8g2_SetFont(&u8g2, u8g2_font_ncenB08_tr);
-
-    const int ascent = u8g2_GetAscent(&u8g2);
-    const int line_h = (u8g2_GetAscent(&u8g2) - u8g2_GetDescent(&u8g2)) + 2;
-    // const int disp_w = u8g2_GetDisplayWidth(&u8g2);
-
-    int y = STATUS_BAR_H + ascent;
+    if (w && w->ok && w != &s_last_weather) {
+        s_last_weather = *w;
+        s_have_weather = true;
+    }
 
     if (!w || !w->ok) {
-        u8g2_DrawStr(&u8g2, 0, y, "Weather error"); y += line_h;
-        u8g2_DrawStr(&u8g2, 0, y, (w && w->err[0]) ? w->err : "No details");
-        u8g2_SendBuffer(&u8g2);
+        u8g2_ClearBuffer(&u8g2);
+        draw_status_bar();
+        u8g2_SetFont(&u8g2, u8g2_font_ncenB08_tr);
+
+        const int line_h = (u8g2_GetAscent(&u8g2) - u8g2_GetDescent(&u8g2)) + 2;
+        int y = STATUS_BAR_H + u8g2_GetAscent(&u8g2);
+        glyph_cache_draw_str(&u8g2, 0, y, "Weather error"); y += line_h;
+        glyph_cache_draw_str(&u8g2, 0, y, (w && w->err[0]) ? w->err : "No details");
+        display_flush_async(&u8g2);
         return;
     }
 
-    char msg[64];
-    int n = snprintf(msg, sizeof(msg),
-        "T:%dC F:%dC H:%u%%\nMin:%dC Max:%dC\nW:%u KM/H\n%.*s",
-        w->temp_c, w->feels_c,
-        w->hum_pct,
-        w->tmin_c, w->tmax_c,
-        w->wind_kmh,
-        24,               // limit desc to 24 chars
-        w->desc);
-    ESP_LOGI("temp", "%d", n);
+    fmt_t* f = screen_text_begin();
+    fmt_str(f, "T:");       fmt_int(f, w->temp_c);
+    fmt_str(f, "C F:");     fmt_int(f, w->feels_c);
+    fmt_str(f, "C H:");     fmt_uint(f, w->hum_pct);
+    fmt_str(f, "%\nMin:");  fmt_int(f, w->tmin_c);
+    fmt_str(f, "C Max:");   fmt_int(f, w->tmax_c);
+    fmt_str(f, "C\nW:");    fmt_uint(f, w->wind_kmh);
+    fmt_str(f, " KM/H\n");
+    fmt_strn(f, w->desc, 24); // limit desc to 24 chars
     log_mem_usage();
-    if (n >= (int)sizeof(msg)) {
-        // truncated (still safe)
-    }
-    update_screenf("%s", msg);
+    screen_text_show(u8g2_font_ncenB08_tr);
 }
 
 static void draw_wifi_info(void) {
@@ -246,55 +344,68 @@ static void draw_wifi_info(void) {
         esp_netif_get_ip_info(netif, &ip_info);
     }
 
-    char msg[192];
-
-    if (ap_ret == ESP_OK) {
-        snprintf(msg, sizeof(msg),
-                 "WiFi CONNECTED\nSSID: %s\nRSSI: %d dBm\nIP: " IPSTR,
-                 (char*)ap_info.ssid,
-                 ap_info.rssi,
-                 IP2STR(&ip_info.ip));
-    } else {
-        snprintf(msg, sizeof(msg), "WiFi not connected");
+    if (ap_ret != ESP_OK) {
+        update_screen_text(u8g2_font_ncenB08_tr, "WiFi not connected");
+        return;
     }
-    update_screenf("%s", msg);
+    fmt_t* f = screen_text_begin();
+    fmt_str(f, "WiFi CONNECTED\nSSID: ");
+    fmt_str(f, (char*)ap_info.ssid);
+    fmt_str(f, "\nRSSI: ");
+    fmt_int(f, ap_info.rssi);
+    fmt_str(f, " dBm\nIP: ");
+    fmt_ip4(f, ip_info.ip.addr);
+    screen_text_show(u8g2_font_ncenB08_tr);
 }
 
 static void draw_geo(void) {
+    fmt_t* f = screen_text_begin();
     if (!geo_info.ok) {
-        update_screenf("Geo: %s", geo_info.message[0] ? geo_info.message : "not ready");
-        return;
+        fmt_str(f, "Geo: ");
+        fmt_str(f, geo_info.message[0] ? geo_info.message : "not ready");
+    } else {
+        fmt_str(f, "Geo\n");
+        fmt_str(f, geo_info.city);
+        fmt_str(f, ", ");
+        fmt_str(f, geo_info.region);
+        fmt_char(f, '\n');
+        fmt_str(f, geo_info.countryCode);
+        fmt_str(f, "\nUTC");
+        fmt_int_signed(f, (int32_t)(geo_info.offset_sec / 3600));
     }
-    update_screenf("Geo\n%s, %s\n%s\nUTC%+ld",
-                   geo_info.city, geo_info.region,
-                   geo_info.countryCode,
-                   geo_info.offset_sec / 3600);
+    screen_text_show(u8g2_font_ncenB08_tr);
 }
 
+// Same text strftime("%A, %B %d %Y %H:%M:%S") gave, without the locale machinery
 static void draw_time(void) {
+    static const char* const wday[7] = { "Sunday", "Monday", "Tuesday", "Wednesday",
+                                         "Thursday", "Friday", "Saturday" };
+    static const char* const month[12] = { "January", "February", "March", "April", "May", "June", "July",
+                                           "August", "September", "October", "November", "December" };
     struct tm timeinfo = {0};
-    if (!wifi_connected) return; // Guard, not really needed.
-
-    if (!sntp_started) {
-        const char* ntpServer = "pool.ntp.org";
-        esp_sntp_setoperatingmode(SNTP_OPMODE_POLL);
-        esp_sntp_setservername(0, ntpServer);
-        esp_sntp_init();
-        sntp_started = true;
-    }
-
-    time_t n = time(NULL);
-    if (n < 1609459200) {
-        update_screenf("Time: syncing...");
+    time_t now;
+    if (!time_service_now(&now)) {
+        update_screen_text(u8g2_font_ncenB08_tr, "Time: syncing...");
         return;
     }
-
-    time_t now = n + geo_info.offset_sec;
     gmtime_r(&now, &timeinfo);
 
-    char time_msg[64] = {0};
-    strftime(time_msg, sizeof(time_msg), "%A, %B %d %Y %H:%M:%S", &timeinfo);
-    update_screenf("%s", time_msg);
+    fmt_t* f = screen_text_begin();
+    fmt_str(f, wday[timeinfo.tm_wday]);
+    fmt_str(f, ", ");
+    fmt_str(f, month[timeinfo.tm_mon]);
+    fmt_char(f, ' ');
+    fmt_uint_pad(f, timeinfo.tm_mday, 2, '0');
+    fmt_char(f, ' ');
+    fmt_int(f, timeinfo.tm_year + 1900);
+    fmt_char(f, ' ');
+    fmt_uint_pad(f, timeinfo.tm_hour, 2, '0');
+    fmt_char(f, ':');
+    fmt_uint_pad(f, timeinfo.tm_min, 2, '0');
+    fmt_char(f, ':');
+    fmt_uint_pad(f, timeinfo.tm_sec, 2, '0');
+    if (time_service_quality() != TIME_SYNCED) fmt_str(f, "\n(not synced)");
+    screen_text_show(u8g2_font_ncenB08_tr);
 }
 
 // Generic menu draw helper
@@ -321,27 +432,43 @@ static void draw_menu(const Menu* menu) {
 
         if (idx == sel) {
             char line[32];
-            snprintf(line, sizeof(line), "> %s", menu->items[idx].label);
-            u8g2_DrawStr(&u8g2, 0, row_y, line);
+            fmt_t f;
+            fmt_init(&f, line, sizeof(line));
+            fmt_str(&f, "> ");
+            fmt_str(&f, menu->items[idx].label);
+            glyph_cache_draw_str(&u8g2, 0, row_y, line);
         } else {
-            u8g2_DrawStr(&u8g2, 10, row_y, menu->items[idx].label);
+            glyph_cache_draw_str(&u8g2, 10, row_y, menu->items[idx].label);
         }
     }
-    u8g2_SendBuffer(&u8g2);
+    display_flush_async(&u8g2);
 }
 
 // Handling input
 static void handle_input(const uint8_t* data, int len) {
-    if (len > 0) {
-        char hex[128] = {0};
-        int pos = 0;
-        for (int i = 0; i < len && pos < (int)sizeof(hex) - 4; i++) {
-            pos += snprintf(hex + pos, sizeof(hex) - pos, "%02X ", data[i]);
-        }
+    if (len > 0 && !trace_replaying()) {
+        display_mark_input(esp_timer_get_time());
     }
     for (int i = 0; i < len; i++) {
         Key k = decode_key(data[i]);
-        if (k == KEY_NONE) continue;
+        if (k == KEY_NONE) {
+            if (s_command_prefix) {
+                s_command_prefix = false;
+                handle_command(data[i]);
+                if (s_console_active) { // the rest of the line is the command
+                    console_feed(data + i + 1, len - i - 1);
+                    return;
+                }
+            } else if (data[i] == COMMAND_PREFIX_KEY && !trace_replaying()) {
+                s_command_prefix = true;
+            }
+            continue;
+        }
+        s_command_prefix = false;
+        const ScreenKeyHook key_hook = screens[current_screen].key;
+        if (key_hook && key_hook(k)) {
+            continue;
+        }
         if (k == KEY_LEFT) {
             go_back_one_menu();
             continue;
@@ -368,24 +495,48 @@ static void handle_input(const uint8_t* data, int len) {
     }
 }
 
-static void go_back_one_menu(void) {
-    switch (current_screen) {
-        case SCREEN_SETTINGS:
-        case SCREEN_WEATHER:
-        case SCREEN_TIME:
+// Console commands: the byte after COMMAND_PREFIX_KEY
+static void handle_command(uint8_t b) {
+    if (trace_replaying()) return; // commands typed during the recording
+    switch (b) {
+    case LATENCY_DUMP_KEY:
+        latency_dump();
+        break;
+    case SETTINGS_CONSOLE_KEY:
+        s_console_active = true;
+        s_console_len = 0;
+        printf("settings> ");
+        fflush(stdout);
+        break;
+#if TRACE_ENABLED
+    case TRACE_RECORD_KEY:
+        if (trace_recording()) {
+            trace_record_stop();
+        } else if (trace_record_start() == ESP_OK) {
+            // A replay starts from the same place
+            main_selected = weather_selected = settings_selected = 0;
             set_screen(SCREEN_MAIN);
-            break;
-        case SCREEN_WIFI:
-        case SCREEN_BT:
-        case SCREEN_GEO:
-            set_screen(SCREEN_SETTINGS);
-            break;
-        case SCREEN_TNH:
-        case SCREEN_WEATHER_MTL:
-            set_screen(SCREEN_WEATHER);
-            break;
-        default:
-            break;
+        }
+        break;
+    case TRACE_DUMP_KEY:
+        trace_dump();
+        break;
+    case TRACE_LOAD_KEY:
+        trace_load_begin();
+        break;
+    case TRACE_REPLAY_KEY:
+        s_replay_pending = true; // runs from the main loop, not inside handle_input
+        break;
+#endif
+    default:
+        break;
+    }
+}
+
+static void go_back_one_menu(void) {
+    Screen parent = screens[current_screen].parent;
+    if (parent != current_screen) {
+        set_screen(parent);
     }
 }
 
@@ -414,43 +565,22 @@ static Key decode_key(uint8_t b) {
 }
 
 static void set_screen(Screen s) {
+    const ScreenDef* def = &screens[s];
+
+    if (s == SCREEN_MAIN && current_screen != SCREEN_MAIN) {
+        s_resume_screen = current_screen;
+        s_resume_main_selected = main_selected;
+    }
     current_screen = s;
-    switch (s) {
-        case SCREEN_MAIN:
-            current_menu = &main_menu;
-            draw_menu(current_menu);
-            break;
-        case SCREEN_SETTINGS:
-            current_menu = &settings_menu;
-            draw_menu(current_menu);
-            break;
-        case SCREEN_WEATHER:
-            current_menu = &weather_menu;
-            draw_menu(current_menu);
-            break;
-        case SCREEN_TNH:
-            current_menu = NULL;
-            break;
-        case SCREEN_TIME:
-            current_menu = NULL;
-            break;
-        case SCREEN_WEATHER_MTL:
-            current_menu = NULL;
-            break;
-        case SCREEN_WIFI:
-            current_menu = NULL;
-            break;
-        case SCREEN_BT:
-            current_menu = NULL;
-            update_screenf("Bluetooth Action");
-            // ble_scan_start();
-            // draw_bt_devices();
-            break;
-        case SCREEN_GEO:
-            current_menu = NULL;
-            draw_geo();
-            break;
+    current_menu = def->menu;
+    if (current_menu) {
+        draw_menu(current_menu);
     }
+    if (def->enter) {
+        def->enter();
+    }
+    // Make the first update hook run on the next loop tick
+    s_last_update = xTaskGetTickCount() - pdMS_TO_TICKS(def->update_period_ms);
 }
 
 // static void draw_wrapped_text(int x, int y, int max_w, const char* text) {
@@ -513,22 +643,7 @@ static void set_screen(Screen s) {
 
 static void get_battery_label(char* out, size_t out_sz) {
     // Placeholder until you have real battery data
-    snprintf(out, out_sz, "BAT?");
-}
-
-static int get_wifi_bars(void) {
-    if (!wifi_connected) return 0;
-
-    wifi_ap_record_t ap_info = {0};
-    if (esp_wifi_sta_get_ap_info(&ap_info) != ESP_OK) {
-        return 0;
-    }
-
-    int rssi = ap_info.rssi;
-    if (rssi >= -67) return 3;
-    if (rssi >= -75) return 2;
-    if (rssi >= -85) return 1;
-    return 0;
+    strlcpy(out, "BAT?", out_sz);
 }
 
 static void draw_wifi_bars(const int w, const int bars) {
@@ -553,31 +668,77 @@ static void draw_wifi_bars(const int w, const int bars) {
     }
 }
 
-// static void draw_bt_devices(void) {
-//     char msg[192] = {0};
-//     ble_get_devices_text(msg, sizeof(msg));
-//     update_screenf("%s", msg);
-// }
+static void draw_bt_devices(void) {
+    ble_scan_start();
+    ble_get_devices_text(screen_text_begin());
+    screen_text_show(u8g2_font_ncenB08_tr);
+}
+
+static void update_bt_devices(void) {
+    if (ble_devices_take_dirty()) {
+        draw_bt_devices();
+    }
+}
+
+// Known networks are starred; redrawn as each channel's results come in
+static void draw_wifi_scan(void) {
+    static wifi_scan_result_t scan; // too big for the UI task stack
+    wifi_scan_get(&scan);
+    s_wifi_scan_gen = scan.generation;
+
+    fmt_t* f = screen_text_begin();
+    if (scan.running) {
+        fmt_str(f, "Scanning ch ");
+        fmt_uint(f, scan.channel);
+        fmt_str(f, "...");
+    } else {
+        fmt_uint(f, scan.count);
+        fmt_str(f, " networks");
+    }
+    for (int i = 0; i < scan.count && !f->truncated; i++) {
+        fmt_char(f, '\n');
+        fmt_char(f, scan.aps[i].known ? '*' : ' ');
+        fmt_int(f, scan.aps[i].rssi);
+        fmt_char(f, ' ');
+        fmt_strn(f, scan.aps[i].ssid, 18);
+    }
+    screen_text_show(u8g2_font_5x8_tr);
+}
+
+static void enter_wifi_scan(void) {
+    wifi_scan_start(); // ESP_ERR_INVALID_STATE just means one is already running
+    draw_wifi_scan();
+}
+
+static void update_wifi_scan(void) {
+    if (wifi_scan_generation() != s_wifi_scan_gen) {
+        draw_wifi_scan();
+    }
+}
 
 static void status_bar_update_if_changed(void) {
     char bat[8];
     get_battery_label(bat, sizeof(bat));
-    const bool wifi = wifi_connected;
-    const int bars = get_wifi_bars();
 
-    if (wifi == s_last_wifi_connected &&
-        bars == s_last_wifi_bars &&
+    // Cached by the connectivity service, no driver call
+    conn_snapshot_t conn;
+    connectivity_get(&conn);
+    const int bars = conn.online ? conn.bars : 0;
+
+    if (bars == s_last_wifi_bars &&
         strcmp(bat, s_last_bat_label) == 0) {
         return; // no change, no redraw
     }
 
     draw_status_bar();
-    u8g2_SendBuffer(&u8g2);
+    display_flush_async(&u8g2);
 }
 
 static void draw_status_bar(void) {
     const int w = u8g2_GetDisplayWidth(&u8g2);
-    const int bars = get_wifi_bars();
+    conn_snapshot_t conn;
+    connectivity_get(&conn);
+    const int bars = conn.online ? conn.bars : 0;
 
     u8g2_SetDrawColor(&u8g2, 0);
     u8g2_DrawBox(&u8g2, 0, 0, w, STATUS_BAR_H);
@@ -588,48 +749,543 @@ static void draw_status_bar(void) {
 
     char bat[8];
     get_battery_label(bat, sizeof(bat));
-    u8g2_DrawStr(&u8g2, 0, 8, bat);
+    glyph_cache_draw_str(&u8g2, 0, 8, bat);
 
     // Right: WiFi bars
     draw_wifi_bars(w, bars);
 
-    s_last_wifi_connected = wifi_connected;
     s_last_wifi_bars = bars;
     strlcpy(s_last_bat_label, bat, sizeof(s_last_bat_label));
 }
 
-static void action_placeholder(void) { update_screenf("Not implemented"); }
 static void action_open_weather(void) { set_screen(SCREEN_WEATHER); }
 static void action_tnh(void) { set_screen(SCREEN_TNH); }
-static void action_time(void) { if (!wifi_connected) { update_screenf("WiFi required"); return; } set_screen(SCREEN_TIME); }
+static void action_time(void) {
+    if (!connectivity_online() && time_service_quality() == TIME_UNSET) { update_screenf("WiFi required"); return; }
+    set_screen(SCREEN_TIME);
+}
 static void action_open_settings(void) { set_screen(SCREEN_SETTINGS); }
 static void action_bt(void) { set_screen(SCREEN_BT); }
+static void action_wifi_scan(void) { set_screen(SCREEN_WIFI_SCAN); }
 static void action_geo(void) { set_screen(SCREEN_GEO); }
 static void action_wifi(void) {
     set_screen(SCREEN_WIFI);
     update_screenf("WiFi: connecting...");
 
-    if (!wifi_connected) {
+    if (trace_replaying()) {
+        // Leave the radio alone; the geo reply, if any, comes from the trace
+        geo_fetch_info("", &geo_info);
+        return;
+    }
+
+    if (!connectivity_online()) {
         esp_err_t status = connect_wifi();
         if (status != WIFI_SUCCESS) {
             update_screenf("WiFi connection failed");
             return;
         }
-        wifi_connected = true;
         status_bar_update_if_changed();
-        geo_fetch_info("", &geo_info);
+#if MIRROR_ENABLED
+        mirror_start();
+#endif
+#if HTTP_API_ENABLED
+        http_api_start();
+#endif
+#if MQTT_PUB_ENABLED
+        mqtt_pub_start();
+#endif
+        if (geo_fetch_info("", &geo_info)) {
+            time_service_set_offset(geo_info.offset_sec);
+        }
+    }
+}
+
+static void action_ota(void) {
+    if (!connectivity_online()) { update_screenf("WiFi required"); return; }
+    esp_err_t err = ota_update_start();
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        update_screenf("Update failed:\n%s", esp_err_to_name(err));
+        return;
     }
+    set_screen(SCREEN_OTA);
+}
+
+static void draw_ota(void) {
+    ota_status_t st;
+    ota_get_status(&st);
+    fmt_t* f = screen_text_begin();
+    switch (st.state) {
+    case OTA_RUNNING:
+        if (st.rx_total > 0) {
+            fmt_str(f, "Updating ");
+            fmt_uint(f, (uint32_t)((uint64_t)st.rx_bytes * 100 / st.rx_total));
+            fmt_str(f, "%\n");
+        } else {
+            fmt_str(f, "Updating...\n");
+        }
+        fmt_uint(f, st.image_bytes / 1024);
+        fmt_str(f, " KB image");
+        break;
+    case OTA_DONE:
+        fmt_str(f, "Update done\nRestarting...");
+        break;
+    case OTA_FAILED:
+        fmt_str(f, "Update failed:\n");
+        fmt_str(f, st.err);
+        break;
+    default:
+        fmt_str(f, "No update running");
+        break;
+    }
+    screen_text_show(u8g2_font_ncenB08_tr);
 }
 
 static void action_weather_mtl(void) {
-    if (wifi_connected) {
-        weather_fetch_city("Montreal", weather_ui_update);
+    if (connectivity_online() || trace_replaying()) {
+        char city[SETTINGS_STR_MAX];
+        settings_get_str(SET_CITY, city, sizeof(city));
+        weather_fetch_city(city, weather_ui_update);
         set_screen(SCREEN_WEATHER_MTL);
     } else {
         update_screenf("WiFi connection failed");
     }
 }
 
+// Forecast for the geolocated city, the configured one until geolocation has run
+static void action_forecast(void) {
+    if (!connectivity_online()) {
+        update_screenf("WiFi connection failed");
+        return;
+    }
+    update_screenf("Forecast: loading...");
+    char city[SETTINGS_STR_MAX];
+    settings_get_str(SET_CITY, city, sizeof(city));
+    esp_err_t err = weather_fetch_forecast(geo_info.ok ? geo_info.city : city, &s_forecast);
+    if (err != ESP_OK) {
+        s_forecast.count = 0;
+        update_screenf("Forecast error:\n%s", esp_err_to_name(err));
+        return;
+    }
+    set_screen(SCREEN_FORECAST);
+}
+
+// One line per local day in the small font: "Sat -9/25C 45% Clear"
+static void draw_forecast(void) {
+    static const char* const wday[7] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+    forecast_day_t days[FORECAST_MAX_DAYS];
+    const size_t n = forecast_daily(&s_forecast, days, FORECAST_MAX_DAYS);
+
+    char city[SETTINGS_STR_MAX];
+    settings_get_str(SET_CITY, city, sizeof(city));
+    fmt_t* f = screen_text_begin();
+    fmt_str(f, geo_info.ok ? geo_info.city : city);
+    for (size_t i = 0; i < n && !f->truncated; i++) {
+        fmt_char(f, '\n');
+        fmt_str(f, wday[days[i].weekday]);
+        fmt_char(f, ' ');
+        fmt_int(f, fixed_round_centi(days[i].tmin_centi_c));
+        fmt_char(f, '/');
+        fmt_int(f, fixed_round_centi(days[i].tmax_centi_c));
+        fmt_str(f, "C ");
+        fmt_uint(f, days[i].hum_pct);
+        fmt_str(f, "% ");
+        fmt_str(f, forecast_condition(days[i].cond_id));
+    }
+    screen_text_show(u8g2_font_5x8_tr);
+}
+
+static void fmt_us(fmt_t* f, uint32_t us) {
+    if (us < 1000) {
+        fmt_uint(f, us);
+        fmt_str(f, "us");
+    } else if (us < 100000) {
+        fmt_fixed(f, (int32_t)((us + 50) / 100), 1);
+        fmt_str(f, "ms");
+    } else if (us < 10000000) {
+        fmt_uint(f, (us + 500) / 1000);
+        fmt_str(f, "ms");
+    } else {
+        fmt_fixed(f, (int32_t)((us + 50000) / 100000), 1);
+        fmt_char(f, 's');
+    }
+}
+
+static void action_diag(void) { set_screen(SCREEN_DIAG); }
+
+// p50/p99/max per histogram, alternating between two pages that fit the 5x8 font
+static void draw_diag(void) {
+    static const latency_id_t pages[2][4] = {
+        { LAT_LOOP_JITTER, LAT_INPUT_TO_PIXEL, LAT_DHT20_READ, LAT_WIFI_CONNECT },
+        { LAT_HTTP_WEATHER, LAT_HTTP_FORECAST, LAT_HTTP_GEO, LAT_GAME_FRAME },
+    };
+    const int page = (xTaskGetTickCount() / pdMS_TO_TICKS(DIAG_PAGE_MS)) % 2;
+
+    fmt_t* f = screen_text_begin();
+    fmt_str(f, "p50/p99/max (");
+    fmt_int(f, page + 1);
+    fmt_str(f, "/2)");
+    for (int i = 0; i < 4 && pages[page][i] != LAT_COUNT && !f->truncated; i++) {
+        latency_summary_t s;
+        latency_summary(pages[page][i], &s);
+        fmt_char(f, '\n');
+        fmt_str(f, latency_name(pages[page][i]));
+        if (s.samples == 0) {
+            fmt_str(f, " -");
+            continue;
+        }
+        fmt_char(f, ' ');
+        fmt_us(f, s.p50_us);
+        fmt_char(f, '/');
+        fmt_us(f, s.p99_us);
+        fmt_char(f, '/');
+        fmt_us(f, s.max_us);
+    }
+    screen_text_show(u8g2_font_5x8_tr);
+}
+
+static void action_games(void) { set_screen(SCREEN_GAMES); }
+
+// Non-blocking: every key waiting on the UART, as game buttons
+static uint8_t poll_game_buttons(void) {
+    uint8_t buf[16];
+    const int len = read(STDIN_FILENO, buf, sizeof(buf));
+    uint8_t pressed = 0;
+    for (int i = 0; i < len; i++) {
+        switch (decode_key(buf[i])) {
+        case KEY_UP:    pressed |= GAME_BTN_UP; break;
+        case KEY_DOWN:  pressed |= GAME_BTN_DOWN; break;
+        case KEY_LEFT:  pressed |= GAME_BTN_LEFT; break;
+        case KEY_RIGHT: pressed |= GAME_BTN_RIGHT; break;
+        case KEY_ENTER: pressed |= GAME_BTN_A; break;
+        case KEY_ESC:   pressed |= GAME_BTN_QUIT; break;
+        default:
+            if (buf[i] == GAME_QUIT_KEY) pressed |= GAME_BTN_QUIT;
+            break;
+        }
+    }
+    return pressed;
+}
+
+// The game owns the UI task until it ends; the result screen leads back to the menu
+static void run_game(const game_t* game) {
+    s_last_game = game;
+    if (game_run(game, &u8g2, poll_game_buttons, &s_game_stats) != ESP_OK) {
+        update_screenf("Game failed to start");
+        return;
+    }
+    set_screen(SCREEN_GAME);
+}
+
+static void action_snake(void) { run_game(&game_snake); }
+static void action_tetris(void) { run_game(&game_tetris); }
+
+static void draw_game_result(void) {
+    const game_stats_t* st = &s_game_stats;
+    if (!s_last_game) return;
+
+    const uint32_t fps10 = st->elapsed_ms ? (uint32_t)((uint64_t)st->frames * 10000 / st->elapsed_ms) : 0;
+    fmt_t* f = screen_text_begin();
+    fmt_str(f, s_last_game->name);
+    fmt_str(f, ": ");
+    fmt_uint(f, st->score);
+    fmt_str(f, " points\n");
+    fmt_fixed(f, (int32_t)fps10, 1);
+    fmt_str(f, " fps, ");
+    fmt_uint(f, st->late);
+    fmt_str(f, " late\nframe work ");
+    fmt_us(f, st->work_avg_us);
+    fmt_char(f, '/');
+    fmt_us(f, st->work_max_us);
+    fmt_char(f, '\n');
+    fmt_uint(f, st->dropped);
+    fmt_str(f, " ticks dropped\nLeft: back");
+    screen_text_show(u8g2_font_5x8_tr);
+}
+
+// Characters the city editor cycles through, space first so it reads as "empty"
+static const char s_prefs_chars[] = " ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-.,'";
+
+static void action_prefs(void) {
+    s_prefs_sel = 0;
+    s_prefs_edit = -1;
+    set_screen(SCREEN_PREFS);
+}
+
+static void draw_prefs(void) {
+    fmt_t* f = screen_text_begin();
+    fmt_str(f, "Preferences");
+    s_prefs_gen = settings_generation();
+
+    // The rows scroll to keep the selection in view
+    const int first = (s_prefs_sel >= PREFS_ROWS) ? s_prefs_sel - PREFS_ROWS + 1 : 0;
+    for (int id = first; id < SET_COUNT && id < first + PREFS_ROWS; id++) {
+        const setting_def_t* d = settings_def(id);
+        fmt_char(f, '\n');
+        fmt_char(f, (id == s_prefs_sel) ? '>' : ' ');
+        fmt_str(f, d->label);
+        fmt_str(f, ": ");
+        if (id != s_prefs_edit) {
+            settings_format(id, f);
+        } else if (d->type == SETTING_INT) {
+            fmt_char(f, '<');
+            fmt_int(f, s_prefs_int);
+            fmt_char(f, '>');
+        } else {
+            // Brackets mark the cursor; past the end it sits on a blank
+            const int n = (int)strlen(s_prefs_str);
+            fmt_strn(f, s_prefs_str, s_prefs_pos);
+            fmt_char(f, '[');
+            fmt_char(f, (s_prefs_pos < n) ? s_prefs_str[s_prefs_pos] : ' ');
+            fmt_char(f, ']');
+            if (s_prefs_pos < n) fmt_str(f, s_prefs_str + s_prefs_pos + 1);
+        }
+    }
+    const char* hint = "Enter: edit";
+    if (s_prefs_edit >= 0) {
+        hint = (settings_def(s_prefs_edit)->type == SETTING_INT) ? "Up/Down, Enter: set"
+                                                                : "Up/Down char, Enter: set";
+    }
+    fmt_char(f, '\n');
+    fmt_str(f, hint);
+    screen_text_show(u8g2_font_5x8_tr);
+}
+
+// Picks up changes made from the console while the screen is up
+static void update_prefs(void) {
+    if (s_prefs_edit < 0 && settings_generation() != s_prefs_gen) draw_prefs();
+}
+
+static void prefs_begin_edit(void) {
+    s_prefs_edit = s_prefs_sel;
+    if (settings_def(s_prefs_edit)->type == SETTING_INT) {
+        s_prefs_int = settings_get_int(s_prefs_edit);
+    } else {
+        settings_get_str(s_prefs_edit, s_prefs_str, sizeof(s_prefs_str));
+        s_prefs_pos = 0;
+    }
+}
+
+// UP/DOWN cycle the character under the cursor; past the end that appends one
+static void prefs_cycle_char(int dir) {
+    const int n = (int)strlen(s_prefs_str);
+    const char cur = (s_prefs_pos < n) ? s_prefs_str[s_prefs_pos] : ' ';
+    const char* at = strchr(s_prefs_chars, cur);
+    const int count = (int)sizeof(s_prefs_chars) - 1;
+    const int idx = at ? (int)(at - s_prefs_chars) : 0;
+    s_prefs_str[s_prefs_pos] = s_prefs_chars[(idx + dir + count) % count];
+    if (s_prefs_pos == n) s_prefs_str[n + 1] = '\0';
+}
+
+static void prefs_apply_str(void) {
+    int n = (int)strlen(s_prefs_str);
+    while (n > 0 && s_prefs_str[n - 1] == ' ') s_prefs_str[--n] = '\0';
+    if (settings_set_str(s_prefs_edit, s_prefs_str) != ESP_OK) {
+        ESP_LOGW("prefs", "Rejected %s '%s'", settings_def(s_prefs_edit)->key, s_prefs_str);
+    }
+}
+
+// Browsing leaves LEFT and ESC to the registry; while editing the screen takes every key
+static bool prefs_key(Key k) {
+    if (s_prefs_edit < 0) {
+        switch (k) {
+        case KEY_UP:    if (s_prefs_sel > 0) s_prefs_sel--; break;
+        case KEY_DOWN:  if (s_prefs_sel < SET_COUNT - 1) s_prefs_sel++; break;
+        case KEY_ENTER:
+        case KEY_RIGHT: prefs_begin_edit(); break;
+        default:        return false;
+        }
+        draw_prefs();
+        return true;
+    }
+
+    const setting_def_t* d = settings_def(s_prefs_edit);
+    if (d->type == SETTING_INT) {
+        switch (k) {
+        case KEY_UP:    s_prefs_int = (s_prefs_int + d->step <= d->max) ? s_prefs_int + d->step : d->max; break;
+        case KEY_DOWN:  s_prefs_int = (s_prefs_int - d->step >= d->min) ? s_prefs_int - d->step : d->min; break;
+        case KEY_ENTER: settings_set_int(s_prefs_edit, s_prefs_int); s_prefs_edit = -1; break;
+        default:        s_prefs_edit = -1; break; // LEFT / ESC cancel
+        }
+    } else {
+        const int n = (int)strlen(s_prefs_str);
+        switch (k) {
+        case KEY_UP:    prefs_cycle_char(1); break;
+        case KEY_DOWN:  prefs_cycle_char(-1); break;
+        case KEY_RIGHT: if (s_prefs_pos < n && s_prefs_pos < d->max - 1) s_prefs_pos++; break;
+        case KEY_LEFT:  if (s_prefs_pos > 0) s_prefs_pos--; else s_prefs_edit = -1; break;
+        case KEY_ENTER: prefs_apply_str(); s_prefs_edit = -1; break;
+        default:        s_prefs_edit = -1; break;
+        }
+    }
+    draw_prefs();
+    return true;
+}
+
+// Settings console line being typed after SETTINGS_CONSOLE_KEY: echoed, run on Enter.
+// Lines starting with "wifi" edit the known networks instead.
+static void console_feed(const uint8_t* data, int len) {
+    for (int i = 0; i < len && s_console_active; i++) {
+        const uint8_t c = data[i];
+        if (c == '\r' || c == '\n') {
+            putchar('\n');
+            s_console_line[s_console_len] = '\0';
+            s_console_active = false;
+            if (strncmp(s_console_line, "wifi", 4) == 0 && (s_console_line[4] == ' ' || !s_console_line[4])) {
+                wifi_store_console(s_console_line + 4);
+            } else {
+                settings_console(s_console_line);
+            }
+        } else if (c == 0x1B) {
+            printf(" (cancelled)\n");
+            s_console_active = false;
+        } else if ((c == 0x08 || c == 0x7F) && s_console_len > 0) {
+            s_console_len--;
+            printf("\b \b");
+        } else if (c >= ' ' && c < 0x7F && s_console_len < (int)sizeof(s_console_line) - 1) {
+            s_console_line[s_console_len++] = (char)c;
+            putchar(c);
+        }
+    }
+    fflush(stdout);
+}
+
+static void snapshot_fill(snapshot_t* snap) {
+    memset(snap, 0, sizeof(*snap));
+    snap->version = SNAPSHOT_VERSION;
+    if (current_screen == SCREEN_MAIN) {
+        snap->screen = (uint8_t)s_resume_screen;
+        snap->main_selected = (uint8_t)s_resume_main_selected;
+    } else {
+        snap->screen = (uint8_t)current_screen;
+        snap->main_selected = (uint8_t)main_selected;
+    }
+    snap->weather_selected = (uint8_t)weather_selected;
+    snap->settings_selected = (uint8_t)settings_selected;
+
+    if (s_have_weather) {
+        snap->flags |= SNAPSHOT_HAS_WEATHER;
+        snap->weather_temp_c = (int8_t)s_last_weather.temp_c;
+        snap->weather_feels_c = (int8_t)s_last_weather.feels_c;
+        snap->weather_tmin_c = (int8_t)s_last_weather.tmin_c;
+        snap->weather_tmax_c = (int8_t)s_last_weather.tmax_c;
+        snap->weather_hum_pct = (uint8_t)s_last_weather.hum_pct;
+        snap->weather_wind_kmh = (uint16_t)s_last_weather.wind_kmh;
+        strlcpy(snap->weather_desc, s_last_weather.desc, sizeof(snap->weather_desc));
+    }
+    if (geo_info.ok) {
+        snap->flags |= SNAPSHOT_HAS_GEO;
+        snap->geo_offset_s = (int32_t)geo_info.offset_sec;
+        strlcpy(snap->geo_country, geo_info.countryCode, sizeof(snap->geo_country));
+        strlcpy(snap->geo_region, geo_info.region, sizeof(snap->geo_region));
+        strlcpy(snap->geo_city, geo_info.city, sizeof(snap->geo_city));
+    }
+    dht20_sample_t r;
+    if (dht20_get_last(&r)) {
+        snap->flags |= SNAPSHOT_HAS_READING;
+        snap->temp_centi_c = r.temp_centi_c;
+        snap->hum_centi_pct = r.hum_centi_pct;
+        snap->reading_time_s = r.time_s;
+    }
+    int64_t utc_s = 0;
+    long offset_s = 0;
+    if (time_service_save(&utc_s, &offset_s)) {
+        snap->flags |= SNAPSHOT_HAS_TIME;
+        snap->utc_s = utc_s;
+    }
+    snap->tz_offset_s = (int32_t)offset_s;
+}
+
+// Saves the warm state in one NVS write, blanks the panel and sleeps until reset
+static void action_shutdown(void) {
+    settings_flush(); // don't lose an edit still waiting on the commit timer
+    sample_store_flush(); // nor offline samples still in the RAM page
+    snapshot_t snap;
+    snapshot_fill(&snap);
+    const int64_t t0 = esp_timer_get_time();
+    esp_err_t err = snapshot_save(&snap);
+    ESP_LOGI("shutdown", "snapshot %u bytes, screen %u, flags 0x%02x, saved in %lld us: %s", (unsigned)sizeof(snap),
+             snap.screen, snap.flags, (long long)(esp_timer_get_time() - t0), esp_err_to_name(err));
+
+    display_flush_wait(pdMS_TO_TICKS(100));
+    u8g2_SetPowerSave(&u8g2, 1);
+    esp_wifi_stop(); // fails harmlessly if WiFi never started
+    esp_deep_sleep_start();
+}
+
+typedef struct {
+    uint32_t renders;
+    uint32_t allocs;
+    uint64_t cpu_us;        // UI task wall time, which is what a user waits for
+} replay_stat_t;
+
+// Feeds the loaded trace through the UI as fast as it goes. Time is virtual: the
+// update hooks and status bar run once per MAIN_LOOP_PERIOD_MS of trace time, and
+// everything in between is skipped. Costs go to the screen shown when the work began.
+void ui_run_replay(void) {
+    static replay_stat_t stats[SCREEN_COUNT];
+    memset(stats, 0, sizeof(stats));
+
+    if (!trace_replay_begin()) {
+        printf("REPLAY no trace loaded\n");
+        return;
+    }
+    const uint32_t trace_ms = trace_duration_ms();
+    main_selected = weather_selected = settings_selected = 0;
+    set_screen(SCREEN_MAIN);
+
+    trace_event_t ev;
+    bool have_event = trace_replay_next(&ev);
+    uint32_t now_ms = 0;
+    uint32_t update_ms = 0;
+    Screen update_screen = SCREEN_COUNT;
+    const int64_t start_us = esp_timer_get_time();
+
+    while (have_event) {
+        const Screen screen = current_screen;
+        display_stats_t d0, d1;
+        display_get_stats(&d0);
+        const uint32_t allocs = trace_alloc_count();
+        const int64_t t0 = esp_timer_get_time();
+
+        if (ev.t_ms <= now_ms) {
+            if (ev.type == TRACE_KEY) {
+                handle_input(ev.data, ev.len);
+            } else if (ev.type == TRACE_DHT20) {
+                dht20_replay_frame(ev.data, ev.len);
+            }
+            have_event = trace_replay_next(&ev);
+        } else {
+            // One loop tick of virtual time
+            now_ms += MAIN_LOOP_PERIOD_MS;
+            const ScreenDef* def = &screens[current_screen];
+            if (def->update && (current_screen != update_screen || now_ms - update_ms >= def->update_period_ms)) {
+                update_screen = current_screen;
+                update_ms = now_ms;
+                def->update();
+            }
+            status_bar_update_if_changed();
+        }
+
+        stats[screen].cpu_us += (uint64_t)(esp_timer_get_time() - t0);
+        stats[screen].allocs += trace_alloc_count() - allocs;
+        display_get_stats(&d1);
+        stats[screen].renders += d1.frames - d0.frames;
+    }
+    display_flush_wait(portMAX_DELAY);
+    const uint32_t run_ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+    trace_replay_end();
+
+    printf("REPLAY %lu ms of trace in %lu ms (%lux)\n", (unsigned long)trace_ms,
+           (unsigned long)run_ms, (unsigned long)(trace_ms / (run_ms ? run_ms : 1)));
+    for (int i = 0; i < SCREEN_COUNT; i++) {
+        const replay_stat_t* st = &stats[i];
+        if (!st->renders && !st->cpu_us) continue;
+        printf("  screen %2d renders=%lu bytes=%lu allocs=%lu cpu=%lluus\n", i,
+               (unsigned long)st->renders, (unsigned long)(st->renders * DISPLAY_FRAME_BYTES),
+               (unsigned long)st->allocs, (unsigned long long)st->cpu_us);
+    }
+}
+
 static void log_mem_usage(void) {
     // Heap
     size_t free_heap = esp_get_free_heap_size();
@@ -646,10 +1302,87 @@ static void log_mem_usage(void) {
     ESP_LOGI("mem", "stack high-water: %u bytes", (unsigned)(words * sizeof(StackType_t)));
 }
 
+// Puts the snapshot's state back. Returns the screen to show: one that draws from
+// what was restored, else its parent.
+static Screen snapshot_apply(const snapshot_t* snap) {
+    if (snap->flags & SNAPSHOT_HAS_WEATHER) {
+        memset(&s_last_weather, 0, sizeof(s_last_weather));
+        s_last_weather.ok = true;
+        s_last_weather.temp_c = snap->weather_temp_c;
+        s_last_weather.feels_c = snap->weather_feels_c;
+        s_last_weather.tmin_c = snap->weather_tmin_c;
+        s_last_weather.tmax_c = snap->weather_tmax_c;
+        s_last_weather.hum_pct = snap->weather_hum_pct;
+        s_last_weather.wind_kmh = snap->weather_wind_kmh;
+        strlcpy(s_last_weather.desc, snap->weather_desc, sizeof(s_last_weather.desc));
+        s_have_weather = true;
+    }
+    if (snap->flags & SNAPSHOT_HAS_GEO) {
+        geo_info.ok = true;
+        geo_info.offset_sec = snap->geo_offset_s;
+        strlcpy(geo_info.countryCode, snap->geo_country, sizeof(geo_info.countryCode));
+        strlcpy(geo_info.region, snap->geo_region, sizeof(geo_info.region));
+        strlcpy(geo_info.city, snap->geo_city, sizeof(geo_info.city));
+    }
+    if (snap->flags & SNAPSHOT_HAS_READING) {
+        dht20_seed(snap->temp_centi_c, snap->hum_centi_pct, snap->reading_time_s);
+    }
+    if (snap->flags & SNAPSHOT_HAS_TIME) {
+        time_service_resume(snap->utc_s, snap->tz_offset_s);
+    } else {
+        time_service_set_offset(snap->tz_offset_s);
+    }
+
+    main_selected = (snap->main_selected < MAIN_MENU_COUNT) ? snap->main_selected : 0;
+    weather_selected = (snap->weather_selected < WEATHER_MENU_COUNT) ? snap->weather_selected : 0;
+    settings_selected = (snap->settings_selected < SETTINGS_MENU_COUNT) ? snap->settings_selected : 0;
+
+    const Screen screen = (snap->screen < SCREEN_COUNT) ? (Screen)snap->screen : SCREEN_MAIN;
+    switch (screen) {
+    case SCREEN_WEATHER_MTL:
+        return s_have_weather ? screen : SCREEN_WEATHER;
+    case SCREEN_FORECAST:   // not kept
+    case SCREEN_WIFI:       // these query the radios
+    case SCREEN_WIFI_SCAN:
+    case SCREEN_BT:
+    case SCREEN_OTA:
+    case SCREEN_GAME:
+        return screens[screen].parent;
+    default:
+        return screen;
+    }
+}
+
+// First frame of the boot: the screen from the shutdown snapshot if there is one
+void ui_resume_or_start(void) {
+    const int64_t t0 = esp_timer_get_time();
+    snapshot_t snap;
+    if (!snapshot_load(&snap)) {
+        set_screen(SCREEN_MAIN);
+        return;
+    }
+
+    const Screen screen = snapshot_apply(&snap);
+    set_screen(screen);
+    if (screen == SCREEN_WEATHER_MTL) weather_ui_update(&s_last_weather);
+    // Screens without a menu draw from their update hook: run it now rather than on
+    // the next loop tick, so the first frame is in the time logged below
+    if (screens[screen].update) {
+        screens[screen].update();
+        s_last_update = xTaskGetTickCount();
+    }
+    display_flush_wait(portMAX_DELAY);
+    const int64_t t1 = esp_timer_get_time();
+
+    snapshot_clear();
+    ESP_LOGI("resume", "screen %d, flags 0x%02x, restored and drawn in %lld us (%lld us after boot)",
+             (int)screen, snap.flags, (long long)(t1 - t0), (long long)t1);
+}
+
 // Main app
 void app_main(void) {
     i2c_master_init();
-    u8g2_init();
+    ui_display_init();
     uart_init();
 
     esp_err_t ret = nvs_flash_init();
@@ -658,39 +1391,59 @@ void app_main(void) {
         ret = nvs_flash_init();
     }
     ESP_ERROR_CHECK(ret);
+    settings_init();
 
-    // ble_init();
+    time_service_init();
+    ui_resume_or_start(); // before BLE and WiFi start
+    ble_init();
+#if MQTT_PUB_ENABLED
+    mqtt_pub_init();
+#endif
+    dht20_start_sampler();
 
-    set_screen(SCREEN_MAIN); // Start on main menu
+    // Display, sensor and radio came up: keep this image
+    ota_confirm_boot();
 
     uint8_t* data = (uint8_t*) malloc(BUF_SIZE);
     bool running = true;
+    int64_t last_loop_us = 0;
     while (running) {
+        // Jitter against the nominal period: long input handling or updates show up here
+        int64_t loop_us = esp_timer_get_time();
+        if (last_loop_us) {
+            int64_t jitter = loop_us - last_loop_us - MAIN_LOOP_PERIOD_MS * 1000;
+            latency_record(LAT_LOOP_JITTER, (uint32_t)(jitter < 0 ? -jitter : jitter));
+        }
+        last_loop_us = loop_us;
+
         int len = read(STDIN_FILENO, data, BUF_SIZE - 1);
 
         if (len > 0) {
             data[len] = '\0';
-            handle_input(data, len);
-        }
-
-        if (current_screen == SCREEN_TNH) {
-            draw_dht20();
-        }
-        if (current_screen == SCREEN_WIFI) {
-            draw_wifi_info();
+            if (trace_loading()) {
+                trace_load_feed(data, len);
+            } else if (s_console_active) {
+                console_feed(data, len);
+            } else {
+                trace_record(TRACE_KEY, data, len);
+                handle_input(data, len);
+            }
         }
-        if (current_screen == SCREEN_TIME) {
-            draw_time();
+        if (s_replay_pending) {
+            s_replay_pending = false;
+            ui_run_replay();
+            last_loop_us = 0; // the replay is not loop jitter
         }
 
-        // if (current_screen == SCREEN_BT) {
-        //     ble_scan_start();
-        //     if (ble_devices_take_dirty()) {
-        //         draw_bt_devices();
-        //     }
-        // }
+        const ScreenDef* def = &screens[current_screen];
+        TickType_t now = xTaskGetTickCount();
+        if (def->update && (now - s_last_update) >= pdMS_TO_TICKS(def->update_period_ms)) {
+            s_last_update = now;
+            def->update();
+        }
+        status_bar_update_if_changed();
 
-        vTaskDelay(pdMS_TO_TICKS(100));
+        vTaskDelay(pdMS_TO_TICKS(MAIN_LOOP_PERIOD_MS));
     }
     free(data);
 }
\ No newline at end of file
@@ -9,14 +9,31 @@
 #include <esp_sntp.h>
 #include <u8g2.h>
 #include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <esp_sleep.h>
 #include <unistd.h> // For STDIN_FILENO
 #include <u8g2_esp32_hal.h>
 
 #include "wifi.h"
-// #include "ble.h"
+#include "connectivity.h"
+#include "ble.h"
 #include "dht20.h"
 #include "weather.h"
 #include "geolocation.h"
+#include "glyph_cache.h"
+#include "display.h"
+#include "mirror.h"
+#include "http_api.h"
+#include "mqtt_pub.h"
+#include "sample_store.h"
+#include "ota.h"
+#include "time_service.h"
+#include "latency.h"
+#include "trace.h"
+#include "game.h"
+#include "snapshot.h"
+#include "settings.h"
+#include "fmt.h"
 
 #define PIN_CLK     6
 #define PIN_MOSI    7
@@ -36,16 +53,39 @@
 
 #define STATUS_BAR_H            10
 
+#define MAIN_LOOP_PERIOD_MS     100
+#define DIAG_PAGE_MS            3000    // diagnostics screen page flip
+#define PREFS_ROWS              4       // settings shown between the title and the hint
+// UART commands are two bytes, COMMAND_PREFIX_KEY then the command key, so stray
+// letters on the console do nothing
+#define COMMAND_PREFIX_KEY      '`'
+#define LATENCY_DUMP_KEY        'd'     // print every latency histogram
+#define GAME_QUIT_KEY           'q'     // leaves a game, as does ESC
+
+// Glyph cache slots per font (direct mapped by character code; 96 covers printable ASCII)
+#define GLYPH_CACHE_ENABLED         1
+#define GLYPH_CACHE_SLOTS_NCENB08   96
+#define GLYPH_CACHE_SLOTS_NCENB12   64
+#define GLYPH_CACHE_SLOTS_5X8       96
+
 typedef enum {
     SCREEN_MAIN,
     SCREEN_SETTINGS,
     SCREEN_WEATHER,
     SCREEN_WEATHER_MTL,
+    SCREEN_FORECAST,
     SCREEN_TIME,
     SCREEN_TNH,
     SCREEN_WIFI,
+    SCREEN_WIFI_SCAN,
     SCREEN_GEO,
-    SCREEN_BT
+    SCREEN_BT,
+    SCREEN_OTA,
+    SCREEN_DIAG,
+    SCREEN_GAMES,
+    SCREEN_GAME,
+    SCREEN_PREFS,
+    SCREEN_COUNT
 } Screen;
 
 typedef void (*MenuAction)(void);
@@ -71,10 +111,33 @@ typedef enum {
     KEY_ESC
 } Key;
 
+typedef void (*ScreenHook)(void);
+// Keys for a non-menu screen; returns false to leave the key to the default handling
+typedef bool (*ScreenKeyHook)(Key k);
+
+// One row of the screen registry. The table is const so it lives in flash.
+typedef struct {
+    Screen parent;              // where KEY_LEFT goes
+    ScreenHook enter;           // run once by set_screen, after the menu (if any) is drawn
+    ScreenHook update;          // run from the UI loop while the screen is active
+    uint16_t update_period_ms;
+    const Menu* menu;           // NULL for non-menu screens
+    ScreenKeyHook key;          // optional, ahead of KEY_LEFT / menu handling
+} ScreenDef;
+
 void update_screenf(const char* fmt, ...);
 void update_screenf_font(const uint8_t* font, const char* fmt, ...);
+// Render paths: build the text in place with fmt_* between these two, no printf
+fmt_t* screen_text_begin(void);
+void screen_text_show(const uint8_t* font);
+// A fixed string, laid out as is
+void update_screen_text(const uint8_t* font, const char* text);
 
 void app_main(void);
+// Also called by the host replay build (test/replay), which has no app_main loop
+void ui_display_init(void);
+void ui_run_replay(void);
+void ui_resume_or_start(void);
 
 #endif /* MAIN */
 
@@ -0,0 +1,173 @@
+#include "mirror.h"
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <lwip/sockets.h>
+
+#include "mirror_codec.h"
+
+#define MIRROR_TAG "MIRROR"
+#define MIRROR_TASK_STACK 4096
+#define MIRROR_POLL_MS 50
+
+static TaskHandle_t s_task = NULL;
+static SemaphoreHandle_t s_frame_lock = NULL;
+static int s_listen = -1;
+static int s_clients[MIRROR_MAX_CLIENTS] = { -1, -1, -1 };
+static volatile int s_client_count = 0;
+
+static uint8_t s_latest[MIRROR_FB_SIZE];     // written by the UI task under s_frame_lock
+static bool s_latest_new = false;
+static uint8_t s_sent[MIRROR_FB_SIZE];       // what every client has now (mirror task only)
+static uint8_t s_msg[MIRROR_MSG_MAX];
+static uint16_t s_frame_no = 0;
+
+static bool send_all(int sock, const uint8_t* buf, size_t len)
+{
+    while (len > 0) {
+        int n = send(sock, buf, len, 0);
+        if (n <= 0) return false;
+        buf += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+static void drop_client(int i)
+{
+    ESP_LOGI(MIRROR_TAG, "client %d gone", s_clients[i]);
+    close(s_clients[i]);
+    s_clients[i] = -1;
+    s_client_count--;
+}
+
+static void accept_clients(void)
+{
+    for (;;) {
+        int sock = accept(s_listen, NULL, NULL);
+        if (sock < 0) return; // EAGAIN: nobody waiting
+
+        int slot = -1;
+        for (int i = 0; i < MIRROR_MAX_CLIENTS; i++) {
+            if (s_clients[i] < 0) { slot = i; break; }
+        }
+        if (slot < 0) {
+            close(sock);
+            continue;
+        }
+
+        // Bound how long a slow client can stall the others
+        struct timeval tv = { .tv_sec = 1, .tv_usec = 0 };
+        setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        int one = 1;
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        // New clients start from a keyframe of what everyone else already has
+        size_t len = mirror_encode_frame(s_sent, NULL, s_frame_no, s_msg, sizeof(s_msg));
+        if (len == 0 || !send_all(sock, s_msg, len)) {
+            close(sock);
+            continue;
+        }
+        s_clients[slot] = sock;
+        s_client_count++;
+        ESP_LOGI(MIRROR_TAG, "client %d connected", sock);
+    }
+}
+
+static void broadcast_diff(void)
+{
+    static uint8_t cur[MIRROR_FB_SIZE];
+
+    xSemaphoreTake(s_frame_lock, portMAX_DELAY);
+    bool fresh = s_latest_new;
+    if (fresh) {
+        memcpy(cur, s_latest, sizeof(cur));
+        s_latest_new = false;
+    }
+    xSemaphoreGive(s_frame_lock);
+    if (!fresh) return;
+
+    if (s_client_count == 0) {
+        // Keep s_sent current so the next client's keyframe is this frame
+        memcpy(s_sent, cur, sizeof(s_sent));
+        return;
+    }
+
+    size_t len = mirror_encode_frame(cur, s_sent, (uint16_t)(s_frame_no + 1), s_msg, sizeof(s_msg));
+    if (len == 0) return; // identical frame
+
+    s_frame_no++;
+    memcpy(s_sent, cur, sizeof(s_sent));
+    for (int i = 0; i < MIRROR_MAX_CLIENTS; i++) {
+        if (s_clients[i] >= 0 && !send_all(s_clients[i], s_msg, len)) {
+            drop_client(i);
+        }
+    }
+}
+
+static void mirror_task(void* arg)
+{
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(MIRROR_POLL_MS));
+        broadcast_diff();
+        accept_clients();
+    }
+}
+
+esp_err_t mirror_start(void)
+{
+    if (s_task) return ESP_OK;
+
+    s_frame_lock = xSemaphoreCreateMutex();
+    if (!s_frame_lock) return ESP_ERR_NO_MEM;
+
+    s_listen = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+    if (s_listen < 0) {
+        ESP_LOGE(MIRROR_TAG, "socket failed: errno %d", errno);
+        return ESP_FAIL;
+    }
+
+    int one = 1;
+    setsockopt(s_listen, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(MIRROR_PORT),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (bind(s_listen, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(s_listen, 1) != 0) {
+        ESP_LOGE(MIRROR_TAG, "bind/listen failed: errno %d", errno);
+        close(s_listen);
+        s_listen = -1;
+        return ESP_FAIL;
+    }
+    fcntl(s_listen, F_SETFL, fcntl(s_listen, F_GETFL, 0) | O_NONBLOCK);
+
+    if (xTaskCreate(mirror_task, "mirror", MIRROR_TASK_STACK, NULL, 3, &s_task) != pdPASS) {
+        close(s_listen);
+        s_listen = -1;
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(MIRROR_TAG, "listening on port %d", MIRROR_PORT);
+    return ESP_OK;
+}
+
+void mirror_submit_frame(const uint8_t* fb)
+{
+    if (!s_task || !fb) return;
+
+    // The mirror task only holds the lock for a 1 KB copy
+    xSemaphoreTake(s_frame_lock, portMAX_DELAY);
+    memcpy(s_latest, fb, sizeof(s_latest));
+    s_latest_new = true;
+    xSemaphoreGive(s_frame_lock);
+    if (s_client_count > 0) {
+        xTaskNotifyGive(s_task);
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef MIRROR
+#define MIRROR
+
+#include <stdint.h>
+#include <esp_err.h>
+
+// Remote display mirror: a TCP server streaming framebuffer diffs (see
+// mirror_codec.h for the wire format, mirror_viewer.py for a client).
+
+#define MIRROR_ENABLED      1
+#define MIRROR_PORT         3333
+#define MIRROR_MAX_CLIENTS  3
+
+// Start the server task. Needs a network interface, so call once Wi-Fi is up.
+esp_err_t mirror_start(void);
+
+// Hand over the frame that was just flushed (a 1 KB copy). The diff is computed
+// on the mirror task, once per frame however many clients are connected.
+void mirror_submit_frame(const uint8_t* fb);
+
+#endif /* MIRROR */
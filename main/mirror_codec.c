@@ -0,0 +1,74 @@
+#include "mirror_codec.h"
+#include <string.h>
+
+#define RLE_MIN_RUN 3
+#define RLE_MAX_RUN 130
+#define RLE_MAX_LIT 128
+
+size_t mirror_rle_encode(const uint8_t* in, size_t n, uint8_t* out, size_t out_sz)
+{
+    size_t o = 0;
+    size_t i = 0;
+    size_t lit_start = 0;
+
+    while (i <= n) {
+        size_t run = 1;
+        if (i < n) {
+            while (i + run < n && in[i + run] == in[i] && run < RLE_MAX_RUN) run++;
+        }
+
+        // Flush pending literals before a run, at the end, or when the chunk is full
+        size_t lit_len = i - lit_start;
+        if (lit_len > 0 && (i == n || run >= RLE_MIN_RUN || lit_len == RLE_MAX_LIT)) {
+            if (o + 1 + lit_len > out_sz) return 0;
+            out[o++] = (uint8_t)(lit_len - 1);
+            memcpy(&out[o], &in[lit_start], lit_len);
+            o += lit_len;
+            lit_start = i;
+        }
+        if (i == n) break;
+
+        if (run >= RLE_MIN_RUN) {
+            if (o + 2 > out_sz) return 0;
+            out[o++] = (uint8_t)(run + 125);
+            out[o++] = in[i];
+            i += run;
+            lit_start = i;
+        } else {
+            i++;
+        }
+    }
+    return o;
+}
+
+size_t mirror_encode_frame(const uint8_t* cur, const uint8_t* prev, uint16_t frame_no,
+                           uint8_t* out, size_t out_sz)
+{
+    if (!cur || !out || out_sz < MIRROR_MSG_MAX) return 0;
+
+    uint8_t* mask = &out[5];
+    memset(mask, 0, MIRROR_MASK_SIZE);
+
+    // Gather the changed tiles, then compress them in one pass
+    uint8_t tiles[MIRROR_FB_SIZE];
+    size_t tn = 0;
+    for (int t = 0; t < MIRROR_TILE_COUNT; t++) {
+        const size_t off = (size_t)(t / MIRROR_TILES_X) * MIRROR_FB_WIDTH + (size_t)(t % MIRROR_TILES_X) * 8;
+        if (prev && memcmp(&cur[off], &prev[off], 8) == 0) continue;
+        mask[t / 8] |= (uint8_t)(1 << (t % 8));
+        memcpy(&tiles[tn], &cur[off], 8);
+        tn += 8;
+    }
+    if (tn == 0) return 0;
+
+    size_t rle = mirror_rle_encode(tiles, tn, &out[MIRROR_HDR_SIZE], out_sz - MIRROR_HDR_SIZE);
+    if (rle == 0) return 0;
+
+    size_t payload = 2 + MIRROR_MASK_SIZE + rle;
+    out[0] = prev ? MIRROR_MSG_DIFF : MIRROR_MSG_KEY;
+    out[1] = payload & 0xFF;
+    out[2] = payload >> 8;
+    out[3] = frame_no & 0xFF;
+    out[4] = frame_no >> 8;
+    return MIRROR_HDR_SIZE + rle;
+}
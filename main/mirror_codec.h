@@ -0,0 +1,35 @@
+#ifndef MIRROR_CODEC
+#define MIRROR_CODEC
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Framebuffer diff encoding for the remote display mirror. The SSD1309 buffer is
+// 8 pages of 128 column bytes; a tile is 8 columns of one page (8 bytes, 8x8 px).
+//
+// Message: [u8 type][u16 payload_len][u16 frame_no][16 B tile mask][RLE data]
+//   type 'K' = keyframe (every tile present), 'D' = diff (only masked tiles)
+//   tile mask bit t (byte t / 8, LSB first) covers tile t = page * 16 + column / 8
+//   RLE data is the changed tiles' bytes concatenated in tile order, encoded as
+//   control c < 128: c + 1 literal bytes follow; c >= 128: next byte repeats c - 125 times
+// Multi-byte fields are little endian; payload_len counts everything after itself.
+
+#define MIRROR_FB_SIZE      1024
+#define MIRROR_FB_WIDTH     128
+#define MIRROR_TILES_X      16
+#define MIRROR_TILE_COUNT   128
+#define MIRROR_MASK_SIZE    (MIRROR_TILE_COUNT / 8)
+#define MIRROR_HDR_SIZE     (5 + MIRROR_MASK_SIZE)
+#define MIRROR_MSG_MAX      (MIRROR_HDR_SIZE + MIRROR_FB_SIZE + MIRROR_FB_SIZE / 128 + 8)
+
+#define MIRROR_MSG_KEY      'K'
+#define MIRROR_MSG_DIFF     'D'
+
+// Encode `cur` against `prev` (NULL for a keyframe). Returns the message length,
+// 0 if nothing changed or `out_sz` is too small.
+size_t mirror_encode_frame(const uint8_t* cur, const uint8_t* prev, uint16_t frame_no,
+                           uint8_t* out, size_t out_sz);
+
+size_t mirror_rle_encode(const uint8_t* in, size_t n, uint8_t* out, size_t out_sz);
+
+#endif /* MIRROR_CODEC */
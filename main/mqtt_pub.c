@@ -0,0 +1,488 @@
+#include "mqtt_pub.h"
+#include <stdio.h>
+#include <string.h>
+
+#include <esp_log.h>
+#include <esp_mac.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include <mqtt_client.h>
+
+#include "climate.h"
+#include "dht20.h"
+#include "history.h"
+#include "sample_store.h"
+#include "settings.h"
+
+#define MQTT_TAG "MQTT_PUB"
+
+#define BATCH_BUF_SIZE  (HISTORY_PACKET_HDR + MQTT_BATCH_MAX_SAMPLES * (HISTORY_RECORD_SIZE + MQTT_CLIMATE_RECORD_SIZE))
+#define EVT_QUEUE_LEN   16
+#define STATS_LOG_EVERY 16  // acked batches
+
+#if MQTT_BATCH_MAX_SAMPLES > 255
+#error "MQTT_BATCH_MAX_SAMPLES must fit the u8 record count"
+#endif
+#if MQTT_BATCH_SAMPLES < 1 || MQTT_BATCH_SAMPLES > MQTT_BATCH_MAX_SAMPLES
+#error "MQTT_BATCH_SAMPLES must be 1..MQTT_BATCH_MAX_SAMPLES"
+#endif
+
+// Everything the MQTT event handler learns is forwarded to the publisher task, so the
+// outbox has a single owner and the handler never waits on a lock the client may
+// hold while publishing.
+typedef enum {
+    EVT_SAMPLE,
+    EVT_CONNECTED,
+    EVT_DISCONNECTED,
+    EVT_ACKED,
+    EVT_DELETED,
+} pub_evt_kind_t;
+
+typedef struct {
+    pub_evt_kind_t kind;
+    int msg_id;
+    history_sample_t sample;
+} pub_evt_t;
+
+typedef enum {
+    SLOT_PENDING,   // sealed, not yet handed to the client
+    SLOT_INFLIGHT,  // published, waiting for PUBACK
+    SLOT_DONE,      // acked, freed once it reaches the tail
+} slot_state_t;
+
+typedef struct {
+    uint8_t data[BATCH_BUF_SIZE];
+    uint16_t len;
+    slot_state_t state;
+    int msg_id;
+    TickType_t sent_at;
+    uint32_t log_seq;   // sample log page it came from, 0 for live samples
+} outbox_slot_t;
+
+static esp_mqtt_client_handle_t s_client = NULL;
+static QueueHandle_t s_events = NULL;
+static TaskHandle_t s_task = NULL;
+static char s_topic[48];
+
+// Publisher task only
+static history_sample_t s_batch[MQTT_BATCH_MAX_SAMPLES];
+static size_t s_batch_n = 0;
+static TickType_t s_batch_started = 0;
+static uint16_t s_batch_no = 0;
+
+static outbox_slot_t s_outbox[MQTT_OUTBOX_SLOTS];
+static unsigned s_tail = 0;     // oldest occupied slot
+static unsigned s_count = 0;    // occupied slots from s_tail
+static bool s_connected = false;
+
+// Backlog from the flash sample log, one page at a time. The page is consumed once
+// every batch cut from it has been acked.
+static history_sample_t s_drain[SAMPLE_LOG_MAX_PER_PAGE];
+static size_t s_drain_n = 0;
+static size_t s_drain_pos = 0;
+static uint32_t s_drain_seq = 0;
+static unsigned s_drain_left = 0;   // batches of this page not acked yet
+static bool s_drain_lost = false;   // one was dropped, so keep the page for another pass
+
+static mqtt_pub_stats_t s_stats = {0};
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+#define STATS_UPDATE(stmt) do { \
+    taskENTER_CRITICAL(&s_stats_lock); stmt; taskEXIT_CRITICAL(&s_stats_lock); \
+} while (0)
+
+static outbox_slot_t* slot_at(unsigned i)
+{
+    return &s_outbox[(s_tail + i) % MQTT_OUTBOX_SLOTS];
+}
+
+static void outbox_trim(void)
+{
+    while (s_count && slot_at(0)->state == SLOT_DONE) {
+        s_tail = (s_tail + 1) % MQTT_OUTBOX_SLOTS;
+        s_count--;
+    }
+}
+
+static void drain_batch_done(const outbox_slot_t* slot, bool acked)
+{
+    if (slot->log_seq == 0 || slot->log_seq != s_drain_seq || s_drain_left == 0) return;
+    if (!acked) s_drain_lost = true;
+    if (--s_drain_left == 0 && s_drain_pos == s_drain_n) {
+        if (!s_drain_lost) sample_store_consume(s_drain_seq);
+        s_drain_n = s_drain_pos = 0;
+        s_drain_lost = false;
+    }
+}
+
+static void put_u16(uint8_t* p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+// Derived metrics for the n encoded samples, after the records. Samples drained from
+// the flash log carry none, so everything is computed here; repeated readings reuse
+// the previous result.
+static size_t append_climate(const history_sample_t* s, size_t n, uint8_t* out)
+{
+    climate_t c = {0};
+    for (size_t i = 0; i < n; i++) {
+        if (i == 0 || s[i].temp_centi_c != s[i - 1].temp_centi_c || s[i].hum_centi_pct != s[i - 1].hum_centi_pct) {
+            climate_compute(s[i].temp_centi_c, s[i].hum_centi_pct, &c);
+        }
+        uint8_t* p = out + i * MQTT_CLIMATE_RECORD_SIZE;
+        put_u16(p, (uint16_t)c.dew_point_centi_c);
+        put_u16(p + 2, (uint16_t)c.heat_index_centi_c);
+        put_u16(p + 4, c.abs_hum_centi_g_m3);
+    }
+    return n * MQTT_CLIMATE_RECORD_SIZE;
+}
+
+// Encode up to MQTT_BATCH_MAX_SAMPLES into a new outbox slot; returns how many went in
+static size_t outbox_push(const history_sample_t* samples, size_t n, uint32_t log_seq)
+{
+    if (s_count == MQTT_OUTBOX_SLOTS) {
+        // Offline for too long: keep the newest data
+        outbox_slot_t* oldest = slot_at(0);
+        if (oldest->state != SLOT_DONE) {
+            drain_batch_done(oldest, false);
+            STATS_UPDATE(s_stats.batches_dropped++);
+        }
+        s_tail = (s_tail + 1) % MQTT_OUTBOX_SLOTS;
+        s_count--;
+    }
+
+    if (n > MQTT_BATCH_MAX_SAMPLES) n = MQTT_BATCH_MAX_SAMPLES;
+    outbox_slot_t* slot = slot_at(s_count);
+    size_t encoded = 0;
+    const size_t climate_sz = n * MQTT_CLIMATE_RECORD_SIZE;
+    size_t len = history_encode(samples, n, s_batch_no++, slot->data, sizeof(slot->data) - climate_sz, &encoded);
+    len += append_climate(samples, encoded, slot->data + len);
+    slot->len = (uint16_t)len;
+    slot->state = SLOT_PENDING;
+    slot->msg_id = -1;
+    slot->log_seq = log_seq;
+    s_count++;
+    STATS_UPDATE(s_stats.batches_sealed++);
+    return encoded;
+}
+
+static void seal_batch(void)
+{
+    if (s_batch_n == 0) return;
+    size_t encoded = outbox_push(s_batch, s_batch_n, 0);
+
+    // The caller only batches samples sharing a base, so this should be everything
+    if (encoded < s_batch_n) {
+        memmove(s_batch, s_batch + encoded, (s_batch_n - encoded) * sizeof(s_batch[0]));
+        s_batch_n -= encoded;
+        s_batch_started = xTaskGetTickCount();
+    } else {
+        s_batch_n = 0;
+    }
+}
+
+// Cut the backlog into batches while there is room, always leaving a slot for live data
+static void drain_log(void)
+{
+    if (!s_connected || !sample_store_ready()) return;
+
+    if (s_drain_pos == s_drain_n && s_drain_left == 0) {
+        s_drain_n = s_drain_pos = 0;
+        if (sample_store_pending() == 0) return;
+        s_drain_n = sample_store_read_oldest(s_drain, &s_drain_seq);
+        if (s_drain_n == 0) return;
+    }
+
+    while (s_drain_pos < s_drain_n && s_count + 1 < MQTT_OUTBOX_SLOTS) {
+        s_drain_pos += outbox_push(&s_drain[s_drain_pos], s_drain_n - s_drain_pos, s_drain_seq);
+        s_drain_left++;
+        STATS_UPDATE(s_stats.backlog_batches++);
+    }
+}
+
+static void add_sample(const history_sample_t* s)
+{
+    if (s_batch_n > 0) {
+        // Wall clock jumps (SNTP sync) cannot be expressed as a u16 offset
+        uint32_t base = s_batch[0].time_s;
+        if (s->time_s < base || s->time_s - base > UINT16_MAX) seal_batch();
+    }
+    if (s_batch_n == 0) s_batch_started = xTaskGetTickCount();
+    s_batch[s_batch_n++] = *s;
+    if (s_batch_n >= (size_t)settings_get_int(SET_MQTT_BATCH)) seal_batch();
+}
+
+static unsigned inflight_count(void)
+{
+    unsigned n = 0;
+    for (unsigned i = 0; i < s_count; i++) {
+        if (slot_at(i)->state == SLOT_INFLIGHT) n++;
+    }
+    return n;
+}
+
+static void on_acked(int msg_id)
+{
+    for (unsigned i = 0; i < s_count; i++) {
+        outbox_slot_t* slot = slot_at(i);
+        if (slot->state != SLOT_INFLIGHT || slot->msg_id != msg_id) continue;
+
+        uint32_t ms = pdTICKS_TO_MS(xTaskGetTickCount() - slot->sent_at);
+        slot->state = SLOT_DONE;
+        drain_batch_done(slot, true);
+        STATS_UPDATE({
+            s_stats.batches_acked++;
+            if (s_stats.ack_ms_avg == 0) s_stats.ack_ms_avg = ms;
+            else s_stats.ack_ms_avg = (s_stats.ack_ms_avg * 7 + ms) / 8;
+        });
+        break;
+    }
+    outbox_trim();
+}
+
+// Back to pending so it goes out again: the client gave up on it, or no ack came
+static void requeue(outbox_slot_t* slot)
+{
+    slot->state = SLOT_PENDING;
+    slot->msg_id = -1;
+    STATS_UPDATE(s_stats.republished++);
+}
+
+static void check_ack_timeouts(void)
+{
+    if (!s_connected) return; // the client resends its own outbox on reconnect
+    TickType_t now = xTaskGetTickCount();
+    for (unsigned i = 0; i < s_count; i++) {
+        outbox_slot_t* slot = slot_at(i);
+        if (slot->state == SLOT_INFLIGHT && (now - slot->sent_at) >= pdMS_TO_TICKS(MQTT_ACK_TIMEOUT_MS)) {
+            ESP_LOGW(MQTT_TAG, "No ack for msg %d, republishing", slot->msg_id);
+            requeue(slot);
+        }
+    }
+}
+
+static void pump(void)
+{
+    if (!s_connected || !s_client) return;
+
+    unsigned inflight = inflight_count();
+    for (unsigned i = 0; i < s_count && inflight < MQTT_MAX_INFLIGHT; i++) {
+        outbox_slot_t* slot = slot_at(i);
+        if (slot->state != SLOT_PENDING) continue;
+
+        int msg_id = esp_mqtt_client_publish(s_client, s_topic, (const char*)slot->data, slot->len, MQTT_QOS, 0);
+        if (msg_id < 0) {
+            ESP_LOGW(MQTT_TAG, "Publish failed (%d), will retry", msg_id);
+            break;
+        }
+
+        STATS_UPDATE({
+            s_stats.batches_published++;
+            s_stats.bytes_published += slot->len;
+        });
+        if (MQTT_QOS == 0) {
+            slot->state = SLOT_DONE; // nothing will come back for it
+            drain_batch_done(slot, true);
+            continue;
+        }
+        slot->state = SLOT_INFLIGHT;
+        slot->msg_id = msg_id;
+        slot->sent_at = xTaskGetTickCount();
+        inflight++;
+    }
+    outbox_trim();
+}
+
+static void log_stats(void)
+{
+    mqtt_pub_stats_t st;
+    mqtt_pub_get_stats(&st);
+    ESP_LOGI(MQTT_TAG, "batches sealed=%lu pub=%lu ack=%lu drop=%lu repub=%lu, bytes=%lu, ack avg=%lums, inflight=%u",
+             (unsigned long)st.batches_sealed, (unsigned long)st.batches_published,
+             (unsigned long)st.batches_acked, (unsigned long)st.batches_dropped,
+             (unsigned long)st.republished, (unsigned long)st.bytes_published,
+             (unsigned long)st.ack_ms_avg, st.inflight);
+    ESP_LOGI(MQTT_TAG, "offline: stored=%lu samples, backlog batches=%lu, pages left=%lu",
+             (unsigned long)st.samples_stored, (unsigned long)st.backlog_batches,
+             (unsigned long)st.backlog_pages);
+}
+
+static TickType_t batch_max_age(void)
+{
+    return pdMS_TO_TICKS(settings_get_int(SET_MQTT_AGE_S) * 1000);
+}
+
+static TickType_t next_timeout(void)
+{
+    TickType_t wait = portMAX_DELAY;
+    if (s_batch_n > 0) {
+        TickType_t age = xTaskGetTickCount() - s_batch_started;
+        TickType_t max_age = batch_max_age();
+        wait = (age >= max_age) ? 0 : max_age - age;
+    }
+    if (s_connected && (inflight_count() > 0 || s_drain_pos < s_drain_n) && wait > pdMS_TO_TICKS(1000)) {
+        wait = pdMS_TO_TICKS(1000); // to notice ack timeouts and keep draining
+    }
+    return wait;
+}
+
+static void mqtt_pub_task(void* arg)
+{
+    for (;;) {
+        pub_evt_t evt;
+        if (xQueueReceive(s_events, &evt, next_timeout()) == pdTRUE) {
+            switch (evt.kind) {
+            case EVT_SAMPLE:
+                // Offline samples go to flash and come back through drain_log()
+                if (!s_connected && sample_store_append(&evt.sample) == ESP_OK) {
+                    STATS_UPDATE(s_stats.samples_stored++);
+                } else {
+                    add_sample(&evt.sample);
+                }
+                break;
+            case EVT_CONNECTED:
+                s_connected = true;
+                sample_store_flush(); // so the partial page goes out with the rest
+                // Restart the ack clock; the client is resending whatever was in flight
+                for (unsigned i = 0; i < s_count; i++) {
+                    if (slot_at(i)->state == SLOT_INFLIGHT) slot_at(i)->sent_at = xTaskGetTickCount();
+                }
+                break;
+            case EVT_DISCONNECTED:
+                s_connected = false;
+                break;
+            case EVT_ACKED: {
+                uint32_t before = s_stats.batches_acked;
+                on_acked(evt.msg_id);
+                if (s_stats.batches_acked != before && s_stats.batches_acked % STATS_LOG_EVERY == 0) {
+                    log_stats();
+                }
+                break;
+            }
+            case EVT_DELETED:
+                for (unsigned i = 0; i < s_count; i++) {
+                    outbox_slot_t* slot = slot_at(i);
+                    if (slot->state == SLOT_INFLIGHT && slot->msg_id == evt.msg_id) requeue(slot);
+                }
+                break;
+            }
+        }
+
+        if (s_batch_n > 0 && (xTaskGetTickCount() - s_batch_started) >= batch_max_age()) {
+            seal_batch();
+        }
+        check_ack_timeouts();
+        drain_log();
+        pump();
+
+        const uint32_t backlog = sample_store_pending();
+        STATS_UPDATE({
+            s_stats.inflight = inflight_count();
+            s_stats.queued = s_count;
+            s_stats.backlog_pages = backlog;
+        });
+    }
+}
+
+static void post_event(pub_evt_kind_t kind, int msg_id)
+{
+    pub_evt_t evt = { .kind = kind, .msg_id = msg_id };
+    // A lost ack only costs a republish after MQTT_ACK_TIMEOUT_MS
+    xQueueSend(s_events, &evt, pdMS_TO_TICKS(10));
+}
+
+static void mqtt_event_handler(void* arg, esp_event_base_t base, int32_t event_id, void* event_data)
+{
+    esp_mqtt_event_handle_t event = event_data;
+    switch ((esp_mqtt_event_id_t)event_id) {
+    case MQTT_EVENT_CONNECTED:
+        ESP_LOGI(MQTT_TAG, "Connected to %s", MQTT_BROKER_URI);
+        post_event(EVT_CONNECTED, 0);
+        break;
+    case MQTT_EVENT_DISCONNECTED:
+        ESP_LOGW(MQTT_TAG, "Disconnected");
+        post_event(EVT_DISCONNECTED, 0);
+        break;
+    case MQTT_EVENT_PUBLISHED:
+        post_event(EVT_ACKED, event->msg_id);
+        break;
+    case MQTT_EVENT_DELETED:
+        post_event(EVT_DELETED, event->msg_id);
+        break;
+    case MQTT_EVENT_ERROR:
+        ESP_LOGW(MQTT_TAG, "Client error");
+        break;
+    default:
+        break;
+    }
+}
+
+static void on_sample(const dht20_sample_t* sample)
+{
+    pub_evt_t evt = {
+        .kind = EVT_SAMPLE,
+        .sample = {
+            .time_s = sample->time_s,
+            .temp_centi_c = sample->temp_centi_c,
+            .hum_centi_pct = sample->hum_centi_pct,
+        },
+    };
+    // Never hold up the sampler
+    if (xQueueSend(s_events, &evt, 0) != pdTRUE) {
+        STATS_UPDATE(s_stats.samples_dropped++);
+    }
+}
+
+esp_err_t mqtt_pub_init(void)
+{
+    if (s_task) return ESP_OK;
+
+    sample_store_init(); // without it offline samples stay in the RAM outbox
+
+    uint8_t mac[6];
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    snprintf(s_topic, sizeof(s_topic), "esp32-humidity/%02x%02x%02x%02x%02x%02x/samples",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+
+    s_events = xQueueCreate(EVT_QUEUE_LEN, sizeof(pub_evt_t));
+    if (!s_events) return ESP_ERR_NO_MEM;
+    if (xTaskCreate(mqtt_pub_task, "mqtt_pub", 3584, NULL, 3, &s_task) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return dht20_add_listener(on_sample);
+}
+
+esp_err_t mqtt_pub_start(void)
+{
+    if (s_client) return ESP_OK;
+    if (!s_task) return ESP_ERR_INVALID_STATE;
+
+    const esp_mqtt_client_config_t cfg = {
+        .broker.address.uri = MQTT_BROKER_URI,
+        .session.keepalive = 60,
+        .network.reconnect_timeout_ms = 5000,
+    };
+    s_client = esp_mqtt_client_init(&cfg);
+    if (!s_client) return ESP_FAIL;
+
+    esp_mqtt_client_register_event(s_client, ESP_EVENT_ANY_ID, mqtt_event_handler, NULL);
+    esp_err_t err = esp_mqtt_client_start(s_client);
+    if (err != ESP_OK) {
+        ESP_LOGE(MQTT_TAG, "Failed to start client: %s", esp_err_to_name(err));
+        esp_mqtt_client_destroy(s_client);
+        s_client = NULL;
+        return err;
+    }
+    ESP_LOGI(MQTT_TAG, "Publishing to %s", s_topic);
+    return ESP_OK;
+}
+
+void mqtt_pub_get_stats(mqtt_pub_stats_t* out)
+{
+    taskENTER_CRITICAL(&s_stats_lock);
+    *out = s_stats;
+    taskEXIT_CRITICAL(&s_stats_lock);
+}
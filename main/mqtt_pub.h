@@ -0,0 +1,75 @@
+#ifndef MQTT_PUB
+#define MQTT_PUB
+
+#include <stdint.h>
+#include <esp_err.h>
+
+#include "wifi_config.h"
+
+// Batched MQTT publisher for DHT20 samples. Samples are collected from the sampler
+// task and sent as one binary message per batch, sealed when it holds the
+// "mqtt_batch" setting's count of samples or its first sample is "mqtt_age_s" old
+// (settings.h; both apply from the next sample). Backlog batches are always cut at
+// MQTT_BATCH_MAX_SAMPLES, the batch buffer size.
+//
+// mqtt_measure.py at the repo root subscribes to the topic and reports batches/s
+// and bytes per sample, for picking the two settings.
+//
+// While the broker is unreachable samples go to the flash sample log (sample_store.h)
+// instead, and are sent back in bulk after reconnecting.
+//
+// Topic:   esp32-humidity/<sta mac>/samples
+// Payload: history packet layout (see history.h), packet_no is the batch number:
+//   [u16 batch_no][u32 base_time][u8 count] then count x [u16 dt_s][i16 temp][u16 hum]
+// followed by the derived metrics (climate.h) of the same samples, in the same order:
+//   count x [i16 dew_point_centi_c][i16 heat_index_centi_c][u16 abs_hum_centi_g_m3]
+
+#define MQTT_PUB_ENABLED        1
+
+// Any of these can be set in wifi_config.h
+#ifndef MQTT_BROKER_URI
+#define MQTT_BROKER_URI         "mqtt://192.168.1.100:1883"
+#endif
+#ifndef MQTT_BATCH_MAX_SAMPLES
+#define MQTT_BATCH_MAX_SAMPLES  60  // buffer size, upper bound of "mqtt_batch"
+#endif
+#ifndef MQTT_BATCH_SAMPLES
+#define MQTT_BATCH_SAMPLES      30  // "mqtt_batch" default
+#endif
+#ifndef MQTT_BATCH_MAX_AGE_S
+#define MQTT_BATCH_MAX_AGE_S    60  // "mqtt_age_s" default
+#endif
+#ifndef MQTT_QOS
+#define MQTT_QOS                1
+#endif
+#ifndef MQTT_MAX_INFLIGHT
+#define MQTT_MAX_INFLIGHT       4   // unacked QoS1 batches on the wire
+#endif
+
+#define MQTT_OUTBOX_SLOTS       8   // sealed batches kept while offline, oldest dropped first
+#define MQTT_ACK_TIMEOUT_MS     30000
+#define MQTT_CLIMATE_RECORD_SIZE 6  // per sample, after the history records
+
+typedef struct {
+    uint32_t batches_sealed;
+    uint32_t batches_published;
+    uint32_t batches_acked;
+    uint32_t batches_dropped;   // outbox overflow
+    uint32_t republished;       // after ack timeout or a deleted outbox entry
+    uint32_t samples_dropped;   // queue to the publisher task was full
+    uint32_t bytes_published;
+    uint32_t ack_ms_avg;        // publish to PUBACK, EWMA
+    uint32_t samples_stored;    // went to the flash log while offline
+    uint32_t backlog_batches;   // cut from the flash log after reconnecting
+    uint32_t backlog_pages;     // still on flash
+    uint8_t inflight;
+    uint8_t queued;             // sealed, not yet acked
+} mqtt_pub_stats_t;
+
+// Registers the sample listener; call before dht20_start_sampler().
+esp_err_t mqtt_pub_init(void);
+// Connect to the broker. Call once Wi-Fi is up; esp-mqtt reconnects on its own after.
+esp_err_t mqtt_pub_start(void);
+void mqtt_pub_get_stats(mqtt_pub_stats_t* out);
+
+#endif /* MQTT_PUB */
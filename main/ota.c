@@ -0,0 +1,270 @@
+#include "ota.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <esp_http_client.h>
+#include <esp_log.h>
+#include <esp_ota_ops.h>
+#include <esp_system.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <mbedtls/sha256.h>
+
+#include "inflate_stream.h"
+
+#define OTA_TAG "OTA"
+
+typedef struct {
+    esp_ota_handle_t handle;
+    mbedtls_sha256_context sha;
+    uint32_t written;
+    size_t max_size;
+    esp_err_t err;
+} ota_sink_t;
+
+static ota_status_t s_status = { .state = OTA_IDLE, .rx_total = -1 };
+static portMUX_TYPE s_status_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t s_task = NULL;
+
+static void set_progress(uint32_t rx, uint32_t image)
+{
+    taskENTER_CRITICAL(&s_status_lock);
+    s_status.rx_bytes = rx;
+    s_status.image_bytes = image;
+    taskEXIT_CRITICAL(&s_status_lock);
+}
+
+static void set_state(ota_state_t state, const char* err)
+{
+    taskENTER_CRITICAL(&s_status_lock);
+    s_status.state = state;
+    strlcpy(s_status.err, err ? err : "", sizeof(s_status.err));
+    taskEXIT_CRITICAL(&s_status_lock);
+}
+
+static int hex_nibble(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// sha256sum format: 64 hex chars, then optionally the file name
+static esp_err_t fetch_expected_hash(uint8_t hash[32])
+{
+    char text[80] = {0};
+    esp_http_client_config_t config = {
+        .url = OTA_IMAGE_URL ".sha256",
+        .method = HTTP_METHOD_GET,
+        .timeout_ms = 10000,
+    };
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (!client) return ESP_FAIL;
+
+    esp_err_t err = esp_http_client_open(client, 0);
+    if (err == ESP_OK && esp_http_client_fetch_headers(client) >= 0 &&
+        esp_http_client_get_status_code(client) == 200) {
+        int total = 0;
+        int r;
+        while (total < (int)sizeof(text) - 1 &&
+               (r = esp_http_client_read(client, text + total, sizeof(text) - 1 - total)) > 0) {
+            total += r;
+        }
+    } else if (err == ESP_OK) {
+        err = ESP_ERR_NOT_FOUND;
+    }
+    esp_http_client_close(client);
+    esp_http_client_cleanup(client);
+    if (err != ESP_OK) return err;
+
+    for (int i = 0; i < 32; i++) {
+        int hi = hex_nibble(text[2 * i]);
+        int lo = hex_nibble(text[2 * i + 1]);
+        if (hi < 0 || lo < 0) return ESP_ERR_INVALID_RESPONSE;
+        hash[i] = (uint8_t)(hi << 4 | lo);
+    }
+    return ESP_OK;
+}
+
+static bool flash_sink(void* ctx, const uint8_t* data, size_t len)
+{
+    ota_sink_t* sink = ctx;
+    if (sink->written + len > sink->max_size) {
+        sink->err = ESP_ERR_INVALID_SIZE;
+        return false;
+    }
+    sink->err = esp_ota_write(sink->handle, data, len);
+    if (sink->err != ESP_OK) return false;
+    mbedtls_sha256_update(&sink->sha, data, len);
+    sink->written += len;
+    return true;
+}
+
+static esp_err_t ota_download(const esp_partition_t* target, const char** what)
+{
+    uint8_t expected[32];
+    esp_err_t err = fetch_expected_hash(expected);
+    if (err != ESP_OK) {
+        *what = "No image hash";
+        return err;
+    }
+
+    esp_http_client_config_t config = {
+        .url = OTA_IMAGE_URL,
+        .method = HTTP_METHOD_GET,
+        .timeout_ms = 10000,
+        .buffer_size = OTA_CHUNK,
+    };
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (!client) return ESP_FAIL;
+
+    uint8_t* chunk = malloc(OTA_CHUNK);
+    inflate_stream_t* inflater = inflate_stream_create(INFLATE_ZLIB);
+    ota_sink_t sink = { .max_size = target->size };
+    bool ota_open = false;
+
+    if (!chunk || !inflater) {
+        err = ESP_ERR_NO_MEM;
+        *what = "Out of memory";
+        goto done;
+    }
+
+    err = esp_http_client_open(client, 0);
+    int64_t clen = (err == ESP_OK) ? esp_http_client_fetch_headers(client) : -1;
+    if (err != ESP_OK || clen < 0 || esp_http_client_get_status_code(client) != 200) {
+        err = (err != ESP_OK) ? err : ESP_ERR_NOT_FOUND;
+        *what = "Download failed";
+        goto done;
+    }
+    taskENTER_CRITICAL(&s_status_lock);
+    s_status.rx_total = (clen > 0) ? (int32_t)clen : -1;
+    taskEXIT_CRITICAL(&s_status_lock);
+
+    err = esp_ota_begin(target, OTA_WITH_SEQUENTIAL_WRITES, &sink.handle);
+    if (err != ESP_OK) {
+        *what = "OTA begin failed";
+        goto done;
+    }
+    ota_open = true;
+    mbedtls_sha256_init(&sink.sha);
+    mbedtls_sha256_starts(&sink.sha, 0);
+
+    uint32_t rx = 0;
+    while (!inflate_stream_done(inflater)) {
+        int r = esp_http_client_read(client, (char*)chunk, OTA_CHUNK);
+        if (r < 0) {
+            err = ESP_FAIL;
+            *what = "Connection lost";
+            break;
+        }
+        rx += r;
+        bool last = (r == 0) || esp_http_client_is_complete_data_received(client);
+        err = inflate_stream_feed(inflater, chunk, r, last, flash_sink, &sink);
+        set_progress(rx, sink.written);
+        if (err != ESP_OK) {
+            if (sink.err != ESP_OK) {
+                err = sink.err;
+                *what = "Flash write failed";
+            } else {
+                *what = (err == ESP_ERR_INVALID_SIZE) ? "Image truncated" : "Bad image data";
+            }
+            break;
+        }
+        if (last) break;
+    }
+    if (err == ESP_OK && !inflate_stream_done(inflater)) {
+        err = ESP_ERR_INVALID_SIZE;
+        *what = "Image truncated";
+    }
+
+    uint8_t actual[32];
+    mbedtls_sha256_finish(&sink.sha, actual);
+    mbedtls_sha256_free(&sink.sha);
+    if (err == ESP_OK && memcmp(actual, expected, sizeof(actual)) != 0) {
+        err = ESP_ERR_INVALID_CRC;
+        *what = "Hash mismatch";
+    }
+
+    if (err == ESP_OK) {
+        ota_open = false;
+        err = esp_ota_end(sink.handle);  // also checks the image header and segments
+        if (err != ESP_OK) *what = "Image invalid";
+    }
+    if (err == ESP_OK) {
+        err = esp_ota_set_boot_partition(target);
+        if (err != ESP_OK) *what = "Set boot failed";
+    }
+    if (err == ESP_OK) {
+        ESP_LOGI(OTA_TAG, "%lu bytes over the air, %lu byte image (%lu%%)",
+                 (unsigned long)rx, (unsigned long)sink.written,
+                 (unsigned long)(sink.written ? (uint64_t)rx * 100 / sink.written : 0));
+    }
+
+done:
+    if (ota_open) esp_ota_abort(sink.handle);
+    inflate_stream_free(inflater);
+    free(chunk);
+    esp_http_client_close(client);
+    esp_http_client_cleanup(client);
+    return err;
+}
+
+static void ota_task(void* arg)
+{
+    const esp_partition_t* target = esp_ota_get_next_update_partition(NULL);
+    const char* what = "No OTA slot";
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+
+    if (target) {
+        ESP_LOGI(OTA_TAG, "Updating %s from %s", target->label, OTA_IMAGE_URL);
+        err = ota_download(target, &what);
+    }
+
+    if (err == ESP_OK) {
+        set_state(OTA_DONE, NULL);
+        ESP_LOGI(OTA_TAG, "Update written, restarting");
+        vTaskDelay(pdMS_TO_TICKS(1000)); // let the screen show it
+        esp_restart();
+    }
+
+    ESP_LOGE(OTA_TAG, "%s: %s", what, esp_err_to_name(err));
+    set_state(OTA_FAILED, what);
+    s_task = NULL;
+    vTaskDelete(NULL);
+}
+
+esp_err_t ota_update_start(void)
+{
+    if (s_task) return ESP_ERR_INVALID_STATE;
+
+    taskENTER_CRITICAL(&s_status_lock);
+    s_status = (ota_status_t){ .state = OTA_RUNNING, .rx_total = -1 };
+    taskEXIT_CRITICAL(&s_status_lock);
+
+    // The inflater is on the heap, the stack only needs the HTTP client and mbedtls
+    if (xTaskCreate(ota_task, "ota", 6144, NULL, 5, &s_task) != pdPASS) {
+        s_task = NULL;
+        set_state(OTA_FAILED, "Out of memory");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void ota_get_status(ota_status_t* out)
+{
+    taskENTER_CRITICAL(&s_status_lock);
+    *out = s_status;
+    taskEXIT_CRITICAL(&s_status_lock);
+}
+
+void ota_confirm_boot(void)
+{
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    esp_ota_img_states_t state;
+    if (esp_ota_get_state_partition(running, &state) == ESP_OK && state == ESP_OTA_IMG_PENDING_VERIFY) {
+        ESP_LOGI(OTA_TAG, "New image on %s works, cancelling rollback", running->label);
+        esp_ota_mark_app_valid_cancel_rollback();
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef OTA
+#define OTA
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+#include "wifi_config.h"
+
+// Over-the-air update from a local HTTP server. The image is served zlib compressed
+// (see ota_pack.py) and inflated chunk by chunk straight into the inactive ota_N slot,
+// so no full image is ever held in RAM. The SHA-256 of the decompressed image must
+// match OTA_IMAGE_URL ".sha256" before the slot is made bootable.
+//
+// The new image boots pending verification; if it resets before ota_confirm_boot()
+// the bootloader goes back to the previous slot.
+
+#define OTA_ENABLED     1
+
+#ifndef OTA_IMAGE_URL
+#define OTA_IMAGE_URL   "http://192.168.1.100:8000/firmware.bin.zz"
+#endif
+
+#define OTA_CHUNK       1024    // compressed bytes per HTTP read
+
+typedef enum {
+    OTA_IDLE,
+    OTA_RUNNING,
+    OTA_DONE,       // about to restart into the new image
+    OTA_FAILED,
+} ota_state_t;
+
+typedef struct {
+    ota_state_t state;
+    uint32_t rx_bytes;      // compressed, over the air
+    int32_t rx_total;       // Content-Length, -1 if unknown
+    uint32_t image_bytes;   // inflated, written to flash
+    char err[32];
+} ota_status_t;
+
+// Starts the update on its own task; needs Wi-Fi.
+esp_err_t ota_update_start(void);
+void ota_get_status(ota_status_t* out);
+
+// Call once the app is known to work. Cancels the pending rollback, if any.
+void ota_confirm_boot(void);
+
+#endif /* OTA */
@@ -0,0 +1,328 @@
+#include "sample_log.h"
+#include <string.h>
+
+#define PAGE_MAGIC      0xA7
+#define STATE_LIVE      0xFF
+#define STATE_CONSUMED  0x00
+#define PAGES_PER_SECTOR (SAMPLE_LOG_SECTOR / SAMPLE_LOG_PAGE)
+#define PAYLOAD_MAX     (SAMPLE_LOG_PAGE - SAMPLE_LOG_HDR)
+
+typedef enum {
+    PAGE_ERASED,
+    PAGE_VALID,
+    PAGE_BAD,   // torn write or garbage
+} page_kind_t;
+
+static void put_u16(uint8_t* p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void put_u32(uint8_t* p, uint32_t v)
+{
+    put_u16(p, v & 0xFFFF);
+    put_u16(p + 2, v >> 16);
+}
+
+static uint16_t get_u16(const uint8_t* p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t* p)
+{
+    return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
+
+static uint16_t crc16(uint16_t crc, const uint8_t* p, size_t n)
+{
+    while (n--) {
+        crc ^= (uint16_t)(*p++) << 8;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+// Covers everything but the state byte, so clearing it later keeps the page valid
+static uint16_t page_crc(const uint8_t* page, size_t used)
+{
+    uint16_t crc = crc16(0xFFFF, &page[1], 9);
+    return crc16(crc, &page[SAMPLE_LOG_HDR], used);
+}
+
+static size_t put_varint(uint8_t* p, int32_t v)
+{
+    uint32_t z = ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+    size_t n = 0;
+    while (z >= 0x80) {
+        p[n++] = (uint8_t)(z | 0x80);
+        z >>= 7;
+    }
+    p[n++] = (uint8_t)z;
+    return n;
+}
+
+static bool get_varint(const uint8_t* p, size_t len, size_t* pos, int32_t* v)
+{
+    uint32_t z = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (*pos >= len) return false;
+        uint8_t b = p[(*pos)++];
+        z |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *v = (int32_t)((z >> 1) ^ (~(z & 1) + 1));
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint32_t page_off(uint32_t page)
+{
+    return page * SAMPLE_LOG_PAGE;
+}
+
+static uint32_t next_page(const sample_log_t* log, uint32_t page)
+{
+    return (page + 1 == log->pages) ? 0 : page + 1;
+}
+
+static page_kind_t read_page(sample_log_t* log, uint32_t page, uint8_t* buf)
+{
+    if (!log->flash.read(log->flash.ctx, page_off(page), buf, SAMPLE_LOG_PAGE)) return PAGE_BAD;
+
+    bool erased = true;
+    for (size_t i = 0; i < SAMPLE_LOG_PAGE; i++) {
+        if (buf[i] != 0xFF) { erased = false; break; }
+    }
+    if (erased) return PAGE_ERASED;
+
+    uint16_t count = get_u16(&buf[2]);
+    uint16_t used = get_u16(&buf[8]);
+    if (buf[1] != PAGE_MAGIC || count == 0 || used < SAMPLE_LOG_FIRST_SIZE || used > PAYLOAD_MAX) {
+        return PAGE_BAD;
+    }
+    return (get_u16(&buf[10]) == page_crc(buf, used)) ? PAGE_VALID : PAGE_BAD;
+}
+
+// Move the tail forward to the oldest live page, or to the head if there is none
+static void advance_tail(sample_log_t* log)
+{
+    uint8_t page[SAMPLE_LOG_PAGE];
+    while (log->tail != log->head) {
+        if (read_page(log, log->tail, page) == PAGE_VALID && page[0] == STATE_LIVE) return;
+        log->tail = next_page(log, log->tail);
+    }
+}
+
+// Called whenever the head moves onto a sector boundary, so the head page is always
+// erased and tail == head only ever means empty. If the ring is full the tail is in
+// this sector and the oldest pages go.
+static bool enter_sector(sample_log_t* log)
+{
+    const uint32_t sector = log->head / PAGES_PER_SECTOR;
+    uint8_t page[SAMPLE_LOG_PAGE];
+
+    if (log->tail / PAGES_PER_SECTOR == sector) {
+        if (read_page(log, log->tail, page) == PAGE_VALID && page[0] == STATE_LIVE) {
+            log->tail = next_page(log, log->head + PAGES_PER_SECTOR - 1);
+        } else {
+            log->tail = log->head;
+        }
+    }
+    if (!log->flash.erase(log->flash.ctx, sector * SAMPLE_LOG_SECTOR, SAMPLE_LOG_SECTOR)) return false;
+    if (log->tail != log->head) advance_tail(log);
+    return true;
+}
+
+static bool advance_head(sample_log_t* log)
+{
+    log->head = next_page(log, log->head);
+    return (log->head % PAGES_PER_SECTOR == 0) ? enter_sector(log) : true;
+}
+
+// Skip torn pages left by a power loss in the middle of a write
+static bool prepare_head(sample_log_t* log)
+{
+    uint8_t page[SAMPLE_LOG_PAGE];
+    while (read_page(log, log->head, page) != PAGE_ERASED) {
+        const bool empty = (log->tail == log->head);
+        if (!advance_head(log)) return false;
+        if (empty) log->tail = log->head;
+    }
+    return true;
+}
+
+bool sample_log_mount(sample_log_t* log, const sample_log_flash_t* flash)
+{
+    if (!log || !flash || !flash->read || !flash->write || !flash->erase) return false;
+    if (flash->size < 2 * SAMPLE_LOG_SECTOR || flash->size % SAMPLE_LOG_SECTOR) return false;
+
+    memset(log, 0, sizeof(*log));
+    log->flash = *flash;
+    log->pages = flash->size / SAMPLE_LOG_PAGE;
+
+    uint8_t page[SAMPLE_LOG_PAGE];
+    bool have_newest = false, have_oldest = false;
+    uint32_t newest_seq = 0, newest = 0;
+    uint32_t oldest_seq = 0, oldest = 0;
+
+    for (uint32_t p = 0; p < log->pages; p++) {
+        if (read_page(log, p, page) != PAGE_VALID) continue;
+        uint32_t seq = get_u32(&page[4]);
+        if (!have_newest || seq > newest_seq) {
+            have_newest = true;
+            newest_seq = seq;
+            newest = p;
+        }
+        if (page[0] == STATE_LIVE && (!have_oldest || seq < oldest_seq)) {
+            have_oldest = true;
+            oldest_seq = seq;
+            oldest = p;
+        }
+    }
+
+    if (!have_newest) {
+        // Fresh or unreadable region
+        log->head = log->tail = 0;
+        log->next_seq = 1;
+        return enter_sector(log);
+    }
+
+    // Anything after the newest page in its sector is either erased or a torn write;
+    // the first flush sorts that out.
+    log->head = next_page(log, newest);
+    log->next_seq = newest_seq + 1;
+    log->tail = have_oldest ? oldest : log->head;
+    return (log->head % PAGES_PER_SECTOR == 0) ? enter_sector(log) : true;
+}
+
+bool sample_log_flush(sample_log_t* log)
+{
+    if (!log || log->buf_count == 0) return true;
+    if (!prepare_head(log)) return false;
+
+    uint8_t* page = log->buf;
+    page[0] = STATE_LIVE;
+    page[1] = PAGE_MAGIC;
+    put_u16(&page[2], log->buf_count);
+    put_u32(&page[4], log->next_seq);
+    put_u16(&page[8], (uint16_t)log->buf_used);
+    put_u16(&page[10], page_crc(page, log->buf_used));
+
+    const bool was_empty = (log->tail == log->head);
+    if (!log->flash.write(log->flash.ctx, page_off(log->head), page, SAMPLE_LOG_HDR + log->buf_used)) {
+        // The page may be half written; it fails its CRC and gets skipped. Keep the
+        // samples for the next attempt.
+        if (was_empty) log->tail = next_page(log, log->head);
+        advance_head(log);
+        return false;
+    }
+
+    log->next_seq++;
+    log->buf_used = 0;
+    log->buf_count = 0;
+    return advance_head(log);
+}
+
+bool sample_log_append(sample_log_t* log, const history_sample_t* s)
+{
+    if (!log || !s) return false;
+
+    uint8_t enc[15];
+    size_t n = 0;
+    if (log->buf_count > 0) {
+        n += put_varint(&enc[n], (int32_t)(s->time_s - log->buf_last.time_s));
+        n += put_varint(&enc[n], (int32_t)s->temp_centi_c - log->buf_last.temp_centi_c);
+        n += put_varint(&enc[n], (int32_t)s->hum_centi_pct - log->buf_last.hum_centi_pct);
+        if (log->buf_used + n > PAYLOAD_MAX) {
+            if (!sample_log_flush(log)) return false;
+        }
+    }
+    if (log->buf_count == 0) {
+        put_u32(&enc[0], s->time_s);
+        put_u16(&enc[4], (uint16_t)s->temp_centi_c);
+        put_u16(&enc[6], s->hum_centi_pct);
+        n = SAMPLE_LOG_FIRST_SIZE;
+    }
+
+    memcpy(&log->buf[SAMPLE_LOG_HDR + log->buf_used], enc, n);
+    log->buf_used += n;
+    log->buf_count++;
+    log->buf_last = *s;
+    return true;
+}
+
+static size_t decode_page(const uint8_t* page, history_sample_t* out)
+{
+    const uint16_t count = get_u16(&page[2]);
+    const size_t used = get_u16(&page[8]);
+    const uint8_t* p = &page[SAMPLE_LOG_HDR];
+    if (count > SAMPLE_LOG_MAX_PER_PAGE) return 0;
+
+    history_sample_t s = {
+        .time_s = get_u32(&p[0]),
+        .temp_centi_c = (int16_t)get_u16(&p[4]),
+        .hum_centi_pct = get_u16(&p[6]),
+    };
+    out[0] = s;
+
+    size_t pos = SAMPLE_LOG_FIRST_SIZE;
+    for (uint16_t i = 1; i < count; i++) {
+        int32_t dt, dtemp, dhum;
+        if (!get_varint(p, used, &pos, &dt) || !get_varint(p, used, &pos, &dtemp) ||
+            !get_varint(p, used, &pos, &dhum)) {
+            return 0;
+        }
+        s.time_s += (uint32_t)dt;
+        s.temp_centi_c = (int16_t)(s.temp_centi_c + dtemp);
+        s.hum_centi_pct = (uint16_t)(s.hum_centi_pct + dhum);
+        out[i] = s;
+    }
+    return count;
+}
+
+size_t sample_log_read_oldest(sample_log_t* log, history_sample_t* out, uint32_t* seq)
+{
+    if (!log || !out) return 0;
+
+    uint8_t page[SAMPLE_LOG_PAGE];
+    advance_tail(log);
+    while (log->tail != log->head) {
+        if (read_page(log, log->tail, page) == PAGE_VALID) {
+            size_t n = decode_page(page, out);
+            if (n > 0) {
+                if (seq) *seq = get_u32(&page[4]);
+                return n;
+            }
+        }
+        // Passed its CRC but does not decode; nothing useful in it
+        log->tail = next_page(log, log->tail);
+        advance_tail(log);
+    }
+    return 0;
+}
+
+bool sample_log_consume(sample_log_t* log, uint32_t seq)
+{
+    if (!log || log->tail == log->head) return false;
+
+    uint8_t hdr[SAMPLE_LOG_HDR];
+    if (!log->flash.read(log->flash.ctx, page_off(log->tail), hdr, sizeof(hdr))) return false;
+    if (hdr[1] != PAGE_MAGIC || get_u32(&hdr[4]) != seq) return false;
+
+    const uint8_t consumed = STATE_CONSUMED;
+    if (!log->flash.write(log->flash.ctx, page_off(log->tail), &consumed, 1)) return false;
+    log->tail = next_page(log, log->tail);
+    advance_tail(log);
+    return true;
+}
+
+uint32_t sample_log_pending(const sample_log_t* log)
+{
+    if (!log) return 0;
+    return (log->head + log->pages - log->tail) % log->pages;
+}
@@ -0,0 +1,70 @@
+#ifndef SAMPLE_LOG
+#define SAMPLE_LOG
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "history.h"
+
+// Append-only sample log over a raw flash region. No ESP-IDF dependencies: the flash is
+// reached through sample_log_flash_t, so the encoder and mount/recovery can run against
+// a RAM image on the host.
+//
+// The region is a ring of 256 byte pages written front to back and wrapping around, so
+// erases are spread evenly over every sector. Each page is written once, in one go:
+//   [u8 state][u8 magic][u16 count][u32 seq][u16 used][u16 crc] payload[used]
+// state is 0xFF while live and cleared to 0x00 (no erase needed) once uploaded; it is
+// the only byte outside the CRC. payload is the first sample as
+// [u32 time][i16 temp][u16 hum], then zigzag varint deltas (dt, dtemp, dhum) per
+// sample, usually 3 bytes each.
+//
+// Power loss: a torn page fails its CRC and is skipped on mount. The page after the
+// newest valid one becomes the write head. The head erases each sector as it enters
+// it, dropping the oldest data once the ring is full.
+
+#define SAMPLE_LOG_SECTOR       4096
+#define SAMPLE_LOG_PAGE         256
+#define SAMPLE_LOG_HDR          12
+#define SAMPLE_LOG_FIRST_SIZE   8
+#define SAMPLE_LOG_MAX_PER_PAGE ((SAMPLE_LOG_PAGE - SAMPLE_LOG_HDR - SAMPLE_LOG_FIRST_SIZE) / 3 + 1)
+
+typedef struct {
+    void* ctx;
+    bool (*read)(void* ctx, uint32_t off, void* buf, size_t len);
+    bool (*write)(void* ctx, uint32_t off, const void* buf, size_t len);
+    bool (*erase)(void* ctx, uint32_t off, size_t len);  // sector aligned
+    uint32_t size;                                       // multiple of SAMPLE_LOG_SECTOR
+} sample_log_flash_t;
+
+typedef struct {
+    sample_log_flash_t flash;
+    uint32_t pages;
+    uint32_t head;          // page the next flush writes
+    uint32_t tail;          // oldest live page (== head when empty)
+    uint32_t next_seq;
+    // Samples not yet on flash
+    uint8_t buf[SAMPLE_LOG_PAGE];
+    size_t buf_used;        // payload bytes
+    uint16_t buf_count;
+    history_sample_t buf_last;
+} sample_log_t;
+
+// Scan the region and rebuild head/tail. Erases the sector under the head if needed.
+bool sample_log_mount(sample_log_t* log, const sample_log_flash_t* flash);
+
+// Buffer a sample; full pages are written out as they fill.
+bool sample_log_append(sample_log_t* log, const history_sample_t* s);
+// Write the partly filled page, if any. The rest of that page is left unused.
+bool sample_log_flush(sample_log_t* log);
+
+// Decode the oldest live page. Returns the sample count (0 when empty) and its seq for
+// sample_log_consume(). out must hold SAMPLE_LOG_MAX_PER_PAGE samples.
+size_t sample_log_read_oldest(sample_log_t* log, history_sample_t* out, uint32_t* seq);
+// Mark the oldest page uploaded if its seq matches.
+bool sample_log_consume(sample_log_t* log, uint32_t seq);
+
+// Live pages on flash (not counting the RAM buffer)
+uint32_t sample_log_pending(const sample_log_t* log);
+
+#endif /* SAMPLE_LOG */
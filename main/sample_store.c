@@ -0,0 +1,105 @@
+#include "sample_store.h"
+
+#include <esp_log.h>
+#include <esp_partition.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#define STORE_TAG "SAMPLE_STORE"
+
+static const esp_partition_t* s_part = NULL;
+static sample_log_t s_log;
+static SemaphoreHandle_t s_lock = NULL;
+
+static bool part_read(void* ctx, uint32_t off, void* buf, size_t len)
+{
+    return esp_partition_read((const esp_partition_t*)ctx, off, buf, len) == ESP_OK;
+}
+
+static bool part_write(void* ctx, uint32_t off, const void* buf, size_t len)
+{
+    return esp_partition_write((const esp_partition_t*)ctx, off, buf, len) == ESP_OK;
+}
+
+static bool part_erase(void* ctx, uint32_t off, size_t len)
+{
+    return esp_partition_erase_range((const esp_partition_t*)ctx, off, len) == ESP_OK;
+}
+
+esp_err_t sample_store_init(void)
+{
+    if (s_lock) return ESP_OK;
+
+    s_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, SAMPLE_STORE_SUBTYPE, SAMPLE_STORE_PARTITION);
+    if (!s_part) {
+        ESP_LOGW(STORE_TAG, "No '%s' partition, offline samples will not be kept", SAMPLE_STORE_PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    const sample_log_flash_t flash = {
+        .ctx = (void*)s_part,
+        .read = part_read,
+        .write = part_write,
+        .erase = part_erase,
+        .size = s_part->size - s_part->size % SAMPLE_LOG_SECTOR,
+    };
+    if (!sample_log_mount(&s_log, &flash)) {
+        ESP_LOGE(STORE_TAG, "Mount failed");
+        return ESP_FAIL;
+    }
+
+    s_lock = xSemaphoreCreateMutex();
+    if (!s_lock) return ESP_ERR_NO_MEM;
+    ESP_LOGI(STORE_TAG, "Mounted, %lu pages pending", (unsigned long)sample_log_pending(&s_log));
+    return ESP_OK;
+}
+
+bool sample_store_ready(void)
+{
+    return s_lock != NULL;
+}
+
+esp_err_t sample_store_append(const history_sample_t* s)
+{
+    if (!s_lock) return ESP_ERR_INVALID_STATE;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool ok = sample_log_append(&s_log, s);
+    xSemaphoreGive(s_lock);
+    return ok ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t sample_store_flush(void)
+{
+    if (!s_lock) return ESP_ERR_INVALID_STATE;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool ok = sample_log_flush(&s_log);
+    xSemaphoreGive(s_lock);
+    return ok ? ESP_OK : ESP_FAIL;
+}
+
+size_t sample_store_read_oldest(history_sample_t* out, uint32_t* seq)
+{
+    if (!s_lock) return 0;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    size_t n = sample_log_read_oldest(&s_log, out, seq);
+    xSemaphoreGive(s_lock);
+    return n;
+}
+
+esp_err_t sample_store_consume(uint32_t seq)
+{
+    if (!s_lock) return ESP_ERR_INVALID_STATE;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool ok = sample_log_consume(&s_log, seq);
+    xSemaphoreGive(s_lock);
+    return ok ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+uint32_t sample_store_pending(void)
+{
+    if (!s_lock) return 0;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    uint32_t n = sample_log_pending(&s_log);
+    xSemaphoreGive(s_lock);
+    return n;
+}
@@ -0,0 +1,28 @@
+#ifndef SAMPLE_STORE
+#define SAMPLE_STORE
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+#include "history.h"
+#include "sample_log.h"
+
+// Offline sample buffer: sample_log on the "samplelog" data partition. Thread safe.
+
+#define SAMPLE_STORE_PARTITION  "samplelog"
+#define SAMPLE_STORE_SUBTYPE    0x40
+
+esp_err_t sample_store_init(void);
+bool sample_store_ready(void);
+
+esp_err_t sample_store_append(const history_sample_t* s);
+esp_err_t sample_store_flush(void);
+
+// Oldest stored page, see sample_log_read_oldest(). out holds SAMPLE_LOG_MAX_PER_PAGE.
+size_t sample_store_read_oldest(history_sample_t* out, uint32_t* seq);
+esp_err_t sample_store_consume(uint32_t seq);
+uint32_t sample_store_pending(void);
+
+#endif /* SAMPLE_STORE */
@@ -0,0 +1,275 @@
+#include "settings.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <nvs.h>
+
+#include "mqtt_pub.h"
+
+#define SETTINGS_TAG "SETTINGS"
+#define NVS_NS "settings"
+
+static const setting_def_t s_defs[SET_COUNT] = {
+    //                 key           label         type         min   max                     step  def                   def_str
+    [SET_CITY]       = { "city",       "City",       SETTING_STR, 1,    SETTINGS_STR_MAX - 1,   0,    0,                    "Montreal" },
+    [SET_SAMPLE_MS]  = { "sample_ms",  "Sample ms",  SETTING_INT, 1000, 60000,                  500,  2000,                 NULL },
+    [SET_HISTORY_S]  = { "history_s",  "History s",  SETTING_INT, 10,   3600,                   10,   60,                   NULL },
+    [SET_MQTT_BATCH] = { "mqtt_batch", "MQTT batch", SETTING_INT, 1,    MQTT_BATCH_MAX_SAMPLES, 1,    MQTT_BATCH_SAMPLES,   NULL },
+    [SET_MQTT_AGE_S] = { "mqtt_age_s", "MQTT age s", SETTING_INT, 5,    3600,                   5,    MQTT_BATCH_MAX_AGE_S, NULL },
+};
+
+typedef union {
+    int32_t i;
+    char s[SETTINGS_STR_MAX];
+} setting_value_t;
+
+static setting_value_t s_values[SET_COUNT];
+static uint32_t s_dirty = 0;            // bit per setting_id_t
+static uint32_t s_generation = 0;
+static portMUX_TYPE s_settings_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t s_commit_timer = NULL;
+
+// Letters, digits and a little punctuation: the city ends up in a URL
+static bool str_valid(const setting_def_t* d, const char* v)
+{
+    const size_t len = strlen(v);
+    if (len < (size_t)d->min || len > (size_t)d->max) return false;
+    for (const char* p = v; *p; p++) {
+        const char c = *p;
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+              c == ' ' || c == '-' || c == '.' || c == ',' || c == '\'')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void set_default(setting_id_t id)
+{
+    const setting_def_t* d = &s_defs[id];
+    if (d->type == SETTING_INT) s_values[id].i = d->def;
+    else strlcpy(s_values[id].s, d->def_str, sizeof(s_values[id].s));
+}
+
+static void commit_cb(void* arg)
+{
+    settings_flush();
+}
+
+void settings_init(void)
+{
+    for (int id = 0; id < SET_COUNT; id++) set_default(id);
+
+    nvs_handle_t h;
+    if (nvs_open(NVS_NS, NVS_READONLY, &h) == ESP_OK) {
+        for (int id = 0; id < SET_COUNT; id++) {
+            const setting_def_t* d = &s_defs[id];
+            if (d->type == SETTING_INT) {
+                int32_t v;
+                if (nvs_get_i32(h, d->key, &v) == ESP_OK && v >= d->min && v <= d->max) s_values[id].i = v;
+            } else {
+                char v[SETTINGS_STR_MAX];
+                size_t len = sizeof(v);
+                if (nvs_get_str(h, d->key, v, &len) == ESP_OK && str_valid(d, v)) {
+                    strlcpy(s_values[id].s, v, sizeof(s_values[id].s));
+                }
+            }
+        }
+        nvs_close(h);
+    }
+
+    const esp_timer_create_args_t args = { .callback = commit_cb, .name = "settings" };
+    if (esp_timer_create(&args, &s_commit_timer) != ESP_OK) s_commit_timer = NULL;
+}
+
+const setting_def_t* settings_def(setting_id_t id)
+{
+    return (id < SET_COUNT) ? &s_defs[id] : NULL;
+}
+
+int settings_find(const char* key)
+{
+    for (int id = 0; id < SET_COUNT; id++) {
+        if (strcmp(s_defs[id].key, key) == 0) return id;
+    }
+    return -1;
+}
+
+int32_t settings_get_int(setting_id_t id)
+{
+    return (id < SET_COUNT && s_defs[id].type == SETTING_INT) ? s_values[id].i : 0;
+}
+
+void settings_get_str(setting_id_t id, char* out, size_t out_sz)
+{
+    if (out_sz == 0) return;
+    out[0] = '\0';
+    if (id >= SET_COUNT || s_defs[id].type != SETTING_STR) return;
+    taskENTER_CRITICAL(&s_settings_lock);
+    strlcpy(out, s_values[id].s, out_sz);
+    taskEXIT_CRITICAL(&s_settings_lock);
+}
+
+uint32_t settings_generation(void)
+{
+    return s_generation;
+}
+
+// Restarting the timer on every write is what coalesces a burst into one commit
+static void schedule_commit(void)
+{
+    if (!s_commit_timer) {
+        settings_flush();
+        return;
+    }
+    esp_timer_stop(s_commit_timer);
+    esp_timer_start_once(s_commit_timer, (uint64_t)SETTINGS_COMMIT_DELAY_MS * 1000);
+}
+
+esp_err_t settings_set_int(setting_id_t id, int32_t value)
+{
+    if (id >= SET_COUNT || s_defs[id].type != SETTING_INT) return ESP_ERR_INVALID_ARG;
+    if (value < s_defs[id].min || value > s_defs[id].max) return ESP_ERR_INVALID_ARG;
+
+    bool changed;
+    taskENTER_CRITICAL(&s_settings_lock);
+    changed = (s_values[id].i != value);
+    if (changed) {
+        s_values[id].i = value;
+        s_dirty |= 1u << id;
+        s_generation++;
+    }
+    taskEXIT_CRITICAL(&s_settings_lock);
+    if (changed) schedule_commit();
+    return ESP_OK;
+}
+
+esp_err_t settings_set_str(setting_id_t id, const char* value)
+{
+    if (id >= SET_COUNT || s_defs[id].type != SETTING_STR || !value) return ESP_ERR_INVALID_ARG;
+    if (!str_valid(&s_defs[id], value)) return ESP_ERR_INVALID_ARG;
+
+    bool changed;
+    taskENTER_CRITICAL(&s_settings_lock);
+    changed = (strcmp(s_values[id].s, value) != 0);
+    if (changed) {
+        strlcpy(s_values[id].s, value, sizeof(s_values[id].s));
+        s_dirty |= 1u << id;
+        s_generation++;
+    }
+    taskEXIT_CRITICAL(&s_settings_lock);
+    if (changed) schedule_commit();
+    return ESP_OK;
+}
+
+esp_err_t settings_set_text(setting_id_t id, const char* text)
+{
+    if (id >= SET_COUNT || !text) return ESP_ERR_INVALID_ARG;
+    if (s_defs[id].type == SETTING_STR) return settings_set_str(id, text);
+
+    char* end;
+    const long v = strtol(text, &end, 10);
+    if (end == text || *end != '\0') return ESP_ERR_INVALID_ARG;
+    return settings_set_int(id, (int32_t)v);
+}
+
+void settings_format(setting_id_t id, fmt_t* f)
+{
+    if (id >= SET_COUNT) return;
+    if (s_defs[id].type == SETTING_INT) {
+        fmt_int(f, s_values[id].i);
+    } else {
+        char v[SETTINGS_STR_MAX];
+        settings_get_str(id, v, sizeof(v));
+        fmt_str(f, v);
+    }
+}
+
+esp_err_t settings_flush(void)
+{
+    // Copy out under the lock; the flash writes happen outside it
+    setting_value_t values[SET_COUNT];
+    taskENTER_CRITICAL(&s_settings_lock);
+    const uint32_t dirty = s_dirty;
+    s_dirty = 0;
+    memcpy(values, s_values, sizeof(values));
+    taskEXIT_CRITICAL(&s_settings_lock);
+    if (!dirty) return ESP_OK;
+
+    if (s_commit_timer) esp_timer_stop(s_commit_timer);
+    const int64_t t0 = esp_timer_get_time();
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(NVS_NS, NVS_READWRITE, &h);
+    if (err == ESP_OK) {
+        for (int id = 0; err == ESP_OK && id < SET_COUNT; id++) {
+            if (!(dirty & (1u << id))) continue;
+            err = (s_defs[id].type == SETTING_INT) ? nvs_set_i32(h, s_defs[id].key, values[id].i)
+                                                    : nvs_set_str(h, s_defs[id].key, values[id].s);
+        }
+        if (err == ESP_OK) err = nvs_commit(h);
+        nvs_close(h);
+    }
+
+    if (err != ESP_OK) {
+        ESP_LOGE(SETTINGS_TAG, "Commit failed: %s", esp_err_to_name(err));
+        taskENTER_CRITICAL(&s_settings_lock);
+        s_dirty |= dirty; // next write retries
+        taskEXIT_CRITICAL(&s_settings_lock);
+        return err;
+    }
+    ESP_LOGI(SETTINGS_TAG, "Committed 0x%lx in %lld us", (unsigned long)dirty,
+             (long long)(esp_timer_get_time() - t0));
+    return ESP_OK;
+}
+
+static void console_print(setting_id_t id)
+{
+    const setting_def_t* d = &s_defs[id];
+    char v[SETTINGS_STR_MAX];
+    fmt_t f;
+    fmt_init(&f, v, sizeof(v));
+    settings_format(id, &f);
+    if (d->type == SETTING_INT) {
+        printf("%s = %s  (%ld..%ld, default %ld)\n", d->key, v, (long)d->min, (long)d->max, (long)d->def);
+    } else {
+        printf("%s = \"%s\"  (default \"%s\")\n", d->key, v, d->def_str);
+    }
+}
+
+void settings_console(const char* line)
+{
+    char cmd[8] = {0}, key[16] = {0};
+    int used = 0;
+    sscanf(line, " %7s %15s %n", cmd, key, &used);
+
+    const bool get = strcmp(cmd, "get") == 0;
+    const bool set = strcmp(cmd, "set") == 0;
+    const bool reset = strcmp(cmd, "reset") == 0;
+    if (strcmp(cmd, "list") == 0) {
+        for (int id = 0; id < SET_COUNT; id++) console_print(id);
+        return;
+    }
+    if (!get && !set && !reset) {
+        printf("usage: list | get <key> | set <key> <value> | reset <key>\n");
+        return;
+    }
+
+    const int id = settings_find(key);
+    if (id < 0) {
+        printf("unknown setting '%s'\n", key);
+        return;
+    }
+    esp_err_t err = ESP_OK;
+    if (set) {
+        err = (used > 0) ? settings_set_text(id, line + used) : ESP_ERR_INVALID_ARG;
+    } else if (reset) {
+        const setting_def_t* d = &s_defs[id];
+        err = (d->type == SETTING_INT) ? settings_set_int(id, d->def) : settings_set_str(id, d->def_str);
+    }
+    if (err != ESP_OK) printf("invalid value for %s\n", key);
+    else console_print(id);
+}
@@ -0,0 +1,75 @@
+#ifndef SETTINGS
+#define SETTINGS
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+#include "fmt.h"
+
+// User settings. The registry in settings.c gives each one a type, a default and a
+// valid range; values live in a RAM cache, so a read is an array index. A write
+// only touches the cache and marks the key dirty: the dirty keys go to NVS in one
+// commit once nothing has changed for SETTINGS_COMMIT_DELAY_MS, or straight away
+// on settings_flush() (Shutdown). Editing on the device goes through the Settings >
+// Preferences screen, and over the UART through the console (settings_console),
+// opened with COMMAND_PREFIX_KEY then SETTINGS_CONSOLE_KEY. The same line takes
+// "wifi ..." for the known networks (wifi_store_console).
+
+#define SETTINGS_COMMIT_DELAY_MS    3000
+#define SETTINGS_STR_MAX            32      // including the NUL
+#define SETTINGS_CONSOLE_KEY        ':'     // UART command: start a settings command line
+
+typedef enum {
+    SET_CITY,               // weather city
+    SET_SAMPLE_MS,          // DHT20 sampling period
+    SET_HISTORY_S,          // history ring period
+    SET_MQTT_BATCH,         // samples per MQTT batch
+    SET_MQTT_AGE_S,         // oldest sample an MQTT batch waits with
+    SET_COUNT
+} setting_id_t;
+
+typedef enum {
+    SETTING_INT,
+    SETTING_STR,
+} setting_type_t;
+
+typedef struct {
+    const char* key;        // NVS key and console name, 15 chars at most
+    const char* label;      // on screen
+    setting_type_t type;
+    int32_t min, max;       // SETTING_INT range; SETTING_STR length
+    int32_t step;           // SETTING_INT: UI increment
+    int32_t def;
+    const char* def_str;
+} setting_def_t;
+
+// After nvs_flash_init(). Values that are missing or out of range get the default.
+void settings_init(void);
+
+const setting_def_t* settings_def(setting_id_t id);
+// Index of `key`, or -1
+int settings_find(const char* key);
+
+// Safe from any task
+int32_t settings_get_int(setting_id_t id);
+void settings_get_str(setting_id_t id, char* out, size_t out_sz);
+// Bumps on every accepted change
+uint32_t settings_generation(void);
+
+// ESP_ERR_INVALID_ARG if the value is out of range or the wrong type
+esp_err_t settings_set_int(setting_id_t id, int32_t value);
+esp_err_t settings_set_str(setting_id_t id, const char* value);
+// Parses `text` by the setting's type
+esp_err_t settings_set_text(setting_id_t id, const char* text);
+// Appends the value as text, for the UI and the console
+void settings_format(setting_id_t id, fmt_t* f);
+
+// Commits pending writes now
+esp_err_t settings_flush(void);
+
+// One console line: "list", "get <key>", "set <key> <value>", "reset <key>"
+void settings_console(const char* line);
+
+#endif /* SETTINGS */
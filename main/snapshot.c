@@ -0,0 +1,39 @@
+#include "snapshot.h"
+
+#include <esp_log.h>
+#include <nvs.h>
+
+#define SNAPSHOT_TAG "SNAPSHOT"
+#define NVS_NS "snapshot"
+#define NVS_KEY "ui"
+
+esp_err_t snapshot_save(const snapshot_t* snap)
+{
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(NVS_NS, NVS_READWRITE, &h);
+    if (err != ESP_OK) return err;
+    err = nvs_set_blob(h, NVS_KEY, snap, sizeof(*snap));
+    if (err == ESP_OK) err = nvs_commit(h);
+    nvs_close(h);
+    if (err != ESP_OK) ESP_LOGE(SNAPSHOT_TAG, "Save failed: %s", esp_err_to_name(err));
+    return err;
+}
+
+bool snapshot_load(snapshot_t* out)
+{
+    nvs_handle_t h;
+    if (nvs_open(NVS_NS, NVS_READONLY, &h) != ESP_OK) return false;
+    size_t len = sizeof(*out);
+    const bool ok = (nvs_get_blob(h, NVS_KEY, out, &len) == ESP_OK && len == sizeof(*out) &&
+                     out->version == SNAPSHOT_VERSION);
+    nvs_close(h);
+    return ok;
+}
+
+void snapshot_clear(void)
+{
+    nvs_handle_t h;
+    if (nvs_open(NVS_NS, NVS_READWRITE, &h) != ESP_OK) return;
+    if (nvs_erase_key(h, NVS_KEY) == ESP_OK) nvs_commit(h);
+    nvs_close(h);
+}
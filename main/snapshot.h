@@ -0,0 +1,55 @@
+#ifndef SNAPSHOT
+#define SNAPSHOT
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+// Warm state written by Shutdown and read back on the next boot, so the UI comes up
+// on the screen it was left on, with the last weather, location and reading, before
+// any radio is touched. It is one packed NVS blob, saved with a single set + commit
+// and taken once: snapshot_clear() runs after a resume, so a later power cut boots
+// cold instead of into stale state.
+
+#define SNAPSHOT_VERSION    1
+
+#define SNAPSHOT_HAS_WEATHER    0x01
+#define SNAPSHOT_HAS_GEO        0x02
+#define SNAPSHOT_HAS_READING    0x04
+#define SNAPSHOT_HAS_TIME       0x08
+
+typedef struct __attribute__((packed)) {
+    uint8_t version;
+    uint8_t flags;              // SNAPSHOT_HAS_*
+    uint8_t screen;
+    uint8_t main_selected;
+    uint8_t weather_selected;
+    uint8_t settings_selected;
+
+    int8_t weather_temp_c;
+    int8_t weather_feels_c;
+    int8_t weather_tmin_c;
+    int8_t weather_tmax_c;
+    uint8_t weather_hum_pct;
+    uint16_t weather_wind_kmh;
+    char weather_desc[32];
+
+    int32_t geo_offset_s;
+    char geo_country[4];
+    char geo_region[32];
+    char geo_city[32];
+
+    int16_t temp_centi_c;
+    uint16_t hum_centi_pct;
+    uint32_t reading_time_s;
+
+    int64_t utc_s;              // the clock at shutdown, a lower bound on the next boot
+    int32_t tz_offset_s;
+} snapshot_t;
+
+esp_err_t snapshot_save(const snapshot_t* snap);
+// False if there is none or it is from another version
+bool snapshot_load(snapshot_t* out);
+void snapshot_clear(void);
+
+#endif /* SNAPSHOT */
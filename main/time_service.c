@@ -0,0 +1,214 @@
+#include "time_service.h"
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <esp_log.h>
+#include <esp_sntp.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <nvs.h>
+
+#define TIME_TAG "TIME"
+#define NVS_NS "time"
+#define VALID_EPOCH_S 1609459200 // 2021-01-01, anything earlier was never set
+
+// The cached clock: UTC at base_mono, advanced by esp_timer scaled by the drift
+typedef struct {
+    time_quality_t quality;
+    int64_t base_epoch_us;
+    int64_t base_mono_us;
+    int64_t slew_us;        // correction still being worked in, see clock_us()
+    int32_t drift_ppb;
+    long offset_s;
+} clock_state_t;
+
+static clock_state_t s_clock = { .quality = TIME_UNSET };
+static portMUX_TYPE s_clock_lock = portMUX_INITIALIZER_UNLOCKED;
+static int64_t s_last_sync_mono_us = -1; // SNTP sync this boot, for the drift estimate
+static bool s_sntp_started = false;
+
+static int64_t clock_us(const clock_state_t* c, int64_t mono_us)
+{
+    int64_t elapsed = mono_us - c->base_mono_us;
+    int64_t t = c->base_epoch_us + elapsed + elapsed * c->drift_ppb / 1000000000;
+
+    if (c->slew_us != 0) {
+        int64_t done = elapsed * TIME_SLEW_RATE_PPM / 1000000;
+        int64_t left = llabs(c->slew_us) - done;
+        if (left > 0) t -= (c->slew_us > 0) ? left : -left;
+    }
+    return t;
+}
+
+static void persist(int64_t epoch_s, int32_t drift_ppb)
+{
+    nvs_handle_t h;
+    if (nvs_open(NVS_NS, NVS_READWRITE, &h) != ESP_OK) return;
+    nvs_set_i64(h, "epoch", epoch_s);
+    nvs_set_i32(h, "drift_ppb", drift_ppb);
+    nvs_commit(h);
+    nvs_close(h);
+}
+
+// Runs on the lwIP task. In smooth mode the system clock has not been corrected yet
+// when this is called, but the cached clock only trusts tv.
+static void on_sntp_sync(struct timeval* tv)
+{
+    const int64_t mono = esp_timer_get_time();
+    const int64_t truth = (int64_t)tv->tv_sec * 1000000 + tv->tv_usec;
+
+    taskENTER_CRITICAL(&s_clock_lock);
+    clock_state_t c = s_clock;
+    taskEXIT_CRITICAL(&s_clock_lock);
+
+    const bool was_synced = (c.quality == TIME_SYNCED);
+    const int64_t error = was_synced ? truth - clock_us(&c, mono) : 0;
+
+    // Whatever error is left after applying the current estimate is more drift
+    if (was_synced && s_last_sync_mono_us >= 0) {
+        int64_t span = mono - s_last_sync_mono_us;
+        if (span >= (int64_t)TIME_DRIFT_MIN_SPAN_S * 1000000 && llabs(error) < TIME_SLEW_MAX_US) {
+            int64_t drift = c.drift_ppb + error * 1000000000 / span / 2;
+            if (drift > TIME_DRIFT_MAX_PPB) drift = TIME_DRIFT_MAX_PPB;
+            if (drift < -TIME_DRIFT_MAX_PPB) drift = -TIME_DRIFT_MAX_PPB;
+            c.drift_ppb = (int32_t)drift;
+        }
+    }
+    s_last_sync_mono_us = mono;
+
+    c.base_epoch_us = truth;
+    c.base_mono_us = mono;
+    c.slew_us = (was_synced && llabs(error) < TIME_SLEW_MAX_US) ? error : 0;
+    c.quality = TIME_SYNCED;
+
+    taskENTER_CRITICAL(&s_clock_lock);
+    c.offset_s = s_clock.offset_s; // may have changed meanwhile
+    s_clock = c;
+    taskEXIT_CRITICAL(&s_clock_lock);
+
+    ESP_LOGI(TIME_TAG, "Synced, error %lld us, drift %ld ppb", (long long)error, (long)c.drift_ppb);
+    persist(tv->tv_sec, c.drift_ppb);
+}
+
+void time_service_init(void)
+{
+    int64_t epoch_s = 0;
+    int32_t drift_ppb = 0;
+    int32_t offset_s = 0;
+    nvs_handle_t h;
+    if (nvs_open(NVS_NS, NVS_READONLY, &h) == ESP_OK) {
+        nvs_get_i64(h, "epoch", &epoch_s);
+        nvs_get_i32(h, "drift_ppb", &drift_ppb);
+        nvs_get_i32(h, "offset_s", &offset_s);
+        nvs_close(h);
+    }
+
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    if (now.tv_sec < VALID_EPOCH_S && epoch_s >= VALID_EPOCH_S) {
+        // Cold boot: the last sync is a lower bound, better than 1970 for timestamps
+        now.tv_sec = (time_t)epoch_s;
+        now.tv_usec = 0;
+        settimeofday(&now, NULL);
+    }
+
+    taskENTER_CRITICAL(&s_clock_lock);
+    s_clock.drift_ppb = drift_ppb;
+    s_clock.offset_s = offset_s;
+    if (now.tv_sec >= VALID_EPOCH_S) {
+        // Either restored above or kept across a soft reset
+        s_clock.base_epoch_us = (int64_t)now.tv_sec * 1000000 + now.tv_usec;
+        s_clock.base_mono_us = esp_timer_get_time();
+        s_clock.quality = TIME_ESTIMATED;
+    }
+    taskEXIT_CRITICAL(&s_clock_lock);
+
+    ESP_LOGI(TIME_TAG, "Start at %lld (%s), drift %ld ppb, offset %ld s", (long long)now.tv_sec,
+             now.tv_sec >= VALID_EPOCH_S ? "estimated" : "unset", (long)drift_ppb, (long)offset_s);
+}
+
+void time_service_on_ip(void)
+{
+    if (s_sntp_started) {
+        esp_sntp_restart(); // new network, sync again right away
+        return;
+    }
+    esp_sntp_setoperatingmode(SNTP_OPMODE_POLL);
+    esp_sntp_setservername(0, TIME_SNTP_SERVER);
+    sntp_set_sync_mode(SNTP_SYNC_MODE_SMOOTH); // system clock slews too
+    sntp_set_time_sync_notification_cb(on_sntp_sync);
+    esp_sntp_init();
+    s_sntp_started = true;
+}
+
+void time_service_set_offset(long offset_sec)
+{
+    taskENTER_CRITICAL(&s_clock_lock);
+    const bool changed = (s_clock.offset_s != offset_sec);
+    s_clock.offset_s = offset_sec;
+    taskEXIT_CRITICAL(&s_clock_lock);
+
+    // Kept for the next cold boot; every geo fetch lands here, so only on a change
+    if (!changed) return;
+    nvs_handle_t h;
+    if (nvs_open(NVS_NS, NVS_READWRITE, &h) != ESP_OK) return;
+    nvs_set_i32(h, "offset_s", (int32_t)offset_sec);
+    nvs_commit(h);
+    nvs_close(h);
+}
+
+bool time_service_now(time_t* out)
+{
+    taskENTER_CRITICAL(&s_clock_lock);
+    clock_state_t c = s_clock;
+    taskEXIT_CRITICAL(&s_clock_lock);
+
+    if (c.quality == TIME_UNSET) return false;
+    *out = (time_t)(clock_us(&c, esp_timer_get_time()) / 1000000) + c.offset_s;
+    return true;
+}
+
+bool time_service_save(int64_t* utc_s, long* offset_s)
+{
+    taskENTER_CRITICAL(&s_clock_lock);
+    clock_state_t c = s_clock;
+    taskEXIT_CRITICAL(&s_clock_lock);
+
+    *offset_s = c.offset_s;
+    if (c.quality == TIME_UNSET) return false;
+    *utc_s = clock_us(&c, esp_timer_get_time()) / 1000000;
+    return true;
+}
+
+void time_service_resume(int64_t utc_s, long offset_s)
+{
+    const int64_t mono = esp_timer_get_time();
+    bool step = false;
+
+    taskENTER_CRITICAL(&s_clock_lock);
+    s_clock.offset_s = offset_s;
+    if (utc_s >= VALID_EPOCH_S && s_clock.quality != TIME_SYNCED &&
+        (s_clock.quality == TIME_UNSET || utc_s * 1000000 > clock_us(&s_clock, mono))) {
+        s_clock.base_epoch_us = utc_s * 1000000;
+        s_clock.base_mono_us = mono;
+        s_clock.slew_us = 0;
+        s_clock.quality = TIME_ESTIMATED;
+        step = true;
+    }
+    taskEXIT_CRITICAL(&s_clock_lock);
+
+    if (step) {
+        struct timeval tv = { .tv_sec = (time_t)utc_s, .tv_usec = 0 };
+        settimeofday(&tv, NULL);
+    }
+}
+
+time_quality_t time_service_quality(void)
+{
+    return s_clock.quality;
+}
+
+int32_t time_service_drift_ppb(void)
+{
+    return s_clock.drift_ppb;
+}
@@ -0,0 +1,46 @@
+#ifndef TIME_SERVICE
+#define TIME_SERVICE
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+// Wall clock for the UI and telemetry. SNTP starts as soon as the station gets an IP.
+// Each sync is blended into a cached clock, which is read with integer math on top of
+// esp_timer, so reading it costs no syscalls:
+// - the drift between syncs is estimated and applied in ppb;
+// - small corrections are slewed in rather than stepped, so seconds never jump back;
+// - the last synced epoch, the drift estimate and the local offset are kept in NVS,
+//   so a cold boot starts from an estimate in local time instead of 1970 UTC.
+
+#define TIME_SNTP_SERVER        "pool.ntp.org"
+#define TIME_SLEW_MAX_US        2000000     // larger corrections are stepped
+#define TIME_SLEW_RATE_PPM      5000        // 5 ms of correction per second
+#define TIME_DRIFT_MIN_SPAN_S   600         // shortest sync interval used for drift
+#define TIME_DRIFT_MAX_PPB      500000
+
+typedef enum {
+    TIME_UNSET,
+    TIME_ESTIMATED,     // restored at boot, not synced yet
+    TIME_SYNCED,
+} time_quality_t;
+
+// After nvs_flash_init(). Restores the persisted epoch, drift and offset.
+void time_service_init(void);
+// Called from the IP event; starts SNTP or asks for an immediate sync.
+void time_service_on_ip(void);
+
+// Local time offset from UTC, e.g. geo_info.offset_sec; persisted when it changes
+void time_service_set_offset(long offset_sec);
+
+// Local time (UTC + offset). False, and *out untouched, while the time is unknown.
+bool time_service_now(time_t* out);
+time_quality_t time_service_quality(void);
+// For the shutdown snapshot: UTC seconds and the local offset. False while unset.
+bool time_service_save(int64_t* utc_s, long* offset_s);
+// After time_service_init(): a saved clock newer than what NVS had becomes the
+// estimate. A synced clock is left alone.
+void time_service_resume(int64_t utc_s, long offset_s);
+int32_t time_service_drift_ppb(void);
+
+#endif /* TIME_SERVICE */
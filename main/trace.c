@@ -0,0 +1,293 @@
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_attr.h>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <sdkconfig.h>
+
+#define TRACE_HDR_LEN   4
+#define REC_HDR_LEN     7
+#define DUMP_LINE       32
+
+typedef enum {
+    TRACE_IDLE,
+    TRACE_RECORDING,
+    TRACE_LOADING,
+    TRACE_REPLAYING,
+} trace_state_t;
+
+static const char* TAG = "trace";
+static const uint8_t s_magic[TRACE_HDR_LEN] = { 'T', 'R', 'C', 1 };
+
+static uint8_t* s_buf = NULL;
+static size_t s_len = 0;
+static trace_state_t s_state = TRACE_IDLE;
+static int64_t s_start_us = 0;
+static bool s_overflow = false;
+static portMUX_TYPE s_trace_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Loader: pending high nibble, or -1. A line with anything but hex in it (the
+// TRACE BEGIN / END markers, log output) is dropped again at its end.
+static int s_nibble = -1;
+static size_t s_line_start = 0;
+static bool s_line_bad = false;
+
+// Replay: event cursor plus one cursor per HTTP type so bodies are handed out in
+// recorded order whenever the fetch code asks for them
+static size_t s_replay_pos = 0;
+static size_t s_http_pos[TRACE_HTTP_GEO + 1];
+
+static volatile uint32_t s_allocs = 0;
+
+#if CONFIG_HEAP_USE_HOOKS
+void IRAM_ATTR esp_heap_trace_alloc_hook(void* ptr, size_t size, uint32_t caps)
+{
+    __atomic_fetch_add(&s_allocs, 1, __ATOMIC_RELAXED);
+}
+
+void IRAM_ATTR esp_heap_trace_free_hook(void* ptr)
+{
+}
+#endif
+
+uint32_t trace_alloc_count(void)
+{
+    return s_allocs;
+}
+
+static bool ensure_buf(void)
+{
+    if (!s_buf) s_buf = malloc(TRACE_BUF_SIZE);
+    return s_buf != NULL;
+}
+
+esp_err_t trace_record_start(void)
+{
+    if (s_state != TRACE_IDLE) return ESP_ERR_INVALID_STATE;
+    if (!ensure_buf()) return ESP_ERR_NO_MEM;
+
+    taskENTER_CRITICAL(&s_trace_lock);
+    memcpy(s_buf, s_magic, TRACE_HDR_LEN);
+    s_len = TRACE_HDR_LEN;
+    s_overflow = false;
+    s_start_us = esp_timer_get_time();
+    s_state = TRACE_RECORDING;
+    taskEXIT_CRITICAL(&s_trace_lock);
+    ESP_LOGI(TAG, "Recording");
+    return ESP_OK;
+}
+
+void trace_record_stop(void)
+{
+    if (s_state != TRACE_RECORDING) return;
+    s_state = TRACE_IDLE;
+    ESP_LOGI(TAG, "Recorded %u bytes in %lu ms%s", (unsigned)s_len,
+             (unsigned long)trace_duration_ms(), s_overflow ? " (buffer full, events dropped)" : "");
+}
+
+bool trace_recording(void)
+{
+    return s_state == TRACE_RECORDING;
+}
+
+void trace_record(trace_type_t type, const void* data, size_t len)
+{
+    if (s_state != TRACE_RECORDING || len > UINT16_MAX) return;
+    const uint32_t t_ms = (uint32_t)((esp_timer_get_time() - s_start_us) / 1000);
+
+    // The copy is at most a few KB and only happens while recording
+    taskENTER_CRITICAL(&s_trace_lock);
+    if (s_state == TRACE_RECORDING && s_len + REC_HDR_LEN + len <= TRACE_BUF_SIZE) {
+        uint8_t* p = s_buf + s_len;
+        p[0] = t_ms;
+        p[1] = t_ms >> 8;
+        p[2] = t_ms >> 16;
+        p[3] = t_ms >> 24;
+        p[4] = type;
+        p[5] = len;
+        p[6] = len >> 8;
+        memcpy(p + REC_HDR_LEN, data, len);
+        s_len += REC_HDR_LEN + len;
+    } else {
+        s_overflow = true;
+    }
+    taskEXIT_CRITICAL(&s_trace_lock);
+}
+
+void trace_dump(void)
+{
+    if (!s_buf || s_len < TRACE_HDR_LEN || s_state == TRACE_RECORDING || s_state == TRACE_LOADING) {
+        printf("TRACE EMPTY\n");
+        return;
+    }
+    printf("TRACE BEGIN %u\n", (unsigned)s_len);
+    for (size_t i = 0; i < s_len; i += DUMP_LINE) {
+        const size_t n = (s_len - i < DUMP_LINE) ? s_len - i : DUMP_LINE;
+        for (size_t j = 0; j < n; j++) printf("%02x", s_buf[i + j]);
+        printf("\n");
+    }
+    printf("TRACE END\n");
+}
+
+void trace_load_begin(void)
+{
+    if (s_state != TRACE_IDLE || !ensure_buf()) return;
+    s_len = 0;
+    s_nibble = -1;
+    s_line_start = 0;
+    s_line_bad = false;
+    s_state = TRACE_LOADING;
+    printf("Send the trace as hex, end with '.'\n");
+}
+
+bool trace_loading(void)
+{
+    return s_state == TRACE_LOADING;
+}
+
+static int hex_value(uint8_t c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static void load_end_line(void)
+{
+    if (s_line_bad) s_len = s_line_start;
+    s_line_start = s_len;
+    s_line_bad = false;
+    s_nibble = -1;
+}
+
+bool trace_load_feed(const uint8_t* data, size_t len)
+{
+    if (s_state != TRACE_LOADING) return false;
+
+    for (size_t i = 0; i < len; i++) {
+        const uint8_t c = data[i];
+        if (c == '.') {
+            load_end_line();
+            s_state = TRACE_IDLE;
+            if (s_len < TRACE_HDR_LEN || memcmp(s_buf, s_magic, TRACE_HDR_LEN) != 0) {
+                ESP_LOGW(TAG, "Not a trace (%u bytes)", (unsigned)s_len);
+                s_len = 0;
+            } else {
+                ESP_LOGI(TAG, "Loaded %u bytes, %lu ms", (unsigned)s_len, (unsigned long)trace_duration_ms());
+            }
+            return false;
+        }
+        if (c == '\n' || c == '\r') {
+            load_end_line();
+            continue;
+        }
+        const int v = hex_value(c);
+        if (v < 0) {
+            if (c != ' ' && c != '\t') s_line_bad = true;
+            continue;
+        }
+        if (s_nibble < 0) {
+            s_nibble = v;
+        } else if (s_len < TRACE_BUF_SIZE) {
+            s_buf[s_len++] = (uint8_t)((s_nibble << 4) | v);
+            s_nibble = -1;
+        } else {
+            s_nibble = -1;
+        }
+    }
+    return true;
+}
+
+esp_err_t trace_load(const void* data, size_t len)
+{
+    if (s_state != TRACE_IDLE) return ESP_ERR_INVALID_STATE;
+    if (len < TRACE_HDR_LEN || len > TRACE_BUF_SIZE || memcmp(data, s_magic, TRACE_HDR_LEN) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!ensure_buf()) return ESP_ERR_NO_MEM;
+    memcpy(s_buf, data, len);
+    s_len = len;
+    ESP_LOGI(TAG, "Loaded %u bytes, %lu ms", (unsigned)s_len, (unsigned long)trace_duration_ms());
+    return ESP_OK;
+}
+
+// Parses the record at *pos, advancing past it. False at the end or on a record
+// that runs past the buffer.
+static bool read_record(size_t* pos, trace_event_t* ev)
+{
+    const size_t p = *pos;
+    if (p + REC_HDR_LEN > s_len) return false;
+    const uint8_t* h = s_buf + p;
+    ev->t_ms = h[0] | (h[1] << 8) | (h[2] << 16) | ((uint32_t)h[3] << 24);
+    ev->type = (trace_type_t)h[4];
+    ev->len = h[5] | (h[6] << 8);
+    if (p + REC_HDR_LEN + ev->len > s_len) return false;
+    ev->data = h + REC_HDR_LEN;
+    *pos = p + REC_HDR_LEN + ev->len;
+    return true;
+}
+
+uint32_t trace_duration_ms(void)
+{
+    if (s_state == TRACE_RECORDING) return (uint32_t)((esp_timer_get_time() - s_start_us) / 1000);
+
+    uint32_t last = 0;
+    trace_event_t ev;
+    size_t pos = TRACE_HDR_LEN;
+    while (read_record(&pos, &ev)) last = ev.t_ms;
+    return last;
+}
+
+bool trace_replay_begin(void)
+{
+    if (s_state != TRACE_IDLE || !s_buf || s_len < TRACE_HDR_LEN ||
+        memcmp(s_buf, s_magic, TRACE_HDR_LEN) != 0) {
+        return false;
+    }
+    s_replay_pos = TRACE_HDR_LEN;
+    for (size_t i = 0; i < sizeof(s_http_pos) / sizeof(s_http_pos[0]); i++) s_http_pos[i] = TRACE_HDR_LEN;
+    s_state = TRACE_REPLAYING;
+    return true;
+}
+
+bool trace_replay_next(trace_event_t* ev)
+{
+    if (s_state != TRACE_REPLAYING) return false;
+    while (read_record(&s_replay_pos, ev)) {
+        if (ev->type == TRACE_KEY || ev->type == TRACE_DHT20) return true;
+    }
+    return false;
+}
+
+void trace_replay_end(void)
+{
+    if (s_state == TRACE_REPLAYING) s_state = TRACE_IDLE;
+}
+
+bool trace_replaying(void)
+{
+    return s_state == TRACE_REPLAYING;
+}
+
+bool trace_replay_http(trace_type_t type, char* out, size_t out_sz, int* len)
+{
+    if (s_state != TRACE_REPLAYING || (type != TRACE_HTTP_WEATHER && type != TRACE_HTTP_GEO) || out_sz == 0) {
+        return false;
+    }
+    trace_event_t ev;
+    while (read_record(&s_http_pos[type], &ev)) {
+        if (ev.type != type) continue;
+        const size_t n = (ev.len < out_sz - 1) ? ev.len : out_sz - 1;
+        memcpy(out, ev.data, n);
+        out[n] = '\0';
+        *len = (int)n;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,69 @@
+#ifndef TRACE
+#define TRACE
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+// Session recorder for performance regression runs. While recording, the UART key
+// bytes, raw DHT20 frames and the weather / geo HTTP bodies are appended to a RAM
+// buffer with millisecond timestamps. The trace can be dumped as hex over the UART
+// (trace_tool.py turns that into a file) and loaded back the same way, and the UI
+// replays it as fast as it can: keys go through handle_input, frames through the
+// DHT20 decoder, and fetches are answered from the recorded bodies.
+//
+// Layout: "TRC" 0x01, then records [u32 t_ms][u8 type][u16 len] data[len], little
+// endian, t_ms counted from the start of the recording.
+
+#define TRACE_ENABLED       1
+#define TRACE_BUF_SIZE      (16 * 1024)
+
+// UART commands (after COMMAND_PREFIX_KEY), ignored while a replay is running
+#define TRACE_RECORD_KEY    'r'     // start / stop recording
+#define TRACE_DUMP_KEY      'x'     // print the trace as hex
+#define TRACE_LOAD_KEY      'l'     // read a trace as hex, up to a '.'
+#define TRACE_REPLAY_KEY    'p'
+
+typedef enum {
+    TRACE_KEY = 1,          // bytes read from the UART in one go
+    TRACE_DHT20,            // the sensor's 7 byte answer
+    TRACE_HTTP_WEATHER,     // response body
+    TRACE_HTTP_GEO,
+} trace_type_t;
+
+typedef struct {
+    uint32_t t_ms;
+    trace_type_t type;
+    uint16_t len;
+    const uint8_t* data;    // points into the trace buffer
+} trace_event_t;
+
+esp_err_t trace_record_start(void);
+void trace_record_stop(void);
+bool trace_recording(void);
+// No-op unless recording. Safe from any task.
+void trace_record(trace_type_t type, const void* data, size_t len);
+
+void trace_dump(void);
+void trace_load_begin(void);
+bool trace_loading(void);
+// Feeds UART bytes while loading; returns false once the closing '.' was seen.
+bool trace_load_feed(const uint8_t* data, size_t len);
+// Takes a whole binary trace (a trace_tool.py file) at once, for the host replay
+esp_err_t trace_load(const void* data, size_t len);
+
+// Replay cursor. Keys and sensor frames come out of trace_replay_next in order;
+// HTTP bodies are taken on demand by the fetch code through trace_replay_http.
+bool trace_replay_begin(void);
+bool trace_replay_next(trace_event_t* ev);
+void trace_replay_end(void);
+bool trace_replaying(void);
+// Copies the next recorded body of `type`. False if there is none left.
+bool trace_replay_http(trace_type_t type, char* out, size_t out_sz, int* len);
+uint32_t trace_duration_ms(void);
+
+// Heap allocations since boot, counted by the heap hooks (CONFIG_HEAP_USE_HOOKS)
+uint32_t trace_alloc_count(void);
+
+#endif /* TRACE */
@@ -1,30 +1,77 @@
 #include "weather.h"
+#include <esp_timer.h>
+#include "http_body.h"
+#include "latency.h"
+#include "trace.h"
 
 #define WEATHER_API_KEY API_KEY
+#define WEATHER_BODY_MAX 2048
+
+// Query string escaping; the settings only allow a few punctuation characters
+static void url_encode(const char *in, char *out, size_t out_sz) {
+    static const char hex[] = "0123456789ABCDEF";
+    size_t n = 0;
+    for (; *in && n + 4 <= out_sz; in++) {
+        const unsigned char c = (unsigned char)*in;
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+            c == '-' || c == '.' || c == '_' || c == '~') {
+            out[n++] = (char)c;
+        } else {
+            out[n++] = '%';
+            out[n++] = hex[c >> 4];
+            out[n++] = hex[c & 0xF];
+        }
+    }
+    out[n] = '\0';
+}
+
+// Body of a 200 reply, NUL terminated; hands the result to update_ui either way
+static void parse_city(const char *body, int total, weather_update_callback_t update_ui) {
+    WeatherInfo info;
+    weather_parse_city(body, total, &info);
+    update_ui(&info);
+}
+
+// Answers from the trace being replayed, no network involved
+static esp_err_t replay_city(weather_update_callback_t update_ui) {
+    char *buffer = malloc(WEATHER_BODY_MAX + 1);
+    if (!buffer) return ESP_ERR_NO_MEM;
 
-static void capitalize_first(char *s) {
-    if (s && s[0] >= 'a' && s[0] <= 'z') {
-        s[0] = (char)(s[0] - 'a' + 'A');
+    int total = 0;
+    esp_err_t err = ESP_OK;
+    if (trace_replay_http(TRACE_HTTP_WEATHER, buffer, WEATHER_BODY_MAX + 1, &total)) {
+        parse_city(buffer, total, update_ui);
+    } else {
+        WeatherInfo info = { .ok = false };
+        strlcpy(info.err, "Not in trace", sizeof(info.err));
+        update_ui(&info);
+        err = ESP_ERR_NOT_FOUND;
     }
+    free(buffer);
+    return err;
 }
 
-esp_err_t weather_fetch_city(const char *city, weather_update_callback_t update_ui) {
+static esp_err_t fetch_city(const char *city, weather_update_callback_t update_ui) {
     if (!city || !update_ui) return ESP_ERR_INVALID_ARG;
+    if (trace_replaying()) return replay_city(update_ui);
 
-    char url[256];
-    // TODO: URL-encode `city` if needed.
+    char q[96], url[256];
+    url_encode(city, q, sizeof(q));
     snprintf(url, sizeof(url),
              "http://api.openweathermap.org/data/2.5/weather?q=%s&units=metric&appid=%s",
-             city, WEATHER_API_KEY);
+             q, WEATHER_API_KEY);
 
     esp_http_client_config_t config = {
         .url = url,
         .method = HTTP_METHOD_GET,
         .timeout_ms = 10000
     };
+    http_body_t body;
+    http_body_config(&config, &body);
 
     esp_http_client_handle_t client = esp_http_client_init(&config);
     if (!client) return ESP_FAIL;
+    http_body_request(client);
 
     esp_err_t err = esp_http_client_open(client, 0);
     if (err != ESP_OK) {
@@ -45,7 +92,7 @@ esp_err_t weather_fetch_city(const char *city, weather_update_callback_t update_
     int status = esp_http_client_get_status_code(client);
     ESP_LOGI("weather", "status=%d, content_len=%lld", status, clen);
 
-    char *buffer = calloc(1, 2048 + 1);
+    char *buffer = calloc(1, WEATHER_BODY_MAX + 1);
     if (!buffer) {
         esp_http_client_close(client);
         esp_http_client_cleanup(client);
@@ -53,16 +100,15 @@ esp_err_t weather_fetch_city(const char *city, weather_update_callback_t update_
     }
 
     int total = 0;
-    while (1) {
-        int r = esp_http_client_read(client, buffer + total, 2048 - total);
-        if (r <= 0) break;
-        total += r;
-        if (total >= 2048) break;
+    err = http_body_read(client, &body, buffer, WEATHER_BODY_MAX + 1, &total);
+    if (err != ESP_OK) {
+        ESP_LOGE("weather", "body read failed: %s", esp_err_to_name(err));
+        total = 0; // parse_city reports the empty body
     }
-
-    WeatherInfo info = {0};
+    http_body_log("weather", &body);
 
     if (status != 200) {
+        WeatherInfo info = {0};
         info.ok = false;
         snprintf(info.err, sizeof(info.err), "HTTP error %d", status);
         update_ui(&info);
@@ -72,53 +118,98 @@ esp_err_t weather_fetch_city(const char *city, weather_update_callback_t update_
         return ESP_FAIL;
     }
 
-    if (total > 0) {
-        buffer[total] = '\0';
-
-        cJSON *root = cJSON_Parse(buffer);
-        if (root) {
-            cJSON *main = cJSON_GetObjectItem(root, "main");
-            cJSON *temp = main ? cJSON_GetObjectItem(main, "temp") : NULL;
-            cJSON *feels = main ? cJSON_GetObjectItem(main, "feels_like") : NULL;
-            cJSON *tmin = main ? cJSON_GetObjectItem(main, "temp_min") : NULL;
-            cJSON *tmax = main ? cJSON_GetObjectItem(main, "temp_max") : NULL;
-            cJSON *hum  = main ? cJSON_GetObjectItem(main, "humidity") : NULL;
-
-            cJSON *wind = cJSON_GetObjectItem(root, "wind");
-            cJSON *wspd = wind ? cJSON_GetObjectItem(wind, "speed") : NULL;
-
-            cJSON *weather = cJSON_GetObjectItem(root, "weather");
-            cJSON *w0 = (weather && cJSON_IsArray(weather)) ? cJSON_GetArrayItem(weather, 0) : NULL;
-            cJSON *desc = w0 ? cJSON_GetObjectItem(w0, "description") : NULL;
-
-            // assume `desc` is a cJSON* for the "description" field
-            const char* desc_str = cJSON_GetStringValue(desc);
-            strlcpy(info.desc, desc_str ? desc_str : "", sizeof(info.desc));
-            capitalize_first(info.desc);
-
-            info.ok = true;
-            info.temp_c  = (temp && cJSON_IsNumber(temp)) ? (int)lround(temp->valuedouble) : 0;
-            info.feels_c  = (feels && cJSON_IsNumber(feels)) ? (int)lround(feels->valuedouble) : 0;
-            info.tmin_c = (tmin && cJSON_IsNumber(tmin)) ? (int)lround(tmin->valuedouble) : 0;
-            info.tmax_c = (tmax && cJSON_IsNumber(tmax)) ? (int)lround(tmax->valuedouble) : 0;
-            info.wind_kmh  = (wspd && cJSON_IsNumber(wspd)) ? (int)lround(wspd->valuedouble * 3.6) : 0;
-            info.hum_pct  = (hum && cJSON_IsNumber(hum)) ? hum->valueint : 0;
-
-            update_ui(&info);
-
-            cJSON_Delete(root);
-        } else {
-            info.ok = false;
-            strlcpy(info.err, "JSON parse error", sizeof(info.err));
-            update_ui(&info);
-        }
-    } else {
-        info.ok = false;
-        strlcpy(info.err, "HTTP no body", sizeof(info.err));
-        update_ui(&info);
-    }
+    trace_record(TRACE_HTTP_WEATHER, buffer, total);
+    parse_city(buffer, total, update_ui);
     free(buffer);
     esp_http_client_close(client);
     esp_http_client_cleanup(client);
     return ESP_OK;
-}
\ No newline at end of file
+}
+
+typedef struct {
+    forecast_parser_t parser;
+    int64_t parse_us;
+} forecast_sink_t;
+
+static bool forecast_sink(void *ctx, const uint8_t *data, size_t len) {
+    forecast_sink_t *sink = ctx;
+    int64_t t0 = esp_timer_get_time();
+    bool ok = forecast_parser_feed(&sink->parser, (const char *)data, len);
+    sink->parse_us += esp_timer_get_time() - t0;
+    return ok;
+}
+
+// The /forecast body is ~16 KB, far more than is worth buffering: it goes through the
+// streaming parser a chunk at a time, so the heap used here is the chunk. It is not
+// asked for gzip: inflating it would need the 32 KB window (~43 KB with the state).
+static esp_err_t fetch_forecast(const char *city, forecast_t *out) {
+    if (!city || !out) return ESP_ERR_INVALID_ARG;
+    if (trace_replaying()) return ESP_ERR_NOT_SUPPORTED; // not recorded
+
+    char q[96], url[256];
+    url_encode(city, q, sizeof(q));
+    snprintf(url, sizeof(url),
+             "http://api.openweathermap.org/data/2.5/forecast?q=%s&units=metric&appid=%s",
+             q, WEATHER_API_KEY);
+
+    esp_http_client_config_t config = {
+        .url = url,
+        .method = HTTP_METHOD_GET,
+        .timeout_ms = 10000
+    };
+    http_body_t body;
+    http_body_config(&config, &body);
+
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (!client) return ESP_FAIL;
+
+    char *chunk = malloc(FORECAST_CHUNK);
+    if (!chunk) {
+        esp_http_client_cleanup(client);
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t err = esp_http_client_open(client, 0);
+    int64_t clen = (err == ESP_OK) ? esp_http_client_fetch_headers(client) : -1;
+    int status = (clen >= 0) ? esp_http_client_get_status_code(client) : 0;
+    if (err != ESP_OK || clen < 0 || status != 200) {
+        ESP_LOGE("weather", "forecast failed: %s, status=%d", esp_err_to_name(err), status);
+        err = (err != ESP_OK) ? err : ESP_FAIL;
+        goto done;
+    }
+
+    forecast_sink_t sink = { .parse_us = 0 };
+    forecast_parser_init(&sink.parser, out);
+    err = http_body_stream(client, &body, chunk, FORECAST_CHUNK, forecast_sink, &sink);
+    http_body_log("forecast", &body);
+
+    if (err != ESP_OK || !forecast_parser_finish(&sink.parser)) {
+        ESP_LOGE("weather", "forecast body bad after %lu bytes: %s",
+                 (unsigned long)body.body_bytes, esp_err_to_name(err));
+        err = ESP_ERR_INVALID_RESPONSE;
+        goto done;
+    }
+    ESP_LOGI("weather", "forecast: %u entries from %lu bytes, parsed in %lld us",
+             out->count, (unsigned long)body.body_bytes, (long long)sink.parse_us);
+    err = (out->count > 0) ? ESP_OK : ESP_ERR_NOT_FOUND;
+
+done:
+    free(chunk);
+    esp_http_client_close(client);
+    esp_http_client_cleanup(client);
+    return err;
+}
+
+esp_err_t weather_fetch_city(const char *city, weather_update_callback_t update_ui) {
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t err = fetch_city(city, update_ui);
+    if (!trace_replaying()) latency_record(LAT_HTTP_WEATHER, (uint32_t)(esp_timer_get_time() - t0));
+    return err;
+}
+
+esp_err_t weather_fetch_forecast(const char *city, forecast_t *out) {
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t err = fetch_forecast(city, out);
+    latency_record(LAT_HTTP_FORECAST, (uint32_t)(esp_timer_get_time() - t0));
+    return err;
+}
@@ -2,11 +2,14 @@
 #define WEATHER
 
 #include <esp_http_client.h>
-#include <math.h>
 #include <cJSON.h>
 #include "wifi.h"
+#include "fixed.h"
+#include "forecast.h"
 #include "secrets.h"
 
+#define FORECAST_CHUNK 512 // HTTP read size while streaming the forecast
+
 typedef struct {
     bool ok;
     char err[64];
@@ -25,5 +28,10 @@ typedef struct {
 typedef void (*weather_update_callback_t)(const WeatherInfo* w);
 
 esp_err_t weather_fetch_city(const char *city, weather_update_callback_t update_ui);
+// Body of a 200 reply of /weather, NUL terminated, total bytes long (weather_parse.c)
+void weather_parse_city(const char *body, int total, WeatherInfo *out);
+// 5 day / 3 hour forecast, parsed while it downloads. Fetched uncompressed so the peak
+// heap stays at FORECAST_CHUNK: a gzip body would need a ~43 KB inflate window.
+esp_err_t weather_fetch_forecast(const char *city, forecast_t *out);
 
 #endif /* WEATHER */
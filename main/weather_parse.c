@@ -0,0 +1,63 @@
+#include "weather.h"
+#include <string.h>
+
+// The current weather reply, apart from the fetch so the host replay parses it too
+
+// cJSON only hands out doubles: round once to hundredths and stay in integers after
+static int32_t json_centi(const cJSON *n) {
+    if (!n || !cJSON_IsNumber(n)) return 0;
+    double d = n->valuedouble * 100.0;
+    return (int32_t)(d < 0 ? d - 0.5 : d + 0.5);
+}
+
+static void capitalize_first(char *s) {
+    if (s && s[0] >= 'a' && s[0] <= 'z') {
+        s[0] = (char)(s[0] - 'a' + 'A');
+    }
+}
+
+void weather_parse_city(const char *body, int total, WeatherInfo *out) {
+    WeatherInfo info = {0};
+
+    if (total > 0) {
+        cJSON *root = cJSON_Parse(body);
+        if (root) {
+            cJSON *main = cJSON_GetObjectItem(root, "main");
+            cJSON *temp = main ? cJSON_GetObjectItem(main, "temp") : NULL;
+            cJSON *feels = main ? cJSON_GetObjectItem(main, "feels_like") : NULL;
+            cJSON *tmin = main ? cJSON_GetObjectItem(main, "temp_min") : NULL;
+            cJSON *tmax = main ? cJSON_GetObjectItem(main, "temp_max") : NULL;
+            cJSON *hum  = main ? cJSON_GetObjectItem(main, "humidity") : NULL;
+
+            cJSON *wind = cJSON_GetObjectItem(root, "wind");
+            cJSON *wspd = wind ? cJSON_GetObjectItem(wind, "speed") : NULL;
+
+            cJSON *weather = cJSON_GetObjectItem(root, "weather");
+            cJSON *w0 = (weather && cJSON_IsArray(weather)) ? cJSON_GetArrayItem(weather, 0) : NULL;
+            cJSON *desc = w0 ? cJSON_GetObjectItem(w0, "description") : NULL;
+
+            // assume `desc` is a cJSON* for the "description" field
+            const char* desc_str = cJSON_GetStringValue(desc);
+            strlcpy(info.desc, desc_str ? desc_str : "", sizeof(info.desc));
+            capitalize_first(info.desc);
+
+            info.ok = true;
+            info.temp_c  = (int)fixed_round_centi(json_centi(temp));
+            info.feels_c  = (int)fixed_round_centi(json_centi(feels));
+            info.tmin_c = (int)fixed_round_centi(json_centi(tmin));
+            info.tmax_c = (int)fixed_round_centi(json_centi(tmax));
+            int32_t wspd_centi = json_centi(wspd); // m/s
+            info.wind_kmh  = (wspd_centi > 0) ? (unsigned)((wspd_centi * 36 + 500) / 1000) : 0;
+            info.hum_pct  = (hum && cJSON_IsNumber(hum)) ? hum->valueint : 0;
+
+            cJSON_Delete(root);
+        } else {
+            info.ok = false;
+            strlcpy(info.err, "JSON parse error", sizeof(info.err));
+        }
+    } else {
+        info.ok = false;
+        strlcpy(info.err, "HTTP no body", sizeof(info.err));
+    }
+    *out = info;
+}
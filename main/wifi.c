@@ -1,21 +1,118 @@
 #include "wifi.h"
+#include <string.h>
+#include "time_service.h"
+#include "connectivity.h"
+#include "latency.h"
+#include <esp_timer.h>
+
+#define WIFI_SCAN_DONE (1 << 2)
+
+typedef enum {
+    LINK_IDLE,
+    LINK_CONNECTING,
+    LINK_UP,
+} link_state_t;
 
 static uint8_t tries = 0;
+static uint8_t max_tries = WIFI_RETRIES_PER_AP;
+static link_state_t link_state = LINK_IDLE;
 static EventGroupHandle_t wifi_event_group;
+static bool s_started = false;
+
+// Written on the event loop task, copied out by readers
+static wifi_scan_result_t s_scan;
+static portMUX_TYPE s_scan_lock = portMUX_INITIALIZER_UNLOCKED;
 
 static void wifi_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
 static void ip_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
 
+static esp_err_t scan_channel(uint8_t channel) {
+    wifi_scan_config_t cfg = {
+        .channel = channel,
+        .show_hidden = false,
+        .scan_type = WIFI_SCAN_TYPE_ACTIVE,
+        .scan_time.active = { .min = 0, .max = WIFI_SCAN_DWELL_MS },
+    };
+    return esp_wifi_scan_start(&cfg, false);
+}
+
+// Keep one entry per SSID, its strongest AP, with the table sorted strongest first
+static void scan_merge(const wifi_ap_record_t* rec, bool known) {
+    int i = 0;
+    while (i < s_scan.count && strcmp(s_scan.aps[i].ssid, (const char*)rec->ssid) != 0) i++;
+    if (i < s_scan.count) {
+        if (rec->rssi <= s_scan.aps[i].rssi) return;
+    } else if (s_scan.count < WIFI_SCAN_MAX) {
+        i = s_scan.count++;
+    } else if (rec->rssi > s_scan.aps[WIFI_SCAN_MAX - 1].rssi) {
+        i = WIFI_SCAN_MAX - 1;
+    } else {
+        return;
+    }
+
+    wifi_scan_ap_t ap = { .rssi = rec->rssi, .channel = rec->primary, .authmode = rec->authmode, .known = known };
+    strlcpy(ap.ssid, (const char*)rec->ssid, sizeof(ap.ssid));
+    memcpy(ap.bssid, rec->bssid, sizeof(ap.bssid));
+
+    // Bubble up into place
+    while (i > 0 && s_scan.aps[i - 1].rssi < ap.rssi) {
+        s_scan.aps[i] = s_scan.aps[i - 1];
+        i--;
+    }
+    s_scan.aps[i] = ap;
+}
+
+// One channel finished: fold its records in and move on to the next
+static void on_scan_done(void) {
+    wifi_ap_record_t rec;
+    while (esp_wifi_scan_get_ap_record(&rec) == ESP_OK) {
+        if (!rec.ssid[0]) continue;
+        bool known = wifi_store_find((const char*)rec.ssid, NULL);
+        taskENTER_CRITICAL(&s_scan_lock);
+        scan_merge(&rec, known);
+        taskEXIT_CRITICAL(&s_scan_lock);
+    }
+    esp_wifi_clear_ap_list();
+
+    taskENTER_CRITICAL(&s_scan_lock);
+    uint8_t next = s_scan.channel + 1;
+    s_scan.channel = next;
+    s_scan.running = (next <= WIFI_SCAN_LAST_CHANNEL);
+    s_scan.generation++;
+    taskEXIT_CRITICAL(&s_scan_lock);
+
+    if (next <= WIFI_SCAN_LAST_CHANNEL && scan_channel(next) == ESP_OK) return;
+
+    taskENTER_CRITICAL(&s_scan_lock);
+    s_scan.running = false;
+    s_scan.generation++;
+    taskEXIT_CRITICAL(&s_scan_lock);
+    xEventGroupSetBits(wifi_event_group, WIFI_SCAN_DONE);
+}
+
 static void wifi_event_handler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data){
-    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START){
-        ESP_LOGI(WIFI_TAG, "Connecting to AP...");
-        esp_wifi_connect();
-    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED){
-        if (tries < MAX_FAILURES){
+    if (event_base != WIFI_EVENT) return;
+
+    if (event_id == WIFI_EVENT_SCAN_DONE) {
+        on_scan_done();
+    } else if (event_id == WIFI_EVENT_STA_CONNECTED) {
+        connectivity_on_link(true);
+    } else if (event_id == WIFI_EVENT_STA_DISCONNECTED){
+        connectivity_on_link(false);
+        if (link_state == LINK_UP) {
+            // Dropped after being up: retry the same AP harder than a first attempt
+            link_state = LINK_CONNECTING;
+            tries = 0;
+            max_tries = MAX_FAILURES;
+        }
+        if (link_state != LINK_CONNECTING) return; // we hung up ourselves
+
+        if (tries < max_tries){
             ESP_LOGI(WIFI_TAG, "Reconnecting to AP...");
             esp_wifi_connect();
             tries++;
         } else {
+            link_state = LINK_IDLE;
             xEventGroupSetBits(wifi_event_group, WIFI_FAILURE);
         }
     }
@@ -27,15 +124,21 @@ static void ip_event_handler(void* arg, esp_event_base_t event_base, int32_t eve
         ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
         ESP_LOGI(WIFI_TAG, "STA IP: " IPSTR, IP2STR(&event->ip_info.ip));
         tries = 0;
+        link_state = LINK_UP;
+        connectivity_on_ip(true);
+        time_service_on_ip();
         xEventGroupSetBits(wifi_event_group, WIFI_SUCCESS);
+    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_LOST_IP) {
+        connectivity_on_ip(false);
     }
 }
 
-//use ret and esp_loge to gracefeully handle errors, wifi errors are not fatal.
-esp_err_t connect_wifi(void){
-	int status = WIFI_FAILURE;
+// Bring up the driver once, without connecting, so scans can run on their own
+static esp_err_t wifi_start_once(void) {
+    if (s_started) return ESP_OK;
+
+    wifi_store_init();
 
-	/** INITIALIZE ALL THE THINGS **/
 	//initialize the esp network interface
 	ESP_ERROR_CHECK(esp_netif_init());
 
@@ -52,41 +155,24 @@ esp_err_t connect_wifi(void){
     /** EVENT LOOP **/
 	wifi_event_group = xEventGroupCreate();
 
-    esp_event_handler_instance_t wifi_handler_event_instance;
+    // Registered for good: reconnects and scans need them after connect_wifi returns
     ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT,
                                                         ESP_EVENT_ANY_ID,
                                                         &wifi_event_handler,
                                                         NULL,
-                                                        &wifi_handler_event_instance));
+                                                        NULL));
 
-    esp_event_handler_instance_t got_ip_event_instance;
     ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT,
-                                                        IP_EVENT_STA_GOT_IP,
+                                                        ESP_EVENT_ANY_ID,
                                                         &ip_event_handler,
                                                         NULL,
-                                                        &got_ip_event_instance));
-
-    /** START THE WIFI DRIVER **/
-    wifi_config_t wifi_config = {
-        .sta = {
-            .ssid = WIFI_SSID,
-            .password = WIFI_PASSWORD,
-	     .threshold.authmode = WIFI_AUTH_WPA2_PSK,
-            .pmf_cfg = {
-                .capable = true,
-                .required = false
-            },
-        },
-    };
+                                                        NULL));
 
     esp_wifi_set_ps(WIFI_PS_NONE);
 
     // set the wifi controller to be a station
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
 
-    // set the wifi config
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
-
     // set the bandwidth to HT40
     ESP_ERROR_CHECK(esp_wifi_set_bandwidth(WIFI_IF_STA, WIFI_BW_HT40));
 
@@ -94,6 +180,73 @@ esp_err_t connect_wifi(void){
     ESP_ERROR_CHECK(esp_wifi_start());
 
     ESP_LOGI(WIFI_TAG, "STA initialization complete");
+    s_started = true;
+    return ESP_OK;
+}
+
+esp_err_t wifi_scan_start(void) {
+    wifi_start_once();
+
+    taskENTER_CRITICAL(&s_scan_lock);
+    bool busy = s_scan.running;
+    if (!busy) {
+        uint32_t gen = s_scan.generation + 1;
+        memset(&s_scan, 0, sizeof(s_scan));
+        s_scan.generation = gen;
+        s_scan.running = true;
+        s_scan.channel = 1;
+    }
+    taskEXIT_CRITICAL(&s_scan_lock);
+    if (busy) return ESP_ERR_INVALID_STATE;
+
+    xEventGroupClearBits(wifi_event_group, WIFI_SCAN_DONE);
+    esp_err_t err = scan_channel(1);
+    if (err != ESP_OK) {
+        ESP_LOGE(WIFI_TAG, "scan start failed: %s", esp_err_to_name(err));
+        taskENTER_CRITICAL(&s_scan_lock);
+        s_scan.running = false;
+        s_scan.generation++;
+        taskEXIT_CRITICAL(&s_scan_lock);
+        xEventGroupSetBits(wifi_event_group, WIFI_SCAN_DONE);
+    }
+    return err;
+}
+
+void wifi_scan_get(wifi_scan_result_t* out) {
+    taskENTER_CRITICAL(&s_scan_lock);
+    *out = s_scan;
+    taskEXIT_CRITICAL(&s_scan_lock);
+}
+
+uint32_t wifi_scan_generation(void) {
+    return s_scan.generation;
+}
+
+// One AP, pinned by BSSID and channel so the driver does not scan again
+static bool try_ap(const wifi_scan_ap_t* ap, const wifi_cred_t* cred) {
+    wifi_config_t wifi_config = {
+        .sta = {
+            .threshold.authmode = cred->pass[0] ? WIFI_AUTH_WPA2_PSK : WIFI_AUTH_OPEN,
+            .channel = ap->channel,
+            .bssid_set = true,
+            .pmf_cfg = {
+                .capable = true,
+                .required = false
+            },
+        },
+    };
+    strlcpy((char*)wifi_config.sta.ssid, cred->ssid, sizeof(wifi_config.sta.ssid));
+    strlcpy((char*)wifi_config.sta.password, cred->pass, sizeof(wifi_config.sta.password));
+    memcpy(wifi_config.sta.bssid, ap->bssid, sizeof(ap->bssid));
+
+    ESP_LOGI(WIFI_TAG, "Connecting to %s (%d dBm, ch %u)", ap->ssid, ap->rssi, ap->channel);
+    if (esp_wifi_set_config(WIFI_IF_STA, &wifi_config) != ESP_OK) return false;
+
+    xEventGroupClearBits(wifi_event_group, WIFI_SUCCESS | WIFI_FAILURE);
+    tries = 0;
+    max_tries = WIFI_RETRIES_PER_AP;
+    link_state = LINK_CONNECTING;
+    esp_wifi_connect();
 
     /** NOW WE WAIT **/
     EventBits_t bits = xEventGroupWaitBits(wifi_event_group,
@@ -101,30 +254,50 @@ esp_err_t connect_wifi(void){
             pdFALSE,
             pdFALSE,
             portMAX_DELAY);
+    if (bits & WIFI_SUCCESS) return true;
 
-    /* xEventGroupWaitBits() returns the bits before the call returned, hence we can test which event actually
-     * happened. */
-    if (bits & WIFI_SUCCESS) {
-        ESP_LOGI(WIFI_TAG, "Connected to ap");
+    link_state = LINK_IDLE;
+    esp_wifi_disconnect();
+    return false;
+}
 
-        wifi_ap_record_t ap_info;
-        if (esp_wifi_sta_get_ap_info(&ap_info) == ESP_OK) {
-            ESP_LOGI("WIFI", "RSSI: %d dBm", ap_info.rssi);
-        }
+//use ret and esp_loge to gracefeully handle errors, wifi errors are not fatal.
+static esp_err_t connect_best(void){
+    wifi_start_once();
+    if (link_state == LINK_UP) return WIFI_SUCCESS;
 
-        status = WIFI_SUCCESS;
-    } else if (bits & WIFI_FAILURE) {
-        ESP_LOGI(WIFI_TAG, "Failed to connect to ap");
-        status = WIFI_FAILURE;
-    } else {
-        ESP_LOGE(WIFI_TAG, "UNEXPECTED EVENT");
-        status = WIFI_FAILURE;
+    // Use the scan the UI may already have running, or start one
+    wifi_scan_start();
+    xEventGroupWaitBits(wifi_event_group, WIFI_SCAN_DONE, pdFALSE, pdFALSE,
+                        pdMS_TO_TICKS(WIFI_SCAN_TIMEOUT_MS));
+
+    static wifi_scan_result_t scan; // only connect_wifi uses it, keeps it off the stack
+    wifi_scan_get(&scan);
+
+    // Strongest known first; the table is already sorted by RSSI
+    for (int i = 0; i < scan.count; i++) {
+        wifi_cred_t cred;
+        if (!scan.aps[i].known || !wifi_store_find(scan.aps[i].ssid, &cred)) continue;
+        if (try_ap(&scan.aps[i], &cred)) {
+            ESP_LOGI(WIFI_TAG, "Connected to ap");
+
+            wifi_ap_record_t ap_info;
+            if (esp_wifi_sta_get_ap_info(&ap_info) == ESP_OK) {
+                ESP_LOGI("WIFI", "RSSI: %d dBm", ap_info.rssi);
+            }
+            return WIFI_SUCCESS;
+        }
+        ESP_LOGI(WIFI_TAG, "Failed to connect to %s", scan.aps[i].ssid);
     }
 
-    /* The event will not be processed after unregister */
-    ESP_ERROR_CHECK(esp_event_handler_instance_unregister(IP_EVENT, IP_EVENT_STA_GOT_IP, got_ip_event_instance));
-    ESP_ERROR_CHECK(esp_event_handler_instance_unregister(WIFI_EVENT, ESP_EVENT_ANY_ID, wifi_handler_event_instance));
-    vEventGroupDelete(wifi_event_group);
+    ESP_LOGI(WIFI_TAG, "No known network reachable (%u seen, %u known)",
+             scan.count, (unsigned)wifi_store_count());
+    return WIFI_FAILURE;
+}
 
+esp_err_t connect_wifi(void){
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t status = connect_best();
+    latency_record(LAT_WIFI_CONNECT, (uint32_t)(esp_timer_get_time() - t0));
     return status;
-}
\ No newline at end of file
+}
@@ -5,6 +5,7 @@
 #include <esp_log.h>              // For logging
 
 #include "wifi_config.h"
+#include "wifi_store.h"
 
 #define WIFI_TAG "WIFI"
 typedef void (*update_screenf_callback_t)(const char* fmt, ...);
@@ -17,6 +18,40 @@ typedef enum {
     MAX_FAILURES = 10
 } wifi_status_t;
 
+// Reconnects per candidate AP before connect_wifi moves on to the next one
+#define WIFI_RETRIES_PER_AP     2
+// Channels are scanned one at a time so results come in as each finishes
+#define WIFI_SCAN_LAST_CHANNEL  13
+#define WIFI_SCAN_DWELL_MS      120
+#define WIFI_SCAN_TIMEOUT_MS    5000
+#define WIFI_SCAN_MAX           12
+
+typedef struct {
+    char ssid[WIFI_SSID_MAX];
+    uint8_t bssid[6];           // strongest AP seen for this SSID
+    int8_t rssi;
+    uint8_t channel;
+    wifi_auth_mode_t authmode;
+    bool known;                 // in the credential store
+} wifi_scan_ap_t;
+
+typedef struct {
+    uint32_t generation;        // bumps whenever anything below changes
+    bool running;
+    uint8_t channel;            // being scanned while running
+    uint8_t count;
+    wifi_scan_ap_t aps[WIFI_SCAN_MAX]; // strongest first, one per SSID
+} wifi_scan_result_t;
+
+// Scans, then tries the known networks in the scan from strongest to weakest.
+// Blocks until one gives an IP or all have failed.
 esp_err_t connect_wifi(void);
 
+// Starts a scan in the background; results are merged in per channel.
+// ESP_ERR_INVALID_STATE if one is already running.
+esp_err_t wifi_scan_start(void);
+// Consistent copy of the scan table, safe from any task
+void wifi_scan_get(wifi_scan_result_t* out);
+uint32_t wifi_scan_generation(void);
+
 #endif /* WIFI */
@@ -0,0 +1,166 @@
+#include "wifi_store.h"
+#include <stdio.h>
+#include <string.h>
+
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <nvs.h>
+
+#include "wifi_config.h"
+
+#define WIFI_STORE_TAG "WIFI_STORE"
+#define NVS_NS "wifi"
+#define NVS_KEY "nets"
+
+typedef struct {
+    uint8_t count;
+    wifi_cred_t nets[WIFI_STORE_MAX];
+} store_t;
+
+static store_t s_store;
+static portMUX_TYPE s_store_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static int find_locked(const char* ssid)
+{
+    for (int i = 0; i < s_store.count; i++) {
+        if (strcmp(s_store.nets[i].ssid, ssid) == 0) return i;
+    }
+    return -1;
+}
+
+// Writers all run on the UI task, so the copy taken here is the latest
+static esp_err_t persist(void)
+{
+    store_t copy;
+    taskENTER_CRITICAL(&s_store_lock);
+    copy = s_store;
+    taskEXIT_CRITICAL(&s_store_lock);
+
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(NVS_NS, NVS_READWRITE, &h);
+    if (err != ESP_OK) return err;
+    err = nvs_set_blob(h, NVS_KEY, &copy, sizeof(copy));
+    if (err == ESP_OK) err = nvs_commit(h);
+    nvs_close(h);
+    return err;
+}
+
+void wifi_store_init(void)
+{
+    store_t loaded = {0};
+    size_t len = sizeof(loaded);
+    nvs_handle_t h;
+    bool ok = false;
+    if (nvs_open(NVS_NS, NVS_READONLY, &h) == ESP_OK) {
+        ok = (nvs_get_blob(h, NVS_KEY, &loaded, &len) == ESP_OK && len == sizeof(loaded) &&
+              loaded.count <= WIFI_STORE_MAX);
+        nvs_close(h);
+    }
+
+    if (ok) {
+        taskENTER_CRITICAL(&s_store_lock);
+        s_store = loaded;
+        taskEXIT_CRITICAL(&s_store_lock);
+    } else if (WIFI_SSID[0]) {
+        wifi_store_add(WIFI_SSID, WIFI_PASSWORD);
+    }
+    ESP_LOGI(WIFI_STORE_TAG, "%u known networks", (unsigned)wifi_store_count());
+}
+
+bool wifi_store_find(const char* ssid, wifi_cred_t* out)
+{
+    taskENTER_CRITICAL(&s_store_lock);
+    int i = find_locked(ssid);
+    if (i >= 0 && out) *out = s_store.nets[i];
+    taskEXIT_CRITICAL(&s_store_lock);
+    return i >= 0;
+}
+
+size_t wifi_store_count(void)
+{
+    return s_store.count;
+}
+
+esp_err_t wifi_store_add(const char* ssid, const char* pass)
+{
+    if (!ssid || !ssid[0] || strlen(ssid) >= WIFI_SSID_MAX) return ESP_ERR_INVALID_ARG;
+    if (!pass || strlen(pass) >= WIFI_PASS_MAX) return ESP_ERR_INVALID_ARG;
+
+    wifi_cred_t cred = {0};
+    strlcpy(cred.ssid, ssid, sizeof(cred.ssid));
+    strlcpy(cred.pass, pass, sizeof(cred.pass));
+
+    taskENTER_CRITICAL(&s_store_lock);
+    int i = find_locked(ssid);
+    if (i < 0) i = (s_store.count < WIFI_STORE_MAX) ? s_store.count++ : WIFI_STORE_MAX - 1;
+    memmove(&s_store.nets[1], &s_store.nets[0], i * sizeof(wifi_cred_t));
+    s_store.nets[0] = cred;
+    taskEXIT_CRITICAL(&s_store_lock);
+
+    return persist();
+}
+
+esp_err_t wifi_store_remove(const char* ssid)
+{
+    taskENTER_CRITICAL(&s_store_lock);
+    int i = find_locked(ssid);
+    if (i >= 0) {
+        memmove(&s_store.nets[i], &s_store.nets[i + 1], (s_store.count - i - 1) * sizeof(wifi_cred_t));
+        s_store.count--;
+        memset(&s_store.nets[s_store.count], 0, sizeof(wifi_cred_t));
+    }
+    taskEXIT_CRITICAL(&s_store_lock);
+
+    return (i >= 0) ? persist() : ESP_ERR_NOT_FOUND;
+}
+
+// One SSID: a word, or "double quoted" when it has spaces
+static bool console_ssid(const char** line, char* out)
+{
+    const char* p = *line;
+    while (*p == ' ') p++;
+    const char end = (*p == '"') ? '"' : ' ';
+    if (end == '"') p++;
+    size_t n = 0;
+    while (p[n] && p[n] != end) n++;
+    if (n == 0 || n >= WIFI_SSID_MAX || (end == '"' && p[n] != '"')) return false;
+    memcpy(out, p, n);
+    out[n] = '\0';
+    p += n + (p[n] ? 1 : 0);
+    while (*p == ' ') p++;
+    *line = p;
+    return true;
+}
+
+void wifi_store_console(const char* line)
+{
+    char cmd[8] = {0}, ssid[WIFI_SSID_MAX];
+    int used = 0;
+    sscanf(line, " %7s %n", cmd, &used);
+    const char* rest = line + used;
+
+    if (strcmp(cmd, "list") == 0) {
+        store_t copy;
+        taskENTER_CRITICAL(&s_store_lock);
+        copy = s_store;
+        taskEXIT_CRITICAL(&s_store_lock);
+        for (int i = 0; i < copy.count; i++) {
+            printf("%d \"%s\"%s\n", i + 1, copy.nets[i].ssid, copy.nets[i].pass[0] ? "" : "  (open)");
+        }
+        printf("%u of %d known networks\n", (unsigned)copy.count, WIFI_STORE_MAX);
+        return;
+    }
+    const bool add = strcmp(cmd, "add") == 0;
+    const bool rm = strcmp(cmd, "rm") == 0;
+    if ((!add && !rm) || !console_ssid(&rest, ssid)) {
+        printf("usage: wifi list | wifi add <ssid> [password] | wifi rm <ssid>, \"quote\" an ssid with spaces\n");
+        return;
+    }
+
+    // The password is the rest of the line, spaces and all; none for an open network
+    esp_err_t err = add ? wifi_store_add(ssid, rest) : wifi_store_remove(ssid);
+    if (err == ESP_OK) printf("%s \"%s\"\n", add ? "saved" : "removed", ssid);
+    else if (err == ESP_ERR_NOT_FOUND) printf("\"%s\" is not a known network\n", ssid);
+    else if (err == ESP_ERR_INVALID_ARG) printf("password longer than %d characters\n", WIFI_PASS_MAX - 1);
+    else printf("not saved: %s\n", esp_err_to_name(err));
+}
@@ -0,0 +1,35 @@
+#ifndef WIFI_STORE
+#define WIFI_STORE
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <esp_err.h>
+
+// Known networks, kept in NVS as one blob and cached in RAM. The first boot seeds it
+// with WIFI_SSID / WIFI_PASSWORD from wifi_config.h.
+
+#define WIFI_STORE_MAX      8
+#define WIFI_SSID_MAX       33  // 32 + NUL
+#define WIFI_PASS_MAX       65  // 64 + NUL
+
+typedef struct {
+    char ssid[WIFI_SSID_MAX];
+    char pass[WIFI_PASS_MAX];
+} wifi_cred_t;
+
+// After nvs_flash_init()
+void wifi_store_init(void);
+
+// Safe from any task. out may be NULL to only test membership.
+bool wifi_store_find(const char* ssid, wifi_cred_t* out);
+size_t wifi_store_count(void);
+
+// Adds or updates a network, most recent first; the oldest is dropped when full.
+esp_err_t wifi_store_add(const char* ssid, const char* pass);
+esp_err_t wifi_store_remove(const char* ssid);
+
+// One console line after "wifi": "list", "add <ssid> [password]", "rm <ssid>".
+// Runs on the UI task like the other writers.
+void wifi_store_console(const char* line);
+
+#endif /* WIFI_STORE */
@@ -0,0 +1,144 @@
+import socket
+import struct
+import sys
+import time
+
+# Viewer for the device's remote display mirror (main/mirror.c).
+# Usage: python mirror_viewer.py <device-ip> [port] [--ascii]
+
+WIDTH = 128
+HEIGHT = 64
+TILES_X = 16
+TILE_COUNT = 128
+MASK_SIZE = TILE_COUNT // 8
+SCALE = 4
+
+
+def recv_exact(sock, n):
+    buf = b""
+    while len(buf) < n:
+        chunk = sock.recv(n - len(buf))
+        if not chunk:
+            raise ConnectionError("device closed the connection")
+        buf += chunk
+    return buf
+
+
+def rle_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        c = data[i]
+        i += 1
+        if c < 128:
+            out += data[i:i + c + 1]
+            i += c + 1
+        else:
+            out += bytes([data[i]]) * (c - 125)
+            i += 1
+    return out
+
+
+def apply_message(fb, payload):
+    frame_no = struct.unpack_from("<H", payload, 0)[0]
+    mask = payload[2:2 + MASK_SIZE]
+    tiles = rle_decode(payload[2 + MASK_SIZE:])
+    pos = 0
+    for t in range(TILE_COUNT):
+        if mask[t // 8] & (1 << (t % 8)):
+            off = (t // TILES_X) * WIDTH + (t % TILES_X) * 8
+            fb[off:off + 8] = tiles[pos:pos + 8]
+            pos += 8
+    return frame_no
+
+
+def pixel(fb, x, y):
+    return (fb[(y // 8) * WIDTH + x] >> (y % 8)) & 1
+
+
+def print_ascii(fb):
+    lines = []
+    for y in range(0, HEIGHT, 2):
+        row = ""
+        for x in range(WIDTH):
+            top, bottom = pixel(fb, x, y), pixel(fb, x, y + 1)
+            row += " ▀▄█"[top | (bottom << 1)]
+        lines.append(row)
+    sys.stdout.write("\x1b[H" + "\n".join(lines) + "\n")
+    sys.stdout.flush()
+
+
+def main():
+    args = [a for a in sys.argv[1:] if not a.startswith("--")]
+    if not args:
+        print("usage: mirror_viewer.py <device-ip> [port] [--ascii]")
+        return
+    host = args[0]
+    port = int(args[1]) if len(args) > 1 else 3333
+    ascii_mode = "--ascii" in sys.argv
+
+    sock = socket.create_connection((host, port))
+    print(f"Connected to {host}:{port}")
+    fb = bytearray(WIDTH * HEIGHT // 8)
+
+    canvas = image = root = None
+    if not ascii_mode:
+        import tkinter as tk
+        root = tk.Tk()
+        root.title(f"Mirror {host}")
+        image = tk.PhotoImage(width=WIDTH * SCALE, height=HEIGHT * SCALE)
+        canvas = tk.Label(root, image=image)
+        canvas.pack()
+    else:
+        sys.stdout.write("\x1b[2J")
+
+    total_bytes = 0
+    frames = 0
+    started = time.time()
+
+    def step():
+        nonlocal total_bytes, frames
+        header = recv_exact(sock, 3)
+        kind = chr(header[0])
+        length = struct.unpack_from("<H", header, 1)[0]
+        payload = recv_exact(sock, length)
+        total_bytes += 3 + length
+        frames += 1
+        frame_no = apply_message(fb, payload)
+
+        if ascii_mode:
+            print_ascii(fb)
+        else:
+            rows = []
+            for y in range(HEIGHT):
+                row = " ".join("#ffffff" if pixel(fb, x, y) else "#000000"
+                               for x in range(WIDTH) for _ in range(SCALE))
+                rows.extend(["{" + row + "}"] * SCALE)
+            image.put(" ".join(rows))
+
+        elapsed = max(time.time() - started, 1e-3)
+        status = (f"{kind} frame {frame_no}: {3 + length} B, "
+                  f"avg {total_bytes / frames:.0f} B/frame, {total_bytes / elapsed:.0f} B/s")
+        if ascii_mode:
+            sys.stdout.write(status + "\x1b[K\n")
+        else:
+            root.title(status)
+
+    try:
+        if ascii_mode:
+            while True:
+                step()
+        else:
+            def pump():
+                step()
+                root.after(1, pump)
+            root.after(1, pump)
+            root.mainloop()
+    except (KeyboardInterrupt, ConnectionError) as e:
+        print(f"\n{e}" if isinstance(e, ConnectionError) else "")
+    finally:
+        sock.close()
+
+
+if __name__ == "__main__":
+    main()
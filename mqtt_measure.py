@@ -0,0 +1,112 @@
+import struct
+import sys
+import threading
+import time
+
+import paho.mqtt.client as mqtt
+
+# Measures the batches main/mqtt_pub.c publishes, for tuning the "mqtt_batch" and
+# "mqtt_age_s" settings. Needs paho-mqtt (pip install paho-mqtt) and the broker the
+# device publishes to (MQTT_BROKER_URI):
+#   python mqtt_measure.py <broker-host> [port] [interval_s]
+# Every interval it prints, per device, the batches and batches/s, the samples per
+# batch, the payload bytes per sample (the 7 byte header spread over the batch) and
+# the time covered by a batch, plus repeats (a republish after a lost PUBACK, or a
+# backlog resent) and skipped batch numbers. Change a setting on the device console,
+# typing `: then "set mqtt_batch 10", and watch the next interval.
+
+TOPIC = "esp32-humidity/+/samples"
+HDR = 7             # [u16 batch_no][u32 base_time][u8 count]
+RECORD = 6 + 6      # history record, then the climate record
+
+
+class Device:
+    def __init__(self):
+        self.last_no = None
+        self.reset()
+
+    def reset(self):
+        self.batches = 0
+        self.samples = 0
+        self.bytes = 0
+        self.span_s = 0
+        self.repeats = 0
+        self.skipped = 0
+        self.bad = 0
+
+
+devices = {}
+lock = threading.Lock()     # on_message runs on the paho thread
+
+
+def on_message(client, userdata, msg):
+    with lock:
+        count_batch(msg.topic.split("/")[1], msg.payload)
+
+
+def count_batch(mac, data):
+    dev = devices.setdefault(mac, Device())
+    if len(data) < HDR:
+        dev.bad += 1
+        return
+    batch_no, _, count = struct.unpack_from("<HIB", data)
+    if len(data) != HDR + count * RECORD or count == 0:
+        dev.bad += 1
+        return
+    last_dt = struct.unpack_from("<H", data, HDR + (count - 1) * 6)[0]
+
+    # Batch numbers are u16 and wrap; anything not ahead of the last one was seen
+    step = 1 if dev.last_no is None else (batch_no - dev.last_no) & 0xFFFF
+    if step == 0 or step >= 0x8000:
+        dev.repeats += 1
+    else:
+        dev.skipped += step - 1
+        dev.last_no = batch_no
+    dev.batches += 1
+    dev.samples += count
+    dev.bytes += len(data)
+    dev.span_s += last_dt
+
+
+def report(interval):
+    for mac, dev in sorted(devices.items()):
+        if dev.batches == 0:
+            print(f"{mac}: no batches")
+            continue
+        print(f"{mac}: {dev.batches} batches, {dev.batches / interval:.3f}/s, "
+              f"{dev.samples / dev.batches:.1f} samples/batch, "
+              f"{dev.bytes / dev.samples:.2f} B/sample, {dev.bytes / interval:.1f} B/s, "
+              f"{dev.span_s / dev.batches:.0f} s/batch, "
+              f"repeats {dev.repeats}, skipped {dev.skipped}, bad {dev.bad}")
+        dev.reset()
+    sys.stdout.flush()
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit("usage: python mqtt_measure.py <broker-host> [port] [interval_s]")
+    host = sys.argv[1]
+    port = int(sys.argv[2]) if len(sys.argv) > 2 else 1883
+    interval = float(sys.argv[3]) if len(sys.argv) > 3 else 300
+
+    if hasattr(mqtt, "CallbackAPIVersion"):     # paho-mqtt 2.x
+        client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION1)
+    else:
+        client = mqtt.Client()
+    client.on_connect = lambda c, u, f, rc: c.subscribe(TOPIC, qos=1)
+    client.on_message = on_message
+    client.connect(host, port)
+    client.loop_start()
+    print(f"subscribed to {TOPIC} on {host}:{port}, reporting every {interval:g} s")
+    try:
+        while True:
+            time.sleep(interval)
+            with lock:
+                report(interval)
+    except KeyboardInterrupt:
+        pass
+    client.loop_stop()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,40 @@
+import hashlib
+import os
+import sys
+import zlib
+
+# Packs an app image for the device's OTA client (main/ota.c): a zlib stream plus a
+# sha256sum-style file holding the hash of the uncompressed image.
+# Usage: python ota_pack.py [build/esp32-mobile.bin] [out_dir]
+# Then serve out_dir, e.g. python -m http.server 8000, and point OTA_IMAGE_URL at
+# http://<host>:8000/firmware.bin.zz
+
+IMAGE_NAME = "firmware.bin.zz"
+
+
+def main():
+    src = sys.argv[1] if len(sys.argv) > 1 else os.path.join("build", "esp32-mobile.bin")
+    out_dir = sys.argv[2] if len(sys.argv) > 2 else "ota"
+
+    with open(src, "rb") as f:
+        image = f.read()
+    if not image or image[0] != 0xE9:
+        sys.exit(f"{src} does not look like an app image")
+
+    packed = zlib.compress(image, 9)
+    digest = hashlib.sha256(image).hexdigest()
+
+    os.makedirs(out_dir, exist_ok=True)
+    out = os.path.join(out_dir, IMAGE_NAME)
+    with open(out, "wb") as f:
+        f.write(packed)
+    with open(out + ".sha256", "w") as f:
+        f.write(f"{digest}  {os.path.basename(src)}\n")
+
+    print(f"{src}: {len(image)} -> {len(packed)} bytes ({100 * len(packed) // len(image)}%)")
+    print(f"sha256 {digest}")
+    print(f"wrote {out} and {out}.sha256")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,33 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+// Host timing for the bench_* programs. Numbers are for relative comparison on the
+// build machine, not cycle counts on the C6.
+
+static inline uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Keeps the compiler from dropping a result
+static volatile uint32_t bench_sink;
+
+// Best of `runs` timings of `iters` calls of `body`, in ns per call
+#define BENCH_NS(result, runs, iters, body) do { \
+    double best_ = 1e30; \
+    for (int r_ = 0; r_ < (runs); r_++) { \
+        uint64_t t0_ = bench_now_ns(); \
+        for (long i_ = 0; i_ < (iters); i_++) { body; } \
+        double ns_ = (double)(bench_now_ns() - t0_) / (double)(iters); \
+        if (ns_ < best_) best_ = ns_; \
+    } \
+    (result) = best_; \
+} while (0)
+
+#endif /* BENCH_H */
@@ -0,0 +1,60 @@
+// Per-sample cost of the derived metrics: climate_compute on changing readings,
+// climate_update on a repeated one (the common case at one sample per second), and
+// the libm float formulas the integer code replaces.
+//
+// The host has an FPU, so the float column understates the C6 cost, where expf/logf
+// and every float operation are soft-float library calls.
+#include <math.h>
+
+#include "bench.h"
+#include "climate.h"
+
+#define RUNS 5
+#define ITERS 1000000
+
+// Keeps the inputs from being compile-time constants
+static volatile uint32_t s_seed = 12345;
+
+static void float_climate(float t, float rh, climate_t* out)
+{
+    float es = 611.2f * expf(17.62f * t / (243.12f + t));
+    float g = logf(rh / 100.0f) + 17.62f * t / (243.12f + t);
+    out->dew_point_centi_c = (centi_c_t)lroundf(24312.0f * g / (17.62f - g));
+    out->abs_hum_centi_g_m3 = (uint16_t)lroundf(216.74f * es * rh / 100.0f / (273.15f + t));
+
+    float tf = t * 1.8f + 32.0f;
+    float hi = 0.5f * (tf + 61.0f + (tf - 68.0f) * 1.2f + rh * 0.094f);
+    if ((hi + tf) / 2.0f >= 80.0f) {
+        hi = -42.379f + 2.04901523f * tf + 10.14333127f * rh - 0.22475541f * tf * rh
+             - 0.00683783f * tf * tf - 0.05481717f * rh * rh + 0.00122874f * tf * tf * rh
+             + 0.00085282f * tf * rh * rh - 0.00000199f * tf * tf * rh * rh;
+    }
+    out->heat_index_centi_c = (centi_c_t)lroundf((hi - 32.0f) * 500.0f / 9.0f);
+}
+
+int main(void)
+{
+    uint32_t seed = s_seed;
+    climate_t c;
+    double t_compute, t_update, t_float;
+
+    // Indoor range: 15..35 C, 20..90 %RH
+    BENCH_NS(t_compute, RUNS, ITERS, {
+        uint32_t x = seed + (uint32_t)i_ * 2654435761u;
+        climate_compute((centi_c_t)(1500 + x % 2000), (centi_pct_t)(2000 + (x >> 11) % 7000), &c);
+        bench_sink += (uint16_t)c.dew_point_centi_c + (uint16_t)c.heat_index_centi_c + c.abs_hum_centi_g_m3;
+    });
+    BENCH_NS(t_update, RUNS, ITERS, {
+        climate_update((centi_c_t)(2512 + (seed & 1)), 5534, &c);
+        bench_sink += (uint16_t)c.dew_point_centi_c;
+    });
+    BENCH_NS(t_float, RUNS, ITERS, {
+        uint32_t x = seed + (uint32_t)i_ * 2654435761u;
+        float_climate((1500 + x % 2000) / 100.0f, (2000 + (x >> 11) % 7000) / 100.0f, &c);
+        bench_sink += (uint16_t)c.dew_point_centi_c + (uint16_t)c.heat_index_centi_c + c.abs_hum_centi_g_m3;
+    });
+
+    printf("per sample: climate_compute %.1f ns, climate_update (repeat) %.1f ns, libm float %.1f ns\n",
+           t_compute, t_update, t_float);
+    return 0;
+}
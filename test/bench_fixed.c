@@ -0,0 +1,45 @@
+// DHT20 conversion cost: the fixed-point path against the float path it replaced.
+//
+// The float path is the old dht20_read/dht20_publish code: double scaling, then
+// lroundf(x * 100.0f). The host has an FPU, so this understates the gap on the C6,
+// where every double operation is a soft-float library call.
+#include <math.h>
+
+#include "bench.h"
+#include "fixed.h"
+
+#define RUNS 5
+#define ITERS 4000000
+
+// Keeps raw from being a compile-time constant
+static volatile uint32_t s_raw_seed = 0x5A5A5;
+
+static int16_t float_temp(uint32_t raw)
+{
+    float t = (float)((raw * 200.0) / (1 << 20) - 50.0);
+    return (int16_t)lroundf(t * 100.0f);
+}
+
+static uint16_t float_hum(uint32_t raw)
+{
+    float h = (float)((raw * 100.0) / (1 << 20));
+    return (uint16_t)lroundf(h * 100.0f);
+}
+
+int main(void)
+{
+    uint32_t seed = s_raw_seed;
+    double t_float, t_fixed;
+
+    BENCH_NS(t_float, RUNS, ITERS, {
+        uint32_t raw = (seed + (uint32_t)i_ * 2654435761u) & 0xFFFFF;
+        bench_sink += (uint16_t)float_temp(raw) + float_hum(raw);
+    });
+    BENCH_NS(t_fixed, RUNS, ITERS, {
+        uint32_t raw = (seed + (uint32_t)i_ * 2654435761u) & 0xFFFFF;
+        bench_sink += (uint16_t)fixed_temp_from_raw20(raw) + fixed_hum_from_raw20(raw);
+    });
+
+    printf("temp+hum per reading: float %.2f ns, fixed %.2f ns (%.1fx)\n", t_float, t_fixed, t_float / t_fixed);
+    return 0;
+}
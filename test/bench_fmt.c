@@ -0,0 +1,80 @@
+// Render-path text cost: fmt against the printf paths it replaced.
+//
+// Weather: the old code did snprintf into a temporary, then update_screenf("%s")
+// ran vsnprintf again to copy it into the layout text. IP line: one snprintf with
+// the address octets and a centi value split into "%d.%02d".
+#include <stdarg.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "fmt.h"
+
+#define RUNS 5
+#define ITERS 2000000
+
+// The old 64 byte temporary, truncation included
+#pragma GCC diagnostic ignored "-Wformat-truncation"
+
+static char s_text[256];
+
+static void __attribute__((noinline)) screenf(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    vsnprintf(s_text, sizeof(s_text), format, args);
+    va_end(args);
+}
+
+static const char* s_descs[] = { "overcast clouds", "light snow showers with wind gusts", "clear sky" };
+
+int main(void)
+{
+    double t_printf, t_fmt;
+
+    BENCH_NS(t_printf, RUNS, ITERS, {
+        const int t = (int)(i_ & 63) - 30;
+        char msg[64];
+        snprintf(msg, sizeof(msg), "T:%dC F:%dC H:%u%%\nMin:%dC Max:%dC\nW:%u KM/H\n%.*s",
+                 t, t - 3, (unsigned)(i_ % 100), t - 5, t + 4, (unsigned)(i_ % 90), 24, s_descs[i_ % 3]);
+        screenf("%s", msg);
+        bench_sink += (uint8_t)s_text[3];
+    });
+    BENCH_NS(t_fmt, RUNS, ITERS, {
+        const int t = (int)(i_ & 63) - 30;
+        fmt_t f;
+        fmt_init(&f, s_text, sizeof(s_text));
+        fmt_str(&f, "T:");      fmt_int(&f, t);
+        fmt_str(&f, "C F:");    fmt_int(&f, t - 3);
+        fmt_str(&f, "C H:");    fmt_uint(&f, (uint32_t)(i_ % 100));
+        fmt_str(&f, "%\nMin:"); fmt_int(&f, t - 5);
+        fmt_str(&f, "C Max:");  fmt_int(&f, t + 4);
+        fmt_str(&f, "C\nW:");   fmt_uint(&f, (uint32_t)(i_ % 90));
+        fmt_str(&f, " KM/H\n"); fmt_strn(&f, s_descs[i_ % 3], 24);
+        bench_sink += (uint8_t)s_text[3];
+    });
+    printf("weather text: snprintf + \"%%s\" copy %.1f ns, fmt %.1f ns (%.1fx)\n", t_printf, t_fmt, t_printf / t_fmt);
+
+    BENCH_NS(t_printf, RUNS, ITERS, {
+        const uint32_t ip = 0x0A01A8C0u + ((uint32_t)i_ << 24);
+        const int centi = (int)(i_ % 4000) - 1000;
+        const int a = abs(centi);
+        snprintf(s_text, sizeof(s_text), "IP: %u.%u.%u.%u\nT: %s%d.%02d C",
+                 (unsigned)(ip & 0xFF), (unsigned)((ip >> 8) & 0xFF), (unsigned)((ip >> 16) & 0xFF),
+                 (unsigned)(ip >> 24), centi < 0 ? "-" : "", a / 100, a % 100);
+        bench_sink += (uint8_t)s_text[5];
+    });
+    BENCH_NS(t_fmt, RUNS, ITERS, {
+        const uint32_t ip = 0x0A01A8C0u + ((uint32_t)i_ << 24);
+        const int centi = (int)(i_ % 4000) - 1000;
+        fmt_t f;
+        fmt_init(&f, s_text, sizeof(s_text));
+        fmt_str(&f, "IP: ");
+        fmt_ip4(&f, ip);
+        fmt_str(&f, "\nT: ");
+        fmt_fixed(&f, centi, 2);
+        fmt_str(&f, " C");
+        bench_sink += (uint8_t)s_text[5];
+    });
+    printf("IP + fixed point line: snprintf %.1f ns, fmt %.1f ns (%.1fx)\n", t_printf, t_fmt, t_printf / t_fmt);
+    return 0;
+}
@@ -0,0 +1,57 @@
+// Forecast parse speed on the fixture bodies (test/data), fed in the 512 byte reads
+// weather_fetch_forecast uses and one byte at a time.
+#include <stdlib.h>
+
+#include "bench.h"
+#include "forecast.h"
+
+#define RUNS 5
+#define ITERS 2000
+
+static const char* const s_fixtures[] = { "forecast_montreal", "forecast_tokyo" };
+static forecast_t s_out;
+
+static char* read_body(const char* name, size_t* len)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s.json", TEST_DATA_DIR, name);
+    FILE* fp = fopen(path, "rb");
+    if (!fp) {
+        fprintf(stderr, "cannot open %s\n", path);
+        exit(2);
+    }
+    fseek(fp, 0, SEEK_END);
+    *len = (size_t)ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char* buf = malloc(*len);
+    if (!buf || fread(buf, 1, *len, fp) != *len) exit(2);
+    fclose(fp);
+    return buf;
+}
+
+static void parse(const char* body, size_t len, size_t chunk)
+{
+    forecast_parser_t p;
+    forecast_parser_init(&p, &s_out);
+    for (size_t off = 0; off < len; off += chunk) {
+        forecast_parser_feed(&p, body + off, (len - off < chunk) ? len - off : chunk);
+    }
+    bench_sink += forecast_parser_finish(&p) + s_out.count;
+}
+
+int main(void)
+{
+    printf("sizeof(forecast_parser_t) = %zu, sizeof(forecast_t) = %zu\n", sizeof(forecast_parser_t), sizeof(forecast_t));
+    for (size_t i = 0; i < sizeof(s_fixtures) / sizeof(s_fixtures[0]); i++) {
+        size_t len;
+        char* body = read_body(s_fixtures[i], &len);
+        double t512, t1;
+
+        BENCH_NS(t512, RUNS, ITERS, parse(body, len, 512));
+        BENCH_NS(t1, RUNS, ITERS, parse(body, len, 1));
+        printf("%s (%zu bytes): %.1f us per body at 512 B reads (%.0f MB/s), %.1f us at 1 B (%.0f MB/s)\n",
+               s_fixtures[i], len, t512 / 1000, len / t512 * 1000, t1 / 1000, len / t1 * 1000);
+        free(body);
+    }
+    return 0;
+}
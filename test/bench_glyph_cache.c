@@ -0,0 +1,120 @@
+// Text rendering cost with and without the glyph cache.
+//
+// Built against the stub u8g2 and a synthetic font with ncenB08-like glyph sizes,
+// this compares cache hits with a one-slot cache that re-runs the RLE decode for
+// every glyph, which is the work u8g2_DrawStr does per character. When the u8g2
+// submodule is checked out, bench_glyph_cache_u8g2 (same file, BENCH_STOCK_U8G2)
+// times the real u8g2_DrawStr on the firmware's fonts and checks the buffers match.
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "glyph_cache.h"
+
+#define RUNS 5
+#define ITERS 200000
+
+static const char* const s_lines[] = {
+    "Temp: 23.45 C",
+    "Hum: 45.67 %",
+    "Montreal: -3.50 C",
+    "192.168.1.42",
+};
+#define LINE_COUNT (sizeof(s_lines) / sizeof(s_lines[0]))
+
+#if BENCH_STOCK_U8G2
+
+static u8g2_t s_u8g2;
+
+static void bench_font(const char* name, const uint8_t* font, uint16_t slots)
+{
+    static uint8_t stock[1024];
+    double t_stock, t_cache;
+
+    glyph_cache_register(font, slots);
+    u8g2_SetFont(&s_u8g2, font);
+
+    BENCH_NS(t_stock, RUNS, ITERS, {
+        bench_sink += u8g2_DrawStr(&s_u8g2, 0, 30, s_lines[i_ % LINE_COUNT]);
+    });
+    BENCH_NS(t_cache, RUNS, ITERS, {
+        bench_sink += glyph_cache_draw_str(&s_u8g2, 0, 30, s_lines[i_ % LINE_COUNT]);
+    });
+
+    // Same pixels either way
+    int mismatches = 0;
+    for (size_t l = 0; l < LINE_COUNT; l++) {
+        u8g2_ClearBuffer(&s_u8g2);
+        u8g2_DrawStr(&s_u8g2, 3, 20, s_lines[l]);
+        memcpy(stock, u8g2_GetBufferPtr(&s_u8g2), sizeof(stock));
+        u8g2_ClearBuffer(&s_u8g2);
+        glyph_cache_draw_str(&s_u8g2, 3, 20, s_lines[l]);
+        if (memcmp(stock, u8g2_GetBufferPtr(&s_u8g2), sizeof(stock)) != 0) mismatches++;
+    }
+
+    printf("%-10s u8g2_DrawStr %7.1f ns/line  cached %7.1f ns/line  %.1fx  %s\n",
+           name, t_stock, t_cache, t_stock / t_cache, mismatches ? "PIXELS DIFFER" : "pixels match");
+}
+
+int main(void)
+{
+    u8g2_Setup_ssd1309_128x64_noname2_f(&s_u8g2, U8G2_R0, u8x8_byte_empty, u8x8_dummy_cb);
+    bench_font("ncenB08", u8g2_font_ncenB08_tr, 96);
+    bench_font("ncenB12", u8g2_font_ncenB12_tr, 64);
+    bench_font("5x8", u8g2_font_5x8_tr, 96);
+    return 0;
+}
+
+#else
+
+#include "synth_font.h"
+
+u8g2_uint_t u8g2_DrawStr(u8g2_t* u8g2, u8g2_uint_t x, u8g2_uint_t y, const char* str)
+{
+    return 0;
+}
+
+u8g2_uint_t u8g2_GetStrWidth(u8g2_t* u8g2, const char* s)
+{
+    return 0;
+}
+
+int main(void)
+{
+    // ncenB08_tr: glyphs up to 9x11, about a third of the box inked
+    srand(8);
+    for (int e = 33; e < 127; e++) {
+        int w = 4 + rand() % 6;
+        int h = 6 + rand() % 6;
+        synth_random_glyph((uint16_t)e, w, h, 0, 0, w + 1, 35);
+    }
+    s_synth[' '].present = true;
+    s_synth[' '].dx = 3;
+    synth_encode(' ');
+
+    static uint8_t buf[1024];
+    u8g2_t u8g2;
+    synth_setup(&u8g2, buf);
+
+    // A second header copy so the same glyphs can be registered with one slot
+    static uint8_t decode_font[sizeof(s_synth_font)];
+    memcpy(decode_font, s_synth_font, sizeof(decode_font));
+    glyph_cache_register(s_synth_font, 96);
+    glyph_cache_register(decode_font, 1);
+
+    double t_hit, t_decode;
+    u8g2.font = s_synth_font;
+    BENCH_NS(t_hit, RUNS, ITERS, {
+        bench_sink += glyph_cache_draw_str(&u8g2, 0, 30, s_lines[i_ % LINE_COUNT]);
+    });
+    u8g2.font = decode_font;
+    BENCH_NS(t_decode, RUNS, ITERS, {
+        bench_sink += glyph_cache_draw_str(&u8g2, 0, 30, s_lines[i_ % LINE_COUNT]);
+    });
+
+    printf("decode every glyph %7.1f ns/line  cached %7.1f ns/line  %.1fx\n",
+           t_decode, t_hit, t_decode / t_hit);
+    return 0;
+}
+
+#endif
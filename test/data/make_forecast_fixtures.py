@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+"""Writes the OpenWeather /forecast fixtures for test_forecast and bench_forecast.
+
+Each city gets <name>.json, a body in the shape of the real 5 day / 3 hour response
+(all fields present, same key order), and <name>.expect, what the firmware should
+extract from it, computed here with Python's json module:
+    tz <city.timezone>
+    entry <dt> <temp_centi_c> <hum_pct> <cond_id>
+    day <local_day> <weekday> <tmin> <tmax> <hum_pct> <cond_id>
+Deterministic, so re-running it leaves the files unchanged.
+"""
+import json
+import math
+import os
+import random
+import time
+from decimal import Decimal, ROUND_HALF_UP
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+CONDITIONS = [
+    (800, "Clear", "clear sky", "01"), (801, "Clouds", "few clouds", "02"),
+    (802, "Clouds", "scattered clouds", "03"), (804, "Clouds", "overcast clouds", "04"),
+    (500, "Rain", "light rain", "10"), (501, "Rain", "moderate rain", "10"),
+    (600, "Snow", "light snow", "13"), (601, "Snow", "snow", "13"),
+    (701, "Mist", "mist", "50"), (211, "Thunderstorm", "thunderstorm", "11"),
+]
+
+CITIES = [
+    # name, id, lat, lon, country, timezone, base temp, swing, start dt
+    ("forecast_montreal", 6077243, 45.5088, -73.5878, "CA", -18000, -6.0, 5.0, 1736802000),
+    ("forecast_tokyo", 1850147, 35.6895, 139.6917, "JP", 32400, 21.0, 6.0, 1752505200),
+]
+
+
+def centi(x):
+    return int(Decimal(repr(x)).quantize(Decimal("0.01"), rounding=ROUND_HALF_UP) * 100)
+
+
+def make(name, cid, lat, lon, country, tz, base, swing, start):
+    rnd = random.Random(name)
+    entries = []
+    for i in range(40):
+        dt = start + i * 10800
+        hour = ((dt + tz) % 86400) / 3600
+        temp = round(base + swing * math.sin((hour - 9) / 24 * 2 * math.pi) + rnd.uniform(-1.5, 1.5), 2)
+        cond = rnd.choice(CONDITIONS)
+        if base < 0 and cond[0] // 100 == 5:
+            cond = CONDITIONS[6]
+        pod = "d" if 6 <= hour < 18 else "n"
+        entry = {
+            "dt": dt,
+            "main": {
+                "temp": temp,
+                "feels_like": round(temp - rnd.uniform(0, 4), 2),
+                "temp_min": round(temp - rnd.uniform(0, 1), 2),
+                "temp_max": round(temp + rnd.uniform(0, 1), 2),
+                "pressure": rnd.randint(995, 1030),
+                "sea_level": rnd.randint(995, 1030),
+                "grnd_level": rnd.randint(985, 1020),
+                "humidity": rnd.randint(25, 100),
+                "temp_kf": round(rnd.uniform(-2, 2), 2),
+            },
+            "weather": [{"id": cond[0], "main": cond[1], "description": cond[2], "icon": cond[3] + pod}],
+            "clouds": {"all": rnd.randint(0, 100)},
+            "wind": {"speed": round(rnd.uniform(0, 12), 2), "deg": rnd.randint(0, 359), "gust": round(rnd.uniform(0, 20), 2)},
+            "visibility": 10000,
+            "pop": round(rnd.uniform(0, 1), 2),
+            "sys": {"pod": pod},
+            "dt_txt": time.strftime("%Y-%m-%d %H:%M:%S", time.gmtime(dt)),
+        }
+        if cond[0] // 100 == 5:
+            entry["rain"] = {"3h": round(rnd.uniform(0.1, 5), 2)}
+        if cond[0] // 100 == 6:
+            entry["snow"] = {"3h": round(rnd.uniform(0.1, 5), 2)}
+        if i % 7 == 3:
+            # Two conditions: the first one counts
+            entry["weather"].append({"id": 701, "main": "Mist", "description": "mist \"light\" é", "icon": "50" + pod})
+        entries.append(entry)
+
+    doc = {
+        "cod": "200", "message": 0, "cnt": 40, "list": entries,
+        "city": {
+            "id": cid, "name": name.split("_")[1].title(), "coord": {"lat": lat, "lon": lon},
+            "country": country, "population": 1000000, "timezone": tz,
+            "sunrise": start + 25000, "sunset": start + 55000,
+        },
+    }
+    body = json.dumps(doc, separators=(",", ":"), ensure_ascii=True)
+
+    parsed = json.loads(body)
+    lines = ["tz %d" % parsed["city"]["timezone"]]
+    rows = []
+    for e in parsed["list"]:
+        row = (e["dt"], centi(e["main"]["temp"]), e["main"]["humidity"], e["weather"][0]["id"])
+        rows.append(row)
+        lines.append("entry %d %d %d %d" % row)
+
+    days = []
+    for dt, t, h, c in rows:
+        local = dt + tz
+        day, dist = local // 86400, abs(local % 86400 - 12 * 3600)
+        if not days or days[-1]["day"] != day:
+            days.append({"day": day, "tmin": t, "tmax": t, "hum": [], "cond": c, "dist": dist})
+        d = days[-1]
+        d["tmin"], d["tmax"] = min(d["tmin"], t), max(d["tmax"], t)
+        if dist < d["dist"]:
+            d["dist"], d["cond"] = dist, c
+        d["hum"].append(h)
+    for d in days:
+        hum = (sum(d["hum"]) + len(d["hum"]) // 2) // len(d["hum"])
+        lines.append("day %d %d %d %d %d %d" % (d["day"], (d["day"] + 4) % 7, d["tmin"], d["tmax"], hum, d["cond"]))
+
+    with open(os.path.join(HERE, name + ".json"), "w") as f:
+        f.write(body)
+    with open(os.path.join(HERE, name + ".expect"), "w") as f:
+        f.write("\n".join(lines) + "\n")
+
+
+for city in CITIES:
+    make(*city)
@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+"""Writes the traces the replay_host ctests run.
+
+replay_session.trc is a scripted session in the format of main/trace.c (what
+trace_tool.py extract produces): the main menu, the local reading with a DHT20 frame
+every second, a city weather fetch, Wi-Fi (answered by a geo body), the diagnostics pages, the clock and
+the preferences screen. The keys are the bytes a terminal sends; the HTTP bodies
+have the shape of the OpenWeather and ip-api replies.
+
+replay_shutdown.trc opens the clock, goes back to the main menu and picks Shutdown:
+the snapshot must keep the clock screen, not the main menu. Deterministic.
+"""
+import json
+import os
+import struct
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+MAGIC = b"TRC\x01"
+KEY, DHT20, HTTP_WEATHER, HTTP_GEO = 1, 2, 3, 4
+
+UP, DOWN, RIGHT, LEFT = b"\x1b[A", b"\x1b[B", b"\x1b[C", b"\x1b[D"
+ENTER = b"\r"
+
+WEATHER = {
+    "coord": {"lon": -73.5878, "lat": 45.5088},
+    "weather": [{"id": 803, "main": "Clouds", "description": "broken clouds", "icon": "04d"}],
+    "base": "stations",
+    "main": {"temp": 18.42, "feels_like": 17.93, "temp_min": 16.61, "temp_max": 19.84,
+             "pressure": 1016, "humidity": 63},
+    "visibility": 10000,
+    "wind": {"speed": 4.12, "deg": 250},
+    "clouds": {"all": 75},
+    "dt": 1718900000,
+    "sys": {"type": 2, "id": 2082061, "country": "CA", "sunrise": 1718874123, "sunset": 1718931041},
+    "timezone": -14400,
+    "id": 6077243,
+    "name": "Montreal",
+    "cod": 200,
+}
+
+GEO = {
+    "status": "success", "country": "Canada", "countryCode": "CA", "region": "QC",
+    "regionName": "Quebec", "city": "Montreal", "zip": "H2X", "lat": 45.5088,
+    "lon": -73.5878, "timezone": "America/Toronto", "offset": -14400,
+    "isp": "Example ISP", "query": "203.0.113.7",
+}
+
+
+def dht20_frame(temp_c, hum_pct):
+    """The sensor's 7 byte answer: status, 20 bit humidity, 20 bit temperature, CRC."""
+    hum = round(hum_pct / 100 * (1 << 20))
+    temp = round((temp_c + 50) / 200 * (1 << 20))
+    frame = bytearray(7)
+    frame[0] = 0x1C
+    frame[1] = hum >> 12
+    frame[2] = (hum >> 4) & 0xFF
+    frame[3] = ((hum & 0x0F) << 4) | (temp >> 16)
+    frame[4] = (temp >> 8) & 0xFF
+    frame[5] = temp & 0xFF
+    crc = 0xFF
+    for b in frame[:6]:
+        crc ^= b
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x31) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    frame[6] = crc
+    return bytes(frame)
+
+
+class Session:
+    def __init__(self):
+        self.t_ms = 0
+        self.events = []
+
+    def add(self, kind, data):
+        self.events.append((self.t_ms, kind, data))
+
+    def keys(self, *seq, gap_ms=400):
+        for k in seq:
+            self.t_ms += gap_ms
+            self.add(KEY, k)
+
+    def wait(self, ms, temp_c=None, hum_pct=None):
+        """Idle for ms, with a sensor frame every second when a reading is given."""
+        end = self.t_ms + ms
+        while self.t_ms + 1000 <= end:
+            self.t_ms += 1000
+            if temp_c is not None:
+                self.add(DHT20, dht20_frame(temp_c, hum_pct))
+                temp_c += 0.07
+                hum_pct -= 0.3
+        self.t_ms = end
+
+    def blob(self):
+        out = bytearray(MAGIC)
+        for t_ms, kind, data in self.events:
+            out += struct.pack("<IBH", t_ms, kind, len(data)) + data
+        return bytes(out)
+
+
+def write(name, s):
+    path = os.path.join(HERE, name)
+    with open(path, "wb") as f:
+        f.write(s.blob())
+    print(f"wrote {path}: {len(s.blob())} bytes, {len(s.events)} events, {s.t_ms} ms")
+
+
+def session():
+    s = Session()
+    s.wait(1500)
+    # Weather > Here: live reading
+    s.keys(DOWN, ENTER, ENTER)
+    s.wait(6000, temp_c=22.4, hum_pct=46.0)
+    # Weather > City: one fetch
+    s.keys(LEFT, DOWN, ENTER)
+    s.add(HTTP_WEATHER, json.dumps(WEATHER, separators=(",", ":")).encode())
+    s.wait(3000)
+    # Settings > WiFi: the geo lookup after connecting
+    s.keys(LEFT, LEFT, DOWN, DOWN, ENTER, ENTER)
+    s.add(HTTP_GEO, json.dumps(GEO, separators=(",", ":")).encode())
+    s.wait(2000)
+    # Settings > Diagnostics, long enough for a page flip
+    s.keys(LEFT, DOWN, DOWN, DOWN, DOWN, DOWN, ENTER)
+    s.wait(7000)
+    # Settings > Preferences, browse
+    s.keys(LEFT, DOWN, ENTER, DOWN, DOWN, UP)
+    s.wait(1500)
+    # Time
+    s.keys(LEFT, LEFT, UP, ENTER)
+    s.wait(3000)
+    s.keys(LEFT)
+    s.wait(1000)
+    return s
+
+
+def shutdown():
+    s = Session()
+    s.wait(1000)
+    s.keys(DOWN, DOWN, ENTER)
+    s.wait(2000, temp_c=21.0, hum_pct=40.0)
+    s.keys(LEFT, DOWN, DOWN, ENTER)
+    return s
+
+
+def main():
+    write("replay_session.trc", session())
+    write("replay_shutdown.trc", shutdown())
+
+
+if __name__ == "__main__":
+    main()
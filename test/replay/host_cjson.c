@@ -0,0 +1,252 @@
+// cJSON_Parse and the lookups main/ uses, for the host replay to parse recorded
+// bodies. Follows cJSON where the parsers can tell: items are a linked tree with
+// the same fields, valueint saturates, keys match case-insensitively, \u escapes
+// become UTF-8 and text after the first value is ignored.
+#include <ctype.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <cJSON.h>
+
+#define NESTING_LIMIT 1000  // CJSON_NESTING_LIMIT
+
+typedef struct {
+    const char* p;
+    int depth;
+} parser_t;
+
+static bool parse_value(parser_t* ps, cJSON* item);
+
+static void skip_ws(parser_t* ps)
+{
+    while (*ps->p && (unsigned char)*ps->p <= ' ') ps->p++;
+}
+
+static int hex4(const char* s)
+{
+    int v = 0;
+    for (int i = 0; i < 4; i++) {
+        const char c = s[i];
+        v <<= 4;
+        if (c >= '0' && c <= '9') v |= c - '0';
+        else if (c >= 'a' && c <= 'f') v |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') v |= c - 'A' + 10;
+        else return -1;
+    }
+    return v;
+}
+
+static size_t put_utf8(char* out, unsigned cp)
+{
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (char)(0xC0 | cp >> 6);
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | cp >> 12);
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | cp >> 18);
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+// At the opening quote; the decoded text is never longer than the source
+static char* parse_string(parser_t* ps)
+{
+    const char* end = ps->p + 1;
+    while (*end && *end != '"') end += (*end == '\\' && end[1]) ? 2 : 1;
+    if (*end != '"') return NULL;
+
+    char* out = malloc((size_t)(end - ps->p));
+    if (!out) return NULL;
+    size_t n = 0;
+    for (const char* s = ps->p + 1; s < end; s++) {
+        if (*s != '\\') {
+            out[n++] = *s;
+            continue;
+        }
+        s++;
+        switch (*s) {
+        case 'b': out[n++] = '\b'; break;
+        case 'f': out[n++] = '\f'; break;
+        case 'n': out[n++] = '\n'; break;
+        case 'r': out[n++] = '\r'; break;
+        case 't': out[n++] = '\t'; break;
+        case '"': case '\\': case '/': out[n++] = *s; break;
+        case 'u': {
+            int cp = (end - s > 4) ? hex4(s + 1) : -1;
+            if (cp < 0 || (cp >= 0xDC00 && cp <= 0xDFFF)) goto fail;
+            s += 4;
+            if (cp >= 0xD800 && cp <= 0xDBFF) {
+                const int lo = (end - s > 6 && s[1] == '\\' && s[2] == 'u') ? hex4(s + 3) : -1;
+                if (lo < 0xDC00 || lo > 0xDFFF) goto fail;
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                s += 6;
+            }
+            n += put_utf8(&out[n], (unsigned)cp);
+            break;
+        }
+        default:
+            goto fail;
+        }
+    }
+    out[n] = '\0';
+    ps->p = end + 1;
+    return out;
+
+fail:
+    free(out);
+    return NULL;
+}
+
+static bool parse_number(parser_t* ps, cJSON* item)
+{
+    char* end;
+    const double d = strtod(ps->p, &end);
+    if (end == ps->p) return false;
+    item->type = cJSON_Number;
+    item->valuedouble = d;
+    item->valueint = (d >= INT_MAX) ? INT_MAX : (d <= (double)INT_MIN) ? INT_MIN : (int)d;
+    ps->p = end;
+    return true;
+}
+
+// Array or object, at the opening bracket
+static bool parse_container(parser_t* ps, cJSON* item, bool object)
+{
+    if (++ps->depth > NESTING_LIMIT) return false;
+    item->type = object ? cJSON_Object : cJSON_Array;
+    const char close = object ? '}' : ']';
+    ps->p++;
+    skip_ws(ps);
+    if (*ps->p == close) {
+        ps->p++;
+        ps->depth--;
+        return true;
+    }
+
+    cJSON* last = NULL;
+    for (;;) {
+        cJSON* child = calloc(1, sizeof(cJSON));
+        if (!child) return false;
+        if (last) {
+            last->next = child;
+            child->prev = last;
+        } else {
+            item->child = child;
+        }
+        last = child;
+        item->child->prev = last;   // cJSON keeps the tail in the head's prev
+
+        skip_ws(ps);
+        if (object) {
+            if (*ps->p != '"' || !(child->string = parse_string(ps))) return false;
+            skip_ws(ps);
+            if (*ps->p++ != ':') return false;
+            skip_ws(ps);
+        }
+        if (!parse_value(ps, child)) return false;
+        skip_ws(ps);
+        if (*ps->p == ',') {
+            ps->p++;
+            continue;
+        }
+        if (*ps->p != close) return false;
+        ps->p++;
+        ps->depth--;
+        return true;
+    }
+}
+
+static bool parse_value(parser_t* ps, cJSON* item)
+{
+    const char* p = ps->p;
+    if (strncmp(p, "null", 4) == 0) {
+        item->type = cJSON_NULL;
+        ps->p += 4;
+        return true;
+    }
+    if (strncmp(p, "false", 5) == 0) {
+        item->type = cJSON_False;
+        ps->p += 5;
+        return true;
+    }
+    if (strncmp(p, "true", 4) == 0) {
+        item->type = cJSON_True;
+        item->valueint = 1;
+        ps->p += 4;
+        return true;
+    }
+    if (*p == '"') {
+        item->type = cJSON_String;
+        return (item->valuestring = parse_string(ps)) != NULL;
+    }
+    if (*p == '-' || isdigit((unsigned char)*p)) return parse_number(ps, item);
+    if (*p == '[' || *p == '{') return parse_container(ps, item, *p == '{');
+    return false;
+}
+
+cJSON* cJSON_Parse(const char* value)
+{
+    if (!value) return NULL;
+    parser_t ps = { .p = value };
+    cJSON* root = calloc(1, sizeof(cJSON));
+    if (!root) return NULL;
+    skip_ws(&ps);
+    if (!parse_value(&ps, root)) {
+        cJSON_Delete(root);
+        return NULL;
+    }
+    return root;
+}
+
+void cJSON_Delete(cJSON* item)
+{
+    while (item) {
+        cJSON* next = item->next;
+        cJSON_Delete(item->child);
+        free(item->valuestring);
+        free(item->string);
+        free(item);
+        item = next;
+    }
+}
+
+cJSON* cJSON_GetObjectItem(const cJSON* object, const char* key)
+{
+    if (!object || !key) return NULL;
+    for (cJSON* c = object->child; c; c = c->next) {
+        if (c->string && strcasecmp(c->string, key) == 0) return c;
+    }
+    return NULL;
+}
+
+cJSON* cJSON_GetArrayItem(const cJSON* array, int index)
+{
+    if (!array || index < 0) return NULL;
+    cJSON* c = array->child;
+    while (c && index-- > 0) c = c->next;
+    return c;
+}
+
+char* cJSON_GetStringValue(const cJSON* item)
+{
+    return cJSON_IsString(item) ? item->valuestring : NULL;
+}
+
+bool cJSON_IsNumber(const cJSON* item) { return item && (item->type & 0xFF) == cJSON_Number; }
+bool cJSON_IsString(const cJSON* item) { return item && (item->type & 0xFF) == cJSON_String; }
+bool cJSON_IsArray(const cJSON* item) { return item && (item->type & 0xFF) == cJSON_Array; }
+bool cJSON_IsObject(const cJSON* item) { return item && (item->type & 0xFF) == cJSON_Object; }
@@ -0,0 +1,94 @@
+// Fakes for the modules that need a radio or a socket. During a replay the device
+// itself leaves these alone except for the weather and geo fetches, which are
+// answered from the trace; here the bodies are taken from the trace the same way
+// and go through the device's parsers (weather_parse.c, geo_parse.c) on host_cjson.c.
+#include <stdio.h>
+#include <string.h>
+
+#include "main.h"
+
+#define HOST_BODY_MAX 4096
+
+// --- BLE: no scanner, so the devices screen stays on "Scanning..."
+
+void ble_init(void) {}
+void ble_scan_start(void) {}
+bool ble_devices_take_dirty(void) { return false; }
+void ble_update_reading(int16_t temp_centi_c, uint16_t hum_centi_pct, int8_t battery_pct) {}
+
+void ble_get_devices_text(fmt_t* f)
+{
+    fmt_str(f, "Scanning...");
+}
+
+// --- Wi-Fi: never connects, scans find nothing
+
+esp_err_t connect_wifi(void) { return WIFI_FAILURE; }
+esp_err_t wifi_scan_start(void) { return ESP_OK; }
+uint32_t wifi_scan_generation(void) { return 0; }
+
+void wifi_scan_get(wifi_scan_result_t* out)
+{
+    memset(out, 0, sizeof(*out));
+}
+
+// --- network services
+
+esp_err_t mirror_start(void) { return ESP_OK; }
+void mirror_submit_frame(const uint8_t* fb) {}
+esp_err_t http_api_start(void) { return ESP_OK; }
+esp_err_t mqtt_pub_init(void) { return ESP_OK; }
+esp_err_t mqtt_pub_start(void) { return ESP_OK; }
+esp_err_t ota_update_start(void) { return ESP_ERR_INVALID_STATE; }
+void ota_confirm_boot(void) {}
+
+void ota_get_status(ota_status_t* out)
+{
+    memset(out, 0, sizeof(*out));
+    out->state = OTA_IDLE;
+}
+
+// --- storage: no sample log partition, as before sample_store_init()
+
+esp_err_t sample_store_flush(void) { return ESP_ERR_INVALID_STATE; }
+
+// --- HTTP fetches
+
+esp_err_t weather_fetch_city(const char* city, weather_update_callback_t update_ui)
+{
+    static char body[HOST_BODY_MAX];
+    int len = 0;
+    WeatherInfo info = { 0 };
+    if (!trace_replaying() || !trace_replay_http(TRACE_HTTP_WEATHER, body, sizeof(body), &len)) {
+        strlcpy(info.err, "Not in trace", sizeof(info.err));
+        update_ui(&info);
+        return ESP_ERR_NOT_FOUND;
+    }
+    weather_parse_city(body, len, &info);
+    printf("HOST weather %d bytes: ok %d, %d C (feels %d, %d..%d), %u%%, %u km/h, \"%s\"\n", len, info.ok,
+           info.temp_c, info.feels_c, info.tmin_c, info.tmax_c, info.hum_pct, info.wind_kmh,
+           info.ok ? info.desc : info.err);
+    update_ui(&info);
+    return ESP_OK;
+}
+
+// Not recorded, as on the device
+esp_err_t weather_fetch_forecast(const char* city, forecast_t* out)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+bool geo_fetch_info(const char* ip, GeoInfo* out)
+{
+    static char body[HOST_BODY_MAX];
+    int len = 0;
+    memset(out, 0, sizeof(*out));
+    if (!trace_replaying() || !trace_replay_http(TRACE_HTTP_GEO, body, sizeof(body), &len)) {
+        strlcpy(out->message, "Not in trace", sizeof(out->message));
+        return false;
+    }
+    const bool ok = geo_parse(body, out);
+    printf("HOST geo %d bytes: ok %d, %s / %s / %s, offset %ld s%s%s\n", len, ok, out->countryCode,
+           out->region, out->city, out->offset_sec, out->message[0] ? ", " : "", out->message);
+    return ok;
+}
@@ -0,0 +1,221 @@
+// esp_http_server on POSIX sockets for the host, see stubs/esp_http_server.h. Binds
+// 127.0.0.1 only. Headers go out with the first chunk; a handler that returns an
+// error before sending anything gets a 500, an unknown path a 404.
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <esp_http_server.h>
+
+#define MAX_HANDLERS    16
+#define REQ_MAX         2048
+#define HDRS_MAX        512
+
+int host_httpd_port = -1;
+
+typedef struct {
+    int listen_fd;
+    pthread_t thread;
+    httpd_uri_t handlers[MAX_HANDLERS];
+    int handler_count;
+    int max_handlers;
+} server_t;
+
+typedef struct {
+    int fd;
+    bool headers_sent;
+    const char* status;
+    const char* type;
+    char hdrs[HDRS_MAX];
+} conn_t;
+
+static bool send_all(int fd, const char* buf, size_t len)
+{
+    while (len > 0) {
+        const ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        buf += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+static bool send_headers(conn_t* c, const char* framing)
+{
+    char head[HDRS_MAX + 256];
+    const int n = snprintf(head, sizeof(head), "HTTP/1.1 %s\r\nContent-Type: %s\r\n%s%sConnection: close\r\n\r\n",
+                           c->status, c->type, c->hdrs, framing);
+    c->headers_sent = true;
+    return n > 0 && (size_t)n < sizeof(head) && send_all(c->fd, head, (size_t)n);
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t* r, const char* status)
+{
+    ((conn_t*)r->aux)->status = status;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t* r, const char* type)
+{
+    ((conn_t*)r->aux)->type = type;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t* r, const char* field, const char* value)
+{
+    conn_t* c = r->aux;
+    const size_t used = strlen(c->hdrs);
+    const int n = snprintf(c->hdrs + used, sizeof(c->hdrs) - used, "%s: %s\r\n", field, value);
+    if (n < 0 || (size_t)n >= sizeof(c->hdrs) - used) {
+        c->hdrs[used] = '\0';
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t* r, const char* buf, ssize_t len)
+{
+    conn_t* c = r->aux;
+    if (buf && len < 0) len = (ssize_t)strlen(buf);
+    if (!c->headers_sent && !send_headers(c, "Transfer-Encoding: chunked\r\n")) return ESP_FAIL;
+
+    char size[16];
+    const int n = snprintf(size, sizeof(size), "%zx\r\n", buf ? (size_t)len : 0);
+    if (!send_all(c->fd, size, (size_t)n)) return ESP_FAIL;
+    if (buf && len > 0 && !send_all(c->fd, buf, (size_t)len)) return ESP_FAIL;
+    return send_all(c->fd, "\r\n", 2) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t* r, const char* buf, ssize_t len)
+{
+    conn_t* c = r->aux;
+    if (!buf) len = 0;
+    else if (len < 0) len = (ssize_t)strlen(buf);
+    char framing[48];
+    snprintf(framing, sizeof(framing), "Content-Length: %zd\r\n", len);
+    if (c->headers_sent || !send_headers(c, framing)) return ESP_FAIL;
+    return (len == 0 || send_all(c->fd, buf, (size_t)len)) ? ESP_OK : ESP_FAIL;
+}
+
+// Reads the request head; the method and the path without the query go to req
+static bool read_request(int fd, httpd_req_t* req)
+{
+    char buf[REQ_MAX + 1];
+    size_t len = 0;
+    while (len < REQ_MAX) {
+        const ssize_t n = recv(fd, buf + len, REQ_MAX - len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        len += (size_t)n;
+        buf[len] = '\0';
+        if (strstr(buf, "\r\n\r\n")) break;
+    }
+    buf[len] = '\0';
+
+    char method[8], path[HTTPD_MAX_URI_LEN + 1];
+    if (sscanf(buf, "%7s %512s", method, path) != 2) return false;
+    path[strcspn(path, "?")] = '\0';
+    req->method = (strcmp(method, "GET") == 0) ? HTTP_GET : (strcmp(method, "POST") == 0) ? HTTP_POST : 0;
+    strlcpy((char*)req->uri, path, sizeof(req->uri));
+    return true;
+}
+
+static void serve(server_t* s, int fd)
+{
+    httpd_req_t req = { .handle = s };
+    conn_t conn = { .fd = fd, .status = "200 OK", .type = "text/html" };
+    req.aux = &conn;
+    if (!read_request(fd, &req)) return;
+
+    const httpd_uri_t* h = NULL;
+    for (int i = 0; i < s->handler_count && !h; i++) {
+        if ((int)s->handlers[i].method == req.method && strcmp(s->handlers[i].uri, req.uri) == 0) {
+            h = &s->handlers[i];
+        }
+    }
+    if (!h) {
+        httpd_resp_set_status(&req, "404 Not Found");
+        httpd_resp_set_type(&req, "text/plain");
+        httpd_resp_send(&req, "Not found\n", HTTPD_RESP_USE_STRLEN);
+        return;
+    }
+    req.user_ctx = h->user_ctx;
+    if (h->handler(&req) != ESP_OK && !conn.headers_sent) {
+        httpd_resp_set_status(&req, "500 Internal Server Error");
+        httpd_resp_set_type(&req, "text/plain");
+        httpd_resp_send(&req, "Handler failed\n", HTTPD_RESP_USE_STRLEN);
+    }
+}
+
+static void* server_thread(void* arg)
+{
+    server_t* s = arg;
+    for (;;) {
+        const int fd = accept(s->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;  // httpd_stop shut the socket down
+        }
+        serve(s, fd);
+        close(fd);
+    }
+    return NULL;
+}
+
+esp_err_t httpd_start(httpd_handle_t* handle, const httpd_config_t* config)
+{
+    if (!handle || !config) return ESP_ERR_INVALID_ARG;
+    server_t* s = calloc(1, sizeof(server_t));
+    if (!s) return ESP_ERR_NO_MEM;
+    s->max_handlers = (config->max_uri_handlers < MAX_HANDLERS) ? config->max_uri_handlers : MAX_HANDLERS;
+
+    s->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    const int one = 1;
+    setsockopt(s->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    addr.sin_port = htons((uint16_t)(host_httpd_port >= 0 ? host_httpd_port : config->server_port));
+    socklen_t addr_len = sizeof(addr);
+    if (s->listen_fd < 0 || bind(s->listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(s->listen_fd, 8) != 0 || getsockname(s->listen_fd, (struct sockaddr*)&addr, &addr_len) != 0) {
+        fprintf(stderr, "httpd: cannot listen: %s\n", strerror(errno));
+        if (s->listen_fd >= 0) close(s->listen_fd);
+        free(s);
+        return ESP_FAIL;
+    }
+    host_httpd_port = ntohs(addr.sin_port);
+
+    if (pthread_create(&s->thread, NULL, server_thread, s) != 0) {
+        close(s->listen_fd);
+        free(s);
+        return ESP_FAIL;
+    }
+    *handle = s;
+    return ESP_OK;
+}
+
+esp_err_t httpd_stop(httpd_handle_t handle)
+{
+    server_t* s = handle;
+    if (!s) return ESP_ERR_INVALID_ARG;
+    shutdown(s->listen_fd, SHUT_RDWR);
+    pthread_join(s->thread, NULL);
+    close(s->listen_fd);
+    free(s);
+    return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t* uri_handler)
+{
+    server_t* s = handle;
+    if (!s || !uri_handler) return ESP_ERR_INVALID_ARG;
+    if (s->handler_count >= s->max_handlers) return ESP_ERR_NO_MEM;
+    s->handlers[s->handler_count++] = *uri_handler;
+    return ESP_OK;
+}
@@ -0,0 +1,395 @@
+// The ESP-IDF and FreeRTOS calls the UI modules make, on top of POSIX. No radios,
+// no I2C bus, SPI transactions finish when queued and NVS lives in RAM.
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <driver/gpio.h>
+#include <driver/i2c.h>
+#include <driver/spi_master.h>
+#include <driver/uart.h>
+#include <esp_err.h>
+#include <esp_heap_caps.h>
+#include <esp_netif.h>
+#include <esp_random.h>
+#include <esp_sleep.h>
+#include <esp_sntp.h>
+#include <esp_timer.h>
+#include <esp_wifi.h>
+#include <freertos/FreeRTOS.h>
+#include <nvs_flash.h>
+#include <u8g2_esp32_hal.h>
+
+#define SPI_QUEUE_MAX   64
+#define NVS_MAX_KEYS    64
+#define NVS_MAX_NS      8
+#define NVS_VALUE_MAX   512
+
+const char* esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK: return "ESP_OK";
+    case ESP_FAIL: return "ESP_FAIL";
+    case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+    default: return "UNKNOWN ERROR";
+    }
+}
+
+// --- time and tasks
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+struct esp_timer {
+    esp_timer_create_args_t args;
+    bool active;
+};
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out)
+{
+    struct esp_timer* t = calloc(1, sizeof(*t));
+    if (!t) return ESP_ERR_NO_MEM;
+    t->args = *args;
+    *out = t;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    if (timer->active) return ESP_ERR_INVALID_STATE;
+    timer->active = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us)
+{
+    return esp_timer_start_once(timer, period_us);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (!timer->active) return ESP_ERR_INVALID_STATE;
+    timer->active = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    free(timer);
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    return timer->active;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+                       UBaseType_t prio, TaskHandle_t* out)
+{
+    if (out) *out = (TaskHandle_t)fn;
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+                                   UBaseType_t prio, TaskHandle_t* out, BaseType_t core)
+{
+    return xTaskCreate(fn, name, stack, arg, prio, out);
+}
+
+void vTaskDelete(TaskHandle_t task) {}
+void vTaskDelay(TickType_t ticks) {}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(esp_timer_get_time() / 1000);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return (TaskHandle_t)&xTaskGetCurrentTaskHandle;
+}
+
+static UBaseType_t s_prio = 1;
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task) { return s_prio; }
+void vTaskPrioritySet(TaskHandle_t task, UBaseType_t prio) { s_prio = prio; }
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) { return 0; }
+BaseType_t xTaskNotifyGive(TaskHandle_t task) { return pdPASS; }
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait) { return 0; }
+
+// --- heap. Every malloc in the linked objects goes through the firmware's alloc
+// hook (-Wl,--wrap=malloc), which is what trace_alloc_count() counts on the device.
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void esp_heap_trace_alloc_hook(void* ptr, size_t size, uint32_t caps);
+
+void* __wrap_malloc(size_t size)
+{
+    void* p = __real_malloc(size);
+    if (p) esp_heap_trace_alloc_hook(p, size, MALLOC_CAP_DEFAULT);
+    return p;
+}
+
+void* __wrap_calloc(size_t n, size_t size)
+{
+    void* p = __real_calloc(n, size);
+    if (p) esp_heap_trace_alloc_hook(p, n * size, MALLOC_CAP_DEFAULT);
+    return p;
+}
+
+void* heap_caps_malloc(size_t size, uint32_t caps)
+{
+    return malloc(size);
+}
+
+void heap_caps_free(void* ptr)
+{
+    free(ptr);
+}
+
+// Nominal figures for the diagnostics screen
+size_t heap_caps_get_free_size(uint32_t caps) { return 256 * 1024; }
+size_t heap_caps_get_minimum_free_size(uint32_t caps) { return 200 * 1024; }
+size_t heap_caps_get_largest_free_block(uint32_t caps) { return 128 * 1024; }
+uint32_t esp_get_free_heap_size(void) { return 256 * 1024; }
+uint32_t esp_get_minimum_free_heap_size(void) { return 200 * 1024; }
+
+uint32_t esp_random(void)
+{
+    static uint32_t s_state = 0x12345678;
+    s_state ^= s_state << 13;
+    s_state ^= s_state >> 17;
+    s_state ^= s_state << 5;
+    return s_state;
+}
+
+void esp_deep_sleep_start(void)
+{
+    printf("deep sleep\n");
+    host_reboot();
+    exit(0);
+}
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us) { return ESP_OK; }
+
+// --- peripherals
+
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level) { return ESP_OK; }
+
+esp_err_t i2c_param_config(i2c_port_t port, const i2c_config_t* conf) { return ESP_OK; }
+esp_err_t i2c_driver_install(i2c_port_t port, i2c_mode_t mode, size_t slv_rx, size_t slv_tx, int flags) { return ESP_OK; }
+i2c_cmd_handle_t i2c_cmd_link_create(void) { return (i2c_cmd_handle_t)1; }
+void i2c_cmd_link_delete(i2c_cmd_handle_t cmd) {}
+esp_err_t i2c_master_start(i2c_cmd_handle_t cmd) { return ESP_OK; }
+esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd) { return ESP_OK; }
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd, uint8_t data, bool ack_en) { return ESP_OK; }
+esp_err_t i2c_master_read_byte(i2c_cmd_handle_t cmd, uint8_t* data, i2c_ack_type_t ack) { return ESP_OK; }
+esp_err_t i2c_master_read(i2c_cmd_handle_t cmd, uint8_t* data, size_t len, i2c_ack_type_t ack) { return ESP_OK; }
+esp_err_t i2c_master_cmd_begin(i2c_port_t port, i2c_cmd_handle_t cmd, TickType_t wait) { return ESP_ERR_TIMEOUT; }
+
+esp_err_t uart_driver_install(uart_port_t port, int rx_size, int tx_size, int queue_size,
+                              QueueHandle_t* queue, int flags) { return ESP_OK; }
+esp_err_t uart_param_config(uart_port_t port, const uart_config_t* conf) { return ESP_OK; }
+esp_err_t uart_set_pin(uart_port_t port, int tx, int rx, int rts, int cts) { return ESP_OK; }
+
+struct spi_device_t {
+    spi_device_interface_config_t cfg;
+    spi_transaction_t* done[SPI_QUEUE_MAX];
+    int head, count;
+};
+
+static struct spi_device_t s_spi_dev;
+static uint64_t s_spi_bytes = 0;
+
+esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t* bus, int dma_chan) { return ESP_OK; }
+
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t* dev,
+                             spi_device_handle_t* out)
+{
+    memset(&s_spi_dev, 0, sizeof(s_spi_dev));
+    s_spi_dev.cfg = *dev;
+    *out = &s_spi_dev;
+    return ESP_OK;
+}
+
+static void spi_run(spi_device_handle_t dev, spi_transaction_t* t)
+{
+    if (dev->cfg.pre_cb) dev->cfg.pre_cb(t);
+    s_spi_bytes += t->length / 8;
+    if (dev->cfg.post_cb) dev->cfg.post_cb(t);
+}
+
+esp_err_t spi_device_queue_trans(spi_device_handle_t dev, spi_transaction_t* t, TickType_t wait)
+{
+    if (dev->count == SPI_QUEUE_MAX) return ESP_ERR_TIMEOUT;
+    spi_run(dev, t);
+    dev->done[(dev->head + dev->count++) % SPI_QUEUE_MAX] = t;
+    return ESP_OK;
+}
+
+esp_err_t spi_device_get_trans_result(spi_device_handle_t dev, spi_transaction_t** t, TickType_t wait)
+{
+    if (dev->count == 0) return ESP_ERR_TIMEOUT;
+    *t = dev->done[dev->head];
+    dev->head = (dev->head + 1) % SPI_QUEUE_MAX;
+    dev->count--;
+    return ESP_OK;
+}
+
+esp_err_t spi_device_polling_transmit(spi_device_handle_t dev, spi_transaction_t* t)
+{
+    spi_run(dev, t);
+    return ESP_OK;
+}
+
+uint64_t host_spi_bytes(void)
+{
+    return s_spi_bytes;
+}
+
+void u8g2_esp32_hal_init(u8g2_esp32_hal_t param) {}
+
+uint8_t u8g2_esp32_gpio_and_delay_cb(u8x8_t* u8x8, uint8_t msg, uint8_t arg_int, void* arg_ptr)
+{
+    return 1;
+}
+
+// --- network: never associated, SNTP never syncs
+
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t* info) { return ESP_ERR_INVALID_STATE; }
+esp_err_t esp_wifi_sta_get_rssi(int* rssi) { return ESP_ERR_INVALID_STATE; }
+esp_err_t esp_wifi_stop(void) { return ESP_OK; }
+esp_netif_t* esp_netif_get_handle_from_ifkey(const char* key) { return NULL; }
+esp_err_t esp_netif_get_ip_info(esp_netif_t* netif, esp_netif_ip_info_t* info) { return ESP_ERR_INVALID_ARG; }
+
+void esp_sntp_setoperatingmode(esp_sntp_operatingmode_t mode) {}
+void esp_sntp_setservername(uint8_t idx, const char* server) {}
+void esp_sntp_init(void) {}
+void esp_sntp_stop(void) {}
+bool esp_sntp_restart(void) { return false; }
+bool esp_sntp_enabled(void) { return false; }
+void sntp_set_sync_mode(sntp_sync_mode_t mode) {}
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback) {}
+
+// --- NVS
+
+typedef struct {
+    bool used;
+    nvs_handle_t ns;
+    char key[16];
+    size_t len;
+    uint8_t value[NVS_VALUE_MAX];
+} nvs_entry_t;
+
+static char s_nvs_ns[NVS_MAX_NS][16];
+static nvs_entry_t s_nvs[NVS_MAX_KEYS];
+
+esp_err_t nvs_flash_init(void) { return ESP_OK; }
+
+esp_err_t nvs_flash_erase(void)
+{
+    memset(s_nvs, 0, sizeof(s_nvs));
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char* ns, nvs_open_mode_t mode, nvs_handle_t* out)
+{
+    for (int i = 0; i < NVS_MAX_NS; i++) {
+        if (!s_nvs_ns[i][0]) strncpy(s_nvs_ns[i], ns, sizeof(s_nvs_ns[i]) - 1);
+        if (strcmp(s_nvs_ns[i], ns) == 0) {
+            *out = (nvs_handle_t)(i + 1);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+void nvs_close(nvs_handle_t h) {}
+esp_err_t nvs_commit(nvs_handle_t h) { return ESP_OK; }
+
+static nvs_entry_t* nvs_find(nvs_handle_t h, const char* key)
+{
+    for (int i = 0; i < NVS_MAX_KEYS; i++) {
+        if (s_nvs[i].used && s_nvs[i].ns == h && strcmp(s_nvs[i].key, key) == 0) return &s_nvs[i];
+    }
+    return NULL;
+}
+
+static esp_err_t nvs_put(nvs_handle_t h, const char* key, const void* value, size_t len)
+{
+    if (len > NVS_VALUE_MAX || strlen(key) >= sizeof(s_nvs[0].key)) return ESP_ERR_INVALID_ARG;
+    nvs_entry_t* e = nvs_find(h, key);
+    for (int i = 0; !e && i < NVS_MAX_KEYS; i++) {
+        if (!s_nvs[i].used) e = &s_nvs[i];
+    }
+    if (!e) return ESP_ERR_NO_MEM;
+    e->used = true;
+    e->ns = h;
+    strcpy(e->key, key);
+    memcpy(e->value, value, len);
+    e->len = len;
+    return ESP_OK;
+}
+
+static esp_err_t nvs_take(nvs_handle_t h, const char* key, void* out, size_t len)
+{
+    const nvs_entry_t* e = nvs_find(h, key);
+    if (!e) return ESP_ERR_NVS_NOT_FOUND;
+    if (e->len != len) return ESP_ERR_INVALID_SIZE;
+    memcpy(out, e->value, len);
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t h, const char* key)
+{
+    nvs_entry_t* e = nvs_find(h, key);
+    if (!e) return ESP_ERR_NVS_NOT_FOUND;
+    e->used = false;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_i32(nvs_handle_t h, const char* key, int32_t* out) { return nvs_take(h, key, out, sizeof(*out)); }
+esp_err_t nvs_set_i32(nvs_handle_t h, const char* key, int32_t value) { return nvs_put(h, key, &value, sizeof(value)); }
+esp_err_t nvs_get_i64(nvs_handle_t h, const char* key, int64_t* out) { return nvs_take(h, key, out, sizeof(*out)); }
+esp_err_t nvs_set_i64(nvs_handle_t h, const char* key, int64_t value) { return nvs_put(h, key, &value, sizeof(value)); }
+esp_err_t nvs_get_u8(nvs_handle_t h, const char* key, uint8_t* out) { return nvs_take(h, key, out, sizeof(*out)); }
+esp_err_t nvs_set_u8(nvs_handle_t h, const char* key, uint8_t value) { return nvs_put(h, key, &value, sizeof(value)); }
+
+esp_err_t nvs_set_str(nvs_handle_t h, const char* key, const char* value)
+{
+    return nvs_put(h, key, value, strlen(value) + 1);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t h, const char* key, const void* value, size_t len)
+{
+    return nvs_put(h, key, value, len);
+}
+
+// Like NVS: out == NULL asks for the length, a short buffer is an error
+static esp_err_t nvs_get_var(nvs_handle_t h, const char* key, void* out, size_t* len)
+{
+    const nvs_entry_t* e = nvs_find(h, key);
+    if (!e) return ESP_ERR_NVS_NOT_FOUND;
+    if (out) {
+        if (*len < e->len) return ESP_ERR_INVALID_SIZE;
+        memcpy(out, e->value, e->len);
+    }
+    *len = e->len;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_str(nvs_handle_t h, const char* key, char* out, size_t* len) { return nvs_get_var(h, key, out, len); }
+esp_err_t nvs_get_blob(nvs_handle_t h, const char* key, void* out, size_t* len) { return nvs_get_var(h, key, out, len); }
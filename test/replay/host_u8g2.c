@@ -0,0 +1,258 @@
+// Stand-in for u8g2 when components/u8g2 is not checked out: a 128x64 full page
+// buffer in the SSD1309 layout and three generated fonts with roughly the metrics
+// of the real ones. Glyphs are encoded in u8g2's RLE format so glyph_cache.c decodes
+// and blits them exactly as on the device; only their shapes are made up.
+#include <stdbool.h>
+#include <string.h>
+
+#include "u8g2.h"
+
+#define HOST_FB_W       128
+#define HOST_FB_H       64
+#define FIRST_GLYPH     0x20
+#define GLYPH_COUNT     95
+#define GLYPH_DATA_MAX  96
+
+// Field widths in bits, as a u8g2 font header gives them
+#define BITS_0  3
+#define BITS_1  2
+#define BITS_W  4
+#define BITS_H  5
+#define BITS_X  3
+#define BITS_Y  3
+#define BITS_DX 5
+
+typedef struct {
+    uint8_t w, h, dx;
+    int8_t descent;
+    bool built;
+    uint8_t data[GLYPH_COUNT][GLYPH_DATA_MAX];
+} host_font_t;
+
+// The font "data" is an index into s_fonts
+const uint8_t u8g2_font_ncenB08_tr[] = { 0 };
+const uint8_t u8g2_font_ncenB12_tr[] = { 1 };
+const uint8_t u8g2_font_5x8_tr[] = { 2 };
+
+static host_font_t s_fonts[] = {
+    { .w = 5, .h = 8,  .dx = 6,  .descent = -2 },
+    { .w = 8, .h = 12, .dx = 9,  .descent = -3 },
+    { .w = 4, .h = 6,  .dx = 5,  .descent = -1 },
+};
+
+static uint8_t s_buf[HOST_FB_W * HOST_FB_H / 8];
+const u8g2_cb_t u8g2_cb_r0;
+
+// Made-up but stable glyph shape: a frame with a few character dependent bits inside
+static bool glyph_px(const host_font_t* f, uint8_t ch, int x, int y)
+{
+    if (ch == ' ') return false;
+    if (x == 0 || y == 0 || x == f->w - 1 || y == f->h - 1) return true;
+    const uint32_t bits = (uint32_t)ch * 2654435761u;
+    return (bits >> ((x + y * 3) & 31)) & 1;
+}
+
+static void put_bits(uint8_t* data, int* bitpos, unsigned v, int n)
+{
+    for (int i = 0; i < n; i++, (*bitpos)++) {
+        if ((v >> i) & 1) data[*bitpos / 8] |= (uint8_t)(1 << (*bitpos % 8));
+    }
+}
+
+// Runs of at most 7 zeros and 3 ones, repeat bit set when the next pair is the same
+static void encode_glyph(host_font_t* f, uint8_t ch)
+{
+    uint8_t* data = f->data[ch - FIRST_GLYPH];
+    memset(data, 0, GLYPH_DATA_MAX);
+    const int w = (ch == ' ') ? 0 : f->w;
+    const int h = (ch == ' ') ? 0 : f->h;
+    int bp = 0;
+    put_bits(data, &bp, w, BITS_W);
+    put_bits(data, &bp, h, BITS_H);
+    put_bits(data, &bp, 1 << (BITS_X - 1), BITS_X);    // x = 0
+    put_bits(data, &bp, 1 << (BITS_Y - 1), BITS_Y);    // y = 0
+    put_bits(data, &bp, f->dx + (1 << (BITS_DX - 1)), BITS_DX);
+
+    const int n = w * h;
+    int last_a = -1, last_b = -1;
+    for (int i = 0; i < n;) {
+        int a = 0, b = 0;
+        while (i < n && !glyph_px(f, ch, i % w, i / w) && a < 7) { a++; i++; }
+        while (i < n && glyph_px(f, ch, i % w, i / w) && b < 3) { b++; i++; }
+        if (a == last_a && b == last_b) {
+            put_bits(data, &bp, 1, 1);
+        } else {
+            if (last_a >= 0) put_bits(data, &bp, 0, 1);
+            put_bits(data, &bp, a, BITS_0);
+            put_bits(data, &bp, b, BITS_1);
+        }
+        last_a = a;
+        last_b = b;
+    }
+    if (last_a >= 0) put_bits(data, &bp, 0, 1);
+}
+
+static host_font_t* current_font(u8g2_t* u8g2)
+{
+    return u8g2->font ? &s_fonts[u8g2->font[0]] : &s_fonts[0];
+}
+
+const uint8_t* u8g2_font_get_glyph_data(u8g2_t* u8g2, uint16_t encoding)
+{
+    if (encoding < FIRST_GLYPH || encoding >= FIRST_GLYPH + GLYPH_COUNT) return NULL;
+    return current_font(u8g2)->data[encoding - FIRST_GLYPH];
+}
+
+u8g2_uint_t u8g2_font_calc_vref_font(u8g2_t* u8g2)
+{
+    return 0;
+}
+
+static void send_cmd(u8g2_t* u8g2, uint8_t cmd)
+{
+    u8x8_t* u8x8 = &u8g2->u8x8;
+    u8x8->byte_cb(u8x8, U8X8_MSG_BYTE_START_TRANSFER, 0, NULL);
+    u8x8->byte_cb(u8x8, U8X8_MSG_BYTE_SET_DC, 0, NULL);
+    u8x8->byte_cb(u8x8, U8X8_MSG_BYTE_SEND, 1, &cmd);
+    u8x8->byte_cb(u8x8, U8X8_MSG_BYTE_END_TRANSFER, 0, NULL);
+}
+
+void u8g2_Setup_ssd1309_128x64_noname2_f(u8g2_t* u8g2, const u8g2_cb_t* rotation,
+                                         u8x8_msg_cb byte_cb, u8x8_msg_cb gpio_and_delay_cb)
+{
+    memset(u8g2, 0, sizeof(*u8g2));
+    u8g2->u8x8.byte_cb = byte_cb;
+    u8g2->u8x8.gpio_and_delay_cb = gpio_and_delay_cb;
+    u8g2->cb = rotation;
+    u8g2->tile_buf_ptr = s_buf;
+    u8g2->tile_buf_height = HOST_FB_H / 8;
+    u8g2->tile_width = HOST_FB_W / 8;
+    u8g2->width = HOST_FB_W;
+    u8g2->height = HOST_FB_H;
+    u8g2->draw_color = 1;
+    u8g2->font_calc_vref = u8g2_font_calc_vref_font;
+    u8g2->font_info.bits_per_0 = BITS_0;
+    u8g2->font_info.bits_per_1 = BITS_1;
+    u8g2->font_info.bits_per_char_width = BITS_W;
+    u8g2->font_info.bits_per_char_height = BITS_H;
+    u8g2->font_info.bits_per_char_x = BITS_X;
+    u8g2->font_info.bits_per_char_y = BITS_Y;
+    u8g2->font_info.bits_per_delta_x = BITS_DX;
+
+    for (size_t i = 0; i < sizeof(s_fonts) / sizeof(s_fonts[0]); i++) {
+        if (s_fonts[i].built) continue;
+        for (int ch = FIRST_GLYPH; ch < FIRST_GLYPH + GLYPH_COUNT; ch++) encode_glyph(&s_fonts[i], (uint8_t)ch);
+        s_fonts[i].built = true;
+    }
+}
+
+void u8g2_InitDisplay(u8g2_t* u8g2)
+{
+    u8x8_t* u8x8 = &u8g2->u8x8;
+    u8x8->gpio_and_delay_cb(u8x8, U8X8_MSG_GPIO_AND_DELAY_INIT, 0, NULL);
+    u8x8->byte_cb(u8x8, U8X8_MSG_BYTE_INIT, 0, NULL);
+    send_cmd(u8g2, 0xAE);   // display off, as the SSD1309 init sequence starts
+}
+
+void u8g2_SetPowerSave(u8g2_t* u8g2, uint8_t is_enable)
+{
+    send_cmd(u8g2, is_enable ? 0xAE : 0xAF);
+}
+
+void u8g2_ClearBuffer(u8g2_t* u8g2)
+{
+    memset(u8g2->tile_buf_ptr, 0, sizeof(s_buf));
+}
+
+void u8g2_SendBuffer(u8g2_t* u8g2)
+{
+    u8x8_t* u8x8 = &u8g2->u8x8;
+    for (int page = 0; page < HOST_FB_H / 8; page++) {
+        uint8_t cmd[3] = { (uint8_t)(0xB0 | page), 0x00, 0x10 };
+        u8x8->byte_cb(u8x8, U8X8_MSG_BYTE_START_TRANSFER, 0, NULL);
+        u8x8->byte_cb(u8x8, U8X8_MSG_BYTE_SET_DC, 0, NULL);
+        u8x8->byte_cb(u8x8, U8X8_MSG_BYTE_SEND, sizeof(cmd), cmd);
+        u8x8->byte_cb(u8x8, U8X8_MSG_BYTE_SET_DC, 1, NULL);
+        u8x8->byte_cb(u8x8, U8X8_MSG_BYTE_SEND, HOST_FB_W, u8g2->tile_buf_ptr + page * HOST_FB_W);
+        u8x8->byte_cb(u8x8, U8X8_MSG_BYTE_END_TRANSFER, 0, NULL);
+    }
+}
+
+void u8g2_SetFont(u8g2_t* u8g2, const uint8_t* font)
+{
+    const host_font_t* f = &s_fonts[font[0]];
+    u8g2->font = font;
+    u8g2->font_info.ascent_A = (int8_t)f->h;
+    u8g2->font_info.descent_g = f->descent;
+}
+
+void u8g2_SetDrawColor(u8g2_t* u8g2, uint8_t color)
+{
+    u8g2->draw_color = color;
+}
+
+static void pixel(u8g2_t* u8g2, int x, int y, uint8_t color)
+{
+    if (x < 0 || y < 0 || x >= HOST_FB_W || y >= HOST_FB_H) return;
+    uint8_t* dst = &u8g2->tile_buf_ptr[(y / 8) * HOST_FB_W + x];
+    const uint8_t bit = (uint8_t)(1 << (y % 8));
+    if (color == 0) *dst &= (uint8_t)~bit;
+    else if (color == 1) *dst |= bit;
+    else *dst ^= bit;
+}
+
+void u8g2_DrawPixel(u8g2_t* u8g2, u8g2_uint_t x, u8g2_uint_t y)
+{
+    pixel(u8g2, (int16_t)x, (int16_t)y, u8g2->draw_color);
+}
+
+void u8g2_DrawHLine(u8g2_t* u8g2, u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t len)
+{
+    for (int i = 0; i < len; i++) pixel(u8g2, (int16_t)x + i, (int16_t)y, u8g2->draw_color);
+}
+
+void u8g2_DrawBox(u8g2_t* u8g2, u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w, u8g2_uint_t h)
+{
+    for (int r = 0; r < h; r++) u8g2_DrawHLine(u8g2, x, (u8g2_uint_t)(y + r), w);
+}
+
+void u8g2_DrawFrame(u8g2_t* u8g2, u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w, u8g2_uint_t h)
+{
+    if (w == 0 || h == 0) return;
+    u8g2_DrawHLine(u8g2, x, y, w);
+    u8g2_DrawHLine(u8g2, x, (u8g2_uint_t)(y + h - 1), w);
+    for (int r = 1; r + 1 < h; r++) {
+        pixel(u8g2, (int16_t)x, (int16_t)y + r, u8g2->draw_color);
+        pixel(u8g2, (int16_t)x + w - 1, (int16_t)y + r, u8g2->draw_color);
+    }
+}
+
+// Baseline at y; solid font mode paints the background in the other colour
+u8g2_uint_t u8g2_DrawStr(u8g2_t* u8g2, u8g2_uint_t x, u8g2_uint_t y, const char* str)
+{
+    const host_font_t* f = current_font(u8g2);
+    const uint8_t color = u8g2->draw_color;
+    const bool solid = (u8g2->font_decode.is_transparent == 0);
+    int pen = (int16_t)x;
+    for (const uint8_t* p = (const uint8_t*)str; *p; p++, pen += f->dx) {
+        if (*p < FIRST_GLYPH || *p >= FIRST_GLYPH + GLYPH_COUNT || *p == ' ') continue;
+        const int top = (int16_t)y - f->h;
+        for (int r = 0; r < f->h; r++) {
+            for (int c = 0; c < f->w; c++) {
+                if (glyph_px(f, *p, c, r)) pixel(u8g2, pen + c, top + r, color);
+                else if (solid) pixel(u8g2, pen + c, top + r, color == 1 ? 0 : (color == 0 ? 1 : 2));
+            }
+        }
+    }
+    return (u8g2_uint_t)(pen - (int16_t)x);
+}
+
+// Sum of advances, the last glyph counted by its own width, as u8g2 does
+u8g2_uint_t u8g2_GetStrWidth(u8g2_t* u8g2, const char* s)
+{
+    const host_font_t* f = current_font(u8g2);
+    const size_t n = strlen(s);
+    if (n == 0) return 0;
+    const bool last_blank = (s[n - 1] == ' ');
+    return (u8g2_uint_t)((n - 1) * f->dx + (last_blank ? f->dx : f->w));
+}
@@ -0,0 +1,52 @@
+// Runs a recorded session through the UI on the host:
+//   replay_host <trace.trc>
+// The trace is a trace_tool.py file. main.c, trace.c, fmt.c, display.c and the
+// other UI modules are the firmware's own; the radios, HTTP and storage modules
+// are fakes (host_fakes.c) and the IDF underneath is host_idf.c. Prints the same
+// REPLAY report as the 'p' command on the device. A trace that ends in Shutdown
+// boots once more from the snapshot (host_reboot) and logs the restore time.
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "main.h"
+
+#include <driver/spi_master.h>
+
+// The boot after Shutdown's deep sleep, up to the first frame as in app_main. RAM is
+// not cleared, but the resume path sets everything the restored screen draws from.
+void host_reboot(void)
+{
+    time_service_init();
+    ui_resume_or_start();
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <trace.trc>\n", argv[0]);
+        return 2;
+    }
+    FILE* f = fopen(argv[1], "rb");
+    if (!f) {
+        perror(argv[1]);
+        return 1;
+    }
+    static uint8_t buf[TRACE_BUF_SIZE + 1];
+    const size_t len = fread(buf, 1, sizeof(buf), f);
+    fclose(f);
+
+    const esp_err_t err = trace_load(buf, len);
+    if (err != ESP_OK) {
+        fprintf(stderr, "%s: not a trace of at most %d bytes (%s)\n", argv[1], TRACE_BUF_SIZE, esp_err_to_name(err));
+        return 1;
+    }
+
+    ui_display_init();
+    ESP_ERROR_CHECK(nvs_flash_init());
+    settings_init();
+    time_service_init();
+
+    ui_run_replay();
+    printf("SPI %llu bytes\n", (unsigned long long)host_spi_bytes());
+    return 0;
+}
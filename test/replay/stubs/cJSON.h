@@ -0,0 +1,42 @@
+#ifndef CJSON_STUB
+#define CJSON_STUB
+
+#include <stdbool.h>
+
+// The part of cJSON the parsers in main/ use, with the same item layout and type
+// bits, implemented in test/replay/host_cjson.c
+
+#define cJSON_Invalid   0
+#define cJSON_False     (1 << 0)
+#define cJSON_True      (1 << 1)
+#define cJSON_NULL      (1 << 2)
+#define cJSON_Number    (1 << 3)
+#define cJSON_String    (1 << 4)
+#define cJSON_Array     (1 << 5)
+#define cJSON_Object    (1 << 6)
+
+typedef struct cJSON {
+    struct cJSON* next;
+    struct cJSON* prev;
+    struct cJSON* child;
+    int type;
+    char* valuestring;
+    int valueint;
+    double valuedouble;
+    char* string;
+} cJSON;
+
+cJSON* cJSON_Parse(const char* value);
+void cJSON_Delete(cJSON* item);
+
+// Keys compare case-insensitively, as in cJSON
+cJSON* cJSON_GetObjectItem(const cJSON* object, const char* key);
+cJSON* cJSON_GetArrayItem(const cJSON* array, int index);
+char* cJSON_GetStringValue(const cJSON* item);
+
+bool cJSON_IsNumber(const cJSON* item);
+bool cJSON_IsString(const cJSON* item);
+bool cJSON_IsArray(const cJSON* item);
+bool cJSON_IsObject(const cJSON* item);
+
+#endif /* CJSON_STUB */
@@ -0,0 +1,13 @@
+#ifndef DRIVER_GPIO_STUB
+#define DRIVER_GPIO_STUB
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef int gpio_num_t;
+
+typedef enum { GPIO_PULLUP_DISABLE, GPIO_PULLUP_ENABLE } gpio_pullup_t;
+
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level);
+
+#endif /* DRIVER_GPIO_STUB */
@@ -0,0 +1,63 @@
+#ifndef DRIVER_SPI_MASTER_STUB
+#define DRIVER_SPI_MASTER_STUB
+
+// Transactions complete as soon as they are queued: the pre and post callbacks run
+// inside spi_device_queue_trans / spi_device_polling_transmit and the result is
+// ready for spi_device_get_trans_result. Bytes sent are counted (host_spi_bytes).
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+typedef enum { SPI1_HOST, SPI2_HOST } spi_host_device_t;
+#define SPI_DMA_CH_AUTO         3
+#define SPI_TRANS_USE_TXDATA    (1 << 3)
+
+typedef struct {
+    int mosi_io_num;
+    int miso_io_num;
+    int sclk_io_num;
+    int quadwp_io_num;
+    int quadhd_io_num;
+    int max_transfer_sz;
+} spi_bus_config_t;
+
+typedef struct spi_transaction_t spi_transaction_t;
+typedef void (*transaction_cb_t)(spi_transaction_t* trans);
+
+struct spi_transaction_t {
+    uint32_t flags;
+    size_t length;              // bits
+    size_t rxlength;
+    void* user;
+    union {
+        const void* tx_buffer;
+        uint8_t tx_data[4];
+    };
+    union {
+        void* rx_buffer;
+        uint8_t rx_data[4];
+    };
+};
+
+typedef struct {
+    uint8_t mode;
+    int clock_speed_hz;
+    int spics_io_num;
+    int queue_size;
+    transaction_cb_t pre_cb;
+    transaction_cb_t post_cb;
+} spi_device_interface_config_t;
+
+typedef struct spi_device_t* spi_device_handle_t;
+
+esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t* bus, int dma_chan);
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t* dev,
+                             spi_device_handle_t* out);
+esp_err_t spi_device_queue_trans(spi_device_handle_t dev, spi_transaction_t* t, TickType_t wait);
+esp_err_t spi_device_get_trans_result(spi_device_handle_t dev, spi_transaction_t** t, TickType_t wait);
+esp_err_t spi_device_polling_transmit(spi_device_handle_t dev, spi_transaction_t* t);
+
+uint64_t host_spi_bytes(void);
+
+#endif /* DRIVER_SPI_MASTER_STUB */
@@ -0,0 +1,9 @@
+#ifndef ESP_ATTR_STUB
+#define ESP_ATTR_STUB
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+
+#endif /* ESP_ATTR_STUB */
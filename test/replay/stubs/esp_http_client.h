@@ -0,0 +1,7 @@
+#ifndef ESP_HTTP_CLIENT_STUB
+#define ESP_HTTP_CLIENT_STUB
+
+// Types only: the HTTP modules are replaced by fakes on the host
+typedef struct esp_http_client* esp_http_client_handle_t;
+
+#endif /* ESP_HTTP_CLIENT_STUB */
@@ -0,0 +1,63 @@
+#ifndef ESP_HTTP_SERVER_STUB
+#define ESP_HTTP_SERVER_STUB
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "esp_err.h"
+
+// The esp_http_server calls http_api.c makes, served by test/replay/host_httpd.c
+// from one thread on a POSIX socket: one request per connection, GET handlers
+// matched on the exact path, responses chunked as on the device.
+
+#define HTTPD_MAX_URI_LEN   512
+
+typedef void* httpd_handle_t;
+
+typedef enum {
+    HTTP_GET = 1,
+    HTTP_POST = 3,
+} httpd_method_t;
+
+typedef struct {
+    uint16_t server_port;
+    uint16_t max_uri_handlers;
+    bool lru_purge_enable;
+} httpd_config_t;
+
+#define HTTPD_DEFAULT_CONFIG() { .server_port = 80, .max_uri_handlers = 8, .lru_purge_enable = false }
+
+typedef struct httpd_req {
+    httpd_handle_t handle;
+    int method;
+    const char uri[HTTPD_MAX_URI_LEN + 1];
+    size_t content_len;
+    void* user_ctx;
+    void* aux;              // the host connection
+} httpd_req_t;
+
+typedef struct httpd_uri {
+    const char* uri;
+    httpd_method_t method;
+    esp_err_t (*handler)(httpd_req_t* r);
+    void* user_ctx;
+} httpd_uri_t;
+
+esp_err_t httpd_start(httpd_handle_t* handle, const httpd_config_t* config);
+esp_err_t httpd_stop(httpd_handle_t handle);
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t* uri_handler);
+
+esp_err_t httpd_resp_set_status(httpd_req_t* r, const char* status);
+esp_err_t httpd_resp_set_type(httpd_req_t* r, const char* type);
+esp_err_t httpd_resp_set_hdr(httpd_req_t* r, const char* field, const char* value);
+esp_err_t httpd_resp_send_chunk(httpd_req_t* r, const char* buf, ssize_t len);
+esp_err_t httpd_resp_send(httpd_req_t* r, const char* buf, ssize_t len);
+
+#define HTTPD_RESP_USE_STRLEN -1
+
+// Host only: -1 listens on the configured port, 0 on any free one. Holds the port
+// bound after httpd_start.
+extern int host_httpd_port;
+
+#endif /* ESP_HTTP_SERVER_STUB */
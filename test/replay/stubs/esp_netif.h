@@ -0,0 +1,20 @@
+#ifndef ESP_NETIF_STUB
+#define ESP_NETIF_STUB
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef struct esp_netif_obj esp_netif_t;
+
+typedef struct { uint32_t addr; } esp_ip4_addr_t;
+
+typedef struct {
+    esp_ip4_addr_t ip;
+    esp_ip4_addr_t netmask;
+    esp_ip4_addr_t gw;
+} esp_netif_ip_info_t;
+
+esp_netif_t* esp_netif_get_handle_from_ifkey(const char* key);
+esp_err_t esp_netif_get_ip_info(esp_netif_t* netif, esp_netif_ip_info_t* info);
+
+#endif /* ESP_NETIF_STUB */
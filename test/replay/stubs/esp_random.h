@@ -0,0 +1,9 @@
+#ifndef ESP_RANDOM_STUB
+#define ESP_RANDOM_STUB
+
+#include <stdint.h>
+
+// Seeded, so replays of the same trace are repeatable
+uint32_t esp_random(void);
+
+#endif /* ESP_RANDOM_STUB */
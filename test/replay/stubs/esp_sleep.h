@@ -0,0 +1,14 @@
+#ifndef ESP_SLEEP_STUB
+#define ESP_SLEEP_STUB
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// Boots again through host_reboot(), then ends the host process
+void esp_deep_sleep_start(void) __attribute__((noreturn));
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us);
+
+// Host only, defined by the replay executable: the boot after a deep sleep
+void host_reboot(void);
+
+#endif /* ESP_SLEEP_STUB */
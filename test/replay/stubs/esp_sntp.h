@@ -0,0 +1,21 @@
+#ifndef ESP_SNTP_STUB
+#define ESP_SNTP_STUB
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+typedef enum { SNTP_OPMODE_POLL, SNTP_OPMODE_LISTENONLY } esp_sntp_operatingmode_t;
+typedef enum { SNTP_SYNC_MODE_IMMED, SNTP_SYNC_MODE_SMOOTH } sntp_sync_mode_t;
+typedef void (*sntp_sync_time_cb_t)(struct timeval* tv);
+
+void esp_sntp_setoperatingmode(esp_sntp_operatingmode_t mode);
+void esp_sntp_setservername(uint8_t idx, const char* server);
+void esp_sntp_init(void);
+void esp_sntp_stop(void);
+bool esp_sntp_restart(void);
+bool esp_sntp_enabled(void);
+void sntp_set_sync_mode(sntp_sync_mode_t mode);
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback);
+
+#endif /* ESP_SNTP_STUB */
@@ -0,0 +1,30 @@
+#ifndef ESP_WIFI_STUB
+#define ESP_WIFI_STUB
+
+// Never associated
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_netif.h"
+
+typedef enum {
+    WIFI_AUTH_OPEN,
+    WIFI_AUTH_WEP,
+    WIFI_AUTH_WPA_PSK,
+    WIFI_AUTH_WPA2_PSK,
+    WIFI_AUTH_WPA_WPA2_PSK,
+    WIFI_AUTH_WPA3_PSK = 6,
+} wifi_auth_mode_t;
+
+typedef struct {
+    uint8_t bssid[6];
+    uint8_t ssid[33];
+    uint8_t primary;
+    int8_t rssi;
+    wifi_auth_mode_t authmode;
+} wifi_ap_record_t;
+
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t* info);
+esp_err_t esp_wifi_sta_get_rssi(int* rssi);
+esp_err_t esp_wifi_stop(void);
+
+#endif /* ESP_WIFI_STUB */
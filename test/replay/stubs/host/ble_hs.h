@@ -0,0 +1,6 @@
+#ifndef HOST_BLE_HS_STUB
+#define HOST_BLE_HS_STUB
+
+// ble.h pulls NimBLE in; nothing from it is used on the host
+
+#endif /* HOST_BLE_HS_STUB */
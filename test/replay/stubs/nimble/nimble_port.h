@@ -0,0 +1,6 @@
+#ifndef NIMBLE_NIMBLE_PORT_STUB
+#define NIMBLE_NIMBLE_PORT_STUB
+
+// ble.h pulls NimBLE in; nothing from it is used on the host
+
+#endif /* NIMBLE_NIMBLE_PORT_STUB */
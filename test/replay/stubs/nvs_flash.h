@@ -0,0 +1,9 @@
+#ifndef NVS_FLASH_STUB
+#define NVS_FLASH_STUB
+
+#include "nvs.h"
+
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_flash_erase(void);
+
+#endif /* NVS_FLASH_STUB */
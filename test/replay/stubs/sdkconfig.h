@@ -0,0 +1,7 @@
+#ifndef SDKCONFIG_STUB
+#define SDKCONFIG_STUB
+
+// host_idf.c feeds malloc through the heap hooks, as the firmware's heap does
+#define CONFIG_HEAP_USE_HOOKS 1
+
+#endif /* SDKCONFIG_STUB */
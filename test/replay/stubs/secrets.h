@@ -0,0 +1,6 @@
+#ifndef SECRETS_STUB
+#define SECRETS_STUB
+
+#define API_KEY ""
+
+#endif /* SECRETS_STUB */
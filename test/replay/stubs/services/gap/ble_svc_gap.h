@@ -0,0 +1,6 @@
+#ifndef SERVICES_GAP_BLE_SVC_GAP_STUB
+#define SERVICES_GAP_BLE_SVC_GAP_STUB
+
+// ble.h pulls NimBLE in; nothing from it is used on the host
+
+#endif /* SERVICES_GAP_BLE_SVC_GAP_STUB */
@@ -0,0 +1,6 @@
+#ifndef SERVICES_GATT_BLE_SVC_GATT_STUB
+#define SERVICES_GATT_BLE_SVC_GATT_STUB
+
+// ble.h pulls NimBLE in; nothing from it is used on the host
+
+#endif /* SERVICES_GATT_BLE_SVC_GATT_STUB */
@@ -0,0 +1,25 @@
+#ifndef U8G2_ESP32_HAL_STUB
+#define U8G2_ESP32_HAL_STUB
+
+#include <u8g2.h>
+
+typedef struct {
+    int clk;
+    int mosi;
+    int sda;
+    int scl;
+    int cs;
+    int reset;
+    int dc;
+} u8g2_esp32_hal_t;
+
+#define U8G2_ESP32_HAL_UNDEFINED    (-1)
+#define U8G2_ESP32_HAL_DEFAULT { U8G2_ESP32_HAL_UNDEFINED, U8G2_ESP32_HAL_UNDEFINED, \
+                                 U8G2_ESP32_HAL_UNDEFINED, U8G2_ESP32_HAL_UNDEFINED, \
+                                 U8G2_ESP32_HAL_UNDEFINED, U8G2_ESP32_HAL_UNDEFINED, \
+                                 U8G2_ESP32_HAL_UNDEFINED }
+
+void u8g2_esp32_hal_init(u8g2_esp32_hal_t param);
+uint8_t u8g2_esp32_gpio_and_delay_cb(u8x8_t* u8x8, uint8_t msg, uint8_t arg_int, void* arg_ptr);
+
+#endif /* U8G2_ESP32_HAL_STUB */
@@ -0,0 +1,9 @@
+#ifndef WIFI_CONFIG_STUB
+#define WIFI_CONFIG_STUB
+
+// Empty credentials: wifi_store starts with no networks
+#define WIFI_SSID       ""
+#define WIFI_PASSWORD   ""
+#define MQTT_BROKER_URI "mqtt://localhost"
+
+#endif /* WIFI_CONFIG_STUB */
@@ -0,0 +1,13 @@
+#ifndef ESP_ROM_CRC_STUB
+#define ESP_ROM_CRC_STUB
+
+#include <stdint.h>
+#include <zlib.h>
+
+// The ROM's little endian CRC32 chains the same way as zlib's
+static inline uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len)
+{
+    return (uint32_t)crc32(crc, buf, len);
+}
+
+#endif /* ESP_ROM_CRC_STUB */
@@ -0,0 +1,29 @@
+#ifndef HOST_COMPAT
+#define HOST_COMPAT
+
+// Bits of newlib the firmware relies on that glibc may lack
+#include <string.h>
+
+#if !defined(__GLIBC__) || !__GLIBC_PREREQ(2, 38)
+static inline size_t host_strlcpy(char* dst, const char* src, size_t size)
+{
+    size_t len = strlen(src);
+    if (size) {
+        size_t n = (len < size - 1) ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+#define strlcpy host_strlcpy
+
+static inline size_t host_strlcat(char* dst, const char* src, size_t size)
+{
+    size_t dlen = strnlen(dst, size);
+    if (dlen == size) return size + strlen(src);
+    return dlen + host_strlcpy(dst + dlen, src, size - dlen);
+}
+#define strlcat host_strlcat
+#endif
+
+#endif /* HOST_COMPAT */
@@ -0,0 +1,55 @@
+#ifndef ROM_MINIZ_STUB
+#define ROM_MINIZ_STUB
+
+// The slice of the ROM tinfl API inflate_stream.c uses, backed on the host by zlib
+// (test/tinfl_host.c). zlib gives unused input back at the end of the stream and
+// tinfl does not: at TINFL_STATUS_DONE the ROM's bit buffer can still hold input
+// bytes past the deflate data. The host version holds back tinfl_host_lookahead
+// whole bytes (plus the padding bits) the same way, so callers see that case.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <zlib.h>
+
+typedef uint32_t mz_uint32;
+typedef uint64_t tinfl_bit_buf_t;
+
+#define TINFL_LZ_DICT_SIZE 32768
+
+enum {
+    TINFL_FLAG_PARSE_ZLIB_HEADER = 1,
+    TINFL_FLAG_HAS_MORE_INPUT = 2,
+    TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF = 4,
+    TINFL_FLAG_COMPUTE_ADLER32 = 8,
+};
+
+typedef enum {
+    TINFL_STATUS_BAD_PARAM = -3,
+    TINFL_STATUS_ADLER32_MISMATCH = -2,
+    TINFL_STATUS_FAILED = -1,
+    TINFL_STATUS_DONE = 0,
+    TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+    TINFL_STATUS_HAS_MORE_OUTPUT = 2,
+} tinfl_status;
+
+typedef struct {
+    mz_uint32 m_state, m_num_bits;
+    tinfl_bit_buf_t m_bit_buf;
+
+    // host only: zlib state, allocated from the arena so free() of the owner is enough
+    z_stream m_zs;
+    uint8_t m_recent[8];        // the last input bytes zlib took, oldest first
+    size_t m_arena_used;
+    uint8_t m_arena[48 * 1024];
+} tinfl_decompressor;
+
+#define tinfl_init(r) do { (r)->m_state = 0; } while (0)
+
+// Whole bytes left in the bit buffer at TINFL_STATUS_DONE, when the input has them
+extern unsigned tinfl_host_lookahead;
+
+tinfl_status tinfl_decompress(tinfl_decompressor* r, const uint8_t* pIn_buf_next, size_t* pIn_buf_size,
+                              uint8_t* pOut_buf_start, uint8_t* pOut_buf_next, size_t* pOut_buf_size,
+                              const mz_uint32 decomp_flags);
+
+#endif /* ROM_MINIZ_STUB */
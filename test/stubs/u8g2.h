@@ -0,0 +1,96 @@
+#ifndef U8G2_STUB
+#define U8G2_STUB
+
+// The parts of u8g2's state that glyph_cache.c reads. Field names follow u8g2.h;
+// the test builds the font header and glyph data itself. The drawing API below is
+// implemented by test/replay/host_u8g2.c for the replay build.
+#include <stdint.h>
+
+typedef uint16_t u8g2_uint_t;
+
+typedef struct u8x8_struct u8x8_t;
+typedef uint8_t (*u8x8_msg_cb)(u8x8_t* u8x8, uint8_t msg, uint8_t arg_int, void* arg_ptr);
+
+struct u8x8_struct {
+    u8x8_msg_cb byte_cb;
+    u8x8_msg_cb gpio_and_delay_cb;
+};
+
+#define U8X8_MSG_BYTE_INIT              20
+#define U8X8_MSG_BYTE_SET_DC            32
+#define U8X8_MSG_BYTE_SEND              23
+#define U8X8_MSG_BYTE_START_TRANSFER    24
+#define U8X8_MSG_BYTE_END_TRANSFER      25
+#define U8X8_MSG_GPIO_AND_DELAY_INIT    40
+
+typedef struct {
+    uint8_t glyph_cnt;
+    uint8_t bbx_mode;
+    uint8_t bits_per_0;
+    uint8_t bits_per_1;
+    uint8_t bits_per_char_width;
+    uint8_t bits_per_char_height;
+    uint8_t bits_per_char_x;
+    uint8_t bits_per_char_y;
+    uint8_t bits_per_delta_x;
+    int8_t ascent_A;
+    int8_t descent_g;
+} u8g2_font_info_t;
+
+typedef struct {
+    uint8_t is_transparent;
+    uint8_t dir;
+} u8g2_font_decode_t;
+
+typedef struct u8g2_struct u8g2_t;
+typedef struct { int unused; } u8g2_cb_t;
+
+extern const u8g2_cb_t u8g2_cb_r0;
+#define U8G2_R0 (&u8g2_cb_r0)
+
+struct u8g2_struct {
+    u8x8_t u8x8;
+    const u8g2_cb_t* cb;
+    uint8_t* tile_buf_ptr;
+    uint8_t tile_buf_height;
+    uint8_t tile_curr_row;
+    uint8_t draw_color;
+    const uint8_t* font;
+    u8g2_font_info_t font_info;
+    u8g2_font_decode_t font_decode;
+    u8g2_uint_t (*font_calc_vref)(u8g2_t*);
+    u8g2_uint_t width;
+    u8g2_uint_t height;
+    uint8_t tile_width;
+};
+
+u8g2_uint_t u8g2_font_calc_vref_font(u8g2_t* u8g2);
+const uint8_t* u8g2_font_get_glyph_data(u8g2_t* u8g2, uint16_t encoding);
+u8g2_uint_t u8g2_DrawStr(u8g2_t* u8g2, u8g2_uint_t x, u8g2_uint_t y, const char* str);
+u8g2_uint_t u8g2_GetStrWidth(u8g2_t* u8g2, const char* s);
+
+#define u8g2_GetBufferTileWidth(u) ((u)->tile_width)
+#define u8g2_GetDisplayWidth(u) ((u)->width)
+#define u8g2_GetDisplayHeight(u) ((u)->height)
+#define u8g2_GetBufferPtr(u) ((u)->tile_buf_ptr)
+#define u8g2_GetAscent(u) ((u)->font_info.ascent_A)
+#define u8g2_GetDescent(u) ((u)->font_info.descent_g)
+
+void u8g2_Setup_ssd1309_128x64_noname2_f(u8g2_t* u8g2, const u8g2_cb_t* rotation,
+                                         u8x8_msg_cb byte_cb, u8x8_msg_cb gpio_and_delay_cb);
+void u8g2_InitDisplay(u8g2_t* u8g2);
+void u8g2_SetPowerSave(u8g2_t* u8g2, uint8_t is_enable);
+void u8g2_ClearBuffer(u8g2_t* u8g2);
+void u8g2_SendBuffer(u8g2_t* u8g2);
+void u8g2_SetFont(u8g2_t* u8g2, const uint8_t* font);
+void u8g2_SetDrawColor(u8g2_t* u8g2, uint8_t color);
+void u8g2_DrawPixel(u8g2_t* u8g2, u8g2_uint_t x, u8g2_uint_t y);
+void u8g2_DrawHLine(u8g2_t* u8g2, u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t len);
+void u8g2_DrawBox(u8g2_t* u8g2, u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w, u8g2_uint_t h);
+void u8g2_DrawFrame(u8g2_t* u8g2, u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w, u8g2_uint_t h);
+
+extern const uint8_t u8g2_font_ncenB08_tr[];
+extern const uint8_t u8g2_font_ncenB12_tr[];
+extern const uint8_t u8g2_font_5x8_tr[];
+
+#endif /* U8G2_STUB */
@@ -0,0 +1,133 @@
+#ifndef SYNTH_FONT
+#define SYNTH_FONT
+
+// Builds u8g2-format RLE glyphs from bitmaps, so glyph_cache can be exercised
+// without the u8g2 sources. Implements the stub's u8g2_font_get_glyph_data().
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "u8g2.h"
+
+#define SYNTH_MAX_W 12
+#define SYNTH_MAX_H 16
+#define SYNTH_DATA_MAX 128
+
+// Field widths in bits, as a u8g2 font header would give them
+#define SYNTH_BITS_0    3
+#define SYNTH_BITS_1    2
+#define SYNTH_BITS_W    4
+#define SYNTH_BITS_H    5
+#define SYNTH_BITS_X    3
+#define SYNTH_BITS_Y    3
+#define SYNTH_BITS_DX   5
+
+typedef struct {
+    bool present;
+    uint8_t w, h;
+    int8_t x, y, dx;
+    uint8_t img[SYNTH_MAX_H][SYNTH_MAX_W];
+    uint8_t data[SYNTH_DATA_MAX];
+} synth_glyph_t;
+
+static synth_glyph_t s_synth[256];
+static uint8_t s_synth_font[23] = { [9] = SYNTH_MAX_W };
+const u8g2_cb_t u8g2_cb_r0;
+
+static void synth_put(uint8_t* data, int* bitpos, unsigned v, int n)
+{
+    for (int i = 0; i < n; i++, (*bitpos)++) {
+        if ((v >> i) & 1) data[*bitpos / 8] |= (uint8_t)(1 << (*bitpos % 8));
+    }
+}
+
+// Encode glyph `e` from its img[][]: runs of at most 7 zeros and 3 ones, with the
+// repeat bit set when the next pair is identical
+static void synth_encode(uint16_t e)
+{
+    synth_glyph_t* g = &s_synth[e];
+    memset(g->data, 0, sizeof(g->data));
+    int bp = 0;
+    synth_put(g->data, &bp, g->w, SYNTH_BITS_W);
+    synth_put(g->data, &bp, g->h, SYNTH_BITS_H);
+    synth_put(g->data, &bp, (unsigned)(g->x + (1 << (SYNTH_BITS_X - 1))), SYNTH_BITS_X);
+    synth_put(g->data, &bp, (unsigned)(g->y + (1 << (SYNTH_BITS_Y - 1))), SYNTH_BITS_Y);
+    synth_put(g->data, &bp, (unsigned)(g->dx + (1 << (SYNTH_BITS_DX - 1))), SYNTH_BITS_DX);
+
+    const int n = g->w * g->h;
+    int pairs[SYNTH_MAX_W * SYNTH_MAX_H + 1][2];
+    int np = 0;
+    for (int i = 0; i < n;) {
+        int a = 0, b = 0;
+        while (i < n && !g->img[i / g->w][i % g->w] && a < 7) { a++; i++; }
+        while (i < n && g->img[i / g->w][i % g->w] && b < 3) { b++; i++; }
+        pairs[np][0] = a;
+        pairs[np][1] = b;
+        np++;
+    }
+    for (int i = 0; i < np;) {
+        synth_put(g->data, &bp, pairs[i][0], SYNTH_BITS_0);
+        synth_put(g->data, &bp, pairs[i][1], SYNTH_BITS_1);
+        int j = i + 1;
+        while (j < np && pairs[j][0] == pairs[i][0] && pairs[j][1] == pairs[i][1]) {
+            synth_put(g->data, &bp, 1, 1);
+            j++;
+        }
+        synth_put(g->data, &bp, 0, 1);
+        i = j;
+    }
+}
+
+// Random glyph with roughly `ink` percent of its pixels set
+static void synth_random_glyph(uint16_t e, int w, int h, int x, int y, int dx, int ink)
+{
+    synth_glyph_t* g = &s_synth[e];
+    g->present = true;
+    g->w = (uint8_t)w;
+    g->h = (uint8_t)h;
+    g->x = (int8_t)x;
+    g->y = (int8_t)y;
+    g->dx = (int8_t)dx;
+    memset(g->img, 0, sizeof(g->img));
+    for (int r = 0; r < h; r++) {
+        for (int c = 0; c < w; c++) {
+            g->img[r][c] = (rand() % 100) < ink;
+        }
+    }
+    synth_encode(e);
+}
+
+const uint8_t* u8g2_font_get_glyph_data(u8g2_t* u8g2, uint16_t encoding)
+{
+    return (encoding < 256 && s_synth[encoding].present) ? s_synth[encoding].data : NULL;
+}
+
+u8g2_uint_t u8g2_font_calc_vref_font(u8g2_t* u8g2)
+{
+    return 0;
+}
+
+// 128x64 full page buffer using the synthetic font
+static void synth_setup(u8g2_t* u8g2, uint8_t* buf)
+{
+    memset(u8g2, 0, sizeof(*u8g2));
+    u8g2->cb = U8G2_R0;
+    u8g2->draw_color = 1;
+    u8g2->font = s_synth_font;
+    u8g2->font_calc_vref = u8g2_font_calc_vref_font;
+    u8g2->font_decode.is_transparent = 1;
+    u8g2->font_info.bits_per_0 = SYNTH_BITS_0;
+    u8g2->font_info.bits_per_1 = SYNTH_BITS_1;
+    u8g2->font_info.bits_per_char_width = SYNTH_BITS_W;
+    u8g2->font_info.bits_per_char_height = SYNTH_BITS_H;
+    u8g2->font_info.bits_per_char_x = SYNTH_BITS_X;
+    u8g2->font_info.bits_per_char_y = SYNTH_BITS_Y;
+    u8g2->font_info.bits_per_delta_x = SYNTH_BITS_DX;
+    u8g2->tile_buf_ptr = buf;
+    u8g2->tile_buf_height = 8;
+    u8g2->tile_width = 16;
+    u8g2->width = 128;
+}
+
+#endif /* SYNTH_FONT */
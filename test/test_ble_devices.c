@@ -0,0 +1,209 @@
+// ble_devices: table behaviour plus a writer/reader stress run of the seqlock snapshot
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+#include "ble_devices.h"
+#include "test.h"
+
+static void make_addr(uint8_t* addr, unsigned id)
+{
+    addr[0] = id & 0xFF;
+    addr[1] = (id >> 8) & 0xFF;
+    addr[2] = 0xA5;
+    addr[3] = 0x5A;
+    addr[4] = 0x11;
+    addr[5] = 0x22;
+}
+
+static unsigned addr_id(const uint8_t* addr)
+{
+    return addr[0] | (addr[1] << 8);
+}
+
+static void test_upsert_and_publish(void)
+{
+    uint8_t a[6];
+    ble_devices_reset();
+
+    make_addr(a, 1);
+    CHECK(ble_devices_upsert(a, "one", -40, 0));
+    // Same RSSI, same name: nothing visible changed
+    CHECK(!ble_devices_upsert(a, "one", -40, 10));
+    CHECK(ble_devices_upsert(a, "renamed", -40, 20));
+
+    make_addr(a, 2);
+    CHECK(ble_devices_upsert(a, NULL, -80, 30));
+    make_addr(a, 3);
+    CHECK(ble_devices_upsert(a, "three", -60, 40));
+
+    uint32_t gen = ble_devices_generation();
+    ble_devices_publish();
+    CHECK_EQ(ble_devices_generation(), gen + 1);
+
+    ble_devices_snapshot_t snap;
+    CHECK(ble_devices_read_snapshot(&snap));
+    CHECK_EQ(snap.total, 3);
+    CHECK_EQ(snap.count, 3);
+    CHECK_EQ(snap.generation, gen + 1);
+    CHECK_EQ(addr_id(snap.devices[0].addr), 1);
+    CHECK_STR(snap.devices[0].name, "renamed");
+    CHECK_EQ(addr_id(snap.devices[1].addr), 3);
+    CHECK_EQ(addr_id(snap.devices[2].addr), 2);
+    CHECK_STR(snap.devices[2].name, "");
+}
+
+static void test_rssi_smoothing(void)
+{
+    uint8_t a[6];
+    ble_devices_reset();
+    make_addr(a, 7);
+    ble_devices_upsert(a, "x", -40, 0);
+    // alpha = 1/4: one -80 report moves the average by 10 dB
+    CHECK(ble_devices_upsert(a, "x", -80, 1));
+    ble_devices_publish();
+
+    ble_devices_snapshot_t snap;
+    CHECK(ble_devices_read_snapshot(&snap));
+    CHECK_EQ(snap.devices[0].rssi, -50);
+}
+
+static void test_lru_eviction(void)
+{
+    uint8_t a[6];
+    ble_devices_reset();
+
+    for (unsigned i = 0; i < BLE_DEVICES_MAX; i++) {
+        make_addr(a, i);
+        ble_devices_upsert(a, "", -50, i);
+    }
+    // Touch device 0 so device 1 becomes the oldest
+    make_addr(a, 0);
+    ble_devices_upsert(a, "", -50, 1000);
+
+    make_addr(a, 5000);
+    CHECK(ble_devices_upsert(a, "new", -20, 1001));
+
+    // Device 1 was evicted and comes back as new; device 0 is still known
+    make_addr(a, 0);
+    CHECK(!ble_devices_upsert(a, "", -50, 1002));
+    make_addr(a, 1);
+    CHECK(ble_devices_upsert(a, "", -50, 1003));
+
+    ble_devices_publish();
+    ble_devices_snapshot_t snap;
+    CHECK(ble_devices_read_snapshot(&snap));
+    CHECK_EQ(snap.total, BLE_DEVICES_MAX);
+    CHECK_EQ(snap.count, BLE_SNAPSHOT_MAX);
+    CHECK_EQ(addr_id(snap.devices[0].addr), 5000);
+}
+
+// Heavy churn through eviction must keep every live entry reachable through the index
+static void test_index_after_churn(void)
+{
+    uint8_t a[6];
+    ble_devices_reset();
+
+    unsigned r = 12345;
+    for (int i = 0; i < 200000; i++) {
+        r = r * 1103515245u + 12345u;
+        make_addr(a, (r >> 8) % (BLE_DEVICES_MAX * 3));
+        ble_devices_upsert(a, "", -50, (uint32_t)i);
+    }
+    // The last BLE_DEVICES_MAX distinct ids are all resident: re-inserting is not "new"
+    for (unsigned i = 0; i < BLE_DEVICES_MAX; i++) {
+        make_addr(a, 60000 + i);
+        ble_devices_upsert(a, "", -50, 300000 + i);
+    }
+    int found = 0;
+    for (unsigned i = 0; i < BLE_DEVICES_MAX; i++) {
+        make_addr(a, 60000 + i);
+        if (!ble_devices_upsert(a, "", -50, 400000 + i)) found++;
+    }
+    CHECK_EQ(found, BLE_DEVICES_MAX);
+}
+
+// The stress writer names every device after its address, so a torn read shows up
+// as a name that does not match the address next to it.
+static atomic_int s_stop;
+
+#define STRESS_PUBLISHES 20000
+#define STRESS_MIN_READS 100000
+
+static void device_name(unsigned id, char* out)
+{
+    snprintf(out, BLE_NAME_MAX, "dev-%u-%u-%u", id, id * 7, id * 13);
+}
+
+static void* stress_writer(void* arg)
+{
+    uint8_t a[6];
+    char name[BLE_NAME_MAX];
+    unsigned r = 1;
+    uint32_t i = 0;
+
+    while (!atomic_load(&s_stop)) {
+        r = r * 1103515245u + 12345u;
+        unsigned id = (r >> 8) % 400;
+        make_addr(a, id);
+        device_name(id, name);
+        ble_devices_upsert(a, name, (int8_t)(-30 - (int)((r >> 20) % 60)), i);
+        if ((++i & 15) == 0) ble_devices_publish();
+    }
+    return NULL;
+}
+
+static void test_concurrent_snapshot(void)
+{
+    ble_devices_reset();
+    // Snapshots left over from the tests above do not follow the naming scheme
+    uint32_t first_gen = ble_devices_generation() + 1;
+
+    pthread_t writer;
+    atomic_store(&s_stop, 0);
+    pthread_create(&writer, NULL, stress_writer, NULL);
+
+    long reads = 0, retries_exhausted = 0, torn = 0, unsorted = 0;
+    uint32_t last_gen = 0;
+    bool gen_backwards = false;
+    // Run for a number of publishes rather than reads: on a single core the writer
+    // may not get scheduled until the reader's time slice ends
+    while (ble_devices_generation() < first_gen + STRESS_PUBLISHES || reads < STRESS_MIN_READS) {
+        ble_devices_snapshot_t snap;
+        if (!ble_devices_read_snapshot(&snap)) {
+            retries_exhausted++;
+            continue;
+        }
+        if (snap.generation < first_gen) continue;
+        reads++;
+        if (snap.generation < last_gen) gen_backwards = true;
+        last_gen = snap.generation;
+
+        for (int i = 0; i < snap.count; i++) {
+            char name[BLE_NAME_MAX];
+            device_name(addr_id(snap.devices[i].addr), name);
+            if (strcmp(name, snap.devices[i].name) != 0) torn++;
+            if (i > 0 && snap.devices[i].rssi > snap.devices[i - 1].rssi) unsorted++;
+        }
+    }
+
+    atomic_store(&s_stop, 1);
+    pthread_join(writer, NULL);
+
+    printf("stress: %ld reads, %ld gave up, generation %u\n", reads, retries_exhausted,
+           (unsigned)ble_devices_generation());
+    CHECK(reads > 0);
+    CHECK_EQ(torn, 0);
+    CHECK_EQ(unsorted, 0);
+    CHECK(!gen_backwards);
+}
+
+int main(void)
+{
+    test_upsert_and_publish();
+    test_rssi_smoothing();
+    test_lru_eviction();
+    test_index_after_churn();
+    test_concurrent_snapshot();
+    return test_report("test_ble_devices");
+}
@@ -0,0 +1,107 @@
+// bthome: exact payload bytes and a walk of the AD structures a receiver would do
+#include <stdbool.h>
+
+#include "bthome.h"
+#include "test.h"
+
+static bool bytes_equal(const uint8_t* a, const uint8_t* b, size_t n)
+{
+    return memcmp(a, b, n) == 0;
+}
+
+static void test_without_battery(void)
+{
+    bthome_reading_t r = { .temp_centi_c = 2512, .hum_centi_pct = 5534, .battery_pct = -1, .packet_id = 7 };
+    uint8_t out[BTHOME_ADV_MAX];
+    static const uint8_t expect[] = {
+        0x02, 0x01, 0x06,
+        0x0C, 0x16, 0xD2, 0xFC, 0x40,
+        0x00, 0x07,
+        0x02, 0xD0, 0x09,
+        0x03, 0x9E, 0x15,
+    };
+
+    size_t n = bthome_encode_adv(&r, out, sizeof(out));
+    CHECK_EQ(n, sizeof(expect));
+    CHECK(bytes_equal(out, expect, sizeof(expect)));
+}
+
+static void test_with_battery_and_negative_temp(void)
+{
+    bthome_reading_t r = { .temp_centi_c = -512, .hum_centi_pct = 10000, .battery_pct = 90, .packet_id = 255 };
+    uint8_t out[BTHOME_ADV_MAX];
+    static const uint8_t expect[] = {
+        0x02, 0x01, 0x06,
+        0x0E, 0x16, 0xD2, 0xFC, 0x40,
+        0x00, 0xFF,
+        0x01, 0x5A,
+        0x02, 0x00, 0xFE,
+        0x03, 0x10, 0x27,
+    };
+
+    size_t n = bthome_encode_adv(&r, out, sizeof(out));
+    CHECK_EQ(n, sizeof(expect));
+    CHECK(bytes_equal(out, expect, sizeof(expect)));
+
+    // Out of range battery is clamped
+    r.battery_pct = 120;
+    n = bthome_encode_adv(&r, out, sizeof(out));
+    CHECK_EQ(out[11], 100);
+}
+
+static void test_buffer_too_small(void)
+{
+    bthome_reading_t r = { .temp_centi_c = 0, .hum_centi_pct = 0, .battery_pct = 50, .packet_id = 0 };
+    uint8_t out[BTHOME_ADV_MAX];
+    size_t full = bthome_encode_adv(&r, out, sizeof(out));
+    CHECK(full > 0);
+    CHECK_EQ(bthome_encode_adv(&r, out, full - 1), 0);
+    CHECK_EQ(bthome_encode_adv(NULL, out, sizeof(out)), 0);
+    CHECK_EQ(bthome_encode_adv(&r, NULL, sizeof(out)), 0);
+}
+
+// Every AD length must land exactly on the end, and the objects must be in id order
+static void test_ad_structure(void)
+{
+    for (int t = -4000; t <= 8000; t += 777) {
+        for (int b = -1; b <= 100; b += 101) {
+            bthome_reading_t r = { .temp_centi_c = (int16_t)t, .hum_centi_pct = 4321, .battery_pct = (int8_t)b, .packet_id = 3 };
+            uint8_t out[BTHOME_ADV_MAX];
+            size_t n = bthome_encode_adv(&r, out, sizeof(out));
+            CHECK(n > 0 && n <= BTHOME_ADV_MAX);
+
+            size_t pos = 0;
+            int temp = 0x7FFFFFFF;
+            while (pos < n) {
+                size_t len = out[pos];
+                CHECK(len > 0 && pos + 1 + len <= n);
+                if (out[pos + 1] == 0x16) {
+                    size_t end = pos + 1 + len;
+                    size_t o = pos + 5;
+                    int last_id = -1;
+                    while (o < end) {
+                        int id = out[o];
+                        CHECK(id > last_id);
+                        last_id = id;
+                        size_t sz = (id == BTHOME_OBJ_TEMPERATURE || id == BTHOME_OBJ_HUMIDITY) ? 2 : 1;
+                        if (id == BTHOME_OBJ_TEMPERATURE) temp = (int16_t)(out[o + 1] | (out[o + 2] << 8));
+                        o += 1 + sz;
+                    }
+                    CHECK_EQ(o, end);
+                }
+                pos += 1 + len;
+            }
+            CHECK_EQ(pos, n);
+            CHECK_EQ(temp, t);
+        }
+    }
+}
+
+int main(void)
+{
+    test_without_battery();
+    test_with_battery_and_negative_temp();
+    test_buffer_too_small();
+    test_ad_structure();
+    return test_report("test_bthome");
+}
@@ -0,0 +1,133 @@
+// climate: integer metrics against a double-precision libm reference over the table range
+#include <math.h>
+#include <stdlib.h>
+
+#include "climate.h"
+#include "test.h"
+
+#define MAX_ERR_C       0.1     // dew point and heat index, degrees C
+#define MAX_ERR_G_M3    0.1     // absolute humidity
+
+static double ref_es_pa(double t)
+{
+    return 611.2 * exp(17.62 * t / (243.12 + t));
+}
+
+static double ref_dew_point(double t, double rh)
+{
+    double g = log(rh / 100.0) + 17.62 * t / (243.12 + t);
+    return 243.12 * g / (17.62 - g);
+}
+
+static double ref_abs_hum(double t, double rh)
+{
+    return 2.1674 * ref_es_pa(t) * rh / 100.0 / (273.15 + t);
+}
+
+// https://www.wpc.ncep.noaa.gov/html/heatindex_equation.shtml
+static double ref_heat_index(double t_c, double rh)
+{
+    double t = t_c * 9.0 / 5.0 + 32.0;
+    double hi = 0.5 * (t + 61.0 + (t - 68.0) * 1.2 + rh * 0.094);
+    if ((hi + t) / 2.0 >= 80.0) {
+        hi = -42.379 + 2.04901523 * t + 10.14333127 * rh - 0.22475541 * t * rh
+             - 0.00683783 * t * t - 0.05481717 * rh * rh + 0.00122874 * t * t * rh
+             + 0.00085282 * t * rh * rh - 0.00000199 * t * t * rh * rh;
+        if (rh < 13.0 && t >= 80.0 && t <= 112.0) {
+            hi -= (13.0 - rh) / 4.0 * sqrt((17.0 - fabs(t - 95.0)) / 17.0);
+        } else if (rh > 85.0 && t >= 80.0 && t <= 87.0) {
+            hi += (rh - 85.0) / 10.0 * (87.0 - t) / 5.0;
+        }
+    }
+    return (hi - 32.0) * 5.0 / 9.0;
+}
+
+typedef struct {
+    double max;
+    int at_t, at_rh;
+} max_err_t;
+
+static void track(max_err_t* m, double err, int t, int rh)
+{
+    err = fabs(err);
+    if (err > m->max) {
+        m->max = err;
+        m->at_t = t;
+        m->at_rh = rh;
+    }
+}
+
+static void test_against_reference(void)
+{
+    max_err_t dp = {0}, hi = {0}, ah = {0};
+    climate_t c;
+
+    for (int t = CLIMATE_T_MIN_C * 100 + 100; t < CLIMATE_T_MAX_C * 100; t += 7) {
+        for (int rh = 100; rh <= 10000; rh += 13) {
+            climate_compute((centi_c_t)t, (centi_pct_t)rh, &c);
+            // Dew points below the table floor clamp to it
+            double ref_dp = ref_dew_point(t / 100.0, rh / 100.0);
+            if (ref_dp >= CLIMATE_T_MIN_C) track(&dp, c.dew_point_centi_c / 100.0 - ref_dp, t, rh);
+            else CHECK(c.dew_point_centi_c <= CLIMATE_T_MIN_C * 100 + (int)(MAX_ERR_C * 100));
+            track(&ah, c.abs_hum_centi_g_m3 / 100.0 - ref_abs_hum(t / 100.0, rh / 100.0), t, rh);
+
+            // The regression runs away far outside its range; the firmware clamps it
+            double ref_hi = ref_heat_index(t / 100.0, rh / 100.0);
+            if (c.heat_index_centi_c == INT16_MAX) CHECK(ref_hi >= INT16_MAX / 100.0 - MAX_ERR_C);
+            else track(&hi, c.heat_index_centi_c / 100.0 - ref_hi, t, rh);
+        }
+    }
+
+    printf("max error: dew point %.3f C (%d, %d), heat index %.3f C (%d, %d), abs hum %.3f g/m3 (%d, %d)\n",
+           dp.max, dp.at_t, dp.at_rh, hi.max, hi.at_t, hi.at_rh, ah.max, ah.at_t, ah.at_rh);
+    CHECK(dp.max <= MAX_ERR_C);
+    CHECK(hi.max <= MAX_ERR_C);
+    CHECK(ah.max <= MAX_ERR_G_M3);
+}
+
+static void test_edges(void)
+{
+    climate_t c;
+
+    // Saturated air: dew point is the temperature
+    climate_compute(2000, 10000, &c);
+    CHECK(abs(c.dew_point_centi_c - 2000) <= 1);
+
+    // Dry air has no dew point in range; it reports the table floor
+    climate_compute(2000, 0, &c);
+    CHECK_EQ(c.dew_point_centi_c, CLIMATE_T_MIN_C * 100);
+    CHECK_EQ(c.abs_hum_centi_g_m3, 0);
+
+    // Out of range inputs clamp instead of reading past the table
+    climate_compute(-6000, 5000, &c);
+    CHECK(c.dew_point_centi_c >= CLIMATE_T_MIN_C * 100);
+    climate_compute(12000, 12000, &c);
+    CHECK(c.dew_point_centi_c <= CLIMATE_T_MAX_C * 100);
+
+    // Below 80 F the heat index is close to the temperature
+    climate_compute(2000, 5000, &c);
+    CHECK(abs(c.heat_index_centi_c - 2000) < 100);
+}
+
+static void test_update_memoises(void)
+{
+    climate_t a, b, direct;
+
+    CHECK(climate_update(2512, 5534, &a));
+    CHECK(!climate_update(2512, 5534, &b));
+    CHECK(memcmp(&a, &b, sizeof(a)) == 0);
+    climate_compute(2512, 5534, &direct);
+    CHECK(memcmp(&a, &direct, sizeof(a)) == 0);
+
+    CHECK(climate_update(2512, 5535, &b));
+    climate_compute(2512, 5535, &direct);
+    CHECK(memcmp(&b, &direct, sizeof(b)) == 0);
+}
+
+int main(void)
+{
+    test_against_reference();
+    test_edges();
+    test_update_memoises();
+    return test_report("test_climate");
+}
@@ -0,0 +1,93 @@
+// fixed: every DHT20 raw value against the libm formula, plus formatting and rounding
+#include <math.h>
+#include <stdlib.h>
+
+#include "fixed.h"
+#include "test.h"
+
+#define RAW20_COUNT (1u << 20)
+
+static void test_temp_all_raw(void)
+{
+    int mismatches = 0;
+    for (uint32_t raw = 0; raw < RAW20_COUNT; raw++) {
+        long expect = lround(raw * 20000.0 / RAW20_COUNT - 5000.0);
+        if (fixed_temp_from_raw20(raw) != expect && mismatches++ < 5) {
+            CHECK_EQ(fixed_temp_from_raw20(raw), expect);
+            fprintf(stderr, "  raw %u\n", (unsigned)raw);
+        }
+    }
+    CHECK_EQ(mismatches, 0);
+}
+
+static void test_hum_all_raw(void)
+{
+    int mismatches = 0;
+    for (uint32_t raw = 0; raw < RAW20_COUNT; raw++) {
+        long expect = lround(raw * 10000.0 / RAW20_COUNT);
+        if (fixed_hum_from_raw20(raw) != expect && mismatches++ < 5) {
+            CHECK_EQ(fixed_hum_from_raw20(raw), expect);
+            fprintf(stderr, "  raw %u\n", (unsigned)raw);
+        }
+    }
+    CHECK_EQ(mismatches, 0);
+}
+
+static void test_negative_ties(void)
+{
+    // -46.875 exactly: lround gives -4688
+    CHECK_EQ(fixed_temp_from_raw20(16384), -4688);
+    CHECK_EQ(fixed_temp_from_raw20(0), -5000);
+    CHECK_EQ(fixed_temp_from_raw20(RAW20_COUNT / 4), 0);
+    CHECK_EQ(fixed_temp_from_raw20(RAW20_COUNT - 1), 15000);
+}
+
+static void test_format(void)
+{
+    static const int32_t values[] = { 0, 5, -5, 99, -99, 100, -100, 12345, -512, 7, INT32_MAX, INT32_MIN };
+    char got[32], expect[32];
+
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        for (unsigned d = 0; d < 4; d++) {
+            long long v = values[i];
+            long long scale = 1;
+            for (unsigned k = 0; k < d; k++) scale *= 10;
+            long long a = llabs(v);
+            if (d) {
+                snprintf(expect, sizeof(expect), "%s%lld.%0*lld", v < 0 ? "-" : "", a / scale, (int)d, a % scale);
+            } else {
+                snprintf(expect, sizeof(expect), "%lld", v);
+            }
+            CHECK_EQ(fixed_format(got, sizeof(got), values[i], d), strlen(expect));
+            CHECK_STR(got, expect);
+        }
+    }
+
+    char small[4];
+    CHECK_EQ(fixed_format(small, sizeof(small), -512, 2), 0);
+    CHECK_STR(small, "");
+    CHECK_EQ(fixed_format(small, sizeof(small), 512, 0), 3);
+    CHECK_STR(small, "512");
+}
+
+static void test_round_centi(void)
+{
+    for (int32_t c = -100000; c <= 100000; c++) {
+        if (fixed_round_centi(c) != lround(c / 100.0)) {
+            CHECK_EQ(fixed_round_centi(c), lround(c / 100.0));
+            break;
+        }
+    }
+    CHECK_EQ(fixed_round_centi(-250), -3);
+    CHECK_EQ(fixed_round_centi(249), 2);
+}
+
+int main(void)
+{
+    test_temp_all_raw();
+    test_hum_all_raw();
+    test_negative_ties();
+    test_format();
+    test_round_centi();
+    return test_report("test_fixed");
+}
@@ -0,0 +1,176 @@
+// fmt: every builder against the snprintf format it stands in for, on edge values
+// and random ones, plus truncation at every buffer size
+#include <inttypes.h>
+#include <stdlib.h>
+
+#include "fmt.h"
+#include "test.h"
+
+#define RANDOM_CASES 200000
+
+static const int32_t s_edges[] = {
+    0, 1, -1, 9, -9, 10, -10, 99, 100, -100, 12345, -512, 65535, 65536,
+    INT32_MAX, INT32_MAX - 1, INT32_MIN, INT32_MIN + 1,
+};
+#define EDGE_COUNT (sizeof(s_edges) / sizeof(s_edges[0]))
+
+// Spread over all magnitudes, not just large values
+static uint32_t random_u32(void)
+{
+    uint32_t v = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+    return v >> (rand() % 32);
+}
+
+static int32_t random_i32(void)
+{
+    uint32_t v = random_u32();
+    return (rand() & 1) ? -(int32_t)(v >> 1) : (int32_t)v;
+}
+
+static int s_mismatches;
+
+static void expect_same(const char* got, const char* expect, const char* what)
+{
+    if (strcmp(got, expect) != 0 && s_mismatches++ < 10) {
+        fprintf(stderr, "%s: got \"%s\", snprintf \"%s\"\n", what, got, expect);
+    }
+}
+
+static void check_int(int32_t v)
+{
+    char got[48], expect[48];
+    fmt_t f;
+    static const unsigned widths[] = { 0, 1, 2, 5, 12 };
+
+    for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+        const int width = (int)widths[w];
+        fmt_init(&f, got, sizeof(got));
+        fmt_int_pad(&f, v, widths[w], ' ');
+        snprintf(expect, sizeof(expect), "%*" PRId32, width, v);
+        expect_same(got, expect, "fmt_int_pad ' '");
+
+        fmt_init(&f, got, sizeof(got));
+        fmt_int_pad(&f, v, widths[w], '0');
+        snprintf(expect, sizeof(expect), "%0*" PRId32, width, v);
+        expect_same(got, expect, "fmt_int_pad '0'");
+
+        fmt_init(&f, got, sizeof(got));
+        fmt_uint_pad(&f, (uint32_t)v, widths[w], '0');
+        snprintf(expect, sizeof(expect), "%0*" PRIu32, width, (uint32_t)v);
+        expect_same(got, expect, "fmt_uint_pad '0'");
+    }
+
+    fmt_init(&f, got, sizeof(got));
+    fmt_int_signed(&f, v);
+    snprintf(expect, sizeof(expect), "%+" PRId32, v);
+    expect_same(got, expect, "fmt_int_signed");
+
+    for (unsigned width = 0; width <= 8; width += 2) {
+        fmt_init(&f, got, sizeof(got));
+        fmt_hex(&f, (uint32_t)v, width);
+        snprintf(expect, sizeof(expect), "%0*" PRIX32, (int)width, (uint32_t)v);
+        expect_same(got, expect, "fmt_hex");
+    }
+
+    fmt_init(&f, got, sizeof(got));
+    fmt_ip4(&f, (uint32_t)v);
+    const uint32_t a = (uint32_t)v;
+    snprintf(expect, sizeof(expect), "%u.%u.%u.%u", (unsigned)(a & 0xFF), (unsigned)((a >> 8) & 0xFF),
+             (unsigned)((a >> 16) & 0xFF), (unsigned)(a >> 24));
+    expect_same(got, expect, "fmt_ip4");
+}
+
+static void test_against_snprintf(void)
+{
+    s_mismatches = 0;
+    for (size_t i = 0; i < EDGE_COUNT; i++) check_int(s_edges[i]);
+    srand(1);
+    for (int i = 0; i < RANDOM_CASES; i++) check_int(random_i32());
+    CHECK_EQ(s_mismatches, 0);
+}
+
+static void test_fixed(void)
+{
+    char buf[32];
+    fmt_t f;
+    fmt_init(&f, buf, sizeof(buf));
+    fmt_fixed(&f, -512, 2);
+    fmt_char(&f, ' ');
+    fmt_fixed(&f, 5, 2);
+    fmt_char(&f, ' ');
+    fmt_fixed(&f, 2150, 1);
+    fmt_char(&f, ' ');
+    fmt_fixed(&f, -7, 0);
+    CHECK_STR(buf, "-5.12 0.05 215.0 -7");
+}
+
+static void test_strings(void)
+{
+    char buf[32];
+    fmt_t f;
+    fmt_init(&f, buf, sizeof(buf));
+    fmt_str(&f, "T:");
+    fmt_str(&f, NULL);
+    fmt_strn(&f, "overcast clouds", 8);
+    fmt_char(&f, '|');
+    fmt_strn(&f, "ab", 8);
+    fmt_strn(&f, NULL, 3);
+    CHECK_STR(buf, "T:overcast|ab");
+    CHECK_EQ(f.len, strlen(buf));
+    CHECK(!f.truncated);
+}
+
+// Same text as the weather screen, built both ways
+static int build_fmt(char* buf, size_t cap)
+{
+    fmt_t f;
+    fmt_init(&f, buf, cap);
+    fmt_str(&f, "T:");      fmt_int(&f, -12);
+    fmt_str(&f, "C F:");    fmt_int(&f, -18);
+    fmt_str(&f, "C H:");    fmt_uint(&f, 87);
+    fmt_str(&f, "%\nMin:"); fmt_int(&f, -15);
+    fmt_str(&f, "C Max:");  fmt_int(&f, -9);
+    fmt_str(&f, "C\nW:");   fmt_uint(&f, 34);
+    fmt_str(&f, " KM/H\n"); fmt_strn(&f, "light snow showers with wind gusts", 24);
+    return f.truncated;
+}
+
+static void test_truncation(void)
+{
+    char full[128];
+    snprintf(full, sizeof(full), "T:%dC F:%dC H:%u%%\nMin:%dC Max:%dC\nW:%u KM/H\n%.*s",
+             -12, -18, 87u, -15, -9, 34u, 24, "light snow showers with wind gusts");
+    char got[128];
+    CHECK(!build_fmt(got, sizeof(got)));
+    CHECK_STR(got, full);
+
+    // Every capacity: the prefix snprintf would keep, NUL terminated, flagged
+    const size_t n = strlen(full);
+    for (size_t cap = 1; cap <= n + 1; cap++) {
+        char small[128], expect[128];
+        memset(small, 'x', sizeof(small));
+        const int truncated = build_fmt(small, cap);
+        snprintf(expect, cap, "%s", full);
+        CHECK_STR(small, expect);
+        CHECK_EQ(truncated, cap <= n);
+        CHECK_EQ(small[cap], 'x');  // nothing written past the buffer
+    }
+
+    // A zero sized buffer is never touched
+    char untouched = 'x';
+    fmt_t f;
+    fmt_init(&f, &untouched, 0);
+    fmt_str(&f, "abc");
+    fmt_int(&f, 42);
+    CHECK(f.truncated);
+    CHECK_EQ(untouched, 'x');
+}
+
+int main(void)
+{
+    test_against_snprintf();
+    test_fixed();
+    test_strings();
+    test_truncation();
+    return test_report("test_fmt");
+}
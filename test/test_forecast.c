@@ -0,0 +1,228 @@
+// forecast: fixture bodies at every chunk size against the values Python's json module
+// extracts (test/data/make_forecast_fixtures.py), truncation and malformed input
+#include <stdlib.h>
+
+#include "forecast.h"
+#include "test.h"
+
+static const char* const s_fixtures[] = { "forecast_montreal", "forecast_tokyo" };
+
+typedef struct {
+    forecast_t f;
+    forecast_day_t days[FORECAST_MAX_DAYS];
+    size_t day_count;
+} expect_t;
+
+static char* read_file(const char* name, const char* ext, size_t* len)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s%s", TEST_DATA_DIR, name, ext);
+    FILE* fp = fopen(path, "rb");
+    if (!fp) {
+        fprintf(stderr, "cannot open %s\n", path);
+        exit(2);
+    }
+    fseek(fp, 0, SEEK_END);
+    *len = (size_t)ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char* buf = malloc(*len + 1);
+    if (!buf || fread(buf, 1, *len, fp) != *len) exit(2);
+    buf[*len] = '\0';
+    fclose(fp);
+    return buf;
+}
+
+static void load_expect(const char* name, expect_t* e)
+{
+    size_t len;
+    char* text = read_file(name, ".expect", &len);
+    memset(e, 0, sizeof(*e));
+
+    for (char* line = strtok(text, "\n"); line; line = strtok(NULL, "\n")) {
+        long a, b, c, d, x, y;
+        if (sscanf(line, "tz %ld", &a) == 1) {
+            e->f.tz_offset_s = (int32_t)a;
+        } else if (sscanf(line, "entry %ld %ld %ld %ld", &a, &b, &c, &d) == 4) {
+            e->f.entries[e->f.count++] = (forecast_entry_t){
+                .time_s = (uint32_t)a, .temp_centi_c = (int16_t)b, .hum_pct = (uint8_t)c, .cond_id = (uint16_t)d,
+            };
+        } else if (sscanf(line, "day %ld %ld %ld %ld %ld %ld", &a, &b, &c, &d, &x, &y) == 6) {
+            e->days[e->day_count++] = (forecast_day_t){
+                .day = (uint32_t)a, .weekday = (uint8_t)b, .tmin_centi_c = (int16_t)c,
+                .tmax_centi_c = (int16_t)d, .hum_pct = (uint8_t)x, .cond_id = (uint16_t)y,
+            };
+        }
+    }
+    free(text);
+}
+
+static bool parse_chunked(const char* body, size_t len, size_t chunk, forecast_t* out)
+{
+    forecast_parser_t p;
+    forecast_parser_init(&p, out);
+    for (size_t off = 0; off < len; off += chunk) {
+        size_t n = (len - off < chunk) ? len - off : chunk;
+        if (!forecast_parser_feed(&p, body + off, n)) return false;
+    }
+    return forecast_parser_finish(&p);
+}
+
+static bool same_entries(const forecast_t* a, const forecast_t* b)
+{
+    if (a->count != b->count || a->tz_offset_s != b->tz_offset_s) return false;
+    for (size_t i = 0; i < a->count; i++) {
+        const forecast_entry_t *x = &a->entries[i], *y = &b->entries[i];
+        if (x->time_s != y->time_s || x->temp_centi_c != y->temp_centi_c ||
+            x->hum_pct != y->hum_pct || x->cond_id != y->cond_id) {
+            fprintf(stderr, "entry %zu: %u %d %u %u vs %u %d %u %u\n", i,
+                    (unsigned)x->time_s, x->temp_centi_c, x->hum_pct, x->cond_id,
+                    (unsigned)y->time_s, y->temp_centi_c, y->hum_pct, y->cond_id);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void test_fixture(const char* name)
+{
+    static forecast_t got;
+    expect_t expect;
+    size_t len;
+    char* body = read_file(name, ".json", &len);
+    load_expect(name, &expect);
+    CHECK_EQ(expect.f.count, FORECAST_MAX_ENTRIES);
+
+    // Every chunk size up to 600 bytes covers each token split at every offset
+    int bad_chunks = 0;
+    for (size_t chunk = 1; chunk <= 600; chunk++) {
+        if (!parse_chunked(body, len, chunk, &got) || !same_entries(&got, &expect.f)) {
+            if (bad_chunks++ == 0) fprintf(stderr, "%s: mismatch at chunk size %zu\n", name, chunk);
+        }
+    }
+    CHECK_EQ(bad_chunks, 0);
+    CHECK(parse_chunked(body, len, len, &got) && same_entries(&got, &expect.f));
+
+    forecast_day_t days[FORECAST_MAX_DAYS];
+    size_t n = forecast_daily(&got, days, FORECAST_MAX_DAYS);
+    CHECK_EQ(n, expect.day_count);
+    for (size_t i = 0; i < n && i < expect.day_count; i++) {
+        CHECK_EQ(days[i].day, expect.days[i].day);
+        CHECK_EQ(days[i].weekday, expect.days[i].weekday);
+        CHECK_EQ(days[i].tmin_centi_c, expect.days[i].tmin_centi_c);
+        CHECK_EQ(days[i].tmax_centi_c, expect.days[i].tmax_centi_c);
+        CHECK_EQ(days[i].hum_pct, expect.days[i].hum_pct);
+        CHECK_EQ(days[i].cond_id, expect.days[i].cond_id);
+    }
+
+    // A cut anywhere before the closing brace is not a complete document
+    int accepted = 0;
+    for (size_t cut = 0; cut < len; cut += 37) {
+        if (parse_chunked(body, cut, 512, &got)) accepted++;
+    }
+    CHECK(!parse_chunked(body, len - 1, 512, &got));
+    CHECK_EQ(accepted, 0);
+
+    free(body);
+}
+
+static bool parse_str(const char* s, forecast_t* out)
+{
+    return parse_chunked(s, strlen(s), strlen(s) ? strlen(s) : 1, out);
+}
+
+static void test_values(void)
+{
+    forecast_t f;
+
+    // Rounding of temperatures to hundredths, halves away from zero
+    CHECK(parse_str("{\"list\":[{\"dt\":1,\"main\":{\"temp\":12.345,\"humidity\":40}},"
+                    "{\"dt\":2,\"main\":{\"temp\":-0.005}},{\"dt\":3,\"main\":{\"temp\":-3}}]}", &f));
+    CHECK_EQ(f.count, 3);
+    CHECK_EQ(f.entries[0].temp_centi_c, 1235);
+    CHECK_EQ(f.entries[0].hum_pct, 40);
+    CHECK_EQ(f.entries[1].temp_centi_c, -1);
+    CHECK_EQ(f.entries[2].temp_centi_c, -300);
+
+    // Entries without dt are dropped; keys of the same name elsewhere are ignored
+    CHECK(parse_str("{\"dt\":9,\"list\":[{\"main\":{\"temp\":1}},{\"dt\":5,\"wind\":{\"temp\":7},"
+                    "\"weather\":[{\"id\":500},{\"id\":800}]}],\"city\":{\"timezone\":3600}}", &f));
+    CHECK_EQ(f.count, 1);
+    CHECK_EQ(f.entries[0].time_s, 5);
+    CHECK_EQ(f.entries[0].temp_centi_c, 0);
+    CHECK_EQ(f.entries[0].cond_id, 500);
+    CHECK_EQ(f.tz_offset_s, 3600);
+
+    // Out of range values are skipped, the entry is kept
+    CHECK(parse_str("{\"list\":[{\"dt\":1,\"main\":{\"temp\":400,\"humidity\":101}}],"
+                    "\"city\":{\"timezone\":99999}}", &f));
+    CHECK_EQ(f.count, 1);
+    CHECK_EQ(f.entries[0].temp_centi_c, 0);
+    CHECK_EQ(f.entries[0].hum_pct, 0);
+    CHECK_EQ(f.tz_offset_s, 0);
+}
+
+static void test_capacity(void)
+{
+    static char body[8192];
+    forecast_t f;
+    size_t n = (size_t)snprintf(body, sizeof(body), "{\"list\":[");
+    for (int i = 0; i < FORECAST_MAX_ENTRIES + 5; i++) {
+        n += (size_t)snprintf(body + n, sizeof(body) - n, "%s{\"dt\":%d}", i ? "," : "", 100 + i);
+    }
+    snprintf(body + n, sizeof(body) - n, "]}");
+
+    CHECK(parse_str(body, &f));
+    CHECK_EQ(f.count, FORECAST_MAX_ENTRIES);
+    CHECK_EQ(f.entries[FORECAST_MAX_ENTRIES - 1].time_s, 100 + FORECAST_MAX_ENTRIES - 1);
+}
+
+static void test_malformed(void)
+{
+    static const char* const bad[] = {
+        "",
+        "[]",
+        "{\"list\":[}",
+        "{\"list\":]}",
+        "{\"a\" 1}x",
+        "{1:2}",
+        "{\"a\":1}}",
+        "{\"a\":{\"b\":{\"c\":{\"d\":{\"e\":{\"f\":{\"g\":{\"h\":{}}}}}}}}}",   // deeper than FORECAST_MAX_DEPTH
+        "{}{}",
+        "{\"a\":\"unterminated}",
+    };
+    forecast_t f;
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        if (parse_str(bad[i], &f)) {
+            fprintf(stderr, "accepted: %s\n", bad[i]);
+            test_failures++;
+        }
+    }
+}
+
+static void test_depth_limit(void)
+{
+    forecast_t f;
+    CHECK(parse_str("{\"a\":{\"b\":{\"c\":{\"d\":{\"e\":{\"f\":{\"g\":{}}}}}}}}", &f));
+    CHECK(parse_str("{}", &f));
+    CHECK_EQ(f.count, 0);
+}
+
+static void test_condition_names(void)
+{
+    CHECK_STR(forecast_condition(211), "Storm");
+    CHECK_STR(forecast_condition(500), "Rain");
+    CHECK_STR(forecast_condition(800), "Clear");
+    CHECK_STR(forecast_condition(804), "Clouds");
+    CHECK_STR(forecast_condition(0), "?");
+}
+
+int main(void)
+{
+    for (size_t i = 0; i < sizeof(s_fixtures) / sizeof(s_fixtures[0]); i++) test_fixture(s_fixtures[i]);
+    test_values();
+    test_capacity();
+    test_malformed();
+    test_depth_limit();
+    test_condition_names();
+    return test_report("test_forecast");
+}
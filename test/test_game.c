@@ -0,0 +1,270 @@
+// game: game_blit against a per-pixel plot at every y from -8 to 64 and x past both
+// edges, and the Tetris row-bitmask collisions (walls, floor, line clears) against a
+// cell-by-cell board. game_tetris.c is compiled into this file for its statics.
+#include <stdlib.h>
+
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "display.h"
+#include "game_tetris.c"
+#include "latency.h"
+#include "test.h"
+
+#define FB_SIZE (GAME_FB_W * GAME_FB_H / 8)
+#define GUARD 64
+
+// --- what game.c and game_tetris.c link against, none of it used by the checks
+
+int64_t esp_timer_get_time(void) { return 0; }
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out) { return ESP_FAIL; }
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t t, uint64_t period_us) { return ESP_FAIL; }
+esp_err_t esp_timer_stop(esp_timer_handle_t t) { return ESP_FAIL; }
+esp_err_t esp_timer_delete(esp_timer_handle_t t) { return ESP_FAIL; }
+TaskHandle_t xTaskGetCurrentTaskHandle(void) { return NULL; }
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task) { return 1; }
+void vTaskPrioritySet(TaskHandle_t task, UBaseType_t prio) {}
+BaseType_t xTaskNotifyGive(TaskHandle_t task) { return pdPASS; }
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait) { return 0; }
+esp_err_t display_flush_async(u8g2_t* u8g2) { return ESP_OK; }
+void latency_record(latency_id_t id, uint32_t us) {}
+void u8g2_ClearBuffer(u8g2_t* u8g2) {}
+void u8g2_SetFont(u8g2_t* u8g2, const uint8_t* font) {}
+void u8g2_DrawFrame(u8g2_t* u8g2, u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w, u8g2_uint_t h) {}
+u8g2_uint_t glyph_cache_draw_str(u8g2_t* u8g2, u8g2_uint_t x, u8g2_uint_t y, const char* str) { return 0; }
+const uint8_t u8g2_font_5x8_tr[1];
+
+static uint32_t s_rand = 0x2545F491;
+
+uint32_t esp_random(void)
+{
+    s_rand ^= s_rand << 13;
+    s_rand ^= s_rand >> 17;
+    s_rand ^= s_rand << 5;
+    return s_rand;
+}
+
+// --- game_blit
+
+static void ref_blit(uint8_t* fb, int x, int y, const uint8_t* cols, int w)
+{
+    for (int i = 0; i < w; i++) {
+        for (int bit = 0; bit < 8; bit++) {
+            const int px = x + i, py = y + bit;
+            if (!(cols[i] & (1 << bit))) continue;
+            if (px < 0 || px >= GAME_FB_W || py < 0 || py >= GAME_FB_H) continue;
+            fb[(py / 8) * GAME_FB_W + px] |= (uint8_t)(1 << (py % 8));
+        }
+    }
+}
+
+static void test_blit(void)
+{
+    // Guard bytes either side catch writes outside the buffer
+    static uint8_t got[GUARD + FB_SIZE + GUARD], expect[GUARD + FB_SIZE + GUARD];
+    static const int xs[] = { -12, -8, -5, -1, 0, 1, 7, 63, 120, 123, 124, 125, 127, 128, 131 };
+    static const int widths[] = { 1, 3, 4, 8, 12 };
+    uint8_t cols[12];
+    int mismatches = 0;
+
+    for (int y = -8; y <= GAME_FB_H; y++) {
+        for (size_t xi = 0; xi < sizeof(xs) / sizeof(xs[0]); xi++) {
+            for (size_t wi = 0; wi < sizeof(widths) / sizeof(widths[0]); wi++) {
+                for (int i = 0; i < 12; i++) cols[i] = (uint8_t)esp_random();
+                cols[0] = 0xFF;  // every row of the sprite at least once
+                for (size_t i = 0; i < sizeof(got); i++) got[i] = (uint8_t)esp_random() & 0x11;
+                memcpy(expect, got, sizeof(got));
+
+                game_blit(got + GUARD, xs[xi], y, cols, widths[wi]);
+                ref_blit(expect + GUARD, xs[xi], y, cols, widths[wi]);
+                if (memcmp(got, expect, sizeof(got)) != 0 && mismatches++ < 5) {
+                    fprintf(stderr, "blit x=%d y=%d w=%d differs\n", xs[xi], y, widths[wi]);
+                }
+            }
+        }
+    }
+    CHECK_EQ(mismatches, 0);
+}
+
+// --- Tetris
+
+static bool s_grid[TETRIS_H][TETRIS_W];  // the reference board, cell by cell
+
+static void load_grid(void)
+{
+    for (int y = 0; y < TETRIS_H; y++) {
+        s_board[y] = TETRIS_WALLS;
+        for (int c = 0; c < TETRIS_W; c++) {
+            if (s_grid[y][c]) s_board[y] |= (uint16_t)(1u << (TETRIS_LEFT + c));
+        }
+    }
+}
+
+static bool grid_matches_board(void)
+{
+    for (int y = 0; y < TETRIS_H; y++) {
+        uint16_t row = TETRIS_WALLS;
+        for (int c = 0; c < TETRIS_W; c++) {
+            if (s_grid[y][c]) row |= (uint16_t)(1u << (TETRIS_LEFT + c));
+        }
+        if (row != s_board[y]) return false;
+    }
+    return true;
+}
+
+// Every cell inside the side walls and above the floor, on an empty square;
+// above the top is open
+static bool ref_fits(uint8_t piece, uint8_t rot, int x, int y)
+{
+    const uint16_t m = s_shapes[piece][rot];
+    for (int r = 0; r < 4; r++) {
+        for (int c = 0; c < 4; c++) {
+            if (!(m & (1u << (r * 4 + c)))) continue;
+            const int col = x - TETRIS_LEFT + c, row = y + r;
+            if (col < 0 || col >= TETRIS_W || row >= TETRIS_H) return false;
+            if (row >= 0 && s_grid[row][col]) return false;
+        }
+    }
+    return true;
+}
+
+static int ref_lock(uint8_t piece, uint8_t rot, int x, int y)
+{
+    const uint16_t m = s_shapes[piece][rot];
+    for (int r = 0; r < 4; r++) {
+        for (int c = 0; c < 4; c++) {
+            if ((m & (1u << (r * 4 + c))) && y + r >= 0) s_grid[y + r][x - TETRIS_LEFT + c] = true;
+        }
+    }
+    int cleared = 0;
+    for (int y2 = TETRIS_H - 1; y2 >= 0; y2--) {
+        bool full = true;
+        for (int c = 0; c < TETRIS_W; c++) full = full && s_grid[y2][c];
+        if (!full) continue;
+        memmove(s_grid[1], s_grid[0], (size_t)y2 * sizeof(s_grid[0]));
+        memset(s_grid[0], 0, sizeof(s_grid[0]));
+        cleared++;
+        y2++;
+    }
+    return cleared;
+}
+
+static void random_grid(int fill_pct, int from_row)
+{
+    memset(s_grid, 0, sizeof(s_grid));
+    for (int y = from_row; y < TETRIS_H; y++) {
+        for (int c = 0; c < TETRIS_W; c++) s_grid[y][c] = (int)(esp_random() % 100) < fill_pct;
+    }
+}
+
+static void test_walls_and_floor(void)
+{
+    tetris_start();
+    memset(s_grid, 0, sizeof(s_grid));
+    load_grid();
+
+    for (uint8_t p = 0; p < TETRIS_PIECES; p++) {
+        for (uint8_t rot = 0; rot < 4; rot++) {
+            const uint16_t m = s_shapes[p][rot];
+            int min_c = 4, max_c = -1, max_r = -1;
+            for (int i = 0; i < 16; i++) {
+                if (!(m & (1u << i))) continue;
+                if (i % 4 < min_c) min_c = i % 4;
+                if (i % 4 > max_c) max_c = i % 4;
+                if (i / 4 > max_r) max_r = i / 4;
+            }
+            // Slide to each wall: it stops with a cell in the outer column
+            int x = TETRIS_LEFT + 3;
+            while (x > 0 && fits(p, rot, x - 1, 5)) x--;
+            CHECK_EQ(x - TETRIS_LEFT + min_c, 0);
+            x = TETRIS_LEFT + 3;
+            while (x < 16 && fits(p, rot, x + 1, 5)) x++;
+            CHECK_EQ(x - TETRIS_LEFT + max_c, TETRIS_W - 1);
+            // Drop: it stops with a cell on the bottom row
+            int y = 0;
+            while (y < TETRIS_H + 4 && fits(p, rot, TETRIS_LEFT + 3, y + 1)) y++;
+            CHECK_EQ(y + max_r, TETRIS_H - 1);
+        }
+    }
+}
+
+static void test_fits_against_grid(void)
+{
+    int mismatches = 0;
+    for (int round = 0; round < 300; round++) {
+        random_grid(round % 60, (int)(esp_random() % TETRIS_H));
+        load_grid();
+        for (uint8_t p = 0; p < TETRIS_PIECES; p++) {
+            for (uint8_t rot = 0; rot < 4; rot++) {
+                for (int x = 0; x <= 12; x++) {
+                    for (int y = -3; y < TETRIS_H + 2; y++) {
+                        if (fits(p, rot, x, y) != ref_fits(p, rot, x, y) && mismatches++ < 5) {
+                            fprintf(stderr, "fits piece %u rot %u at %d,%d differs\n", p, rot, x, y);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    CHECK_EQ(mismatches, 0);
+}
+
+// Hard drops through tetris_step on random boards, checked against the reference
+static void test_line_clears(void)
+{
+    int mismatches = 0, total_cleared = 0;
+    for (int round = 0; round < 3000; round++) {
+        tetris_start();
+        random_grid(85 + (int)(esp_random() % 15), 8 + (int)(esp_random() % 8));
+        load_grid();
+        s_piece = (uint8_t)(esp_random() % TETRIS_PIECES);
+        s_rot = (uint8_t)(esp_random() % 4);
+        s_x = (int8_t)(TETRIS_LEFT + (int)(esp_random() % TETRIS_W) - 1);
+        s_y = 0;
+        if (!fits(s_piece, s_rot, s_x, s_y)) continue;
+
+        int y = s_y;
+        while (ref_fits(s_piece, s_rot, s_x, y + 1)) y++;
+        const uint32_t lines = s_lines;
+        const int cleared = ref_lock(s_piece, s_rot, s_x, y);
+        total_cleared += cleared;
+
+        tetris_step(GAME_BTN_A);
+        if ((s_lines - lines != (uint32_t)cleared || !grid_matches_board()) && mismatches++ < 5) {
+            fprintf(stderr, "round %d: %lu lines vs %d, board differs\n", round,
+                    (unsigned long)(s_lines - lines), cleared);
+        }
+    }
+    CHECK_EQ(mismatches, 0);
+    CHECK(total_cleared > 100);  // the boards are dense enough to clear often
+
+    // A vertical I into a four row well: a tetris, and the row above drops to the floor
+    tetris_start();
+    memset(s_grid, 0, sizeof(s_grid));
+    for (int y = TETRIS_H - 4; y < TETRIS_H; y++) {
+        for (int c = 1; c < TETRIS_W; c++) s_grid[y][c] = true;
+    }
+    s_grid[TETRIS_H - 5][4] = true;
+    load_grid();
+    s_piece = 0;
+    s_rot = 1;      // I standing in column 2 of its box
+    s_x = TETRIS_LEFT - 2;
+    s_y = 0;
+    CHECK(fits(s_piece, s_rot, s_x, s_y));
+    s_score = 0;
+    tetris_step(GAME_BTN_A);
+    CHECK_EQ(s_lines, 4);
+    CHECK_EQ(s_score, 1200 + 2 * (TETRIS_H - 4));
+    for (int y = 0; y < TETRIS_H - 1; y++) CHECK_EQ(s_board[y], TETRIS_WALLS);
+    CHECK_EQ(s_board[TETRIS_H - 1], TETRIS_WALLS | (1u << (TETRIS_LEFT + 4)));
+}
+
+int main(void)
+{
+    test_blit();
+    test_walls_and_floor();
+    test_fits_against_grid();
+    test_line_clears();
+    return test_report("test_game");
+}
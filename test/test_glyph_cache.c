@@ -0,0 +1,131 @@
+// glyph_cache: decoded glyphs blitted into the page buffer must match a direct plot
+#include "glyph_cache.h"
+#include "synth_font.h"
+#include "test.h"
+
+static int s_fallback_draws = 0;
+
+u8g2_uint_t u8g2_DrawStr(u8g2_t* u8g2, u8g2_uint_t x, u8g2_uint_t y, const char* str)
+{
+    s_fallback_draws++;
+    return 0;
+}
+
+u8g2_uint_t u8g2_GetStrWidth(u8g2_t* u8g2, const char* s)
+{
+    return 0;
+}
+
+static void ref_pixel(uint8_t* buf, int x, int y, int on)
+{
+    if (x < 0 || x >= 128 || y < 0 || y >= 64) return;
+    if (on) buf[(y / 8) * 128 + x] |= (uint8_t)(1 << (y % 8));
+    else buf[(y / 8) * 128 + x] &= (uint8_t)~(1 << (y % 8));
+}
+
+// u8g2 semantics: the glyph box sits h + y rows above the baseline
+static int ref_draw_str(uint8_t* buf, int x, int y, const char* str, bool solid)
+{
+    int pen = x;
+    for (const uint8_t* p = (const uint8_t*)str; *p; p++) {
+        const synth_glyph_t* g = &s_synth[*p];
+        if (!g->present) continue;
+        int top = y - g->h - g->y;
+        for (int r = 0; r < g->h; r++) {
+            for (int c = 0; c < g->w; c++) {
+                if (g->img[r][c]) ref_pixel(buf, pen + g->x + c, top + r, 1);
+                else if (solid) ref_pixel(buf, pen + g->x + c, top + r, 0);
+            }
+        }
+        pen += g->dx;
+    }
+    return pen - x;
+}
+
+static void make_font(void)
+{
+    srand(31);
+    for (int e = 33; e < 127; e++) {
+        int w = 3 + rand() % 9;
+        int h = 4 + rand() % 12;
+        synth_random_glyph((uint16_t)e, w, h, rand() % 3 - 1, rand() % 5 - 2, w + 1 + rand() % 2, 40);
+    }
+    // Space: advance only
+    s_synth[' '].present = true;
+    s_synth[' '].w = 0;
+    s_synth[' '].h = 0;
+    s_synth[' '].dx = 4;
+    synth_encode(' ');
+}
+
+static void test_matches_reference(bool solid)
+{
+    static const char* const strings[] = {
+        "Temp: 23.45 C", "Hum: 45.67 %", "AEIMQUY]aeimquy}", "~}|{zyx", "!\"#$%&'()*+,-./",
+    };
+    // Positions include clipping at every edge
+    static const int pos[][2] = { {0, 20}, {10, 63}, {90, 40}, {-5, 12}, {100, 3}, {0, 70}, {30, 0} };
+
+    uint8_t buf[1024], ref[1024];
+    u8g2_t u8g2;
+    synth_setup(&u8g2, buf);
+    u8g2.font_decode.is_transparent = solid ? 0 : 1;
+
+    for (size_t s = 0; s < sizeof(strings) / sizeof(strings[0]); s++) {
+        for (size_t p = 0; p < sizeof(pos) / sizeof(pos[0]); p++) {
+            memset(buf, 0x5A, sizeof(buf));
+            memset(ref, 0x5A, sizeof(ref));
+            int w = glyph_cache_draw_str(&u8g2, (u8g2_uint_t)pos[p][0], (u8g2_uint_t)pos[p][1], strings[s]);
+            int rw = ref_draw_str(ref, pos[p][0], pos[p][1], strings[s], solid);
+            CHECK_EQ((int16_t)w, rw);
+            if (memcmp(buf, ref, sizeof(buf)) != 0) {
+                fprintf(stderr, "mismatch: \"%s\" at %d,%d solid=%d\n", strings[s], pos[p][0], pos[p][1], solid);
+                test_failures++;
+            }
+        }
+    }
+}
+
+static void test_width(void)
+{
+    uint8_t buf[1024];
+    u8g2_t u8g2;
+    synth_setup(&u8g2, buf);
+
+    const char* str = "Wx7";
+    int expect = s_synth['W'].dx + s_synth['x'].dx + s_synth['7'].w + s_synth['7'].x;
+    CHECK_EQ(glyph_cache_str_width(&u8g2, str), expect);
+    CHECK_EQ(glyph_cache_str_width(&u8g2, ""), 0);
+}
+
+static void test_fallback(void)
+{
+    uint8_t buf[1024];
+    u8g2_t u8g2;
+    synth_setup(&u8g2, buf);
+
+    // Unsupported draw state goes to u8g2
+    u8g2.draw_color = 0;
+    glyph_cache_draw_str(&u8g2, 0, 10, "A");
+    CHECK_EQ(s_fallback_draws, 1);
+
+    // So does a font that was never registered
+    static const uint8_t other_font[23] = { [9] = 8 };
+    synth_setup(&u8g2, buf);
+    u8g2.font = other_font;
+    glyph_cache_draw_str(&u8g2, 0, 10, "A");
+    CHECK_EQ(s_fallback_draws, 2);
+}
+
+int main(void)
+{
+    make_font();
+    // Few slots, so the direct-mapped cache keeps evicting and re-decoding
+    CHECK(glyph_cache_register(s_synth_font, 7));
+    test_matches_reference(false);
+    test_matches_reference(true);
+    test_width();
+    test_fallback();
+    CHECK_EQ(s_fallback_draws, 2);
+    return test_report("test_glyph_cache");
+}
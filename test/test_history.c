@@ -0,0 +1,167 @@
+// history: ring addressing and the bulk download packet layout
+#include "history.h"
+#include "test.h"
+
+static uint32_t get_u32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t get_u16(const uint8_t* p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static void push(uint32_t t, int16_t temp, uint16_t hum)
+{
+    history_sample_t s = { .time_s = t, .temp_centi_c = temp, .hum_centi_pct = hum };
+    history_push(&s);
+}
+
+// Unpacks one packet and checks it against the ring starting at first_seq
+static size_t check_packet(const uint8_t* pkt, size_t len, uint16_t packet_no, uint32_t first_seq)
+{
+    CHECK(len >= HISTORY_PACKET_HDR);
+    size_t count = pkt[HISTORY_PACKET_COUNT_OFS];
+    CHECK_EQ(len, HISTORY_PACKET_HDR + count * HISTORY_RECORD_SIZE);
+    CHECK_EQ(get_u16(pkt + HISTORY_PACKET_NO_OFS), packet_no);
+
+    uint32_t base = get_u32(pkt + HISTORY_PACKET_BASE_OFS);
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t* r = pkt + HISTORY_PACKET_HDR + i * HISTORY_RECORD_SIZE;
+        history_sample_t s;
+        CHECK(history_get(first_seq + i, &s));
+        CHECK_EQ(base + get_u16(r), s.time_s);
+        CHECK_EQ((int16_t)get_u16(r + 2), s.temp_centi_c);
+        CHECK_EQ(get_u16(r + 4), s.hum_centi_pct);
+    }
+    return count;
+}
+
+static void test_ring(void)
+{
+    CHECK_EQ(history_head(), 0);
+    CHECK_EQ(history_oldest(), 0);
+    history_sample_t s;
+    CHECK(!history_get(0, &s));
+
+    for (uint32_t i = 0; i < HISTORY_CAPACITY + 5; i++) {
+        push(1000 + i * 60, (int16_t)(2000 + i), (uint16_t)(4000 + i));
+    }
+    CHECK_EQ(history_head(), HISTORY_CAPACITY + 5);
+    CHECK_EQ(history_oldest(), 6);
+    CHECK(!history_get(5, &s));
+    CHECK(history_get(6, &s));
+    CHECK_EQ(s.time_s, 1000 + 6 * 60);
+    CHECK(!history_get(HISTORY_CAPACITY + 5, &s));
+
+    CHECK_EQ(history_find_since(0), 6);
+    CHECK_EQ(history_find_since(1000 + 10 * 60), 10);
+    CHECK_EQ(history_find_since(1000 + 10 * 60 - 1), 10);
+    CHECK_EQ(history_find_since(0xFFFFFFFF), history_head());
+}
+
+static void test_pack_stream(void)
+{
+    // MTU-sized packets: walk the whole ring to the terminating empty packet
+    uint8_t pkt[244];
+    uint32_t seq = 0; // below oldest: skips forward
+    uint16_t packet_no = 0;
+    uint32_t expect_seq = history_oldest();
+    size_t total = 0;
+    for (;;) {
+        uint32_t before = seq < history_oldest() ? history_oldest() : seq;
+        size_t len = history_pack(&seq, packet_no, pkt, sizeof(pkt));
+        size_t count = check_packet(pkt, len, packet_no, before);
+        CHECK_EQ(before, expect_seq);
+        expect_seq += count;
+        total += count;
+        packet_no++;
+        if (count == 0) break;
+        CHECK(count <= (sizeof(pkt) - HISTORY_PACKET_HDR) / HISTORY_RECORD_SIZE);
+    }
+    CHECK_EQ(total, history_head() - history_oldest());
+    CHECK_EQ(seq, history_head());
+
+    // A buffer without room for the header packs nothing
+    seq = history_oldest();
+    CHECK_EQ(history_pack(&seq, 0, pkt, HISTORY_PACKET_HDR - 1), 0);
+    CHECK_EQ(history_pack(&seq, 0, pkt, HISTORY_PACKET_HDR), HISTORY_PACKET_HDR);
+    CHECK_EQ(pkt[HISTORY_PACKET_COUNT_OFS], 0);
+}
+
+static void test_pack_time_gap(void)
+{
+    // A gap wider than the u16 time offset starts a new packet with a fresh base
+    uint32_t first = history_head();
+    uint32_t t = 5000000;
+    push(t, 1, 1);
+    push(t + 100, 2, 2);
+    push(t + 100 + 70000, 3, 3);
+    push(t + 100 + 70001, -4, 4);
+
+    uint8_t pkt[244];
+    uint32_t seq = first;
+    size_t len = history_pack(&seq, 7, pkt, sizeof(pkt));
+    CHECK_EQ(check_packet(pkt, len, 7, first), 2);
+    CHECK_EQ(get_u32(pkt + HISTORY_PACKET_BASE_OFS), t);
+
+    len = history_pack(&seq, 8, pkt, sizeof(pkt));
+    CHECK_EQ(check_packet(pkt, len, 8, first + 2), 2);
+    CHECK_EQ(get_u32(pkt + HISTORY_PACKET_BASE_OFS), t + 100 + 70000);
+}
+
+static void test_encode(void)
+{
+    history_sample_t s[5] = {
+        { 100, -250, 5000 }, { 160, -240, 5100 }, { 220, 0, 0 }, { 100 + 65535, 1, 2 }, { 100 + 65536, 3, 4 },
+    };
+    uint8_t pkt[64];
+    size_t encoded = 99;
+
+    // The fifth sample is one second past the u16 offset range
+    size_t len = history_encode(s, 5, 3, pkt, sizeof(pkt), &encoded);
+    CHECK_EQ(encoded, 4);
+    CHECK_EQ(len, HISTORY_PACKET_HDR + 4 * HISTORY_RECORD_SIZE);
+    CHECK_EQ(get_u16(pkt + HISTORY_PACKET_NO_OFS), 3);
+    CHECK_EQ(get_u32(pkt + HISTORY_PACKET_BASE_OFS), 100);
+    CHECK_EQ(pkt[HISTORY_PACKET_COUNT_OFS], 4);
+    const uint8_t* r = pkt + HISTORY_PACKET_HDR;
+    CHECK_EQ(get_u16(r + 0), 0);
+    CHECK_EQ((int16_t)get_u16(r + 2), -250);
+    CHECK_EQ(get_u16(r + 4), 5000);
+    CHECK_EQ(get_u16(r + 3 * HISTORY_RECORD_SIZE), 65535);
+
+    // Out of space: only whole records
+    len = history_encode(s, 5, 0, pkt, HISTORY_PACKET_HDR + 2 * HISTORY_RECORD_SIZE + 5, &encoded);
+    CHECK_EQ(encoded, 2);
+    CHECK_EQ(len, HISTORY_PACKET_HDR + 2 * HISTORY_RECORD_SIZE);
+
+    // Empty input is the end-of-stream packet
+    len = history_encode(NULL, 0, 9, pkt, sizeof(pkt), &encoded);
+    CHECK_EQ(len, HISTORY_PACKET_HDR);
+    CHECK_EQ(encoded, 0);
+    CHECK_EQ(pkt[HISTORY_PACKET_COUNT_OFS], 0);
+    CHECK_EQ(history_encode(s, 5, 0, pkt, HISTORY_PACKET_HDR - 1, &encoded), 0);
+}
+
+// history_pack stages at most HISTORY_PACK_MAX_RECORDS samples, whatever the buffer
+static void test_pack_large_buffer(void)
+{
+    uint8_t pkt[1024];
+    uint32_t seq = history_oldest();
+    size_t len = history_pack(&seq, 0, pkt, sizeof(pkt));
+    CHECK_EQ(pkt[HISTORY_PACKET_COUNT_OFS], HISTORY_PACK_MAX_RECORDS);
+    CHECK_EQ(len, HISTORY_PACKET_HDR + HISTORY_PACK_MAX_RECORDS * HISTORY_RECORD_SIZE);
+    CHECK_EQ(seq, history_oldest() + HISTORY_PACK_MAX_RECORDS);
+}
+
+int main(void)
+{
+    test_ring();
+    test_pack_stream();
+    test_pack_large_buffer();
+    test_pack_time_gap();
+    test_encode();
+    return test_report("test_history");
+}
@@ -0,0 +1,250 @@
+// http_api: the real handlers behind the esp_http_server shim on 127.0.0.1, fetched
+// with curl. The JSON goes through cJSON, the Prometheus text is checked line by
+// line, and esp32_http_renders_total shows when the cached sample part is rebuilt:
+// only for a new sample, not for a second GET or a change of the live values.
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <esp_http_server.h>
+
+#include "http_api.h"
+#include "main.h"
+#include "test.h"
+
+#define BODY_MAX 4096
+
+// --- what http_api.c reads
+
+static dht20_sample_t s_sample;
+static bool s_have_sample;
+static TickType_t s_ticks;
+static int64_t s_now_us;
+static uint32_t s_heap = 200000;
+static conn_snapshot_t s_conn;
+
+bool dht20_get_last(dht20_sample_t* out)
+{
+    *out = s_sample;
+    return s_have_sample;
+}
+
+void connectivity_get(conn_snapshot_t* out) { *out = s_conn; }
+TickType_t xTaskGetTickCount(void) { return s_ticks; }
+int64_t esp_timer_get_time(void) { return s_now_us; }
+uint32_t esp_get_free_heap_size(void) { return s_heap; }
+uint32_t esp_get_minimum_free_heap_size(void) { return 150000; }
+
+void display_get_stats(display_stats_t* out)
+{
+    memset(out, 0, sizeof(*out));
+    out->frames = 1234;
+}
+
+const char* esp_err_to_name(esp_err_t code)
+{
+    return code == ESP_OK ? "ESP_OK" : "error";
+}
+
+// --- curl
+
+typedef struct {
+    char body[BODY_MAX];
+    int status;
+    char type[64];
+} response_t;
+
+static response_t s_resp;
+
+// The body, then the status and content type on the last two lines
+static bool get(const char* path)
+{
+    char cmd[256];
+    snprintf(cmd, sizeof(cmd), "%s -sS --max-time 5 -w '\\n%%{http_code}\\n%%{content_type}' http://127.0.0.1:%d%s",
+             CURL_PATH, host_httpd_port, path);
+    FILE* p = popen(cmd, "r");
+    if (!p) return false;
+    char out[BODY_MAX + 128];
+    const size_t n = fread(out, 1, sizeof(out) - 1, p);
+    out[n] = '\0';
+    if (pclose(p) != 0) return false;
+
+    char* type = strrchr(out, '\n');
+    if (!type) return false;
+    *type++ = '\0';
+    char* status = strrchr(out, '\n');
+    if (!status) return false;
+    *status++ = '\0';
+    strlcpy(s_resp.body, out, sizeof(s_resp.body));
+    strlcpy(s_resp.type, type, sizeof(s_resp.type));
+    s_resp.status = atoi(status);
+    return true;
+}
+
+// The value of an unlabelled sample line "name value", -1 if it is not there
+static double metric(const char* name)
+{
+    const size_t len = strlen(name);
+    for (const char* line = s_resp.body; line && *line; line = strchr(line, '\n'), line = line ? line + 1 : NULL) {
+        if (strncmp(line, name, len) == 0 && line[len] == ' ') return atof(line + len + 1);
+    }
+    return -1;
+}
+
+// Every line a "# TYPE name gauge|counter" or a sample of the type declared above it
+static bool prometheus_ok(void)
+{
+    char type_name[96] = "";
+    const char* line = s_resp.body;
+    while (*line) {
+        const char* end = strchr(line, '\n');
+        if (!end) return false;     // the body ends with a newline
+        char l[160];
+        const size_t n = (size_t)(end - line);
+        if (n >= sizeof(l)) return false;
+        memcpy(l, line, n);
+        l[n] = '\0';
+
+        char name[96], kind[16], value[32];
+        if (strncmp(l, "# TYPE ", 7) == 0) {
+            if (sscanf(l, "# TYPE %95s %15s", name, kind) != 2) return false;
+            if (strcmp(kind, "gauge") != 0 && strcmp(kind, "counter") != 0) return false;
+            strlcpy(type_name, name, sizeof(type_name));
+        } else {
+            if (sscanf(l, "%95[a-z0-9_]%*[^ ] %31s", name, value) != 2 &&
+                sscanf(l, "%95[a-z0-9_] %31s", name, value) != 2) return false;
+            if (strcmp(name, type_name) != 0) return false;
+            char* num_end;
+            strtod(value, &num_end);
+            if (*num_end) return false;
+        }
+        line = end + 1;
+    }
+    return true;
+}
+
+static double renders(void)
+{
+    return get("/metrics") ? metric("esp32_http_renders_total") : -1;
+}
+
+static void test_reading(void)
+{
+    // No sample yet: the sensor fields are null
+    CHECK(get("/api/v1/reading"));
+    CHECK_EQ(s_resp.status, 200);
+    CHECK_STR(s_resp.type, "application/json");
+    cJSON* root = cJSON_Parse(s_resp.body);
+    CHECK(root != NULL);
+    CHECK(cJSON_GetObjectItem(root, "temperature_c") && cJSON_GetObjectItem(root, "temperature_c")->type == cJSON_NULL);
+    cJSON_Delete(root);
+
+    s_sample.temp_centi_c = 2153;
+    s_sample.hum_centi_pct = 4820;
+    s_sample.seq = 1;
+    s_sample.tick = 1000;
+    s_sample.climate.dew_point_centi_c = 1007;
+    s_sample.climate.heat_index_centi_c = 2130;
+    s_sample.climate.abs_hum_centi_g_m3 = 914;
+    s_have_sample = true;
+    s_ticks = 4000;
+    s_now_us = 90 * 1000000LL;
+    s_conn.associated = true;
+    s_conn.rssi = -61;
+
+    CHECK(get("/api/v1/reading"));
+    root = cJSON_Parse(s_resp.body);
+    CHECK(root != NULL);
+    if (root) {
+        static const struct { const char* key; double value; } fields[] = {
+            { "temperature_c", 21.53 }, { "humidity_pct", 48.2 }, { "dew_point_c", 10.07 },
+            { "heat_index_c", 21.3 }, { "abs_humidity_g_m3", 9.14 }, { "sample_age_s", 3 },
+            { "wifi_rssi_dbm", -61 }, { "heap_free", 200000 }, { "heap_min_free", 150000 },
+            { "uptime_s", 90 },
+        };
+        for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+            const cJSON* item = cJSON_GetObjectItem(root, fields[i].key);
+            CHECK(cJSON_IsNumber(item));
+            if (item && (long)(item->valuedouble * 100 + 0.5) != (long)(fields[i].value * 100 + 0.5)) {
+                fprintf(stderr, "%s: %g, expected %g\n", fields[i].key, item->valuedouble, fields[i].value);
+                CHECK(false);
+            }
+        }
+    }
+    cJSON_Delete(root);
+}
+
+static void test_metrics(void)
+{
+    CHECK(get("/metrics"));
+    CHECK_EQ(s_resp.status, 200);
+    CHECK_STR(s_resp.type, "text/plain; version=0.0.4");
+    CHECK(prometheus_ok());
+    CHECK(metric("esp32_temperature_celsius") == 21.53);
+    CHECK(metric("esp32_humidity_percent") == 48.2);
+    CHECK(metric("esp32_sensor_samples_total") == 1);
+    CHECK(metric("esp32_sample_age_seconds") == 3);
+    CHECK(metric("esp32_wifi_rssi_dbm") == -61);
+    CHECK(metric("esp32_display_frames_total") == 1234);
+    CHECK(strstr(s_resp.body, "esp32_http_requests_total{path=\"/api/v1/reading\"} 2\n") != NULL);
+
+    // Not associated: no RSSI line
+    s_conn.associated = false;
+    CHECK(get("/metrics"));
+    CHECK(prometheus_ok());
+    CHECK(metric("esp32_wifi_rssi_dbm") == -1);
+    s_conn.associated = true;
+
+    CHECK(get("/nothing"));
+    CHECK_EQ(s_resp.status, 404);
+}
+
+static void test_cache(void)
+{
+    // Both bodies are rendered for the current sample by now
+    CHECK(get("/api/v1/reading"));
+    const double before = renders();
+    CHECK(before >= 2);
+
+    // Same sample: the cached parts are reused, only the live values move
+    char first[BODY_MAX];
+    CHECK(get("/api/v1/reading"));
+    strlcpy(first, s_resp.body, sizeof(first));
+    s_now_us += 5 * 1000000LL;
+    s_heap -= 4096;
+    s_ticks += 5000;
+    CHECK(get("/api/v1/reading"));
+    CHECK(strcmp(first, s_resp.body) != 0);
+    CHECK(strstr(s_resp.body, "\"uptime_s\":95") != NULL);
+    CHECK(strstr(s_resp.body, "\"sample_age_s\":8") != NULL);
+    CHECK(renders() == before);
+    CHECK(renders() == before);
+
+    // A new sample: each body is rebuilt once, on its next GET
+    s_sample.seq = 2;
+    s_sample.temp_centi_c = -505;
+    CHECK(get("/api/v1/reading"));
+    CHECK(strstr(s_resp.body, "\"temperature_c\":-5.05,") != NULL);
+    CHECK(get("/api/v1/reading"));
+    CHECK(renders() == before + 2);
+    CHECK(metric("esp32_temperature_celsius") == -5.05);
+    CHECK(renders() == before + 2);
+}
+
+// test_http_api --serve [port]: after the checks, keeps serving for curl by hand
+int main(int argc, char** argv)
+{
+    const bool serve = argc > 1 && strcmp(argv[1], "--serve") == 0;
+    host_httpd_port = (serve && argc > 2) ? atoi(argv[2]) : 0;
+    CHECK_EQ(http_api_start(), ESP_OK);
+    CHECK(host_httpd_port > 0);
+    test_reading();
+    test_metrics();
+    test_cache();
+    const int failed = test_report("test_http_api");
+    if (serve) {
+        printf("serving http://127.0.0.1:%d/api/v1/reading and /metrics, Ctrl-C to stop\n", host_httpd_port);
+        fflush(stdout);
+        for (;;) pause();
+    }
+    return failed;
+}
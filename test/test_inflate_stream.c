@@ -0,0 +1,134 @@
+// inflate_stream: gzip -9 bodies at every chunk size and tinfl read-ahead depth, in
+// both window modes, then damaged and truncated trailers. The fixtures are the
+// forecast bodies compressed by gzip(1):
+//   gzip -9 -n -c forecast_montreal.json > forecast_montreal.json.gz
+//   gzip -9 -c forecast_tokyo.json > forecast_tokyo.json.gz    (FNAME and MTIME set)
+#include <stdlib.h>
+
+#include "inflate_stream.h"
+#include "test.h"
+
+static const char* const s_fixtures[] = { "forecast_montreal", "forecast_tokyo" };
+static const size_t s_chunks[] = { 1, 2, 3, 7, 64, 1000, SIZE_MAX };
+
+#define OUT_MAX (64 * 1024)
+
+static uint8_t* read_file(const char* name, const char* ext, size_t* len)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s%s", TEST_DATA_DIR, name, ext);
+    FILE* fp = fopen(path, "rb");
+    if (!fp) {
+        fprintf(stderr, "cannot open %s\n", path);
+        exit(2);
+    }
+    fseek(fp, 0, SEEK_END);
+    *len = (size_t)ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    uint8_t* buf = malloc(*len + 16);
+    if (!buf || fread(buf, 1, *len, fp) != *len) exit(2);
+    fclose(fp);
+    return buf;
+}
+
+typedef struct {
+    uint8_t data[OUT_MAX];
+    size_t len;
+} collect_t;
+
+static bool collect_sink(void* ctx, const uint8_t* data, size_t len)
+{
+    collect_t* c = ctx;
+    if (c->len + len > sizeof(c->data)) return false;
+    memcpy(c->data + c->len, data, len);
+    c->len += len;
+    return true;
+}
+
+// Feeds gz in chunks of `chunk` bytes until the stream is done or fails
+static esp_err_t run(inflate_stream_t* s, const uint8_t* gz, size_t len, size_t chunk, collect_t* out)
+{
+    out->len = 0;
+    esp_err_t err = ESP_OK;
+    for (size_t pos = 0; err == ESP_OK && !inflate_stream_done(s) && pos < len;) {
+        const size_t n = (len - pos < chunk) ? len - pos : chunk;
+        err = inflate_stream_feed(s, gz + pos, n, pos + n == len, collect_sink, out);
+        pos += n;
+    }
+    return err;
+}
+
+static collect_t s_out;
+
+static void test_fixtures(void)
+{
+    for (size_t f = 0; f < sizeof(s_fixtures) / sizeof(s_fixtures[0]); f++) {
+        size_t gz_len, json_len;
+        uint8_t* gz = read_file(s_fixtures[f], ".json.gz", &gz_len);
+        uint8_t* json = read_file(s_fixtures[f], ".json", &json_len);
+
+        for (unsigned ahead = 0; ahead <= 4; ahead++) {
+            tinfl_host_lookahead = ahead;
+            for (size_t c = 0; c < sizeof(s_chunks) / sizeof(s_chunks[0]); c++) {
+                inflate_stream_t* s = inflate_stream_create(INFLATE_GZIP);
+                CHECK_EQ(run(s, gz, gz_len, s_chunks[c], &s_out), ESP_OK);
+                CHECK(inflate_stream_done(s));
+                CHECK_EQ(s->in_total, gz_len);
+                CHECK_EQ(s_out.len, json_len);
+                CHECK(memcmp(s_out.data, json, json_len) == 0);
+                inflate_stream_free(s);
+            }
+
+            // Linear, as http_body reads a whole body
+            static uint8_t linear[OUT_MAX];
+            inflate_stream_t* s = inflate_stream_create_linear(INFLATE_GZIP, linear, sizeof(linear));
+            CHECK_EQ(run(s, gz, gz_len, 512, &s_out), ESP_OK);
+            CHECK(inflate_stream_done(s));
+            CHECK(memcmp(linear, json, json_len) == 0);
+            inflate_stream_free(s);
+        }
+        free(gz);
+        free(json);
+    }
+    tinfl_host_lookahead = 4;
+}
+
+static esp_err_t run_whole(const uint8_t* gz, size_t len, size_t chunk)
+{
+    inflate_stream_t* s = inflate_stream_create(INFLATE_GZIP);
+    esp_err_t err = run(s, gz, len, chunk, &s_out);
+    if (err == ESP_OK && !inflate_stream_done(s)) err = ESP_ERR_INVALID_SIZE;
+    inflate_stream_free(s);
+    return err;
+}
+
+static void test_trailer(void)
+{
+    size_t len;
+    uint8_t* gz = read_file("forecast_montreal", ".json.gz", &len);
+
+    // Bytes after the member are not part of it
+    memset(gz + len, 0xA5, 16);
+    inflate_stream_t* s = inflate_stream_create(INFLATE_GZIP);
+    CHECK_EQ(run(s, gz, len + 16, 100, &s_out), ESP_OK);
+    CHECK(inflate_stream_done(s));
+    CHECK_EQ(s->in_total, len);
+    inflate_stream_free(s);
+
+    for (size_t i = 1; i <= 8; i++) {
+        gz[len - i] ^= 0x01;  // crc32, then isize
+        CHECK_EQ(run_whole(gz, len, 1), ESP_ERR_INVALID_CRC);
+        CHECK_EQ(run_whole(gz, len, SIZE_MAX), ESP_ERR_INVALID_CRC);
+        gz[len - i] ^= 0x01;
+        CHECK_EQ(run_whole(gz, len - i, 5), ESP_ERR_INVALID_SIZE);
+    }
+    CHECK_EQ(run_whole(gz, len, 5), ESP_OK);
+    free(gz);
+}
+
+int main(void)
+{
+    test_fixtures();
+    test_trailer();
+    return test_report("test_inflate_stream");
+}
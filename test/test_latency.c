@@ -0,0 +1,149 @@
+// latency: bucket edges, the 12.5% bound, percentiles against a sorted reference,
+// clamping to the largest sample and count halving. The bucket helpers are static,
+// so the module is compiled into this file.
+#include <stdlib.h>
+
+#include "latency.c"
+#include "test.h"
+
+#define RANDOM_SAMPLES 20000
+
+static void reset(void)
+{
+    memset(s_hist, 0, sizeof(s_hist));
+}
+
+static void test_bucket_edges(void)
+{
+    // Exact below 2^LATENCY_SUB_BITS
+    for (uint32_t v = 0; v <= 7; v++) {
+        CHECK_EQ(bucket_of(v), v);
+        CHECK_EQ(bucket_top(v), v);
+    }
+    // 8..15 are still one value per bucket, 16 starts steps of 2
+    CHECK_EQ(bucket_of(8), 8);
+    CHECK_EQ(bucket_of(15), 15);
+    CHECK_EQ(bucket_top(15), 15);
+    CHECK_EQ(bucket_of(16), 16);
+    CHECK_EQ(bucket_of(17), 16);
+    CHECK_EQ(bucket_top(16), 17);
+    // The top of the range is the last bucket
+    CHECK_EQ(bucket_of(MAX_VALUE), LATENCY_BUCKETS - 1);
+    CHECK_EQ(bucket_top(LATENCY_BUCKETS - 1), MAX_VALUE);
+
+    // Contiguous: every bucket starts one past the previous top
+    for (unsigned b = 0; b < LATENCY_BUCKETS; b++) {
+        const uint32_t top = bucket_top(b);
+        CHECK_EQ(bucket_of(top), b);
+        if (b + 1 < LATENCY_BUCKETS) CHECK_EQ(bucket_of(top + 1), b + 1);
+    }
+}
+
+static void test_error_bound(void)
+{
+    int bad = 0;
+    for (uint32_t v = 1; v < (1u << 20); v++) {
+        const uint32_t top = bucket_top(bucket_of(v));
+        if (top < v || (uint64_t)(top - v) * 8 > v) bad++;
+    }
+    srand(3);
+    for (int i = 0; i < 1000000; i++) {
+        const uint32_t v = (((uint32_t)rand() << 16) ^ (uint32_t)rand()) & MAX_VALUE;
+        const uint32_t top = bucket_top(bucket_of(v));
+        if (top < v || (uint64_t)(top - v) * 8 > v) bad++;
+    }
+    CHECK_EQ(bad, 0);
+}
+
+static int cmp_u32(const void* a, const void* b)
+{
+    const uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// What the summary should say for the sample at `rank` (1 based) of the sorted set
+static uint32_t expect_at(const uint32_t* sorted, uint32_t rank, uint32_t max)
+{
+    const uint32_t top = bucket_top(bucket_of(sorted[rank - 1]));
+    return top < max ? top : max;
+}
+
+static void test_percentiles(void)
+{
+    static uint32_t values[RANDOM_SAMPLES];
+    static const uint32_t sizes[] = { 1, 2, 3, 10, 99, 100, 101, 1000, RANDOM_SAMPLES };
+    srand(7);
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        const uint32_t n = sizes[s];
+        reset();
+        for (uint32_t i = 0; i < n; i++) {
+            values[i] = (uint32_t)rand() >> (4 + rand() % 27);  // every magnitude in range
+            latency_record(LAT_HTTP_GEO, values[i]);
+        }
+        qsort(values, n, sizeof(values[0]), cmp_u32);
+
+        latency_summary_t sum;
+        latency_summary(LAT_HTTP_GEO, &sum);
+        CHECK_EQ(sum.samples, n);
+        CHECK_EQ(sum.max_us, values[n - 1]);
+        CHECK_EQ(sum.p50_us, expect_at(values, (n * 500 + 999) / 1000, sum.max_us));
+        CHECK_EQ(sum.p99_us, expect_at(values, (n * 990 + 999) / 1000, sum.max_us));
+    }
+
+    // Nothing recorded
+    reset();
+    latency_summary_t sum;
+    latency_summary(LAT_LOOP_JITTER, &sum);
+    CHECK_EQ(sum.samples, 0);
+    CHECK_EQ(sum.p50_us, 0);
+    CHECK_EQ(sum.p99_us, 0);
+}
+
+static void test_clamp_to_max(void)
+{
+    latency_summary_t sum;
+
+    // 1000 lands in a bucket reaching 1023; no percentile is above the real max
+    reset();
+    latency_record(LAT_DHT20_READ, 1000);
+    latency_summary(LAT_DHT20_READ, &sum);
+    CHECK_EQ(sum.p50_us, 1000);
+    CHECK_EQ(sum.p99_us, 1000);
+
+    // Beyond the range: counted in the last bucket, max stays exact
+    reset();
+    latency_record(LAT_DHT20_READ, 1u << 30);
+    latency_summary(LAT_DHT20_READ, &sum);
+    CHECK_EQ(s_hist[LAT_DHT20_READ].counts[LATENCY_BUCKETS - 1], 1);
+    CHECK_EQ(sum.max_us, 1u << 30);
+    CHECK_EQ(sum.p99_us, MAX_VALUE);
+}
+
+static void test_halving(void)
+{
+    reset();
+    histogram_t* h = &s_hist[LAT_GAME_FRAME];
+    for (int i = 0; i < 10; i++) latency_record(LAT_GAME_FRAME, 500);
+    for (uint32_t i = 0; i < UINT16_MAX; i++) latency_record(LAT_GAME_FRAME, 16000);
+    CHECK_EQ(h->counts[bucket_of(16000)], UINT16_MAX);
+    CHECK_EQ(h->counts[bucket_of(500)], 10);
+
+    // The next one would overflow: everything halves first
+    latency_record(LAT_GAME_FRAME, 16000);
+    CHECK_EQ(h->counts[bucket_of(16000)], UINT16_MAX / 2 + 1);
+    CHECK_EQ(h->counts[bucket_of(500)], 5);
+    CHECK_EQ(h->samples, 10 + UINT16_MAX + 1);
+
+    // Other histograms are untouched
+    CHECK_EQ(s_hist[LAT_GAME_FRAME - 1].samples, 0);
+}
+
+int main(void)
+{
+    test_bucket_edges();
+    test_error_bound();
+    test_percentiles();
+    test_clamp_to_max();
+    test_halving();
+    return test_report("test_latency");
+}
@@ -0,0 +1,214 @@
+// mirror_codec: encode, then decode as mirror_viewer.py does (rle_decode and
+// apply_message) and compare the frame buffers. Unchanged frames, one tile, the
+// whole screen, and runs and literal chunks either side of the control byte limits.
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "mirror_codec.h"
+#include "test.h"
+
+#define RLE_MAX_RUN 130     // control 255
+#define RLE_MAX_LIT 128     // control 127
+
+static uint8_t s_msg[MIRROR_MSG_MAX];
+
+static uint32_t s_rand = 0x9E3779B9;
+
+static uint8_t rand_byte(void)
+{
+    s_rand ^= s_rand << 13;
+    s_rand ^= s_rand >> 17;
+    s_rand ^= s_rand << 5;
+    return (uint8_t)s_rand;
+}
+
+// The viewer's rle_decode, with bounds checks; returns the decoded length or -1
+static int rle_decode(const uint8_t* in, size_t n, uint8_t* out, size_t out_sz)
+{
+    size_t i = 0, o = 0;
+    while (i < n) {
+        const uint8_t c = in[i++];
+        const size_t len = (c < 128) ? (size_t)c + 1 : (size_t)c - 125;
+        if (o + len > out_sz) return -1;
+        if (c < 128) {
+            if (i + len > n) return -1;
+            memcpy(&out[o], &in[i], len);
+            i += len;
+        } else {
+            if (i >= n) return -1;
+            memset(&out[o], in[i++], len);
+        }
+        o += len;
+    }
+    return (int)o;
+}
+
+// The viewer's apply_message on a whole message; false if it is malformed
+static bool apply_message(uint8_t* fb, const uint8_t* msg, size_t len, uint16_t* frame_no)
+{
+    if (len < MIRROR_HDR_SIZE) return false;
+    if (msg[0] != MIRROR_MSG_KEY && msg[0] != MIRROR_MSG_DIFF) return false;
+    if ((size_t)(msg[1] | msg[2] << 8) != len - 3) return false;
+    *frame_no = (uint16_t)(msg[3] | msg[4] << 8);
+
+    const uint8_t* mask = &msg[5];
+    uint8_t tiles[MIRROR_FB_SIZE];
+    const int n = rle_decode(&msg[MIRROR_HDR_SIZE], len - MIRROR_HDR_SIZE, tiles, sizeof(tiles));
+    if (n < 0) return false;
+
+    int pos = 0;
+    for (int t = 0; t < MIRROR_TILE_COUNT; t++) {
+        if (!(mask[t / 8] & (1 << (t % 8)))) continue;
+        if (pos + 8 > n) return false;
+        const size_t off = (size_t)(t / MIRROR_TILES_X) * MIRROR_FB_WIDTH + (size_t)(t % MIRROR_TILES_X) * 8;
+        memcpy(&fb[off], &tiles[pos], 8);
+        pos += 8;
+    }
+    if (msg[0] == MIRROR_MSG_KEY && pos != MIRROR_FB_SIZE) return false;
+    return pos == n;
+}
+
+static int mask_bits(void)
+{
+    int bits = 0;
+    for (int i = 0; i < MIRROR_MASK_SIZE; i++) bits += __builtin_popcount(s_msg[5 + i]);
+    return bits;
+}
+
+// Sends cur as a diff against prev into a viewer holding prev; true if the viewer
+// ends up with cur
+static bool round_trip(const uint8_t* cur, const uint8_t* prev, size_t* msg_len)
+{
+    uint8_t fb[MIRROR_FB_SIZE];
+    uint16_t frame_no = 0;
+    memcpy(fb, prev, sizeof(fb));
+    *msg_len = mirror_encode_frame(cur, prev, 0x1234, s_msg, sizeof(s_msg));
+    if (*msg_len == 0) return memcmp(cur, prev, MIRROR_FB_SIZE) == 0;
+    return apply_message(fb, s_msg, *msg_len, &frame_no) && frame_no == 0x1234
+           && memcmp(fb, cur, sizeof(fb)) == 0;
+}
+
+static void test_frames(void)
+{
+    static uint8_t prev[MIRROR_FB_SIZE], cur[MIRROR_FB_SIZE], fb[MIRROR_FB_SIZE];
+    size_t len;
+    uint16_t frame_no;
+
+    for (size_t i = 0; i < sizeof(prev); i++) prev[i] = rand_byte();
+
+    // Keyframe: every tile, the viewer starts from a blank buffer
+    len = mirror_encode_frame(prev, NULL, 7, s_msg, sizeof(s_msg));
+    CHECK(len > 0);
+    CHECK_EQ(s_msg[0], MIRROR_MSG_KEY);
+    CHECK_EQ(mask_bits(), MIRROR_TILE_COUNT);
+    memset(fb, 0, sizeof(fb));
+    CHECK(apply_message(fb, s_msg, len, &frame_no));
+    CHECK_EQ(frame_no, 7);
+    CHECK(memcmp(fb, prev, sizeof(fb)) == 0);
+    // Incompressible: within the worst case the buffer is sized for
+    CHECK(len <= MIRROR_MSG_MAX);
+
+    // Unchanged: no message at all
+    memcpy(cur, prev, sizeof(cur));
+    CHECK_EQ(mirror_encode_frame(cur, prev, 8, s_msg, sizeof(s_msg)), 0);
+
+    // One pixel in each tile in turn: one tile in the mask, eight bytes of data
+    for (int t = 0; t < MIRROR_TILE_COUNT; t++) {
+        memcpy(cur, prev, sizeof(cur));
+        const size_t off = (size_t)(t / MIRROR_TILES_X) * MIRROR_FB_WIDTH + (size_t)(t % MIRROR_TILES_X) * 8;
+        cur[off + (size_t)(t % 8)] ^= 0x10;
+        CHECK(round_trip(cur, prev, &len));
+        CHECK_EQ(s_msg[0], MIRROR_MSG_DIFF);
+        CHECK_EQ(mask_bits(), 1);
+        CHECK(s_msg[5 + t / 8] & (1 << (t % 8)));
+    }
+
+    // The whole screen, cleared and then inverted
+    memset(cur, 0, sizeof(cur));
+    CHECK(round_trip(cur, prev, &len));
+    CHECK_EQ(mask_bits(), MIRROR_TILE_COUNT);
+    CHECK_EQ(len, MIRROR_HDR_SIZE + 2 * ((MIRROR_FB_SIZE + RLE_MAX_RUN - 1) / RLE_MAX_RUN));
+    for (size_t i = 0; i < sizeof(cur); i++) cur[i] = (uint8_t)~prev[i];
+    CHECK(round_trip(cur, prev, &len));
+    CHECK_EQ(mask_bits(), MIRROR_TILE_COUNT);
+
+    // Random edits on a mostly blank screen, as the UI draws
+    int bad = 0;
+    memset(prev, 0, sizeof(prev));
+    for (int round = 0; round < 2000; round++) {
+        memcpy(cur, prev, sizeof(cur));
+        const int edits = 1 + rand_byte() % 40;
+        for (int e = 0; e < edits; e++) {
+            const size_t at = ((size_t)rand_byte() << 8 | rand_byte()) % MIRROR_FB_SIZE;
+            const size_t n = 1 + rand_byte() % 200;
+            const uint8_t v = (rand_byte() & 1) ? rand_byte() : 0xFF;
+            for (size_t i = at; i < at + n && i < MIRROR_FB_SIZE; i++) cur[i] = (rand_byte() & 3) ? v : rand_byte();
+        }
+        if (!round_trip(cur, prev, &len)) bad++;
+        memcpy(prev, cur, sizeof(prev));
+    }
+    CHECK_EQ(bad, 0);
+}
+
+// Runs and literal chunks either side of the limits of one control byte
+static void test_rle_limits(void)
+{
+    static uint8_t in[4 * RLE_MAX_RUN + 8], enc[sizeof(in) * 2], dec[sizeof(in)];
+    static const size_t lens[] = { 1, 2, 3, 4, RLE_MAX_LIT - 1, RLE_MAX_LIT, RLE_MAX_LIT + 1,
+                                   RLE_MAX_RUN - 1, RLE_MAX_RUN, RLE_MAX_RUN + 1, RLE_MAX_RUN + 2,
+                                   RLE_MAX_RUN + 3, 2 * RLE_MAX_RUN, 2 * RLE_MAX_RUN + 1, 4 * RLE_MAX_RUN };
+
+    for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+        const size_t n = lens[l];
+
+        // One run: full 255 controls, then whatever is left
+        memset(in, 0xA5, n);
+        size_t len = mirror_rle_encode(in, n, enc, sizeof(enc));
+        CHECK(len > 0);
+        CHECK_EQ(rle_decode(enc, len, dec, sizeof(dec)), (int)n);
+        CHECK(memcmp(dec, in, n) == 0);
+        if (n >= RLE_MAX_RUN) CHECK_EQ(enc[0], 255);
+        for (size_t i = 0; i < len; i++) {
+            if (enc[i] >= 128) CHECK(enc[i] - 125 <= RLE_MAX_RUN);
+        }
+
+        // Literals: no two neighbours equal, split at 128 per control
+        for (size_t i = 0; i < n; i++) in[i] = (uint8_t)(i & 0x7F) ^ (uint8_t)(i >> 7);
+        len = mirror_rle_encode(in, n, enc, sizeof(enc));
+        CHECK_EQ(len, n + (n + RLE_MAX_LIT - 1) / RLE_MAX_LIT);
+        CHECK_EQ(rle_decode(enc, len, dec, sizeof(dec)), (int)n);
+        CHECK(memcmp(dec, in, n) == 0);
+        if (n >= RLE_MAX_LIT) CHECK_EQ(enc[0], RLE_MAX_LIT - 1);
+
+        // A run of n between literals, and a run right after a full literal chunk
+        memset(in, 0x3C, sizeof(in));
+        in[0] = 1;
+        in[1] = 2;
+        in[n + 2] = 3;
+        len = mirror_rle_encode(in, n + 3, enc, sizeof(enc));
+        CHECK_EQ(rle_decode(enc, len, dec, sizeof(dec)), (int)n + 3);
+        CHECK(memcmp(dec, in, n + 3) == 0);
+
+        for (size_t i = 0; i < RLE_MAX_LIT; i++) in[i] = (uint8_t)(i | 0x80);
+        memset(&in[RLE_MAX_LIT], 0x00, n < RLE_MAX_RUN ? n : RLE_MAX_RUN);
+        const size_t total = RLE_MAX_LIT + (n < RLE_MAX_RUN ? n : RLE_MAX_RUN);
+        len = mirror_rle_encode(in, total, enc, sizeof(enc));
+        CHECK_EQ(rle_decode(enc, len, dec, sizeof(dec)), (int)total);
+        CHECK(memcmp(dec, in, total) == 0);
+    }
+
+    // Output shorter than it needs: refused, not overrun
+    memset(in, 0x11, RLE_MAX_RUN + 1);
+    const size_t need = mirror_rle_encode(in, RLE_MAX_RUN + 1, enc, sizeof(enc));
+    CHECK_EQ(need, 4);
+    for (size_t sz = 0; sz < need; sz++) CHECK_EQ(mirror_rle_encode(in, RLE_MAX_RUN + 1, enc, sz), 0);
+    CHECK_EQ(mirror_rle_encode(in, RLE_MAX_RUN, enc, 2), 2);
+    CHECK_EQ(mirror_rle_encode(in, RLE_MAX_RUN, enc, 1), 0);
+}
+
+int main(void)
+{
+    test_frames();
+    test_rle_limits();
+    return test_report("test_mirror_codec");
+}
@@ -0,0 +1,322 @@
+// sample_log against an in-memory NOR flash: round trips, wrap-around, and power
+// cuts at random points of writes and erases followed by a remount
+#include <stdlib.h>
+
+#include "sample_log.h"
+#include "test.h"
+
+#define FLASH_SIZE (8 * SAMPLE_LOG_SECTOR)
+
+// NOR semantics: a write can only clear bits, an erase sets a whole sector to 0xFF.
+// Once the power is cut every operation fails until the next "boot" (remount).
+typedef struct {
+    uint8_t mem[FLASH_SIZE];
+    long ops;           // writes and erases so far
+    long cut_at;        // op number that loses power, -1 for never
+    bool dead;
+    long erases[FLASH_SIZE / SAMPLE_LOG_SECTOR];
+} nor_t;
+
+static nor_t s_nor;
+
+static bool nor_read(void* ctx, uint32_t off, void* buf, size_t len)
+{
+    nor_t* f = ctx;
+    if (f->dead || off + len > FLASH_SIZE) return false;
+    memcpy(buf, &f->mem[off], len);
+    return true;
+}
+
+static bool nor_power(nor_t* f)
+{
+    if (f->dead) return false;
+    if (f->cut_at >= 0 && f->ops++ == f->cut_at) {
+        f->dead = true;
+        return false;
+    }
+    return true;
+}
+
+static bool nor_write(void* ctx, uint32_t off, const void* buf, size_t len)
+{
+    nor_t* f = ctx;
+    const uint8_t* src = buf;
+    CHECK(off + len <= FLASH_SIZE);
+    // Page program may not cross a page
+    CHECK(off / SAMPLE_LOG_PAGE == (off + len - 1) / SAMPLE_LOG_PAGE);
+    size_t n = len;
+    if (!nor_power(f)) {
+        if (!f->dead) return false;
+        n = (size_t)rand() % (len + 1); // torn: some prefix made it
+    }
+    for (size_t i = 0; i < n; i++) f->mem[off + i] &= src[i];
+    return !f->dead;
+}
+
+static bool nor_erase(void* ctx, uint32_t off, size_t len)
+{
+    nor_t* f = ctx;
+    CHECK(off % SAMPLE_LOG_SECTOR == 0 && len == SAMPLE_LOG_SECTOR);
+    size_t n = len;
+    if (!nor_power(f)) {
+        if (!f->dead) return false;
+        n = (size_t)rand() % (len + 1);
+    }
+    memset(&f->mem[off], 0xFF, n);
+    if (n == len) f->erases[off / SAMPLE_LOG_SECTOR]++;
+    return !f->dead;
+}
+
+static const sample_log_flash_t s_flash = {
+    .ctx = &s_nor, .read = nor_read, .write = nor_write, .erase = nor_erase, .size = FLASH_SIZE,
+};
+
+static void nor_reset(uint8_t fill)
+{
+    memset(&s_nor, 0, sizeof(s_nor));
+    memset(s_nor.mem, fill, sizeof(s_nor.mem));
+    s_nor.cut_at = -1;
+}
+
+static void nor_boot(void)
+{
+    s_nor.dead = false;
+    s_nor.cut_at = -1;
+}
+
+// Sample i of a deterministic stream: mostly small steps, some large jumps
+static history_sample_t sample_at(uint32_t i)
+{
+    history_sample_t s = {
+        .time_s = 1000 + i * 60 + (i / 100) * 100000,
+        .temp_centi_c = (int16_t)(-1500 + (int)((i * 37) % 4000) - (i % 13 == 0 ? 20000 : 0)),
+        .hum_centi_pct = (uint16_t)(i % 17 == 0 ? 0 : 4000 + (i * 11) % 2000),
+    };
+    return s;
+}
+
+static bool same_sample(const history_sample_t* a, const history_sample_t* b)
+{
+    return a->time_s == b->time_s && a->temp_centi_c == b->temp_centi_c && a->hum_centi_pct == b->hum_centi_pct;
+}
+
+// Drains the log, checking each sample is the next one of the stream; returns the index
+// after the last sample read
+static uint32_t drain(sample_log_t* log, uint32_t expect_first, bool* ok)
+{
+    history_sample_t out[SAMPLE_LOG_MAX_PER_PAGE];
+    uint32_t seq;
+    uint32_t i = expect_first;
+    size_t n;
+    while ((n = sample_log_read_oldest(log, out, &seq)) > 0) {
+        for (size_t k = 0; k < n; k++, i++) {
+            history_sample_t want = sample_at(i);
+            if (!same_sample(&out[k], &want)) *ok = false;
+        }
+        if (!sample_log_consume(log, seq)) {
+            *ok = false;
+            break;
+        }
+    }
+    return i;
+}
+
+static void test_round_trip(void)
+{
+    nor_reset(0xA5); // garbage, not erased
+    sample_log_t log;
+    CHECK(sample_log_mount(&log, &s_flash));
+    CHECK_EQ(sample_log_pending(&log), 0);
+
+    const uint32_t n = 1000;
+    for (uint32_t i = 0; i < n; i++) {
+        history_sample_t s = sample_at(i);
+        CHECK(sample_log_append(&log, &s));
+    }
+    CHECK(sample_log_flush(&log));
+    CHECK(sample_log_pending(&log) > 0);
+
+    // Typical deltas take 3 bytes, so a page holds close to the maximum
+    CHECK(sample_log_pending(&log) <= n / 40 + 2);
+
+    sample_log_t again;
+    CHECK(sample_log_mount(&again, &s_flash));
+    CHECK_EQ(sample_log_pending(&again), sample_log_pending(&log));
+    bool ok = true;
+    CHECK_EQ(drain(&again, 0, &ok), n);
+    CHECK(ok);
+    CHECK_EQ(sample_log_pending(&again), 0);
+
+    // Consumed pages stay consumed across a remount
+    CHECK(sample_log_mount(&again, &s_flash));
+    CHECK_EQ(sample_log_pending(&again), 0);
+}
+
+static void test_wrap(void)
+{
+    nor_reset(0xFF);
+    sample_log_t log;
+    CHECK(sample_log_mount(&log, &s_flash));
+
+    // Far more than the region holds: only the newest pages survive, in order
+    const uint32_t n = 60000;
+    for (uint32_t i = 0; i < n; i++) {
+        history_sample_t s = sample_at(i);
+        CHECK(sample_log_append(&log, &s));
+    }
+    CHECK(sample_log_flush(&log));
+
+    // At most one sector is being recycled at any time
+    const uint32_t pages = FLASH_SIZE / SAMPLE_LOG_PAGE;
+    const uint32_t per_sector = SAMPLE_LOG_SECTOR / SAMPLE_LOG_PAGE;
+    CHECK(sample_log_pending(&log) >= pages - 2 * per_sector);
+
+    sample_log_t again;
+    CHECK(sample_log_mount(&again, &s_flash));
+    history_sample_t out[SAMPLE_LOG_MAX_PER_PAGE];
+    uint32_t seq;
+    size_t k = sample_log_read_oldest(&again, out, &seq);
+    CHECK(k > 0);
+
+    // Find where the surviving data starts in the stream, then check the rest
+    uint32_t first = 0;
+    while (first < n && sample_at(first).time_s != out[0].time_s) first++;
+    CHECK(first < n && first > 0);
+    bool ok = true;
+    CHECK_EQ(drain(&again, first, &ok), n);
+    CHECK(ok);
+
+    // Wear levelling: every sector has been erased about the same number of times
+    long lo = s_nor.erases[0], hi = s_nor.erases[0];
+    for (size_t i = 1; i < sizeof(s_nor.erases) / sizeof(s_nor.erases[0]); i++) {
+        if (s_nor.erases[i] < lo) lo = s_nor.erases[i];
+        if (s_nor.erases[i] > hi) hi = s_nor.erases[i];
+    }
+    CHECK(hi - lo <= 1);
+}
+
+// Append in bursts and cut the power at a random flash operation, then reboot.
+// Samples whose page write completed must come back; nothing may come back
+// corrupted or out of order. A cut during consume may deliver a page twice (at least
+// once delivery), which shows up as a repeat of already delivered samples.
+#define CUT_SAMPLES 200000
+
+enum { SAMPLE_LOST, SAMPLE_APPENDED, SAMPLE_DURABLE };
+
+static uint8_t s_state[CUT_SAMPLES];
+static uint8_t s_delivered[CUT_SAMPLES];
+
+// sample_at() times increase with the index, so find it by bisection
+static uint32_t index_of(const history_sample_t* s)
+{
+    uint32_t lo = 0, hi = CUT_SAMPLES;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (sample_at(mid).time_s < s->time_s) lo = mid + 1;
+        else hi = mid;
+    }
+    history_sample_t want = sample_at(lo);
+    return (lo < CUT_SAMPLES && same_sample(s, &want)) ? lo : UINT32_MAX;
+}
+
+// Reads and consumes everything; returns false on a sample that is not from the
+// stream or out of order
+static bool drain_checked(sample_log_t* log, uint32_t* last)
+{
+    history_sample_t out[SAMPLE_LOG_MAX_PER_PAGE];
+    uint32_t seq;
+    size_t n;
+    bool ok = true;
+    while (!s_nor.dead && (n = sample_log_read_oldest(log, out, &seq)) > 0) {
+        uint32_t page_first = index_of(&out[0]);
+        for (size_t k = 0; k < n; k++) {
+            uint32_t idx = index_of(&out[k]);
+            if (idx == UINT32_MAX || s_state[idx] == SAMPLE_LOST) {
+                ok = false;
+                continue;
+            }
+            // A repeated page starts at or before what was already delivered;
+            // otherwise the stream only moves forward
+            if (k > 0 && idx <= page_first) ok = false;
+            if (s_delivered[idx] && idx > *last) ok = false;
+            s_delivered[idx] = 1;
+            if (idx > *last) *last = idx;
+        }
+        if (!sample_log_consume(log, seq)) break;
+    }
+    return ok;
+}
+
+static void test_power_cuts(void)
+{
+    nor_reset(0xFF);
+    memset(s_state, SAMPLE_LOST, sizeof(s_state));
+    memset(s_delivered, 0, sizeof(s_delivered));
+    srand(36);
+
+    uint32_t next = 0;
+    uint32_t last = 0;
+    long cuts = 0, bad = 0;
+
+    for (int round = 0; round < 3000 && next + 200 < CUT_SAMPLES; round++) {
+        nor_boot();
+        sample_log_t log;
+        CHECK(sample_log_mount(&log, &s_flash));
+        s_nor.cut_at = s_nor.ops + rand() % 8;
+
+        int burst = rand() % 120;
+        uint32_t page_start = next;     // first sample in the RAM page buffer
+        for (int i = 0; i < burst && !s_nor.dead; i++) {
+            history_sample_t s = sample_at(next);
+            uint32_t before = sample_log_pending(&log);
+            if (!sample_log_append(&log, &s)) break;
+            s_state[next] = SAMPLE_APPENDED;
+            // A full page went out before this sample was buffered
+            if (sample_log_pending(&log) != before) {
+                for (uint32_t j = page_start; j < next; j++) s_state[j] = SAMPLE_DURABLE;
+                page_start = next;
+            }
+            next++;
+        }
+        if (!s_nor.dead && sample_log_flush(&log)) {
+            for (uint32_t j = page_start; j < next; j++) s_state[j] = SAMPLE_DURABLE;
+        }
+        if (s_nor.dead) cuts++;
+
+        // Reboot and drain now and then, as the uploader would after reconnecting,
+        // sometimes losing power again part way
+        if (rand() % 4 == 0) {
+            nor_boot();
+            sample_log_t r;
+            CHECK(sample_log_mount(&r, &s_flash));
+            if (rand() % 3 == 0) s_nor.cut_at = s_nor.ops + rand() % 8;
+            if (!drain_checked(&r, &last)) bad++;
+        }
+    }
+
+    // Final clean drain: every durable sample was delivered at least once
+    nor_boot();
+    sample_log_t r;
+    CHECK(sample_log_mount(&r, &s_flash));
+    if (!drain_checked(&r, &last)) bad++;
+    long missing = 0, durable = 0;
+    for (uint32_t j = 0; j < next; j++) {
+        if (s_state[j] != SAMPLE_DURABLE) continue;
+        durable++;
+        if (!s_delivered[j]) missing++;
+    }
+
+    printf("power cuts: %ld cuts, %ld durable samples, %u appended\n", cuts, durable, next);
+    CHECK(cuts > 100);
+    CHECK(durable > 1000);
+    CHECK_EQ(bad, 0);
+    CHECK_EQ(missing, 0);
+}
+
+int main(void)
+{
+    test_round_trip();
+    test_wrap();
+    test_power_cuts();
+    return test_report("test_sample_log");
+}
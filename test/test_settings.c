@@ -0,0 +1,329 @@
+// settings: range and charset checks, the console verbs, and the coalesced commit on
+// a fake NVS and esp_timer. The fake NVS keeps writes pending until nvs_commit, as
+// the real one may lose them without it, and can be told to fail the next commit.
+#include <stdlib.h>
+
+#include <esp_timer.h>
+#include <nvs.h>
+
+#include "mqtt_pub.h"
+#include "settings.h"
+#include "test.h"
+
+// --- fake NVS: one namespace is enough here
+
+#define NVS_KEYS 8
+
+typedef struct {
+    char key[16];
+    bool is_str;
+    int32_t i;
+    char s[SETTINGS_STR_MAX];
+} nvs_entry_t;
+
+static nvs_entry_t s_stored[NVS_KEYS], s_pending[NVS_KEYS];
+static int s_commits;
+static bool s_fail_commit;
+
+static nvs_entry_t* entry(nvs_entry_t* table, const char* key, bool create)
+{
+    for (int i = 0; i < NVS_KEYS; i++) {
+        if (strcmp(table[i].key, key) == 0) return &table[i];
+    }
+    if (!create) return NULL;
+    for (int i = 0; i < NVS_KEYS; i++) {
+        if (!table[i].key[0]) {
+            strlcpy(table[i].key, key, sizeof(table[i].key));
+            return &table[i];
+        }
+    }
+    return NULL;
+}
+
+esp_err_t nvs_open(const char* ns, nvs_open_mode_t mode, nvs_handle_t* out)
+{
+    memcpy(s_pending, s_stored, sizeof(s_pending));
+    *out = 1;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t h) {}
+
+esp_err_t nvs_commit(nvs_handle_t h)
+{
+    if (s_fail_commit) {
+        s_fail_commit = false;
+        return ESP_FAIL;
+    }
+    memcpy(s_stored, s_pending, sizeof(s_stored));
+    s_commits++;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_i32(nvs_handle_t h, const char* key, int32_t value)
+{
+    nvs_entry_t* e = entry(s_pending, key, true);
+    e->is_str = false;
+    e->i = value;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_i32(nvs_handle_t h, const char* key, int32_t* out)
+{
+    const nvs_entry_t* e = entry(s_stored, key, false);
+    if (!e || e->is_str) return ESP_ERR_NVS_NOT_FOUND;
+    *out = e->i;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_str(nvs_handle_t h, const char* key, const char* value)
+{
+    nvs_entry_t* e = entry(s_pending, key, true);
+    e->is_str = true;
+    strlcpy(e->s, value, sizeof(e->s));
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_str(nvs_handle_t h, const char* key, char* out, size_t* len)
+{
+    const nvs_entry_t* e = entry(s_stored, key, false);
+    if (!e || !e->is_str) return ESP_ERR_NVS_NOT_FOUND;
+    strlcpy(out, e->s, *len);
+    return ESP_OK;
+}
+
+static const char* stored_str(const char* key)
+{
+    const nvs_entry_t* e = entry(s_stored, key, false);
+    return e ? e->s : "";
+}
+
+static int32_t stored_int(const char* key)
+{
+    const nvs_entry_t* e = entry(s_stored, key, false);
+    return e ? e->i : -1;
+}
+
+// --- fake esp_timer: one timer, time moves only in advance_ms()
+
+struct esp_timer {
+    esp_timer_create_args_t args;
+    bool active;
+    int64_t due_us;
+};
+
+static struct esp_timer s_timer;
+static int64_t s_now_us;
+
+int64_t esp_timer_get_time(void) { return s_now_us; }
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out)
+{
+    memset(&s_timer, 0, sizeof(s_timer));
+    s_timer.args = *args;
+    *out = &s_timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t t, uint64_t timeout_us)
+{
+    if (t->active) return ESP_ERR_INVALID_STATE;
+    t->active = true;
+    t->due_us = s_now_us + (int64_t)timeout_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t t)
+{
+    if (!t->active) return ESP_ERR_INVALID_STATE;
+    t->active = false;
+    return ESP_OK;
+}
+
+static void advance_ms(int ms)
+{
+    s_now_us += (int64_t)ms * 1000;
+    if (s_timer.active && s_now_us >= s_timer.due_us) {
+        s_timer.active = false;
+        s_timer.args.callback(s_timer.args.arg);
+    }
+}
+
+const char* esp_err_to_name(esp_err_t code)
+{
+    return code == ESP_OK ? "ESP_OK" : "error";
+}
+
+// ---
+
+static void get_city(char* out)
+{
+    settings_get_str(SET_CITY, out, SETTINGS_STR_MAX);
+}
+
+static void test_defaults_and_ranges(void)
+{
+    char city[SETTINGS_STR_MAX];
+    settings_init();
+    get_city(city);
+    CHECK_STR(city, "Montreal");
+    CHECK_EQ(settings_get_int(SET_SAMPLE_MS), 2000);
+
+    // Ints: both ends of the range, and text that is not a number
+    CHECK_EQ(settings_set_int(SET_SAMPLE_MS, 999), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(settings_set_int(SET_SAMPLE_MS, 60001), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(settings_set_int(SET_SAMPLE_MS, 1000), ESP_OK);
+    CHECK_EQ(settings_set_int(SET_SAMPLE_MS, 60000), ESP_OK);
+    CHECK_EQ(settings_set_text(SET_HISTORY_S, "12x"), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(settings_set_text(SET_HISTORY_S, ""), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(settings_set_text(SET_HISTORY_S, "9"), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(settings_set_text(SET_HISTORY_S, "120"), ESP_OK);
+    CHECK_EQ(settings_get_int(SET_HISTORY_S), 120);
+    CHECK_EQ(settings_set_str(SET_SAMPLE_MS, "2000"), ESP_ERR_INVALID_ARG);  // wrong type
+
+    // The MQTT batch size is bounded by the publisher's batch buffer
+    CHECK_EQ(settings_get_int(SET_MQTT_BATCH), MQTT_BATCH_SAMPLES);
+    CHECK_EQ(settings_get_int(SET_MQTT_AGE_S), MQTT_BATCH_MAX_AGE_S);
+    CHECK_EQ(settings_set_int(SET_MQTT_BATCH, 0), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(settings_set_int(SET_MQTT_BATCH, MQTT_BATCH_MAX_SAMPLES + 1), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(settings_set_int(SET_MQTT_BATCH, MQTT_BATCH_MAX_SAMPLES), ESP_OK);
+    CHECK_EQ(settings_set_text(SET_MQTT_AGE_S, "4"), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(settings_set_text(SET_MQTT_AGE_S, "3600"), ESP_OK);
+    CHECK_EQ(settings_set_text(SET_MQTT_AGE_S, "3601"), ESP_ERR_INVALID_ARG);
+
+    // Strings: length and the URL-safe charset
+    char longest[SETTINGS_STR_MAX + 1];
+    memset(longest, 'a', sizeof(longest));
+    longest[SETTINGS_STR_MAX] = '\0';
+    CHECK_EQ(settings_set_str(SET_CITY, longest), ESP_ERR_INVALID_ARG);
+    longest[SETTINGS_STR_MAX - 1] = '\0';
+    CHECK_EQ(settings_set_str(SET_CITY, longest), ESP_OK);
+    CHECK_EQ(settings_set_str(SET_CITY, ""), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(settings_set_str(SET_CITY, "Paris&x=1"), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(settings_set_str(SET_CITY, "a/b"), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(settings_set_str(SET_CITY, "Saint-Jean-sur-Richelieu"), ESP_OK);
+    CHECK_EQ(settings_set_str(SET_CITY, "St. John's"), ESP_OK);
+    get_city(city);
+    CHECK_STR(city, "St. John's");
+    settings_flush();
+}
+
+static void test_console(void)
+{
+    char city[SETTINGS_STR_MAX];
+    settings_console("set city New York");
+    get_city(city);
+    CHECK_STR(city, "New York");
+
+    // No value: rejected, nothing changes
+    const uint32_t gen = settings_generation();
+    settings_console("set city");
+    settings_console("set sample_ms");
+    settings_console("set sample_ms   ");
+    settings_console("set");
+    settings_console("set nosuch 5");
+    settings_console("set sample_ms 10");
+    settings_console("bogus");
+    CHECK_EQ(settings_generation(), gen);
+    get_city(city);
+    CHECK_STR(city, "New York");
+
+    settings_console("set sample_ms 5000");
+    CHECK_EQ(settings_get_int(SET_SAMPLE_MS), 5000);
+    settings_console("reset sample_ms");
+    CHECK_EQ(settings_get_int(SET_SAMPLE_MS), 2000);
+    settings_console("reset city");
+    get_city(city);
+    CHECK_STR(city, "Montreal");
+    settings_console("list");
+    settings_console("get city");
+    settings_flush();
+}
+
+static void test_coalesced_commit(void)
+{
+    settings_flush();
+    s_commits = 0;
+
+    // A burst, each write inside the delay of the one before
+    settings_set_str(SET_CITY, "Quebec");
+    advance_ms(SETTINGS_COMMIT_DELAY_MS - 1);
+    settings_set_int(SET_SAMPLE_MS, 3000);
+    advance_ms(SETTINGS_COMMIT_DELAY_MS / 2);
+    settings_set_int(SET_HISTORY_S, 300);
+    advance_ms(SETTINGS_COMMIT_DELAY_MS - 1);
+    settings_set_int(SET_SAMPLE_MS, 4000);
+    CHECK_EQ(s_commits, 0);
+
+    advance_ms(SETTINGS_COMMIT_DELAY_MS - 1);
+    CHECK_EQ(s_commits, 0);
+    advance_ms(1);
+    CHECK_EQ(s_commits, 1);
+    CHECK_STR(stored_str("city"), "Quebec");
+    CHECK_EQ(stored_int("sample_ms"), 4000);
+    CHECK_EQ(stored_int("history_s"), 300);
+
+    // Nothing left: no further commits
+    advance_ms(10 * SETTINGS_COMMIT_DELAY_MS);
+    CHECK_EQ(settings_flush(), ESP_OK);
+    CHECK_EQ(s_commits, 1);
+
+    // Writing the current value is not a change
+    settings_set_int(SET_SAMPLE_MS, 4000);
+    advance_ms(SETTINGS_COMMIT_DELAY_MS);
+    CHECK_EQ(s_commits, 1);
+}
+
+static void test_failed_commit(void)
+{
+    s_commits = 0;
+    settings_set_str(SET_CITY, "Gatineau");
+    settings_set_int(SET_HISTORY_S, 600);
+    s_fail_commit = true;
+    advance_ms(SETTINGS_COMMIT_DELAY_MS);
+    CHECK_EQ(s_commits, 0);
+    CHECK_STR(stored_str("city"), "Quebec");
+
+    // Both keys are dirty again: the next flush writes them
+    CHECK_EQ(settings_flush(), ESP_OK);
+    CHECK_EQ(s_commits, 1);
+    CHECK_STR(stored_str("city"), "Gatineau");
+    CHECK_EQ(stored_int("history_s"), 600);
+
+    // And also after a write to another key only
+    s_fail_commit = true;
+    settings_set_int(SET_HISTORY_S, 900);
+    CHECK_EQ(settings_flush(), ESP_FAIL);
+    settings_set_int(SET_SAMPLE_MS, 1500);
+    advance_ms(SETTINGS_COMMIT_DELAY_MS);
+    CHECK_EQ(s_commits, 2);
+    CHECK_EQ(stored_int("history_s"), 900);
+    CHECK_EQ(stored_int("sample_ms"), 1500);
+}
+
+static void test_reload(void)
+{
+    // What was committed comes back; out-of-range or bad stored values do not
+    settings_init();
+    CHECK_EQ(settings_get_int(SET_HISTORY_S), 900);
+    char city[SETTINGS_STR_MAX];
+    get_city(city);
+    CHECK_STR(city, "Gatineau");
+
+    entry(s_stored, "sample_ms", false)->i = 5;
+    strlcpy(entry(s_stored, "city", false)->s, "a?b", SETTINGS_STR_MAX);
+    settings_init();
+    CHECK_EQ(settings_get_int(SET_SAMPLE_MS), 2000);
+    get_city(city);
+    CHECK_STR(city, "Montreal");
+}
+
+int main(void)
+{
+    test_defaults_and_ranges();
+    test_console();
+    test_coalesced_commit();
+    test_failed_commit();
+    test_reload();
+    return test_report("test_settings");
+}
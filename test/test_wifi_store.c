@@ -0,0 +1,183 @@
+// wifi_store: most recent first on add and update, the oldest dropped when full,
+// removal keeping the order, the NVS blob read back at init, and the "wifi" console
+// verbs. Compiled in for the order of the static list.
+#include <stdlib.h>
+
+#include <nvs.h>
+
+#include "wifi_store.c"
+#include "test.h"
+
+// --- fake NVS: the one blob
+
+static uint8_t s_blob[sizeof(store_t) + 8];
+static size_t s_blob_len;
+static int s_writes;
+
+esp_err_t nvs_open(const char* ns, nvs_open_mode_t mode, nvs_handle_t* out)
+{
+    *out = 1;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t h) {}
+esp_err_t nvs_commit(nvs_handle_t h) { return ESP_OK; }
+
+esp_err_t nvs_set_blob(nvs_handle_t h, const char* key, const void* value, size_t len)
+{
+    if (len > sizeof(s_blob)) return ESP_ERR_NVS_NO_FREE_PAGES;
+    memcpy(s_blob, value, len);
+    s_blob_len = len;
+    s_writes++;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t h, const char* key, void* out, size_t* len)
+{
+    if (!s_blob_len) return ESP_ERR_NVS_NOT_FOUND;
+    if (*len < s_blob_len) return ESP_ERR_INVALID_SIZE;
+    memcpy(out, s_blob, s_blob_len);
+    *len = s_blob_len;
+    return ESP_OK;
+}
+
+const char* esp_err_to_name(esp_err_t code)
+{
+    return code == ESP_OK ? "ESP_OK" : "error";
+}
+
+// ---
+
+// The stored order, most recent first, as "a,b,c"
+static const char* order(void)
+{
+    static char out[WIFI_STORE_MAX * WIFI_SSID_MAX];
+    out[0] = '\0';
+    for (int i = 0; i < s_store.count; i++) {
+        if (i) strlcat(out, ",", sizeof(out));
+        strlcat(out, s_store.nets[i].ssid, sizeof(out));
+    }
+    return out;
+}
+
+static const char* pass_of(const char* ssid)
+{
+    static wifi_cred_t cred;
+    return wifi_store_find(ssid, &cred) ? cred.pass : "(none)";
+}
+
+static void test_order(void)
+{
+    static const char* const names[] = { "a", "b", "c", "d", "e", "f", "g", "h" };
+    wifi_store_init();
+    CHECK_EQ(wifi_store_count(), 0);
+
+    for (int i = 0; i < WIFI_STORE_MAX; i++) CHECK_EQ(wifi_store_add(names[i], "pw"), ESP_OK);
+    CHECK_EQ(wifi_store_count(), WIFI_STORE_MAX);
+    CHECK_STR(order(), "h,g,f,e,d,c,b,a");
+
+    // Update: moves to the front with the new password, nothing dropped
+    CHECK_EQ(wifi_store_add("c", "new"), ESP_OK);
+    CHECK_STR(order(), "c,h,g,f,e,d,b,a");
+    CHECK_STR(pass_of("c"), "new");
+    CHECK_EQ(wifi_store_add("a", "pw2"), ESP_OK);
+    CHECK_STR(order(), "a,c,h,g,f,e,d,b");
+
+    // Full: a new one drops the oldest, which is now b
+    CHECK_EQ(wifi_store_add("i", ""), ESP_OK);
+    CHECK_STR(order(), "i,a,c,h,g,f,e,d");
+    CHECK(!wifi_store_find("b", NULL));
+    CHECK_EQ(wifi_store_count(), WIFI_STORE_MAX);
+
+    // Remove: first, middle, last, and one that is not there
+    CHECK_EQ(wifi_store_remove("i"), ESP_OK);
+    CHECK_EQ(wifi_store_remove("g"), ESP_OK);
+    CHECK_EQ(wifi_store_remove("d"), ESP_OK);
+    CHECK_STR(order(), "a,c,h,f,e");
+    const int writes = s_writes;
+    CHECK_EQ(wifi_store_remove("zz"), ESP_ERR_NOT_FOUND);
+    CHECK_EQ(s_writes, writes);
+    CHECK_EQ(wifi_store_count(), 5);
+    CHECK(s_store.nets[5].ssid[0] == '\0');
+
+    // And room again: a new one goes in front without dropping anything
+    CHECK_EQ(wifi_store_add("j", "pw"), ESP_OK);
+    CHECK_STR(order(), "j,a,c,h,f,e");
+}
+
+static void test_limits(void)
+{
+    char ssid[WIFI_SSID_MAX + 1], pass[WIFI_PASS_MAX + 1];
+    memset(ssid, 's', sizeof(ssid));
+    memset(pass, 'p', sizeof(pass));
+    ssid[WIFI_SSID_MAX] = pass[WIFI_PASS_MAX] = '\0';
+
+    const int writes = s_writes;
+    CHECK_EQ(wifi_store_add(ssid, "pw"), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(wifi_store_add("x", pass), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(wifi_store_add("", "pw"), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(wifi_store_add(NULL, "pw"), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(wifi_store_add("x", NULL), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(s_writes, writes);
+
+    ssid[WIFI_SSID_MAX - 1] = pass[WIFI_PASS_MAX - 1] = '\0';
+    CHECK_EQ(wifi_store_add(ssid, pass), ESP_OK);
+    CHECK_STR(pass_of(ssid), pass);
+    CHECK_EQ(wifi_store_remove(ssid), ESP_OK);
+}
+
+static void test_reload(void)
+{
+    // What was written comes back in the same order
+    const char* before = strdup(order());
+    memset(&s_store, 0, sizeof(s_store));
+    wifi_store_init();
+    CHECK_STR(order(), before);
+    free((void*)before);
+
+    // A damaged blob is not loaded
+    s_blob[offsetof(store_t, count)] = WIFI_STORE_MAX + 1;
+    memset(&s_store, 0, sizeof(s_store));
+    wifi_store_init();
+    CHECK_EQ(wifi_store_count(), 0);
+    s_blob[offsetof(store_t, count)] = 3;
+    s_blob_len = sizeof(store_t) - 1;
+    wifi_store_init();
+    CHECK_EQ(wifi_store_count(), 0);
+}
+
+static void test_console(void)
+{
+    s_blob_len = 0;
+    memset(&s_store, 0, sizeof(s_store));
+    wifi_store_console(" add Home secret");
+    wifi_store_console(" add \"Cafe Wifi\" two words ");
+    wifi_store_console(" add Library");
+    CHECK_STR(order(), "Library,Cafe Wifi,Home");
+    CHECK_STR(pass_of("Home"), "secret");
+    CHECK_STR(pass_of("Cafe Wifi"), "two words ");
+    CHECK_STR(pass_of("Library"), "");
+
+    // Malformed lines change nothing
+    wifi_store_console(" add");
+    wifi_store_console(" add \"Unclosed pw");
+    wifi_store_console(" add \"\" pw");
+    wifi_store_console(" rm");
+    wifi_store_console(" rm Nowhere");
+    wifi_store_console(" drop Home");
+    wifi_store_console("");
+    CHECK_STR(order(), "Library,Cafe Wifi,Home");
+
+    wifi_store_console(" rm \"Cafe Wifi\"");
+    wifi_store_console(" list");
+    CHECK_STR(order(), "Library,Home");
+}
+
+int main(void)
+{
+    test_order();
+    test_limits();
+    test_reload();
+    test_console();
+    return test_report("test_wifi_store");
+}
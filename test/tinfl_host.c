@@ -0,0 +1,105 @@
+// tinfl_decompress on zlib, for host tests of code written against the ROM tinfl.
+// Status codes and flags follow tinfl; the difference that matters is the end of
+// the stream, see rom/miniz.h.
+#include <string.h>
+
+#include <rom/miniz.h>
+
+unsigned tinfl_host_lookahead = 4;
+
+static voidpf arena_alloc(voidpf opaque, uInt items, uInt size)
+{
+    tinfl_decompressor* r = opaque;
+    const size_t n = ((size_t)items * size + 15) & ~(size_t)15;
+    if (n > sizeof(r->m_arena) - r->m_arena_used) return Z_NULL;
+    void* p = r->m_arena + r->m_arena_used;
+    r->m_arena_used += n;
+    return p;
+}
+
+static void arena_free(voidpf opaque, voidpf p) {}
+
+static void remember(tinfl_decompressor* r, const uint8_t* in, size_t n)
+{
+    const size_t keep = sizeof(r->m_recent);
+    if (n >= keep) {
+        memcpy(r->m_recent, in + n - keep, keep);
+    } else {
+        memmove(r->m_recent, r->m_recent + n, keep - n);
+        memcpy(r->m_recent + keep - n, in, n);
+    }
+}
+
+// zlib has stopped right after the deflate data, holding only data_type's unused
+// bits. Take more input into the bit buffer, as tinfl's refill would have.
+static size_t hold_back(tinfl_decompressor* r, const uint8_t* next, size_t avail)
+{
+    const unsigned unused = (unsigned)r->m_zs.data_type & 63;
+    const unsigned held = unused >> 3;
+    size_t extra = 0;
+    if (tinfl_host_lookahead > held) {
+        extra = tinfl_host_lookahead - held;
+        if (extra > avail) extra = avail;
+    }
+
+    uint8_t bytes[16];
+    memcpy(bytes, r->m_recent + sizeof(r->m_recent) - held, held);
+    memcpy(bytes + held, next, extra);
+
+    r->m_num_bits = unused + 8 * (unsigned)extra;
+    r->m_bit_buf = 0;
+    for (size_t i = 0; i < held + extra; i++) {
+        r->m_bit_buf |= (tinfl_bit_buf_t)bytes[i] << ((unused & 7) + 8 * i);
+    }
+    return extra;
+}
+
+tinfl_status tinfl_decompress(tinfl_decompressor* r, const uint8_t* pIn_buf_next, size_t* pIn_buf_size,
+                              uint8_t* pOut_buf_start, uint8_t* pOut_buf_next, size_t* pOut_buf_size,
+                              const mz_uint32 decomp_flags)
+{
+    if (r->m_state == 2) {
+        *pIn_buf_size = *pOut_buf_size = 0;
+        return TINFL_STATUS_DONE;
+    }
+    if (r->m_state == 3) {
+        *pIn_buf_size = *pOut_buf_size = 0;
+        return TINFL_STATUS_FAILED;
+    }
+    if (r->m_state == 0) {
+        memset(&r->m_zs, 0, sizeof(r->m_zs));
+        r->m_zs.zalloc = arena_alloc;
+        r->m_zs.zfree = arena_free;
+        r->m_zs.opaque = r;
+        r->m_arena_used = 0;
+        r->m_num_bits = 0;
+        r->m_bit_buf = 0;
+        const int wbits = (decomp_flags & TINFL_FLAG_PARSE_ZLIB_HEADER) ? 15 : -15;
+        if (inflateInit2(&r->m_zs, wbits) != Z_OK) return TINFL_STATUS_BAD_PARAM;
+        r->m_state = 1;
+    }
+
+    r->m_zs.next_in = (Bytef*)pIn_buf_next;
+    r->m_zs.avail_in = (uInt)*pIn_buf_size;
+    r->m_zs.next_out = pOut_buf_next;
+    r->m_zs.avail_out = (uInt)*pOut_buf_size;
+    const int ret = inflate(&r->m_zs, Z_NO_FLUSH);
+
+    size_t in_used = *pIn_buf_size - r->m_zs.avail_in;
+    remember(r, pIn_buf_next, in_used);
+    *pOut_buf_size -= r->m_zs.avail_out;
+
+    if (ret == Z_STREAM_END) {
+        in_used += hold_back(r, r->m_zs.next_in, r->m_zs.avail_in);
+        *pIn_buf_size = in_used;
+        r->m_state = 2;
+        return TINFL_STATUS_DONE;
+    }
+    *pIn_buf_size = in_used;
+    if (ret != Z_OK && ret != Z_BUF_ERROR) {
+        r->m_state = 3;
+        return (ret == Z_DATA_ERROR) ? TINFL_STATUS_FAILED : TINFL_STATUS_BAD_PARAM;
+    }
+    if (r->m_zs.avail_out == 0) return TINFL_STATUS_HAS_MORE_OUTPUT;
+    return (decomp_flags & TINFL_FLAG_HAS_MORE_INPUT) ? TINFL_STATUS_NEEDS_MORE_INPUT : TINFL_STATUS_FAILED;
+}
@@ -0,0 +1,75 @@
+import struct
+import sys
+
+# Session traces from main/trace.c. Type '`x' on the device console to dump the
+# current trace between TRACE BEGIN / TRACE END lines, then:
+#   python trace_tool.py extract serial.log session.trc   # dump -> binary
+#   python trace_tool.py list session.trc                  # one line per event
+#   python trace_tool.py send session.trc > /dev/ttyUSB0   # after typing '`l'
+# or replay it on the host with the test project's build-test/replay_host session.trc
+
+MAGIC = b"TRC\x01"
+TYPES = {1: "key", 2: "dht20", 3: "weather", 4: "geo"}
+LINE = 32
+
+
+def read_events(blob):
+    if blob[:4] != MAGIC:
+        sys.exit("not a trace")
+    pos = 4
+    while pos + 7 <= len(blob):
+        t_ms, kind, n = struct.unpack_from("<IBH", blob, pos)
+        pos += 7
+        yield t_ms, kind, blob[pos:pos + n]
+        pos += n
+
+
+def extract(log_path, out_path):
+    hex_lines, inside = [], False
+    with open(log_path, errors="replace") as f:
+        for line in f:
+            line = line.strip()
+            if line.startswith("TRACE BEGIN"):
+                hex_lines, inside = [], True
+            elif line == "TRACE END":
+                inside = False
+            elif inside:
+                hex_lines.append(line)
+    if not hex_lines:
+        sys.exit(f"no trace dump in {log_path}")
+    blob = bytes.fromhex("".join(hex_lines))  # the last dump wins
+    with open(out_path, "wb") as f:
+        f.write(blob)
+    print(f"wrote {out_path}: {len(blob)} bytes")
+
+
+def list_events(path):
+    with open(path, "rb") as f:
+        blob = f.read()
+    for t_ms, kind, data in read_events(blob):
+        name = TYPES.get(kind, f"type{kind}")
+        shown = data.hex(" ") if kind in (1, 2) else data[:48].decode(errors="replace")
+        print(f"{t_ms / 1000:9.3f}s {name:8} {len(data):5}  {shown}")
+
+
+def send(path):
+    with open(path, "rb") as f:
+        blob = f.read()
+    for i in range(0, len(blob), LINE):
+        sys.stdout.write(blob[i:i + LINE].hex() + "\n")
+    sys.stdout.write(".\n")
+
+
+def main():
+    if len(sys.argv) >= 4 and sys.argv[1] == "extract":
+        extract(sys.argv[2], sys.argv[3])
+    elif len(sys.argv) >= 3 and sys.argv[1] == "list":
+        list_events(sys.argv[2])
+    elif len(sys.argv) >= 3 and sys.argv[1] == "send":
+        send(sys.argv[2])
+    else:
+        sys.exit("usage: trace_tool.py extract <log> <out.trc> | list <trace> | send <trace>")
+
+
+if __name__ == "__main__":
+    main()